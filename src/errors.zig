@@ -36,6 +36,7 @@ pub const LexborError = error{
     CssSelectorsInitFailed,
     CssSelectorParseFailed,
     CssSelectorFindFailed,
+    CssStylesheetParseFailed,
     CssEngineNotInitialized,
     SetAttributeFailed,
     CreateCommentFailed,
@@ -52,4 +53,13 @@ pub const LexborError = error{
     SerializationFailed,
     DocumentRootNotFound,
     DomException,
+    UrlParserCreateFailed,
+    UrlParserInitFailed,
+    UrlParseFailed,
+    IdnaInitFailed,
+    IdnaFailed,
+    TooManyObservers,
+    TooManyNeedles,
+    XPathParseFailed,
+    XPathAttributeResult,
 };
@@ -35,6 +35,25 @@ pub fn main() !void {
     try demoNormalizer(gpa);
     try normalizeString_DOM_parsing_bencharmark(gpa);
     try serverSideRenderingBenchmark(gpa);
+    try linkExtractionBenchmark(gpa);
+    try urlNormalizationBenchmark(gpa);
+    try inlineStylesBenchmark(gpa);
+    try domNavigationBenchmark(gpa);
+    try flatDomBenchmark(gpa);
+    try compactDocumentBenchmark(gpa);
+    try forkDocumentBenchmark(gpa);
+    try serializeCacheBenchmark(gpa);
+    try queryResultCacheBenchmark(gpa);
+    try serializeMatchesBenchmark(gpa);
+    try prettyPrintBenchmark(gpa);
+    try markdownBenchmark(gpa);
+    try canonicalHashBenchmark(gpa);
+    try structuredDataBenchmark(gpa);
+    try tableExtractionBenchmark(gpa);
+    try findTextBenchmark(gpa);
+    try xpathBenchmark(gpa);
+    try formBenchmark(gpa);
+    try streamPoolBenchmark(gpa);
 }
 
 /// use `parseString` or `createDocFromString` to create a document with a BODY element populated by the input string
@@ -1435,3 +1454,1250 @@ fn serverSideRenderingBenchmark(allocator: std.mem.Allocator) !void {
     z.print("• Parser reused across multiple requests\n", .{});
     z.print("• Malicious content is sanitized for security\n", .{});
 }
+
+/// Generates a large synthetic page for the benchmarks: navigation, articles with links,
+/// `srcset` images, lists, a table, code blocks, a form and a footer, repeated `sections` times.
+///
+/// Caller needs to free the slice
+fn generateBenchmarkPage(allocator: std.mem.Allocator, sections: usize) ![]u8 {
+    var html: std.ArrayList(u8) = .empty;
+    errdefer html.deinit(allocator);
+    try html.ensureTotalCapacity(allocator, sections * 1_600 + 1_024);
+
+    try html.appendSlice(allocator,
+        \\<!DOCTYPE html>
+        \\<html lang="en"><head><meta charset="UTF-8"/><title>Benchmark page</title>
+        \\<base href="/site/">
+        \\<link rel="stylesheet" href="css/main.css"/>
+        \\<style>.post { margin: 0 } .post-title { color: #333 } #main p { line-height: 1.5 }</style>
+        \\<script src="js/app.js"></script>
+        \\</head><body>
+        \\<nav class="site-nav"><ul><li><a href="/">Home</a></li><li><a href="/blog/">Blog</a></li><li><a href="https://example.org/about">About</a></li></ul></nav>
+        \\<main id="main">
+        \\
+    );
+
+    var w = std.Io.Writer.Allocating.fromArrayList(allocator, &html);
+    defer html = w.toArrayList();
+    const writer = &w.writer;
+
+    for (0..sections) |i| {
+        try writer.print(
+            \\<article class="post" id="post-{d}">
+            \\  <h2 class="post-title">Post number {d}</h2>
+            \\  <p>Some <strong>bold</strong> and <em>emphasised</em> text with a <a href="posts/{d}.html">link</a>
+            \\  and an <a href="../archive/{d}/">archive</a> reference, plus <code>inline code</code>.</p>
+            \\  <img src="img/{d}.png" srcset="img/{d}-1x.png 1x, img/{d}-2x.png 2x" alt="Picture {d}">
+            \\  <ul><li>First item</li><li>Second <a href="#post-{d}">item</a></li><li>Third item</li></ul>
+            \\  <table><thead><tr><th>Name</th><th>Value</th></tr></thead>
+            \\  <tbody><tr><td>alpha</td><td>{d}</td></tr><tr><td colspan="2">total</td></tr></tbody></table>
+            \\  <pre><code>const x = {d};
+            \\return x * 2;</code></pre>
+            \\</article>
+            \\
+        , .{ i, i, i, i, i, i, i, i, i, i, i });
+    }
+
+    try writer.writeAll(
+        \\</main>
+        \\<form action="/subscribe" method="post"><input type="email" name="email" value="a@b.c"><button type="submit">Subscribe</button></form>
+        \\<footer><p>Copyright 2025 - <a href="/legal">Legal</a></p></footer>
+        \\</body></html>
+    );
+
+    return w.toOwnedSlice();
+}
+
+/// Link extraction: `querySelectorAll` + attribute reads + string joins vs one-walk `LinkExtractor`
+fn linkExtractionBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== LINK EXTRACTION BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 1_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    const page_url = "https://www.example.com/blog/index.html";
+    const iterations = 50;
+    const ns_to_ms: f64 = 1_000_000.0;
+    z.print("HTML size: {d:.1} KB, iterations: {d}\n", .{ @as(f64, @floatFromInt(html.len)) / 1024.0, iterations });
+
+    // A: one querySelectorAll per URL-bearing selector, naive string join with the page directory
+    var timer = try std.time.Timer.start();
+    var count_a: usize = 0;
+    const selectors = [_][2][]const u8{
+        .{ "a[href]", "href" },
+        .{ "link[href]", "href" },
+        .{ "img[src]", "src" },
+        .{ "script[src]", "src" },
+        .{ "form[action]", "action" },
+    };
+    for (0..iterations) |_| {
+        for (selectors) |sel| {
+            const elements = try z.querySelectorAll(allocator, doc, sel[0]);
+            defer allocator.free(elements);
+            for (elements) |element| {
+                const value = z.getAttribute_zc(element, sel[1]) orelse continue;
+                const joined = try std.mem.concat(allocator, u8, &.{ "https://www.example.com/blog/", value });
+                allocator.free(joined);
+                count_a += 1;
+            }
+        }
+    }
+    const ms_a = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    // B: single walk, WHATWG resolution with lexbor/url, cached base URL, arena output
+    timer.reset();
+    var extractor = try z.LinkExtractor.init(allocator);
+    defer extractor.deinit();
+    var count_b: usize = 0;
+    for (0..iterations) |_| {
+        var links = try extractor.extract(allocator, doc, page_url, .{});
+        defer links.deinit();
+        count_b += links.items.len;
+    }
+    const ms_b = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    z.print("querySelectorAll + join (no srcset, unresolved): {d:.2} ms/doc, {d:.0} links/sec\n", .{
+        ms_a / iterations,
+        @as(f64, @floatFromInt(count_a)) * 1000.0 / ms_a,
+    });
+    z.print("LinkExtractor (resolved, srcset):                {d:.2} ms/doc, {d:.0} links/sec\n", .{
+        ms_b / iterations,
+        @as(f64, @floatFromInt(count_b)) * 1000.0 / ms_b,
+    });
+}
+
+/// URL normalization and dedupe throughput on generated crawler-like URLs (many duplicates, IDN hosts)
+fn urlNormalizationBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== URL NORMALIZATION BENCHMARK ===\n", .{});
+
+    const count = 200_000;
+    const hosts = [_][]const u8{ "Example.COM", "www.example.com:443", "Bücher.example", "xn--bcher-kva.example", "CDN.example.org" };
+    const paths = [_][]const u8{ "/a/./b/../c", "/blog/post", "/img/x.png", "/search", "/" };
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const inputs = try arena.allocator().alloc([]const u8, count);
+    for (inputs, 0..) |*input, i| {
+        input.* = try std.fmt.allocPrint(arena.allocator(), "HTTPS://{s}{s}?id={d}&ref=x#frag", .{
+            hosts[i % hosts.len],
+            paths[(i / hosts.len) % paths.len],
+            i % 5_000,
+        });
+    }
+
+    const ns_to_ms: f64 = 1_000_000.0;
+    var timer = try std.time.Timer.start();
+
+    var normalizer = try z.UrlNormalizer.init(allocator, .{ .sort_query = true });
+    defer normalizer.deinit();
+    var total_len: usize = 0;
+    for (inputs) |input| {
+        total_len += (try normalizer.normalize(input)).len;
+    }
+    const ms_norm = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    var set = try z.UrlSet.init(allocator, .{ .sort_query = true });
+    defer set.deinit();
+    for (inputs) |input| {
+        _ = try set.add(input);
+    }
+    const ms_set = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    z.print("normalize:       {d:.0} URLs/sec ({d} bytes out)\n", .{ count * 1000.0 / ms_norm, total_len });
+    z.print("normalize+dedupe: {d:.0} URLs/sec ({d} unique of {d})\n", .{ count * 1000.0 / ms_set, set.count(), count });
+}
+
+/// CSS inlining of a ~200 KB newsletter with ~1k rules:
+/// one `querySelectorAll` per rule with naive `style` concatenation vs the indexed `CssInliner`
+fn inlineStylesBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== CSS INLINER BENCHMARK ===\n", .{});
+
+    const sections = 130;
+    const page = try generateBenchmarkPage(allocator, sections);
+    defer allocator.free(page);
+
+    var css: std.ArrayList(u8) = .empty;
+    defer css.deinit(allocator);
+    var rules: std.ArrayList([2][]const u8) = .empty;
+    defer rules.deinit(allocator);
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const a = arena.allocator();
+
+    for (0..1_000) |i| {
+        const rule: [2][]const u8 = switch (i % 4) {
+            0 => .{ try std.fmt.allocPrint(a, "#post-{d} .post-title", .{(i / 4) % sections}), try std.fmt.allocPrint(a, "color: #{x:0>6}", .{i * 4_099}) },
+            1 => .{ try std.fmt.allocPrint(a, ".filler-{d}", .{i}), try std.fmt.allocPrint(a, "padding: {d}px", .{i}) },
+            2 => .{ try std.fmt.allocPrint(a, ".post ul li:nth-child({d})", .{i % 3 + 1}), try std.fmt.allocPrint(a, "margin: {d}px", .{i % 7}) },
+            else => .{ try std.fmt.allocPrint(a, "table td.c{d}, tr > td", .{i}), "border: 1px solid #ccc" },
+        };
+        try rules.append(allocator, rule);
+        try css.print(allocator, "{s} {{ {s} }}\n", .{ rule[0], rule[1] });
+    }
+    try css.appendSlice(allocator, "a:hover { color: red }\n@media (max-width: 600px) { .post { padding: 0 } }\n");
+
+    const head_end = std.mem.indexOf(u8, page, "</head>").?;
+    const html = try std.mem.concat(allocator, u8, &.{ page[0..head_end], "<style>", css.items, "</style>", page[head_end..] });
+    defer allocator.free(html);
+
+    const iterations = 5;
+    const ns_to_ms: f64 = 1_000_000.0;
+    z.print("HTML size: {d:.1} KB, rules: {d}, iterations: {d}\n", .{ @as(f64, @floatFromInt(html.len)) / 1024.0, rules.items.len, iterations });
+
+    // A: one querySelectorAll per rule, declarations appended to the `style` attribute (no cascade)
+    var engine = try z.CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+    var ns_a: u64 = 0;
+    for (0..iterations) |_| {
+        const doc = try z.createDocFromString(html);
+        defer z.destroyDocument(doc);
+        const body = z.bodyNode(doc).?;
+
+        var timer = try std.time.Timer.start();
+        for (rules.items) |rule| {
+            const nodes = try engine.querySelectorAll(body, rule[0]);
+            defer allocator.free(nodes);
+            for (nodes) |node| {
+                const element = z.nodeToElement(node) orelse continue;
+                const old = z.getAttribute_zc(element, "style") orelse "";
+                const style = try std.mem.concat(allocator, u8, &.{ old, "; ", rule[1] });
+                defer allocator.free(style);
+                _ = z.setAttribute(element, "style", style);
+            }
+        }
+        ns_a += timer.read();
+    }
+
+    // B: indexed rules, one match per candidate rule, cascade merge
+    var inliner = try z.CssInliner.init(allocator);
+    defer inliner.deinit();
+    var ns_b: u64 = 0;
+    var stats: z.InlineStats = .{};
+    for (0..iterations) |_| {
+        const doc = try z.createDocFromString(html);
+        defer z.destroyDocument(doc);
+
+        var timer = try std.time.Timer.start();
+        stats = try inliner.inlineDocument(doc, .{});
+        ns_b += timer.read();
+    }
+
+    const ms_a = @as(f64, @floatFromInt(ns_a)) / ns_to_ms / iterations;
+    const ms_b = @as(f64, @floatFromInt(ns_b)) / ns_to_ms / iterations;
+    z.print("querySelectorAll per rule: {d:.2} ms/doc\n", .{ms_a});
+    z.print("CssInliner:                {d:.2} ms/doc ({d} elements styled, {d} residual rules), {d:.1}x\n", .{
+        ms_b,
+        stats.styled,
+        stats.residual_rules,
+        ms_a / ms_b,
+    });
+}
+
+// `_noi` exports used by the navigation helpers before the layout mirrors, kept for comparison
+extern "c" fn lxb_dom_node_first_child_noi(node: *z.DomNode) ?*z.DomNode;
+extern "c" fn lxb_dom_node_next_noi(node: *z.DomNode) ?*z.DomNode;
+extern "c" fn lxb_dom_node_parent_noi(node: *z.DomNode) ?*z.DomNode;
+
+/// Pre-order walk counting `<a>` elements, one C call per step, tag read through `tagName_zc`
+fn countLinksNoi(root: *z.DomNode) usize {
+    var count: usize = 0;
+    var node = lxb_dom_node_first_child_noi(root);
+    while (node) |current| {
+        const name = z.nodeName_zc(current);
+        if (name.len > 0 and name[0] != '#') {
+            if (std.mem.eql(u8, z.tagName_zc(@ptrCast(current)), "A")) count += 1;
+        }
+        if (lxb_dom_node_first_child_noi(current)) |child| {
+            node = child;
+            continue;
+        }
+        var up: ?*z.DomNode = current;
+        node = null;
+        while (up) |n| : (up = lxb_dom_node_parent_noi(n)) {
+            if (n == root) break;
+            if (lxb_dom_node_next_noi(n)) |next| {
+                node = next;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+/// Same walk with the inlined field reads
+fn countLinksInline(root: *z.DomNode) usize {
+    const lxb_tag_a = 0x0006; // LXB_TAG_A
+    var count: usize = 0;
+    var node = z.firstChild(root);
+    while (node) |current| {
+        if (z.nodeType(current) == .element and z.nodeTagId(current) == lxb_tag_a) count += 1;
+        if (z.firstChild(current)) |child| {
+            node = child;
+            continue;
+        }
+        var up: ?*z.DomNode = current;
+        node = null;
+        while (up) |n| : (up = z.parentNode(n)) {
+            if (n == root) break;
+            if (z.nextSibling(n)) |next| {
+                node = next;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+/// DOM navigation: `_noi` C calls vs inlined `extern struct` field reads
+fn domNavigationBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== DOM NAVIGATION BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 2_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const root = z.documentRoot(doc).?;
+    const body = z.bodyNode(doc).?;
+
+    const iterations = 50;
+    const ns_to_ms: f64 = 1_000_000.0;
+    z.print("HTML size: {d:.1} KB, iterations: {d}\n", .{ @as(f64, @floatFromInt(html.len)) / 1024.0, iterations });
+
+    var timer = try std.time.Timer.start();
+    var links_noi: usize = 0;
+    for (0..iterations) |_| links_noi += countLinksNoi(root);
+    const ms_noi = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    var links_inline: usize = 0;
+    for (0..iterations) |_| links_inline += countLinksInline(root);
+    const ms_inline = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.debug.assert(links_noi == links_inline);
+
+    z.print("walk, _noi calls + tag name:   {d:.3} ms/walk\n", .{ms_noi / iterations});
+    z.print("walk, field reads + tag id:    {d:.3} ms/walk ({d:.1}x)\n", .{ ms_inline / iterations, ms_noi / ms_inline });
+
+    // search helpers built on `nodeToElement` / `nodeType`, last element of the page
+    timer.reset();
+    var found: usize = 0;
+    for (0..iterations) |_| {
+        if (z.getElementById(body, "post-1999") != null) found += 1;
+        if (z.getElementByTag(body, .footer) != null) found += 1;
+    }
+    const ms_search = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    z.print("getElementById + getElementByTag: {d:.3} ms/search ({d} found)\n", .{ ms_search / (2 * iterations), found });
+}
+
+/// `FlatDom`: build cost, then tag / class / text queries against the live-DOM equivalents
+fn flatDomBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== FLAT DOM BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 2_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    const iterations = 20;
+    const ns_to_ms: f64 = 1_000_000.0;
+    z.print("HTML size: {d:.1} KB, iterations: {d}\n", .{ @as(f64, @floatFromInt(html.len)) / 1024.0, iterations });
+
+    var timer = try std.time.Timer.start();
+    for (0..iterations - 1) |_| {
+        var flat = try z.FlatDom.build(allocator, doc);
+        flat.deinit();
+    }
+    var flat = try z.FlatDom.build(allocator, doc);
+    defer flat.deinit();
+    const ms_build = @as(f64, @floatFromInt(timer.read())) / ns_to_ms / iterations;
+    z.print("build: {d:.2} ms ({d} nodes, {d} attributes, {d:.1} KB strings)\n", .{
+        ms_build,
+        flat.len(),
+        flat.attributes.len,
+        @as(f64, @floatFromInt(flat.strings.len)) / 1024.0,
+    });
+
+    // 1. tag scan
+    timer.reset();
+    var live_tags: usize = 0;
+    for (0..iterations) |_| {
+        const elements = try z.getElementsByTagName(allocator, doc, "A");
+        live_tags += elements.len;
+        allocator.free(elements);
+    }
+    const ms_live_tags = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    const tag_a = flat.tagId("a").?;
+    var flat_tags: usize = 0;
+    for (0..iterations) |_| flat_tags += flat.countTag(tag_a, flat.all());
+    const ms_flat_tags = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    // 2. class scan
+    timer.reset();
+    var live_classes: usize = 0;
+    for (0..iterations) |_| {
+        const elements = try z.getElementsByClassName(allocator, doc, "post-title");
+        live_classes += elements.len;
+        allocator.free(elements);
+    }
+    const ms_live_classes = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    var flat_classes: usize = 0;
+    for (0..iterations) |_| {
+        var it = flat.classIterator("post-title", flat.all());
+        while (it.next()) |_| flat_classes += 1;
+    }
+    const ms_flat_classes = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    // 3. text of every <article>
+    const articles = try z.getElementsByTagName(allocator, doc, "ARTICLE");
+    defer allocator.free(articles);
+
+    timer.reset();
+    var live_text: usize = 0;
+    for (0..iterations) |_| {
+        for (articles) |article| {
+            const text = try z.textContent(allocator, z.elementToNode(article));
+            live_text += text.len;
+            allocator.free(text);
+        }
+    }
+    const ms_live_text = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    const tag_article = flat.tagId("article").?;
+    var flat_text: usize = 0;
+    for (0..iterations) |_| {
+        var it = flat.tagIterator(tag_article, flat.all());
+        while (it.next()) |i| {
+            out.clearRetainingCapacity();
+            try flat.textContent(i, &out.writer);
+            flat_text += out.written().len;
+        }
+    }
+    const ms_flat_text = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    std.debug.assert(live_tags == flat_tags and live_classes == flat_classes and live_text == flat_text);
+
+    z.print("tag <a>:          live {d:.3} ms, flat {d:.3} ms ({d:.0}x)\n", .{ ms_live_tags / iterations, ms_flat_tags / iterations, ms_live_tags / ms_flat_tags });
+    z.print("class post-title: live {d:.3} ms, flat {d:.3} ms ({d:.0}x)\n", .{ ms_live_classes / iterations, ms_flat_classes / iterations, ms_live_classes / ms_flat_classes });
+    z.print("article text:     live {d:.3} ms, flat {d:.3} ms ({d:.1}x)\n", .{ ms_live_text / iterations, ms_flat_text / iterations, ms_live_text / ms_flat_text });
+    z.print("build amortized after {d:.1} tag+class+text query rounds\n", .{
+        ms_build / ((ms_live_tags + ms_live_classes + ms_live_text - ms_flat_tags - ms_flat_classes - ms_flat_text) / iterations),
+    });
+}
+
+/// Traversal and selector timings on a mutated ~50k-node document, before and after `compactDocument`
+fn compactDocumentBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== DOCUMENT COMPACTION BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 1_200);
+    defer allocator.free(html);
+    var doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    // scatter: new nodes between the parsed ones, attributes rewritten, half the <strong> removed
+    const items = try z.getElementsByTagName(allocator, doc, "LI");
+    defer allocator.free(items);
+    for (items, 0..) |item, i| {
+        const span = try z.createElement(doc, "span");
+        try z.setContentAsText(z.elementToNode(span), "inserted");
+        z.insertBefore(z.elementToNode(item), z.elementToNode(span));
+        _ = z.setAttribute(item, "data-index", if (i % 2 == 0) "even" else "odd");
+    }
+    const strongs = try z.getElementsByTagName(allocator, doc, "STRONG");
+    defer allocator.free(strongs);
+    for (strongs, 0..) |strong, i| {
+        if (i % 2 == 0) {
+            z.removeNode(z.elementToNode(strong));
+            z.destroyNode(z.elementToNode(strong));
+        }
+    }
+
+    var engine = try z.CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+    const iterations = 30;
+    const ns_to_ms: f64 = 1_000_000.0;
+
+    const before = try timeTraversals(allocator, doc, &engine, iterations);
+
+    var timer = try std.time.Timer.start();
+    var compacted = try z.compactDocument(allocator, doc, .{});
+    defer compacted.deinit();
+    const ms_compact = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    doc = compacted.document;
+
+    const after = try timeTraversals(allocator, doc, &engine, iterations);
+
+    z.print("nodes: {d}, compaction (with remap): {d:.2} ms\n", .{ compacted.remap.count(), ms_compact });
+    z.print("walk:     {d:.3} -> {d:.3} ms ({d:.2}x)\n", .{ before[0] / iterations, after[0] / iterations, before[0] / after[0] });
+    z.print("selector: {d:.3} -> {d:.3} ms ({d:.2}x)\n", .{ before[1] / iterations, after[1] / iterations, before[1] / after[1] });
+}
+
+/// Per-request rendering from a shared layout: re-parse vs in-document deep clone vs `forkDocument`
+/// (a deep import into a fresh document), each followed by the same mutation and serialization
+fn forkDocumentBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== DOCUMENT FORK BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 20);
+    defer allocator.free(html);
+    const base = try z.createDocFromString(html);
+    defer z.destroyDocument(base);
+
+    const iterations = 2_000;
+    const ns_to_ms: f64 = 1_000_000.0;
+    var bytes: usize = 0;
+
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |i| {
+        const doc = try z.createDocFromString(html);
+        defer z.destroyDocument(doc);
+        bytes += try renderRequest(allocator, z.documentRoot(doc).?, i);
+    }
+    const ms_parse = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    for (0..iterations) |i| {
+        const root = z.cloneNode(z.documentRoot(base).?) orelse return error.CloneFailed;
+        defer z.destroyNode_deep(root);
+        bytes += try renderRequest(allocator, root, i);
+    }
+    const ms_clone = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    for (0..iterations) |i| {
+        const doc = try z.forkDocument(base);
+        defer z.destroyDocument(doc);
+        bytes += try renderRequest(allocator, z.documentRoot(doc).?, i);
+    }
+    const ms_fork = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.mem.doNotOptimizeAway(bytes);
+
+    z.print("layout: {d} bytes, {d} requests\n", .{ html.len, iterations });
+    z.print("parse from string:          {d:.3} ms/req\n", .{ms_parse / iterations});
+    z.print("deep cloneNode:             {d:.3} ms/req\n", .{ms_clone / iterations});
+    z.print("forkDocument (deep import): {d:.3} ms/req ({d:.2}x vs parse)\n", .{ ms_fork / iterations, ms_parse / ms_fork });
+}
+
+/// Fills one post of the layout and serializes the page, returns the serialized size
+fn renderRequest(allocator: std.mem.Allocator, root: *z.DomNode, request: usize) !usize {
+    const post = z.getElementById(root, "post-3") orelse return error.ElementNotFound;
+    _ = z.setAttribute(post, "class", "post current");
+    var buf: [32]u8 = undefined;
+    const title = try std.fmt.bufPrint(&buf, "Request {d}", .{request});
+    try z.setContentAsText(z.elementToNode(z.firstElementChild(post).?), title);
+
+    const page = try z.outerNodeHTML(allocator, root);
+    defer allocator.free(page);
+    return page.len;
+}
+
+/// "Mutate one node, reserialize" on a ~2 MB page: lexbor string vs streaming vs `SerializeCache`
+fn serializeCacheBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== SERIALIZATION CACHE BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 2_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const root = z.documentRoot(doc).?;
+
+    const posts = try z.getElementsByTagName(allocator, doc, "ARTICLE");
+    defer allocator.free(posts);
+
+    // `outerNodeHTML` builds its string in the document's memory: few rounds
+    const iterations = 20;
+    const ns_to_ms: f64 = 1_000_000.0;
+    var prng = std.Random.DefaultPrng.init(42);
+    const random = prng.random();
+    var bytes: usize = 0;
+
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |_| {
+        _ = z.setAttribute(posts[random.uintLessThan(usize, posts.len)], "data-seen", "1");
+        const page = try z.outerNodeHTML(allocator, root);
+        defer allocator.free(page);
+        bytes += page.len;
+    }
+    const ms_string = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+
+    timer.reset();
+    for (0..iterations) |_| {
+        _ = z.setAttribute(posts[random.uintLessThan(usize, posts.len)], "data-seen", "2");
+        out.clearRetainingCapacity();
+        try z.serializeTo(root, &out.writer);
+        bytes += out.written().len;
+    }
+    const ms_stream = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    var cache = z.SerializeCache.init(allocator, doc, .{});
+    defer cache.deinit();
+    out.clearRetainingCapacity();
+    timer.reset();
+    try cache.serializeTo(root, &out.writer);
+    const ms_fill = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    for (0..iterations) |_| {
+        _ = z.setAttribute(posts[random.uintLessThan(usize, posts.len)], "data-seen", "3");
+        out.clearRetainingCapacity();
+        try cache.serializeTo(root, &out.writer);
+        bytes += out.written().len;
+    }
+    const ms_cached = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.mem.doNotOptimizeAway(bytes);
+
+    z.print("page: {d} bytes, cache: {d} subtrees / {d} bytes (first fill {d:.2} ms)\n", .{ out.written().len, cache.stats.entries, cache.stats.bytes, ms_fill });
+    z.print("outerNodeHTML:         {d:.3} ms/op\n", .{ms_string / iterations});
+    z.print("serializeTo:           {d:.3} ms/op\n", .{ms_stream / iterations});
+    z.print("SerializeCache:        {d:.3} ms/op ({d:.1}x vs outerNodeHTML)\n", .{ ms_cached / iterations, ms_string / ms_cached });
+}
+
+/// Repeated `querySelectorAll(".post-title")` on a mostly unchanged page, with and without the result cache
+fn queryResultCacheBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== QUERY RESULT CACHE BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 200);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+    const titles = try z.getElementsByTagName(allocator, doc, "H2");
+    defer allocator.free(titles);
+
+    const iterations = 1_000;
+    // one mutation every `mutate_every` queries
+    const mutate_every = 100;
+    const ns_to_ms: f64 = 1_000_000.0;
+    var found: usize = 0;
+
+    var engine = try z.CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |i| {
+        if (i % mutate_every == 0) _ = z.setAttribute(titles[i % titles.len], "data-round", "1");
+        const nodes = try engine.querySelectorAll(body, ".post-title");
+        defer allocator.free(nodes);
+        found += nodes.len;
+    }
+    const ms_plain = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    try engine.enableResultCache(.{});
+    timer.reset();
+    for (0..iterations) |i| {
+        if (i % mutate_every == 0) _ = z.setAttribute(titles[i % titles.len], "data-round", "2");
+        const nodes = try engine.querySelectorAllShared(body, ".post-title");
+        found += nodes.len;
+    }
+    const ms_cached = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.mem.doNotOptimizeAway(found);
+
+    const stats = engine.resultCacheStats().?;
+    z.print("{d} queries, a mutation every {d}\n", .{ iterations, mutate_every });
+    z.print("querySelectorAll:       {d:.4} ms/query\n", .{ms_plain / iterations});
+    z.print("querySelectorAllShared: {d:.4} ms/query ({d:.1}x), hit rate {d:.1}%, {d} bytes\n", .{
+        ms_cached / iterations,
+        ms_plain / ms_cached,
+        stats.hitRate() * 100,
+        stats.bytes,
+    });
+}
+
+fn serializeMatchesBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== SERIALIZE MATCHES BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 200);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    const iterations = 200;
+    const ns_to_ms: f64 = 1_000_000.0;
+    var bytes: usize = 0;
+
+    var engine = try z.CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+
+    // one `outerHTML` string per match, concatenated
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |_| {
+        var joined: std.ArrayList(u8) = .empty;
+        defer joined.deinit(allocator);
+        const nodes = try engine.querySelectorAll(body, "article.post");
+        defer allocator.free(nodes);
+        for (nodes) |node| {
+            const part = try z.outerHTML(allocator, z.nodeToElement(node).?);
+            defer allocator.free(part);
+            try joined.appendSlice(allocator, part);
+        }
+        bytes += joined.items.len;
+    }
+    const ms_loop = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    // one buffer, reused across responses
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    timer.reset();
+    for (0..iterations) |_| {
+        out.clearRetainingCapacity();
+        _ = try z.serializeMatches(&engine, body, "article.post", &out.writer);
+        bytes += out.written().len;
+    }
+    const ms_stream = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.mem.doNotOptimizeAway(bytes);
+
+    z.print("{d} responses of 200 articles ({d} bytes each)\n", .{ iterations, out.written().len });
+    z.print("outerHTML per match: {d:.3} ms/response\n", .{ms_loop / iterations});
+    z.print("serializeMatches:    {d:.3} ms/response ({d:.1}x)\n", .{ ms_stream / iterations, ms_loop / ms_stream });
+}
+
+fn prettyPrintBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== PRETTY PRINT BENCHMARK ===\n", .{});
+
+    // about 5 MB of HTML
+    const html = try generateBenchmarkPage(allocator, 3_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const root = z.documentRoot(doc).?;
+
+    const iterations = 5;
+    const ns_to_ms: f64 = 1_000_000.0;
+    const bytes_to_mb: f64 = 1024.0 * 1024.0;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+
+    z.print("{d:.1} MB of HTML\n", .{@as(f64, @floatFromInt(html.len)) / bytes_to_mb});
+    for ([_]bool{ true, false }) |colour| {
+        var timer = try std.time.Timer.start();
+        for (0..iterations) |_| {
+            out.clearRetainingCapacity();
+            try z.prettyPrintTo(root, &out.writer, .{ .colour = colour });
+        }
+        const ms = @as(f64, @floatFromInt(timer.read())) / ns_to_ms / iterations;
+        const mb = @as(f64, @floatFromInt(out.written().len)) / bytes_to_mb;
+        z.print("prettyPrintTo, colour {}: {d:.1} ms, {d:.1} MB out ({d:.0} MB/s)\n", .{ colour, ms, mb, mb / (ms / 1000.0) });
+    }
+}
+
+fn markdownBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== MARKDOWN BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 3_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    const iterations = 10;
+    const ns_to_s: f64 = 1_000_000_000.0;
+    const mb: f64 = @as(f64, @floatFromInt(html.len)) / (1024.0 * 1024.0);
+    var bytes: usize = 0;
+
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |_| {
+        const text = try z.textContent(allocator, body);
+        defer allocator.free(text);
+        bytes += text.len;
+    }
+    const s_text = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    timer.reset();
+    for (0..iterations) |_| {
+        out.clearRetainingCapacity();
+        try z.toMarkdown(&out.writer, body, .{});
+        bytes += out.written().len;
+    }
+    const s_markdown = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+    const markdown_kb = out.written().len / 1024;
+
+    timer.reset();
+    for (0..iterations) |_| {
+        out.clearRetainingCapacity();
+        try z.toPlainText(allocator, &out.writer, body, .{ .wrap = 78 });
+        bytes += out.written().len;
+    }
+    const s_plain = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+    std.mem.doNotOptimizeAway(bytes);
+
+    z.print("{d:.1} MB of HTML, {d} KB of Markdown\n", .{ mb, markdown_kb });
+    z.print("textContent: {d:.0} MB/s\n", .{mb * iterations / s_text});
+    z.print("toMarkdown:  {d:.0} MB/s\n", .{mb * iterations / s_markdown});
+    z.print("toPlainText: {d:.0} MB/s\n", .{mb * iterations / s_plain});
+}
+
+fn canonicalHashBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== CANONICAL HASH BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 1_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const articles = try z.getElementsByTagName(allocator, doc, "ARTICLE");
+    defer allocator.free(articles);
+
+    const rounds = 20;
+    const ns_to_s: f64 = 1_000_000_000.0;
+    var checksum: u64 = 0;
+
+    // materialized: canonical string, then hash
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    var timer = try std.time.Timer.start();
+    for (0..rounds) |_| {
+        for (articles) |article| {
+            out.clearRetainingCapacity();
+            try z.canonicalSerializeTo(allocator, z.elementToNode(article), &out.writer, .{});
+            checksum +%= std.hash.Wyhash.hash(0, out.written());
+        }
+    }
+    const s_string = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+
+    timer.reset();
+    for (0..rounds) |_| {
+        for (articles) |article| checksum +%= try z.canonicalHash(allocator, z.elementToNode(article), .{});
+    }
+    const s_stream = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+    std.mem.doNotOptimizeAway(checksum);
+
+    const fragments: f64 = @floatFromInt(rounds * articles.len);
+    z.print("{d} fragments\n", .{rounds * articles.len});
+    z.print("serialize + hash: {d:.2} M fragments/min\n", .{fragments / s_string * 60.0 / 1e6});
+    z.print("canonicalHash:    {d:.2} M fragments/min\n", .{fragments / s_stream * 60.0 / 1e6});
+}
+
+/// A product page with OpenGraph tags, a JSON-LD block and a microdata product with reviews
+fn generateProductPage(allocator: std.mem.Allocator, id: usize) ![]u8 {
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    errdefer out.deinit();
+    const writer = &out.writer;
+
+    try writer.print(
+        \\<!DOCTYPE html>
+        \\<html><head><meta charset="UTF-8"/><title>Product {d}</title>
+        \\<meta property="og:type" content="product">
+        \\<meta property="og:title" content="Widget {d}">
+        \\<meta property="og:url" content="https://shop.example.com/p/{d}">
+        \\<meta property="og:image" content="https://shop.example.com/img/{d}.jpg">
+        \\<meta property="product:price:amount" content="{d}.99">
+        \\<meta name="twitter:card" content="summary_large_image">
+        \\<script type="application/ld+json">
+        \\{{"@context":"https://schema.org","@type":"Product","name":"Widget {d}","sku":"W-{d}",
+        \\ "offers":{{"@type":"Offer","price":"{d}.99","priceCurrency":"EUR"}}}}
+        \\</script>
+        \\<script src="/js/app.js"></script>
+        \\</head><body>
+        \\<nav><ul><li><a href="/">Home</a></li><li><a href="/c/widgets">Widgets</a></li></ul></nav>
+        \\<main itemscope itemtype="https://schema.org/Product">
+        \\  <h1 itemprop="name">Widget {d}</h1>
+        \\  <img itemprop="image" src="/img/{d}.jpg" alt="Widget {d}">
+        \\  <p itemprop="description">A <strong>sturdy</strong> widget, item {d} of the catalog.</p>
+        \\  <div itemprop="offers" itemscope itemtype="https://schema.org/Offer">
+        \\    <meta itemprop="priceCurrency" content="EUR"><span itemprop="price">{d}.99</span>
+        \\    <link itemprop="availability" href="https://schema.org/InStock">In stock
+        \\  </div>
+        \\
+    , .{ id, id, id, id, id, id, id, id, id, id, id, id, id });
+
+    for (0..8) |r| {
+        try writer.print(
+            \\  <div itemprop="review" itemscope itemtype="https://schema.org/Review">
+            \\    <span itemprop="author">User {d}</span> rated <span itemprop="reviewRating">{d}</span>/5
+            \\    <time itemprop="datePublished" datetime="2025-01-{d:0>2}">January {d}</time>
+            \\    <p itemprop="reviewBody">Review {d} of widget {d}: works as expected.</p>
+            \\  </div>
+            \\
+        , .{ r, r % 5 + 1, r + 1, r + 1, r, id });
+    }
+    try writer.writeAll(
+        \\</main>
+        \\<footer><p>Copyright 2025 - <a href="/legal">Legal</a></p></footer>
+        \\</body></html>
+    );
+    return out.toOwnedSlice();
+}
+
+/// Structured data: `querySelectorAll` + `textContent` per kind vs one-walk `extractStructuredData`
+fn structuredDataBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== STRUCTURED DATA BENCHMARK ===\n", .{});
+
+    const pages = 200;
+    const rounds = 20;
+    const ns_to_s: f64 = 1_000_000_000.0;
+
+    const docs = try allocator.alloc(*z.HTMLDocument, pages);
+    defer allocator.free(docs);
+    var bytes: usize = 0;
+    for (docs, 0..) |*doc, i| {
+        const html = try generateProductPage(allocator, i);
+        defer allocator.free(html);
+        bytes += html.len;
+        doc.* = try z.createDocFromString(html);
+    }
+    defer for (docs) |doc| z.destroyDocument(doc);
+
+    // A: one query per kind, copied values
+    var checksum: usize = 0;
+    var timer = try std.time.Timer.start();
+    for (0..rounds) |_| {
+        for (docs) |doc| {
+            const scripts = try z.querySelectorAll(allocator, doc, "script[type=\"application/ld+json\"]");
+            defer allocator.free(scripts);
+            for (scripts) |script| {
+                const json = try z.textContent(allocator, z.elementToNode(script));
+                defer allocator.free(json);
+                checksum += json.len;
+            }
+            const metas = try z.querySelectorAll(allocator, doc, "meta[property^=\"og:\"], meta[property^=\"product:\"], meta[name^=\"twitter:\"]");
+            defer allocator.free(metas);
+            for (metas) |meta| {
+                const content = try z.getAttribute(allocator, meta, "content") orelse continue;
+                defer allocator.free(content);
+                checksum += content.len;
+            }
+            const props = try z.querySelectorAll(allocator, doc, "[itemprop]");
+            defer allocator.free(props);
+            for (props) |prop| {
+                const value = try z.textContent(allocator, z.elementToNode(prop));
+                defer allocator.free(value);
+                checksum += value.len;
+            }
+        }
+    }
+    const s_queries = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+
+    // B: one walk, streamed JSON
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    timer.reset();
+    for (0..rounds) |_| {
+        for (docs) |doc| {
+            out.clearRetainingCapacity();
+            const counts = try z.extractStructuredData(allocator, doc, &out.writer);
+            checksum += out.written().len + counts.microdata;
+        }
+    }
+    const s_walk = @as(f64, @floatFromInt(timer.read())) / ns_to_s;
+    std.mem.doNotOptimizeAway(checksum);
+
+    const total: f64 = @floatFromInt(rounds * pages);
+    z.print("{d} pages of {d:.1} KB, {d} rounds\n", .{ pages, @as(f64, @floatFromInt(bytes / pages)) / 1024.0, rounds });
+    z.print("querySelectorAll + textContent: {d:.0} pages/s\n", .{total / s_queries});
+    z.print("extractStructuredData:          {d:.0} pages/s ({d:.1}x)\n", .{ total / s_walk, s_queries / s_walk });
+}
+
+/// Table scraping: `children` + `textContent` per cell vs `extractTable` and CSV `extractTableTo`
+fn tableExtractionBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== TABLE EXTRACTION BENCHMARK ===\n", .{});
+
+    const row_count = 100_000;
+    var html: std.Io.Writer.Allocating = .init(allocator);
+    defer html.deinit();
+    try html.writer.writeAll(
+        \\<html><body><table><thead><tr><th>Date</th><th>Ticker</th><th>Open</th><th>Close</th><th colspan="2">Volume</th></tr></thead>
+        \\<tbody>
+        \\
+    );
+    for (0..row_count) |i| {
+        if (i % 10 == 0) {
+            try html.writer.print(
+                \\<tr><td rowspan="2">2025-{d:0>2}-{d:0>2}</td><td>T{d}</td><td>{d}.{d:0>2}</td><td> {d}.{d:0>2} </td><td colspan="2">{d}</td></tr>
+                \\
+            , .{ i % 12 + 1, i % 28 + 1, i % 97, i, i % 100, i + 1, i % 100, i * 13 });
+        } else if (i % 10 == 1) {
+            try html.writer.print(
+                \\<tr><td>T{d}</td><td>{d}.{d:0>2}</td><td>{d}.{d:0>2}</td><td>{d}</td><td>lots</td></tr>
+                \\
+            , .{ i % 97, i, i % 100, i + 1, i % 100, i * 13 });
+        } else {
+            try html.writer.print(
+                \\<tr><td>2025-{d:0>2}-{d:0>2}</td><td>T{d}</td><td>{d}.{d:0>2}</td><td>{d}.{d:0>2}</td><td>{d}</td><td><span>lots</span></td></tr>
+                \\
+            , .{ i % 12 + 1, i % 28 + 1, i % 97, i, i % 100, i + 1, i % 100, i * 13 });
+        }
+    }
+    try html.writer.writeAll("</tbody><tfoot><tr><td>Total</td><td colspan=\"5\">-</td></tr></tfoot></table></body></html>");
+
+    const doc = try z.createDocFromString(html.written());
+    defer z.destroyDocument(doc);
+    const table = z.firstElementChild(z.bodyElement(doc).?).?;
+    const ns_to_ms: f64 = 1_000_000.0;
+    var checksum: usize = 0;
+
+    // A: rows with `children`, one `textContent` copy per cell, no span expansion
+    var timer = try std.time.Timer.start();
+    const groups = try z.children(allocator, table);
+    defer allocator.free(groups);
+    for (groups) |group| {
+        const rows = try z.children(allocator, group);
+        defer allocator.free(rows);
+        for (rows) |row| {
+            const cells = try z.children(allocator, row);
+            defer allocator.free(cells);
+            for (cells) |cell| {
+                const text = try z.textContent(allocator, z.elementToNode(cell));
+                defer allocator.free(text);
+                checksum += text.len;
+            }
+        }
+    }
+    const ms_naive = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    var extracted = try z.extractTable(allocator, table, .{});
+    const ms_columnar = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    checksum += extracted.text.len + extracted.column(3).len;
+    const shape = [2]usize{ extracted.rows, extracted.columns };
+    extracted.deinit();
+
+    var csv: std.Io.Writer.Allocating = .init(allocator);
+    defer csv.deinit();
+    timer.reset();
+    checksum += try z.extractTableTo(allocator, table, &csv.writer, .{});
+    const ms_csv = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.mem.doNotOptimizeAway(checksum);
+
+    z.print("{d} rows x {d} columns, HTML {d:.1} MB, CSV {d:.1} MB\n", .{
+        shape[0],
+        shape[1],
+        @as(f64, @floatFromInt(html.written().len)) / 1_048_576.0,
+        @as(f64, @floatFromInt(csv.written().len)) / 1_048_576.0,
+    });
+    z.print("children + textContent: {d:.1} ms\n", .{ms_naive});
+    z.print("extractTable:           {d:.1} ms ({d:.1}x)\n", .{ ms_columnar, ms_naive / ms_columnar });
+    z.print("extractTableTo (CSV):   {d:.1} ms ({d:.1}x)\n", .{ ms_csv, ms_naive / ms_csv });
+}
+
+/// Text search: walker + `std.mem.indexOf` per node and needle vs `findText`
+fn findTextBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== FIND TEXT BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 3_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    const needles = [_][]const u8{ "emphasised", "archive", "return x", "Third" };
+    const rounds = 20;
+    const ns_to_ms: f64 = 1_000_000.0;
+
+    var found: [3]usize = @splat(0);
+    var timer = try std.time.Timer.start();
+    for (0..rounds) |_| {
+        var it = z.iterateDescendants(body);
+        while (it.next()) |node| {
+            if (!z.isTypeText(node)) continue;
+            const data = z.textContent_zc(node);
+            for (needles) |needle| {
+                var from: usize = 0;
+                while (std.mem.indexOfPos(u8, data, from, needle)) |at| : (from = at + 1) found[0] += 1;
+            }
+        }
+    }
+    const ms_naive = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    const Counter = struct {
+        fn onMatch(count: *usize, _: z.TextMatch) !bool {
+            count.* += 1;
+            return true;
+        }
+    };
+    timer.reset();
+    for (0..rounds) |_| _ = try z.findText(body, &needles, .{}, &found[1], Counter.onMatch);
+    const ms_find = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    for (0..rounds) |_| _ = try z.findText(body, &needles, .{ .ignore_case = true }, &found[2], Counter.onMatch);
+    const ms_find_ci = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.debug.assert(found[0] == found[1]);
+
+    z.print("{d:.1} MB page, {d} needles, {d} matches per round\n", .{
+        @as(f64, @floatFromInt(html.len)) / 1_048_576.0,
+        needles.len,
+        found[1] / rounds,
+    });
+    z.print("walker + indexOf:          {d:.2} ms/round\n", .{ms_naive / rounds});
+    z.print("findText:                  {d:.2} ms/round ({d:.1}x)\n", .{ ms_find / rounds, ms_naive / ms_find });
+    z.print("findText (ignore case):    {d:.2} ms/round\n", .{ms_find_ci / rounds});
+}
+
+fn xpathBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== XPATH BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 1_000);
+    defer allocator.free(html);
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    // the same nodes, as a selector and as a path
+    const queries = [_][2][]const u8{
+        .{ "article li", "//article//li" },
+        .{ "a[href]", "//a[@href]" },
+        .{ "tr td:first-child", "//tr/td[1]" },
+        .{ "h2.post-title", "//h2[@class='post-title']" },
+    };
+    const rounds = 20;
+    const ns_to_ms: f64 = 1_000_000.0;
+
+    var css_engine = try z.CssSelectorEngine.init(allocator);
+    defer css_engine.deinit();
+    var xpath_engine: z.XPathEngine = .init(allocator);
+    defer xpath_engine.deinit();
+
+    for (queries) |query| {
+        var found: [2]usize = @splat(0);
+        var timer = try std.time.Timer.start();
+        for (0..rounds) |_| {
+            const nodes = try css_engine.querySelectorAll(body, query[0]);
+            defer allocator.free(nodes);
+            found[0] = nodes.len;
+        }
+        const ms_css = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+        timer.reset();
+        for (0..rounds) |_| {
+            const nodes = try xpath_engine.select(body, query[1]);
+            defer allocator.free(nodes);
+            found[1] = nodes.len;
+        }
+        const ms_xpath = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+        std.debug.assert(found[0] == found[1]);
+
+        z.print("{s:<28} {d:>6} nodes  css {d:.3} ms  xpath {d:.3} ms ({d:.2}x)\n", .{
+            query[1],
+            found[1],
+            ms_css / rounds,
+            ms_xpath / rounds,
+            ms_xpath / ms_css,
+        });
+    }
+}
+
+fn formBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== FORM SERIALIZATION BENCHMARK ===\n", .{});
+
+    var page: std.Io.Writer.Allocating = .init(allocator);
+    defer page.deinit();
+    try page.writer.writeAll("<form id=\"checkout\" action=\"/order\">\n");
+    for (0..200) |i| {
+        try page.writer.print(
+            \\<fieldset><legend>Line {d}</legend>
+            \\<input name="sku-{d}" value="SKU {d}/A"><input type="number" name="qty-{d}" value="{d}">
+            \\<input type="checkbox" name="gift-{d}"{s}><select name="size-{d}"><option>S</option><option selected>M</option><option>L</option></select>
+            \\<textarea name="note-{d}">Leave at the door
+            \\thanks</textarea></fieldset>
+            \\
+        , .{ i, i, i, i, i % 5, i, if (i % 2 == 0) " checked" else "", i, i });
+    }
+    try page.writer.writeAll("<button name=\"go\" value=\"pay\">Pay</button></form>");
+
+    const doc = try z.createDocFromString(page.written());
+    defer z.destroyDocument(doc);
+    const form = z.getElementById(z.bodyNode(doc).?, "checkout").?;
+
+    const rounds = 2_000;
+    const ns_to_us: f64 = 1_000.0;
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+
+    var entries: usize = 0;
+    var timer = try std.time.Timer.start();
+    for (0..rounds) |_| {
+        out.clearRetainingCapacity();
+        entries = try z.serializeForm(allocator, &out.writer, form, null);
+    }
+    const us_stream = @as(f64, @floatFromInt(timer.read())) / ns_to_us;
+
+    timer.reset();
+    for (0..rounds) |_| {
+        out.clearRetainingCapacity();
+        const collected = try z.collectForm(allocator, form, null);
+        defer collected.deinit(allocator);
+        try z.writeFormUrlEncoded(&out.writer, collected.entries);
+    }
+    const us_collect = @as(f64, @floatFromInt(timer.read())) / ns_to_us;
+
+    z.print("{d} entries, {d} bytes encoded\n", .{ entries, out.written().len });
+    z.print("serializeForm:               {d:.2} us/form\n", .{us_stream / rounds});
+    z.print("collectForm + write:         {d:.2} us/form\n", .{us_collect / rounds});
+}
+
+fn streamPoolBenchmark(allocator: std.mem.Allocator) !void {
+    z.print("\n=== STREAM REUSE BENCHMARK ===\n", .{});
+
+    const html = try generateBenchmarkPage(allocator, 4);
+    defer allocator.free(html);
+    const chunk_size = 512;
+    const bodies = 5_000;
+
+    var timer = try std.time.Timer.start();
+    for (0..bodies) |_| {
+        var stream = try z.Stream.init(allocator);
+        defer z.destroyDocument(stream.getDocument());
+        defer stream.deinit();
+        try parseInChunks(&stream, html, chunk_size);
+    }
+    const s_fresh = @as(f64, @floatFromInt(timer.read())) / std.time.ns_per_s;
+
+    var pool: z.StreamPool = .init(allocator, 8);
+    defer pool.deinit();
+    timer.reset();
+    for (0..bodies) |_| {
+        const stream = try pool.acquire();
+        defer pool.release(stream);
+        try parseInChunks(stream, html, chunk_size);
+    }
+    const s_pooled = @as(f64, @floatFromInt(timer.read())) / std.time.ns_per_s;
+
+    z.print("{d} bodies of {d} bytes, {d}-byte chunks\n", .{ bodies, html.len, chunk_size });
+    z.print("new Stream per body:     {d:.0} streams/s\n", .{bodies / s_fresh});
+    z.print("StreamPool:              {d:.0} streams/s ({d:.2}x)\n", .{ bodies / s_pooled, s_fresh / s_pooled });
+}
+
+fn parseInChunks(stream: *z.Stream, html: []const u8, chunk_size: usize) !void {
+    try stream.beginParsing();
+    var start: usize = 0;
+    while (start < html.len) : (start += chunk_size) {
+        try stream.processChunk(html[start..@min(start + chunk_size, html.len)]);
+    }
+    try stream.endParsing();
+}
+
+/// [walk ms, `article li[data-index]` ms] over `iterations` rounds
+fn timeTraversals(allocator: std.mem.Allocator, doc: *z.HTMLDocument, engine: *z.CssSelectorEngine, iterations: usize) ![2]f64 {
+    const ns_to_ms: f64 = 1_000_000.0;
+    const root = z.documentRoot(doc).?;
+
+    var timer = try std.time.Timer.start();
+    var links: usize = 0;
+    for (0..iterations) |_| links += countLinksInline(root);
+    const ms_walk = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+
+    timer.reset();
+    var matched: usize = 0;
+    for (0..iterations) |_| {
+        const nodes = try engine.querySelectorAll(root, "article li[data-index]");
+        matched += nodes.len;
+        allocator.free(nodes);
+    }
+    const ms_selector = @as(f64, @floatFromInt(timer.read())) / ns_to_ms;
+    std.mem.doNotOptimizeAway(links + matched);
+
+    return .{ ms_walk, ms_selector };
+}
@@ -3,6 +3,8 @@
 #include <lexbor/html/serialize.h>
 #include <lexbor/html/interfaces/template_element.h>
 #include <lexbor/html/tree.h>
+#include <lexbor/css/css.h>
+#include <stddef.h>
 
 /**
  * Minimal C wrappers for lexbor functions that require access to
@@ -130,3 +132,124 @@ lxb_html_template_element_t *lexbor_node_to_template_wrapper(lxb_dom_node_t *nod
   return NULL;
 }
 
+/**
+ * Layout of lxb_dom_node_t / lxb_dom_element_t mirrored by
+ * src/modules/dom_layout.zig. The build fails here when the bundled
+ * headers no longer match the offsets asserted on the Zig side.
+ */
+#define LEXBOR_LAYOUT_CHECK(name, cond) typedef char lexbor_layout_check_##name[(cond) ? 1 : -1]
+
+LEXBOR_LAYOUT_CHECK(node_local_name, offsetof(lxb_dom_node_t, local_name) == 1 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_prefix, offsetof(lxb_dom_node_t, prefix) == 2 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_ns, offsetof(lxb_dom_node_t, ns) == 3 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_owner_document, offsetof(lxb_dom_node_t, owner_document) == 4 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_next, offsetof(lxb_dom_node_t, next) == 5 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_prev, offsetof(lxb_dom_node_t, prev) == 6 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_parent, offsetof(lxb_dom_node_t, parent) == 7 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_first_child, offsetof(lxb_dom_node_t, first_child) == 8 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_last_child, offsetof(lxb_dom_node_t, last_child) == 9 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_user, offsetof(lxb_dom_node_t, user) == 10 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_type, offsetof(lxb_dom_node_t, type) == 11 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(node_type_size, sizeof(lxb_dom_node_type_t) == 4);
+LEXBOR_LAYOUT_CHECK(node_size, sizeof(lxb_dom_node_t) == 12 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(element_first_attr, offsetof(lxb_dom_element_t, first_attr) == 15 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(element_attr_class, offsetof(lxb_dom_element_t, attr_class) == 18 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(character_data, offsetof(lxb_dom_character_data_t, data) == 12 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(str_length, offsetof(lexbor_str_t, length) == sizeof(void *));
+LEXBOR_LAYOUT_CHECK(html_document_node, offsetof(lxb_html_document_t, dom_document) == 0);
+LEXBOR_LAYOUT_CHECK(document_compat_mode, offsetof(lxb_dom_document_t, compat_mode) == 12 * sizeof(void *));
+LEXBOR_LAYOUT_CHECK(document_compat_mode_size, sizeof(lxb_dom_document_cmode_t) == 4);
+
+// Offsets compared with the Zig mirrors in a unit test
+const size_t *lexbor_dom_layout_wrapper(size_t *count)
+{
+  static const size_t offsets[] = {
+      sizeof(lxb_dom_node_t),
+      offsetof(lxb_dom_node_t, local_name),
+      offsetof(lxb_dom_node_t, ns),
+      offsetof(lxb_dom_node_t, owner_document),
+      offsetof(lxb_dom_node_t, next),
+      offsetof(lxb_dom_node_t, prev),
+      offsetof(lxb_dom_node_t, parent),
+      offsetof(lxb_dom_node_t, first_child),
+      offsetof(lxb_dom_node_t, last_child),
+      offsetof(lxb_dom_node_t, type),
+      offsetof(lxb_dom_element_t, first_attr),
+      offsetof(lxb_dom_element_t, attr_id),
+      offsetof(lxb_dom_element_t, attr_class),
+      offsetof(lxb_dom_character_data_t, data),
+      offsetof(lexbor_str_t, length),
+      offsetof(lxb_dom_document_t, compat_mode),
+  };
+
+  *count = sizeof(offsets) / sizeof(offsets[0]);
+  return offsets;
+}
+
+/**
+ * Rule tree of a parsed lxb_css_stylesheet_t / declaration list,
+ * walked by src/modules/css_inliner.zig
+ */
+
+// First top-level rule of a stylesheet
+lxb_css_rule_t *lexbor_css_stylesheet_first_rule_wrapper(lxb_css_stylesheet_t *sst)
+{
+  if (sst->root == NULL)
+  {
+    return NULL;
+  }
+  if (sst->root->type == LXB_CSS_RULE_LIST)
+  {
+    return lxb_css_rule_list(sst->root)->first;
+  }
+  return sst->root;
+}
+
+lxb_css_rule_t *lexbor_css_rule_next_wrapper(lxb_css_rule_t *rule)
+{
+  return rule->next;
+}
+
+int lexbor_css_rule_type_wrapper(lxb_css_rule_t *rule)
+{
+  return (int)rule->type;
+}
+
+// Selector list of a style rule: one entry per comma-separated selector
+lxb_css_selector_list_t *lexbor_css_rule_style_selectors_wrapper(lxb_css_rule_t *rule)
+{
+  return lxb_css_rule_style(rule)->selector;
+}
+
+lxb_css_selector_list_t *lexbor_css_selector_list_next_wrapper(lxb_css_selector_list_t *list)
+{
+  return list->next;
+}
+
+// First entry of the declarations of a style rule, a bad style rule or a declaration list
+lxb_css_rule_t *lexbor_css_rule_first_declaration_wrapper(lxb_css_rule_t *rule)
+{
+  lxb_css_rule_declaration_list_t *list = NULL;
+
+  switch (rule->type)
+  {
+  case LXB_CSS_RULE_STYLE:
+    list = lxb_css_rule_style(rule)->declarations;
+    break;
+  case LXB_CSS_RULE_BAD_STYLE:
+    list = lxb_css_rule_bad_style(rule)->declarations;
+    break;
+  case LXB_CSS_RULE_DECLARATION_LIST:
+    list = lxb_css_rule_declaration_list(rule);
+    break;
+  default:
+    break;
+  }
+
+  return list != NULL ? list->first : NULL;
+}
+
+bool lexbor_css_rule_declaration_important_wrapper(lxb_css_rule_t *rule)
+{
+  return rule->type == LXB_CSS_RULE_DECLARATION && lxb_css_rule_declaration(rule)->important;
+}
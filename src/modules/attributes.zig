@@ -6,6 +6,7 @@
 const std = @import("std");
 const z = @import("../root.zig");
 const Err = z.Err;
+const mutation = @import("mutation.zig");
 
 const testing = std.testing;
 const print = std.debug.print;
@@ -143,6 +144,7 @@ pub fn hasAttributes(element: *z.HTMLElement) bool {
 ///
 /// Returns the created DomAttr or null if the attribute could not be set (e.g., memory allocation failure)
 pub fn setAttribute(element: *z.HTMLElement, name: []const u8, value: []const u8) ?*DomAttr {
+    mutation.notify(.{ .kind = .attribute, .target = z.elementToNode(element), .name = name });
     return lxb_dom_element_set_attribute(
         element,
         name.ptr,
@@ -169,6 +171,7 @@ pub fn setAttribute(element: *z.HTMLElement, name: []const u8, value: []const u8
 /// ```
 pub fn setAttributes(element: *z.HTMLElement, attrs: []const AttributePair) ?void {
     for (attrs) |attr| {
+        mutation.notify(.{ .kind = .attribute, .target = z.elementToNode(element), .name = attr.name });
         _ = lxb_dom_element_set_attribute(
             element,
             attr.name.ptr,
@@ -246,6 +249,51 @@ fn getNextAttribute(attr: *DomAttr) ?*DomAttr {
     return lxb_dom_element_next_attribute_noi(attr);
 }
 
+/// [attributes] Zero-copy iterator over the attributes of an element, in document order
+///
+/// The returned `AttributePair` slices point into lexbor's memory: they are valid until the attribute is changed.
+/// ## Example
+/// ```
+/// var it = z.iterateAttributes(element);
+/// while (it.next()) |attr| {
+///     print("{s}={s}\n", .{ attr.name, attr.value });
+/// }
+/// ---
+/// ```
+pub const AttributeIterator = struct {
+    current: ?*DomAttr,
+
+    pub fn next(self: *@This()) ?AttributePair {
+        const attr = self.current orelse return null;
+        self.current = getNextAttribute(attr);
+        return .{
+            .name = getAttributeName_zc(attr),
+            .value = getAttributeValue_zc(attr),
+        };
+    }
+};
+
+/// [attributes] Returns a zero-copy `AttributeIterator` over the attributes of the element
+pub fn iterateAttributes(element: *z.HTMLElement) AttributeIterator {
+    return .{ .current = getFirstAttribute(element) };
+}
+
+test "iterateAttributes" {
+    const doc = try z.createDocFromString("<div id='main' class='card' hidden></div>");
+    defer z.destroyDocument(doc);
+    const div = z.nodeToElement(z.firstChild(z.bodyNode(doc).?).?).?;
+
+    var it = iterateAttributes(div);
+    const first = it.next().?;
+    try testing.expectEqualStrings("id", first.name);
+    try testing.expectEqualStrings("main", first.value);
+    try testing.expectEqualStrings("class", it.next().?.name);
+    const last = it.next().?;
+    try testing.expectEqualStrings("hidden", last.name);
+    try testing.expectEqualStrings("", last.value);
+    try testing.expect(it.next() == null);
+}
+
 // ----------------------------------------------------------
 
 /// [attributes] Collect all attributes with stack buffer optimization (bf = buffered)
@@ -305,6 +353,7 @@ pub fn getAttributes_bf(allocator: std.mem.Allocator, element: *z.HTMLElement) !
 ///
 /// Fails silently
 pub fn removeAttribute(element: *z.HTMLElement, name: []const u8) !void {
+    mutation.notify(.{ .kind = .attribute, .target = z.elementToNode(element), .name = name });
     const result = lxb_dom_element_remove_attribute(
         element,
         name.ptr,
@@ -0,0 +1,344 @@
+//! Canonical serialization, for hashing and deduplication
+//!
+//! Two fragments that only differ by attribute order, name case, whitespace or entity
+//! spelling (`&amp;` vs `&#38;`, decoded by the parser) have the same canonical form:
+//! - element and attribute names lowercased, attributes sorted by name, values double-quoted;
+//! - text escaped with `&amp;`, `&lt;`, `&gt;` only (attribute values also `&quot;`),
+//!   `<script>` and `<style>` content written as is;
+//! - whitespace normalized as `normalizeDOM` does, see `CanonicalOptions`.
+//!
+//! The output goes to any `std.Io.Writer`: `canonicalHash` feeds it to a hasher through
+//! `HashingWriter`, so the canonical string is never materialized.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// `LXB_DOM_NODE_TYPE_DOCUMENT_TYPE`
+const LXB_DOM_NODE_TYPE_DOCUMENT_TYPE: u32 = 0x0A;
+
+pub const CanonicalOptions = struct {
+    /// `skip_comments` drops the comments
+    normalize: z.NormalizeOptions = .{},
+    /// Outside `<pre>`, `<code>`, `<textarea>`, `<script>` and `<style>`: whitespace-only text
+    /// is dropped and whitespace runs become one space
+    collapse_whitespace: bool = true,
+};
+
+/// [canonical] Streams the canonical form of `root` and its subtree into `writer`
+///
+/// `allocator` is only used when an element has more attributes than a stack buffer holds.
+/// ## Example
+/// ```
+/// var out: std.Io.Writer.Allocating = .init(allocator);
+/// defer out.deinit();
+/// try z.canonicalSerializeTo(allocator, fragment, &out.writer, .{});
+/// ---
+/// ```
+pub fn canonicalSerializeTo(allocator: std.mem.Allocator, root: *z.DomNode, writer: *std.Io.Writer, options: CanonicalOptions) !void {
+    var fallback = std.heap.stackFallback(32 * @sizeOf(z.AttributePair), allocator);
+    var serializer: Serializer = .{
+        .allocator = fallback.get(),
+        .writer = writer,
+        .options = options,
+    };
+    defer serializer.attributes.deinit(serializer.allocator);
+    try serializer.walk(root);
+}
+
+/// [canonical] Wyhash of the canonical form of `root`, computed without building the string
+///
+/// Equal hashes for fragments that are the same up to attribute order, case, whitespace and entities.
+/// ## Example
+/// ```
+/// const a = try z.canonicalHash(allocator, card_1, .{});
+/// const b = try z.canonicalHash(allocator, card_2, .{});
+/// if (a == b) ... // duplicate
+/// ---
+/// ```
+pub fn canonicalHash(allocator: std.mem.Allocator, root: *z.DomNode, options: CanonicalOptions) !u64 {
+    var buffer: [4096]u8 = undefined;
+    var hashing: HashingWriter(std.hash.Wyhash) = .init(.init(0), &buffer);
+    try canonicalSerializeTo(allocator, root, &hashing.writer, options);
+    return hashing.final();
+}
+
+/// [canonical] A `std.Io.Writer` that feeds a streaming hasher (`update` / `final`) and keeps nothing
+///
+/// ## Example
+/// ```
+/// var buffer: [4096]u8 = undefined;
+/// var hashing: z.HashingWriter(std.hash.Wyhash) = .init(.init(0), &buffer);
+/// try z.serializeTo(node, &hashing.writer);
+/// const hash = hashing.final();
+/// ---
+/// ```
+pub fn HashingWriter(comptime Hasher: type) type {
+    return struct {
+        hasher: Hasher,
+        writer: std.Io.Writer,
+
+        const Self = @This();
+
+        pub fn init(hasher: Hasher, buffer: []u8) Self {
+            return .{
+                .hasher = hasher,
+                .writer = .{ .vtable = &.{ .drain = drain }, .buffer = buffer },
+            };
+        }
+
+        /// Hash of everything written so far
+        pub fn final(self: *Self) @typeInfo(@TypeOf(Hasher.final)).@"fn".return_type.? {
+            self.hasher.update(self.writer.buffered());
+            self.writer.end = 0;
+            return self.hasher.final();
+        }
+
+        fn drain(w: *std.Io.Writer, data: []const []const u8, splat: usize) std.Io.Writer.Error!usize {
+            const self: *Self = @alignCast(@fieldParentPtr("writer", w));
+            self.hasher.update(w.buffered());
+            w.end = 0;
+
+            var written: usize = 0;
+            for (data[0 .. data.len - 1]) |bytes| {
+                self.hasher.update(bytes);
+                written += bytes.len;
+            }
+            const pattern = data[data.len - 1];
+            for (0..splat) |_| self.hasher.update(pattern);
+            return written + pattern.len * splat;
+        }
+    };
+}
+
+const Serializer = struct {
+    allocator: std.mem.Allocator,
+    writer: *std.Io.Writer,
+    options: CanonicalOptions,
+    /// attributes of the current element, reused for sorting
+    attributes: std.ArrayList(z.AttributePair) = .empty,
+    /// depth of `<pre>`, `<code>`, `<textarea>`, `<script>`, `<style>` ancestors
+    preserve_depth: usize = 0,
+    /// depth of `<script>`, `<style>` ancestors
+    raw_depth: usize = 0,
+
+    const Error = std.Io.Writer.Error || std.mem.Allocator.Error;
+
+    /// Pre-order walk of `root`; re-entered for the content of `<template>` elements
+    fn walk(self: *Serializer, root: *z.DomNode) Error!void {
+        var node = root;
+        while (true) {
+            if (try self.enter(node)) {
+                if (z.firstChild(node)) |child| {
+                    node = child;
+                    continue;
+                }
+            }
+            try self.exit(node);
+            while (node != root) {
+                if (z.nextSibling(node)) |next| {
+                    node = next;
+                    break;
+                }
+                node = z.parentNode(node).?;
+                try self.exit(node);
+            } else break;
+        }
+    }
+
+    /// Returns true when the children must be written
+    fn enter(self: *Serializer, node: *z.DomNode) !bool {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {},
+            z.LXB_DOM_NODE_TYPE_TEXT => {
+                try self.text(z.characterData(node));
+                return false;
+            },
+            z.LXB_DOM_NODE_TYPE_COMMENT => {
+                if (self.options.normalize.skip_comments) return false;
+                try self.writer.writeAll("<!--");
+                try self.writer.writeAll(z.characterData(node));
+                try self.writer.writeAll("-->");
+                return false;
+            },
+            LXB_DOM_NODE_TYPE_DOCUMENT_TYPE => {
+                try self.writer.writeAll("<!DOCTYPE ");
+                try writeLower(self.writer, z.nodeName_zc(node));
+                try self.writer.writeByte('>');
+                return false;
+            },
+            z.LXB_DOM_NODE_TYPE_DOCUMENT, z.LXB_DOM_NODE_TYPE_FRAGMENT => return true,
+            else => return false,
+        }
+
+        const element = z.nodeToElement(node).?;
+        try self.writer.writeByte('<');
+        try writeLower(self.writer, z.qualifiedName_zc(element));
+
+        self.attributes.clearRetainingCapacity();
+        var it = z.iterateAttributes(element);
+        while (it.next()) |attr| try self.attributes.append(self.allocator, attr);
+        std.mem.sortUnstable(z.AttributePair, self.attributes.items, {}, attributeLessThan);
+        for (self.attributes.items) |attr| {
+            try self.writer.writeByte(' ');
+            try writeLower(self.writer, attr.name);
+            try self.writer.writeAll("=\"");
+            try writeEscaped(self.writer, attr.value, true);
+            try self.writer.writeByte('"');
+        }
+        try self.writer.writeByte('>');
+
+        if (z.isVoid(node)) return false;
+        if (isPreserving(node)) self.preserve_depth += 1;
+        if (isRawText(node)) self.raw_depth += 1;
+        // the content of a template is a fragment of its own, outside the child list
+        if (z.isTemplate(node)) {
+            if (z.nodeToTemplate(node)) |template| try self.walk(z.fragmentToNode(z.templateContent(template)));
+        }
+        return true;
+    }
+
+    fn exit(self: *Serializer, node: *z.DomNode) !void {
+        const element = z.nodeToElement(node) orelse return;
+        if (z.isVoid(node)) return;
+        if (isPreserving(node)) self.preserve_depth -= 1;
+        if (isRawText(node)) self.raw_depth -= 1;
+        try self.writer.writeAll("</");
+        try writeLower(self.writer, z.qualifiedName_zc(element));
+        try self.writer.writeByte('>');
+    }
+
+    fn text(self: *Serializer, data: []const u8) !void {
+        if (self.raw_depth > 0) return self.writer.writeAll(data);
+        const collapse = self.options.collapse_whitespace and self.preserve_depth == 0;
+        if (collapse and z.isWhitespaceOnly(data)) return;
+        try writeText(self.writer, data, collapse);
+    }
+};
+
+fn attributeLessThan(_: void, a: z.AttributePair, b: z.AttributePair) bool {
+    return std.ascii.lessThanIgnoreCase(a.name, b.name);
+}
+
+fn isPreserving(node: *z.DomNode) bool {
+    return z.isHtmlTag(node, z.LXB_TAG_PRE) or z.isHtmlTag(node, z.LXB_TAG_CODE) or
+        z.isHtmlTag(node, z.LXB_TAG_TEXTAREA) or isRawText(node);
+}
+
+fn isRawText(node: *z.DomNode) bool {
+    return z.isHtmlTag(node, z.LXB_TAG_SCRIPT) or z.isHtmlTag(node, z.LXB_TAG_STYLE);
+}
+
+fn writeLower(writer: *std.Io.Writer, name: []const u8) !void {
+    for (name) |c| {
+        if (std.ascii.isUpper(c)) break;
+    } else return writer.writeAll(name);
+    for (name) |c| try writer.writeByte(std.ascii.toLower(c));
+}
+
+/// Text escaped in runs; with `collapse`, each whitespace run is written as one space
+fn writeText(writer: *std.Io.Writer, data: []const u8, collapse: bool) !void {
+    var start: usize = 0;
+    var i: usize = 0;
+    while (i < data.len) : (i += 1) {
+        const c = data[i];
+        if (collapse and std.ascii.isWhitespace(c)) {
+            var end = i + 1;
+            while (end < data.len and std.ascii.isWhitespace(data[end])) end += 1;
+            if (end - i == 1 and c == ' ') continue;
+            try writer.writeAll(data[start..i]);
+            try writer.writeByte(' ');
+            start = end;
+            i = end - 1;
+            continue;
+        }
+        const entity: []const u8 = switch (c) {
+            '&' => "&amp;",
+            '<' => "&lt;",
+            '>' => "&gt;",
+            else => continue,
+        };
+        try writer.writeAll(data[start..i]);
+        try writer.writeAll(entity);
+        start = i + 1;
+    }
+    try writer.writeAll(data[start..]);
+}
+
+fn writeEscaped(writer: *std.Io.Writer, value: []const u8, attribute: bool) !void {
+    var start: usize = 0;
+    for (value, 0..) |c, i| {
+        const entity: []const u8 = switch (c) {
+            '&' => "&amp;",
+            '<' => "&lt;",
+            '>' => "&gt;",
+            '"' => if (attribute) "&quot;" else continue,
+            else => continue,
+        };
+        try writer.writeAll(value[start..i]);
+        try writer.writeAll(entity);
+        start = i + 1;
+    }
+    try writer.writeAll(value[start..]);
+}
+
+test "canonicalSerializeTo / canonicalHash" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<div id="b" CLASS="a">
+        \\  <p>x &#38;   y</p><!-- c --><br><pre>  kept
+        \\  as is</pre>
+        \\</div>
+        \\<div class="a" id="b"><p>x &amp;
+        \\y</p><br><pre>  kept
+        \\  as is</pre></div>
+        \\<div class="a" id="b"><p>x &amp; z</p><br><pre>  kept
+        \\  as is</pre></div>
+    );
+    defer z.destroyDocument(doc);
+    const first = z.firstElementChild(z.bodyElement(doc).?).?;
+    const second = z.nextElementSibling(first).?;
+    const third = z.nextElementSibling(second).?;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try canonicalSerializeTo(allocator, z.elementToNode(first), &out.writer, .{ .normalize = .{ .skip_comments = true } });
+    try testing.expectEqualStrings(
+        \\<div class="a" id="b"><p>x &amp; y</p><br><pre>  kept
+        \\  as is</pre></div>
+    , out.written());
+
+    const options: CanonicalOptions = .{ .normalize = .{ .skip_comments = true } };
+    const h1 = try canonicalHash(allocator, z.elementToNode(first), options);
+    const h2 = try canonicalHash(allocator, z.elementToNode(second), options);
+    const h3 = try canonicalHash(allocator, z.elementToNode(third), options);
+    try testing.expectEqual(h1, h2);
+    try testing.expect(h1 != h3);
+    try testing.expectEqual(std.hash.Wyhash.hash(0, out.written()), h1);
+
+    // comments count by default
+    try testing.expect(try canonicalHash(allocator, z.elementToNode(first), .{}) != h1);
+}
+
+test "canonical form includes template content" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<template id="t"><li class="a">one</li></template><template id="t"><li class="a">two</li></template>
+    );
+    defer z.destroyDocument(doc);
+    const head = z.firstElementChild(z.nodeToElement(z.documentRoot(doc).?).?).?;
+    const first = z.firstElementChild(head).?;
+    const second = z.nextElementSibling(first).?;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try canonicalSerializeTo(allocator, z.elementToNode(first), &out.writer, .{});
+    try testing.expectEqualStrings("<template id=\"t\"><li class=\"a\">one</li></template>", out.written());
+
+    const h1 = try canonicalHash(allocator, z.elementToNode(first), .{});
+    const h2 = try canonicalHash(allocator, z.elementToNode(second), .{});
+    try testing.expect(h1 != h2);
+}
@@ -1,4 +1,8 @@
 //! Stream processor
+//!
+//! The chunks go to the parser of the document itself: lexbor creates it at the first `beginParsing`
+//! and frees it with the document. `Stream.reset()` empties the document and keeps both its memory and
+//! its parser for the next body, and `StreamPool` keeps reset streams for servers parsing many bodies.
 
 const std = @import("std");
 const z = @import("../root.zig");
@@ -9,12 +13,9 @@ const print = std.debug.print;
 
 // =======================================================================
 
-extern "c" fn lxb_html_parser_create() *z.HtmlParser;
-extern "c" fn lxb_html_parser_init(*z.HtmlParser) usize;
-extern "c" fn lxb_html_parser_destroy(parser: *z.HtmlParser) void;
 extern "c" fn lxb_html_document_parse_chunk_begin(document: *z.HTMLDocument) usize;
 extern "c" fn lxb_html_document_parse_chunk_end(document: *z.HTMLDocument) usize;
-extern "c" fn lxb_html_document_parse_chunk(document: *z.HTMLDocument, chunk: [*:0]const u8, len: usize) usize;
+extern "c" fn lxb_html_document_parse_chunk(document: *z.HTMLDocument, chunk: [*]const u8, len: usize) usize;
 
 // =======================================================================
 
@@ -30,11 +31,12 @@ extern "c" fn lxb_html_document_parse_chunk(document: *z.HTMLDocument, chunk: [*
 ///
 /// Exposes:
 /// - `init`: create a new document
-/// - `deinit`: destroy the document and parser
+/// - `deinit`: end the parsing in progress
 /// - `beginParsing`: start the parsing process
 /// - `processChunk`: process a chunk of HTML
 /// - `endParsing`: end the parsing process
 /// - `getDocument`: get the underlying HTML document
+/// - `reset`: empty the document for the next body, keeping its memory and parser
 /// ## Example
 /// ```
 /// var chunk_parser = try Stream.init(allocator);
@@ -49,34 +51,45 @@ extern "c" fn lxb_html_document_parse_chunk(document: *z.HTMLDocument, chunk: [*
 /// ```
 pub const Stream = struct {
     doc: *z.HTMLDocument,
-    parser: *z.HtmlParser,
     allocator: std.mem.Allocator,
     parsing_active: bool = false,
 
     /// [chunks] Initialize a new stream parser
     /// 
-    /// Creates a new HTML document and parser for streaming processing.
+    /// Creates a new HTML document for streaming processing; its parser is created by the first beginParsing().
     /// Call deinit() and destroyDocument() when done.
     pub fn init(allocator: std.mem.Allocator) !Stream {
         const doc = z.createDocument() catch return Err.DocCreateFailed;
         return .{
             .doc = doc,
             .allocator = allocator,
-            .parser = lxb_html_parser_create(),
         };
     }
 
     /// [chunks] Clean up the stream parser resources
     /// 
-    /// Ends parsing if active and destroys the parser.
-    /// Document must be destroyed separately using destroyDocument().
+    /// Ends parsing if active. The parser belongs to the document:
+    /// it is freed with it, by destroyDocument().
     pub fn deinit(self: *Stream) void {
         if (self.parsing_active) {
             _ = lxb_html_document_parse_chunk_end(self.doc);
-            lxb_html_parser_destroy(self.parser);
+            self.parsing_active = false;
         }
     }
 
+    /// [chunks] Recycle the stream for the next body
+    ///
+    /// Ends parsing if active and empties the document. Its memory and its parser are kept:
+    /// the next beginParsing() allocates neither a document nor a parser.
+    /// The nodes of the previous body are gone, and the document must not have been destroyed.
+    pub fn reset(self: *Stream) void {
+        if (self.parsing_active) {
+            _ = lxb_html_document_parse_chunk_end(self.doc);
+            self.parsing_active = false;
+        }
+        z.cleanDocument(self.doc);
+    }
+
     /// [chunks] Begin parsing HTML chunks
     /// 
     /// Must be called before processChunk(). Fails if parsing is already active.
@@ -88,11 +101,7 @@ pub const Stream = struct {
         if (lxb_html_document_parse_chunk_begin(self.doc) != 0) {
             return Err.ChunkBeginFailed;
         }
-        
-        if (lxb_html_parser_init(self.parser) != z._OK) {
-            return Err.ParserInitFailed;
-        }
-        
+
         self.parsing_active = true;
     }
 
@@ -105,12 +114,9 @@ pub const Stream = struct {
             return Err.ChunkProcessFailed;
         }
 
-        const html_ptr = try self.allocator.dupeZ(u8, html_chunk);
-        defer self.allocator.free(html_ptr);
-
         if (lxb_html_document_parse_chunk(
             self.doc,
-            html_ptr,
+            html_chunk.ptr,
             html_chunk.len,
         ) != 0) {
             return Err.ChunkProcessFailed;
@@ -141,6 +147,65 @@ pub const Stream = struct {
     }
 };
 
+/// [chunks] Pool of reset streams, for servers parsing many streamed bodies
+///
+/// `acquire` hands out an idle stream (or a new one), `release` resets it and keeps it for the next body.
+/// The documents belong to the pool: use them between acquire() and release(), never destroy them.
+/// ## Example
+/// ```
+/// var pool: z.StreamPool = .init(allocator, 64);
+/// defer pool.deinit();
+///
+/// const stream = try pool.acquire();
+/// defer pool.release(stream);
+/// try stream.beginParsing();
+/// while (try body.next()) |chunk| try stream.processChunk(chunk);
+/// try stream.endParsing();
+/// const doc = stream.getDocument();
+/// ---
+/// ```
+pub const StreamPool = struct {
+    allocator: std.mem.Allocator,
+    idle: std.ArrayList(*Stream) = .empty,
+    /// released streams beyond this number are destroyed
+    max_idle: usize,
+
+    pub fn init(allocator: std.mem.Allocator, max_idle: usize) StreamPool {
+        return .{ .allocator = allocator, .max_idle = max_idle };
+    }
+
+    /// [chunks] Destroy the idle streams and their documents
+    ///
+    /// The streams still acquired must be released before.
+    pub fn deinit(self: *StreamPool) void {
+        for (self.idle.items) |stream| self.destroy(stream);
+        self.idle.deinit(self.allocator);
+    }
+
+    /// [chunks] An idle stream, or a new one, ready for beginParsing()
+    pub fn acquire(self: *StreamPool) !*Stream {
+        if (self.idle.pop()) |stream| return stream;
+
+        const stream = try self.allocator.create(Stream);
+        errdefer self.allocator.destroy(stream);
+        stream.* = try Stream.init(self.allocator);
+        return stream;
+    }
+
+    /// [chunks] Reset `stream` and keep it for the next acquire()
+    pub fn release(self: *StreamPool, stream: *Stream) void {
+        if (self.idle.items.len >= self.max_idle) return self.destroy(stream);
+        stream.reset();
+        self.idle.append(self.allocator, stream) catch self.destroy(stream);
+    }
+
+    fn destroy(self: *StreamPool, stream: *Stream) void {
+        stream.deinit();
+        z.destroyDocument(stream.doc);
+        self.allocator.destroy(stream);
+    }
+};
+
 test "chunks1" {
     const allocator = testing.allocator;
     var chunk_parser = try Stream.init(allocator);
@@ -322,3 +387,61 @@ test "parse interpolate" {
     const html_doc = streamer.getDocument();
     defer z.destroyDocument(html_doc);
 }
+
+test "Stream.reset and StreamPool" {
+    const allocator = testing.allocator;
+    var stream = try Stream.init(allocator);
+    defer z.destroyDocument(stream.getDocument());
+    defer stream.deinit();
+
+    const bodies = [_][]const []const u8{
+        &.{ "<ul><li>one</", "li><li>two</li></ul>" },
+        &.{ "<p>second <b", ">body</b></p>" },
+    };
+    const expected = [_][]const u8{
+        "<body><ul><li>one</li><li>two</li></ul></body>",
+        "<body><p>second <b>body</b></p></body>",
+    };
+    for (bodies, expected) |chunks, html| {
+        stream.reset();
+        try stream.beginParsing();
+        for (chunks) |chunk| try stream.processChunk(chunk);
+        try stream.endParsing();
+
+        const body = try z.outerHTML(allocator, z.bodyElement(stream.getDocument()).?);
+        defer allocator.free(body);
+        try testing.expectEqualStrings(html, body);
+    }
+
+    // reset in the middle of a body
+    try stream.beginParsing();
+    try stream.processChunk("<div><p>cut");
+    stream.reset();
+    try stream.beginParsing();
+    try stream.processChunk("<p>whole</p>");
+    try stream.endParsing();
+    try testing.expectEqualStrings("whole", z.textContent_zc(z.bodyNode(stream.getDocument()).?));
+
+    var pool: StreamPool = .init(allocator, 1);
+    defer pool.deinit();
+
+    const first = try pool.acquire();
+    const second = try pool.acquire();
+    try testing.expect(first != second);
+    try first.beginParsing();
+    try first.processChunk("<h1>pooled</h1>");
+    try first.endParsing();
+    pool.release(first);
+    // beyond `max_idle`: destroyed
+    pool.release(second);
+    try testing.expectEqual(1, pool.idle.items.len);
+
+    const again = try pool.acquire();
+    defer pool.release(again);
+    try testing.expect(again == first);
+    try testing.expect(z.bodyElement(again.getDocument()) == null);
+    try again.beginParsing();
+    try again.processChunk("<h2>next</h2>");
+    try again.endParsing();
+    try testing.expectEqualStrings("next", z.textContent_zc(z.bodyNode(again.getDocument()).?));
+}
@@ -2,6 +2,9 @@
 const std = @import("std");
 const z = @import("../root.zig");
 const Err = z.Err;
+// navigation, node type and owner document are field reads through the layout mirrors
+const layout = @import("dom_layout.zig");
+const mutation = @import("mutation.zig");
 
 const testing = std.testing;
 const print = std.debug.print;
@@ -9,10 +12,6 @@ const time = std.time;
 const Instant = time.Instant;
 const Timer = time.Timer;
 
-pub const LXB_TAG_TEMPLATE: u32 = 0x31; // From lexbor source
-pub const LXB_TAG_STYLE: u32 = 0x2d;
-pub const LXB_TAG_SCRIPT: u32 = 0x29;
-
 // =============================================================
 extern "c" fn lxb_html_document_create() ?*z.HTMLDocument;
 extern "c" fn lxb_html_document_destroy(doc: *z.HTMLDocument) void;
@@ -29,18 +28,16 @@ extern "c" fn lxb_dom_comment_interface_destroy(doc: *z.Comment) *z.Comment;
 extern "c" fn lxb_dom_node_insert_child(parent: *z.DomNode, child: *z.DomNode) void;
 extern "c" fn lxb_html_document_body_element_noi(doc: *z.HTMLDocument) ?*z.HTMLElement;
 extern "c" fn lxb_dom_document_root(doc: *z.HTMLDocument) ?*z.DomNode;
-extern "c" fn lexbor_node_owner_document_wrapper(node: *z.DomNode) *z.HTMLDocument;
-extern "c" fn lxb_dom_node_parent_noi(node: *z.DomNode) ?*z.DomNode;
 extern "c" fn lxb_dom_node_replace_all(parent: *z.DomNode, node: *z.DomNode) c_int;
 
 extern "c" fn lxb_dom_document_destroy_element(element: *z.HTMLElement) *z.HTMLElement;
 extern "c" fn lexbor_dom_interface_node_wrapper(obj: *anyopaque) *z.DomNode;
-extern "c" fn lexbor_dom_interface_element_wrapper(node: *z.DomNode) ?*z.HTMLElement;
 extern "c" fn lxb_dom_node_name(node: *z.DomNode, len: ?*usize) [*:0]const u8;
 extern "c" fn lxb_dom_element_tag_name(element: *z.HTMLElement, len: ?*usize) [*:0]const u8;
 extern "c" fn lxb_dom_element_qualified_name(element: *z.HTMLElement, len: *usize) [*:0]const u8;
 extern "c" fn lxb_dom_node_remove_wo_events(node: *z.DomNode) void;
 extern "c" fn lxb_dom_node_destroy(node: *z.DomNode) void;
+extern "c" fn lxb_dom_node_destroy_deep(root: *z.DomNode) ?*z.DomNode;
 extern "c" fn lxb_dom_document_destroy_text_noi(node: *z.DomNode, text: []const u8) void;
 
 extern "c" fn lxb_dom_node_clone(node: *z.DomNode, deep: bool) ?*z.DomNode;
@@ -49,10 +46,6 @@ extern "c" fn lxb_dom_document_import_node(doc: *z.HTMLDocument, node: *z.DomNod
 extern "c" fn lxb_html_node_is_void_noi(node: *z.DomNode) bool;
 extern "c" fn lxb_dom_node_is_empty(node: *z.DomNode) bool;
 
-extern "c" fn lxb_dom_node_first_child_noi(node: *z.DomNode) ?*z.DomNode;
-extern "c" fn lxb_dom_node_next_noi(node: *z.DomNode) ?*z.DomNode;
-extern "c" fn lxb_dom_node_prev_noi(node: *z.DomNode) ?*z.DomNode;
-extern "c" fn lxb_dom_node_last_child_noi(node: *z.DomNode) ?*z.DomNode;
 
 //===========================================================================
 // CORE DOCUMENT FUNCTIONS
@@ -74,11 +67,13 @@ pub fn createDocument() !*z.HTMLDocument {
 
 /// [core] Destroy an HTML document.
 pub fn destroyDocument(doc: *z.HTMLDocument) void {
+    mutation.notifyDocument(.destroyed, doc);
     lxb_html_document_destroy(doc);
 }
 
 /// [core] Clean up an HTML document.
 pub fn cleanDocument(doc: *z.HTMLDocument) void {
+    mutation.notifyDocument(.children_replaced, doc);
     lxb_html_document_clean(doc);
 }
 
@@ -242,7 +237,7 @@ test "documentRoot is HTML" {
 ///
 /// Useful with fragments/templates
 pub fn ownerDocument(node: *z.DomNode) *z.HTMLDocument {
-    return lexbor_node_owner_document_wrapper(node);
+    return layout.node(node).owner_document.?;
 }
 
 test "ownerDocument" {
@@ -324,25 +319,26 @@ pub fn objectToNode(obj: *anyopaque) *z.DomNode {
 }
 
 /// [core] Convert DOM Element to Node
-pub fn elementToNode(element: *z.HTMLElement) *z.DomNode {
-    return objectToNode(element);
+pub inline fn elementToNode(element: *z.HTMLElement) *z.DomNode {
+    // `lxb_html_element_t` starts with its `lxb_dom_node_t`
+    return @ptrCast(element);
 }
 
 /// [core] Convert Comment to Node
-pub fn commentToNode(comment: *z.Comment) *z.DomNode {
-    return objectToNode(comment);
+pub inline fn commentToNode(comment: *z.Comment) *z.DomNode {
+    return @ptrCast(comment);
 }
 
 /// [core] Convert DOM node to Element
 ///
 /// Returns NULL if the node is not an element
-pub fn nodeToElement(node: *z.DomNode) ?*z.HTMLElement {
+pub inline fn nodeToElement(node: *z.DomNode) ?*z.HTMLElement {
     // Only convert if it's actually an element node
-    if (z.nodeType(node) != .element) {
+    if (layout.nodeTypeId(node) != z.LXB_DOM_NODE_TYPE_ELEMENT) {
         return null;
     }
 
-    return lexbor_dom_interface_element_wrapper(node);
+    return @ptrCast(node);
 }
 
 /// [core] Cast Node of type `.comment` into *z.Comment that is a comment
@@ -655,14 +651,24 @@ pub fn qualifiedName_zc(element: *z.HTMLElement) []const u8 {
 
 /// [core] Remove a node from its parent
 pub fn removeNode(node: *z.DomNode) void {
+    mutation.notifyRemove(node);
     lxb_dom_node_remove_wo_events(node);
 }
 
-/// [core] Destroy a node from the DOM with its children
+/// [core] Destroy a node from the DOM; its children are not destroyed (see `destroyNode_deep`)
 pub fn destroyNode(node: *z.DomNode) void {
+    mutation.notifyRemove(node);
+    mutation.notify(.{ .kind = .destroyed, .target = node });
     lxb_dom_node_destroy(node);
 }
 
+/// [core] Detach a node and destroy it with its whole subtree
+pub fn destroyNode_deep(node: *z.DomNode) void {
+    mutation.notifyRemove(node);
+    mutation.notify(.{ .kind = .destroyed, .target = node });
+    _ = lxb_dom_node_destroy_deep(node);
+}
+
 // /// [core] Destroy an element in the document
 // pub fn destroyElement(element: *z.HTMLElement) void {
 //     _ = lxb_dom_document_destroy_element(element);
@@ -686,6 +692,15 @@ test "destruction" {
         std.debug.assert(z.firstChild(body) == null);
         std.debug.assert(z.isNodeEmpty(body));
     }
+    {
+        const doc = try z.createDocFromString("<div><p>a<b>b</b></p></div><i></i>");
+        defer z.destroyDocument(doc);
+
+        const body = z.bodyNode(doc).?;
+        destroyNode_deep(z.firstChild(body).?);
+        try testing.expectEqualStrings("I", z.nodeName_zc(z.firstChild(body).?));
+        try testing.expect(z.firstChild(body) == z.lastChild(body));
+    }
 }
 
 /// [core] Deep node clone in the same document
@@ -748,8 +763,8 @@ test "import between documents" {
 //=============================================================================
 
 /// [core] Parent node of a given node
-pub fn parentNode(node: *z.DomNode) ?*z.DomNode {
-    return lxb_dom_node_parent_noi(node);
+pub inline fn parentNode(node: *z.DomNode) ?*z.DomNode {
+    return layout.node(node).parent;
 }
 
 /// [core] Parent element of a given element
@@ -763,25 +778,25 @@ pub fn parentElement(element: *z.HTMLElement) ?*z.HTMLElement {
 }
 
 /// [core] Next sibling of node
-pub fn nextSibling(node: *z.DomNode) ?*z.DomNode {
-    return lxb_dom_node_next_noi(node);
+pub inline fn nextSibling(node: *z.DomNode) ?*z.DomNode {
+    return layout.node(node).next;
 }
 
 /// [core] Previous sibling of node
-pub fn previousSibling(node: *z.DomNode) ?*z.DomNode {
-    return lxb_dom_node_prev_noi(node);
+pub inline fn previousSibling(node: *z.DomNode) ?*z.DomNode {
+    return layout.node(node).prev;
 }
 
 /// [core] Get first child of node
 ///
 /// Returns NULL when there are no children.
-pub fn firstChild(node: *z.DomNode) ?*z.DomNode {
-    return lxb_dom_node_first_child_noi(node);
+pub inline fn firstChild(node: *z.DomNode) ?*z.DomNode {
+    return layout.node(node).first_child;
 }
 
 /// [core] Last child of node
-pub fn lastChild(node: *z.DomNode) ?*z.DomNode {
-    return lxb_dom_node_last_child_noi(node);
+pub inline fn lastChild(node: *z.DomNode) ?*z.DomNode {
+    return layout.node(node).last_child;
 }
 
 test "firstChild / lastChild / next / previous" {
@@ -970,19 +985,19 @@ test "first / last / nextElementSibling" {
 
 /// [core] Collect all child nodes from a node
 ///
-/// Returns a slice of all child nodes (including text, comments)
+/// Returns a slice of all child nodes (including text, comments).
+/// To loop over them once, `iterateChildren` does not allocate.
 ///
 /// Caller needs to free the slice
 pub fn childNodes(allocator: std.mem.Allocator, parent_node: *z.DomNode) ![]*z.DomNode {
-    var nodes: std.ArrayList(*z.DomNode) = .empty;
-
-    var child = firstChild(parent_node);
-    while (child != null) {
-        try nodes.append(allocator, child.?);
-        child = nextSibling(child.?);
-    }
+    var count: usize = 0;
+    var it = iterateChildren(parent_node);
+    while (it.next()) |_| count += 1;
 
-    return nodes.toOwnedSlice(allocator);
+    const nodes = try allocator.alloc(*z.DomNode, count);
+    it = iterateChildren(parent_node);
+    for (nodes) |*slot| slot.* = it.next().?;
+    return nodes;
 }
 
 test "childNodes" {
@@ -1006,6 +1021,8 @@ test "childNodes" {
 
 /// [core] Collect only element children from an element
 ///
+/// To loop over them once, `iterateElementChildren` does not allocate.
+///
 /// Allocated: Caller needs to free the slice
 /// ## Example
 /// ```
@@ -1025,15 +1042,10 @@ test "childNodes" {
 /// ```
 /// ## Signature
 pub fn children(allocator: std.mem.Allocator, parent_element: *z.HTMLElement) ![]*z.HTMLElement {
-    var elements: std.ArrayList(*z.HTMLElement) = .empty;
-
-    var child = firstElementChild(parent_element);
-    while (child != null) {
-        try elements.append(allocator, child.?);
-        child = nextElementSibling(child.?);
-    }
-
-    return elements.toOwnedSlice(allocator);
+    const elements = try allocator.alloc(*z.HTMLElement, childElementCount(parent_element));
+    var it = iterateElementChildren(parent_element);
+    for (elements) |*slot| slot.* = it.next().?;
+    return elements;
 }
 
 test "children" {
@@ -1054,6 +1066,204 @@ test "children" {
     );
 }
 
+/// [core] Number of element children, without allocating
+pub fn childElementCount(element: *z.HTMLElement) usize {
+    var count: usize = 0;
+    var it = iterateElementChildren(element);
+    while (it.next()) |_| count += 1;
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Non-allocating iterators
+//
+// Each iterator is a small struct read with `while (it.next()) |node|`.
+// The child, ancestor and sibling iterators step past a node before returning it,
+// so the returned node may be detached. `DescendantIterator` steps from the last
+// returned node: do not detach it before the next call to `next`.
+
+/// [core] Iterator over the child nodes (text and comments included)
+pub const ChildIterator = struct {
+    current: ?*z.DomNode,
+
+    pub fn next(self: *ChildIterator) ?*z.DomNode {
+        const node = self.current orelse return null;
+        self.current = nextSibling(node);
+        return node;
+    }
+};
+
+/// [core] Iterate over the child nodes of `node`
+///
+/// ## Example
+/// ```
+/// var it = z.iterateChildren(ul);
+/// while (it.next()) |child| { ... }
+/// ---
+/// ```
+pub fn iterateChildren(node: *z.DomNode) ChildIterator {
+    return .{ .current = firstChild(node) };
+}
+
+/// [core] Iterator over the element children
+pub const ElementChildIterator = struct {
+    current: ?*z.DomNode,
+
+    pub fn next(self: *ElementChildIterator) ?*z.HTMLElement {
+        while (self.current) |node| {
+            self.current = nextSibling(node);
+            if (nodeToElement(node)) |element| return element;
+        }
+        return null;
+    }
+};
+
+/// [core] Iterate over the element children of `element`
+pub fn iterateElementChildren(element: *z.HTMLElement) ElementChildIterator {
+    return .{ .current = firstChild(elementToNode(element)) };
+}
+
+/// [core] Iterator over the ancestors, closest first, up to the document node
+pub const AncestorIterator = struct {
+    current: ?*z.DomNode,
+
+    pub fn next(self: *AncestorIterator) ?*z.DomNode {
+        const node = self.current orelse return null;
+        self.current = parentNode(node);
+        return node;
+    }
+};
+
+/// [core] Iterate over the ancestors of `node`, `node` excluded
+pub fn iterateAncestors(node: *z.DomNode) AncestorIterator {
+    return .{ .current = parentNode(node) };
+}
+
+/// [core] Iterator over the siblings in one direction
+pub const SiblingIterator = struct {
+    current: ?*z.DomNode,
+    forward: bool,
+
+    pub fn next(self: *SiblingIterator) ?*z.DomNode {
+        const node = self.current orelse return null;
+        self.current = if (self.forward) nextSibling(node) else previousSibling(node);
+        return node;
+    }
+};
+
+/// [core] Iterate over the siblings after `node`, closest first
+pub fn iterateFollowingSiblings(node: *z.DomNode) SiblingIterator {
+    return .{ .current = nextSibling(node), .forward = true };
+}
+
+/// [core] Iterate over the siblings before `node`, closest first
+pub fn iteratePrecedingSiblings(node: *z.DomNode) SiblingIterator {
+    return .{ .current = previousSibling(node), .forward = false };
+}
+
+/// [core] Pre-order iterator over the descendants of a root, the root excluded
+pub const DescendantIterator = struct {
+    root: *z.DomNode,
+    /// last returned node
+    current: ?*z.DomNode = null,
+    skip_children: bool = false,
+    done: bool = false,
+
+    pub fn next(self: *DescendantIterator) ?*z.DomNode {
+        if (self.done) return null;
+        const from = self.current orelse self.root;
+        const skip = self.skip_children;
+        self.skip_children = false;
+
+        var node: ?*z.DomNode = null;
+        if (!skip) node = firstChild(from);
+        if (node == null and from != self.root) {
+            var up = from;
+            while (up != self.root) {
+                if (nextSibling(up)) |sibling| {
+                    node = sibling;
+                    break;
+                }
+                up = parentNode(up) orelse break;
+            }
+        }
+
+        self.current = node;
+        if (node == null) self.done = true;
+        return node;
+    }
+
+    /// Do not descend into the children of the last returned node
+    pub fn skipSubtree(self: *DescendantIterator) void {
+        self.skip_children = true;
+    }
+};
+
+/// [core] Iterate over the descendants of `root` in document order, `root` excluded
+///
+/// ## Example
+/// ```
+/// var it = z.iterateDescendants(body);
+/// while (it.next()) |node| {
+///     if (z.isTemplate(node)) it.skipSubtree();
+/// }
+/// ---
+/// ```
+pub fn iterateDescendants(root: *z.DomNode) DescendantIterator {
+    return .{ .root = root };
+}
+
+test "non-allocating iterators" {
+    const doc = try z.createDocFromString("<ul><li>a</li><!--c--><li><b>b</b></li><li>c</li></ul><p></p>");
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+    const ul = firstChild(body).?;
+
+    var count: usize = 0;
+    var child_it = iterateChildren(ul);
+    while (child_it.next()) |_| count += 1;
+    try testing.expectEqual(@as(usize, 4), count);
+    try testing.expectEqual(@as(usize, 3), childElementCount(nodeToElement(ul).?));
+
+    var element_it = iterateElementChildren(nodeToElement(ul).?);
+    while (element_it.next()) |li| try testing.expectEqualStrings("LI", tagName_zc(li));
+
+    const second_li = nextSibling(nextSibling(firstChild(ul).?).?).?;
+    const b = firstChild(second_li).?;
+    var ancestors = iterateAncestors(firstChild(b).?);
+    try testing.expect(ancestors.next().? == b);
+    try testing.expect(ancestors.next().? == second_li);
+    try testing.expect(ancestors.next().? == ul);
+    try testing.expect(ancestors.next().? == body);
+
+    var following = iterateFollowingSiblings(second_li);
+    try testing.expectEqualStrings("LI", nodeName_zc(following.next().?));
+    try testing.expect(following.next() == null);
+    var preceding = iteratePrecedingSiblings(second_li);
+    try testing.expectEqualStrings("#comment", nodeName_zc(preceding.next().?));
+    try testing.expectEqualStrings("LI", nodeName_zc(preceding.next().?));
+    try testing.expect(preceding.next() == null);
+
+    // ul, li, #text, #comment, li, b, #text, li, #text, p
+    count = 0;
+    var all = iterateDescendants(body);
+    while (all.next()) |_| count += 1;
+    try testing.expectEqual(@as(usize, 10), count);
+
+    // skipping the children of every <li>: ul, li, #comment, li, li, p
+    count = 0;
+    var pruned = iterateDescendants(body);
+    while (pruned.next()) |node| {
+        count += 1;
+        if (std.mem.eql(u8, nodeName_zc(node), "LI")) pruned.skipSubtree();
+    }
+    try testing.expectEqual(@as(usize, 6), count);
+
+    var empty = iterateDescendants(nextSibling(ul).?);
+    try testing.expect(empty.next() == null);
+    try testing.expect(empty.next() == null);
+}
+
 /// [core] Append a child node to parent
 ///
 /// ## Example
@@ -1065,6 +1275,7 @@ test "children" {
 ///
 /// ## Signature
 pub fn appendChild(parent: *z.DomNode, child: *z.DomNode) void {
+    mutation.notify(.{ .kind = .child_added, .target = parent, .node = child });
     lxb_dom_node_insert_child(parent, child);
 }
 
@@ -1127,6 +1338,7 @@ test "appendChild/dren" {
 ///
 /// Does not work as expected: check test "replaceAll"
 pub fn replaceAll(parent: *z.DomNode, node: *z.DomNode) !void {
+    mutation.notify(.{ .kind = .children_replaced, .target = parent, .node = node });
     if (lxb_dom_node_replace_all(parent, node) != z._OK) {
         return Err.ReplaceAllFailed;
     }
@@ -1179,11 +1391,13 @@ test "replaceAll" {
 
 /// [core] Insert a node after a reference node.
 pub fn insertAfter(reference_node: *z.DomNode, new_node: *z.DomNode) void {
+    if (parentNode(reference_node)) |parent| mutation.notify(.{ .kind = .child_added, .target = parent, .node = new_node });
     lxb_dom_node_insert_after_wo_events(reference_node, new_node);
 }
 
 /// [core] Insert a node before a reference node
 pub fn insertBefore(reference_node: *z.DomNode, new_node: *z.DomNode) void {
+    if (parentNode(reference_node)) |parent| mutation.notify(.{ .kind = .child_added, .target = parent, .node = new_node });
     lxb_dom_node_insert_before_wo_events(reference_node, new_node);
 }
 
@@ -0,0 +1,714 @@
+//! CSS inliner for HTML email: `<style>` rules are moved into `style` attributes
+//!
+//! - stylesheets and `style` attributes are parsed by `lexbor/css`; the declarations are read back
+//!   through lexbor's serializer, so known properties come out normalized and unknown ones verbatim;
+//! - each selector is matched with the cached `lexbor/selectors` engine, which also reports its specificity;
+//! - rules are indexed by the key of their rightmost compound (`#id`, `.class`, tag or `*`),
+//!   so an element is only matched against the rules that can apply to it;
+//! - declarations are merged per property following the cascade:
+//!   specificity then source order, inline `style` over rules, `!important` over both.
+//!
+//! At-rules (`@media`, `@font-face`, ...) and selectors that can not be inlined (`:hover`, `::before`, ...)
+//! are kept in a single residual `<style>` element.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+const CssMemory = opaque {};
+const CssStylesheet = opaque {};
+/// `lxb_css_rule_t` and the rule structs starting with it
+const CssRule = opaque {};
+
+extern "c" fn lxb_css_parser_create() ?*z.CssParser;
+extern "c" fn lxb_css_parser_init(parser: *z.CssParser, tkz: ?*anyopaque) c_uint;
+extern "c" fn lxb_css_parser_destroy(parser: *z.CssParser, destroy_self: bool) ?*z.CssParser;
+extern "c" fn lxb_css_memory_create() ?*CssMemory;
+extern "c" fn lxb_css_memory_init(memory: *CssMemory, prepare_count: usize) c_uint;
+extern "c" fn lxb_css_memory_clean(memory: *CssMemory) void;
+extern "c" fn lxb_css_memory_destroy(memory: *CssMemory, self_destroy: bool) ?*CssMemory;
+
+extern "c" fn lxb_css_stylesheet_parse(parser: *z.CssParser, data: [*]const u8, length: usize) ?*CssStylesheet;
+extern "c" fn lxb_css_stylesheet_destroy(sst: *CssStylesheet, destroy_memory: bool) ?*CssStylesheet;
+extern "c" fn lxb_css_declaration_list_parse(parser: *z.CssParser, memory: *CssMemory, data: [*]const u8, length: usize) ?*CssRule;
+
+const SerializeCb = *const fn (data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint;
+extern "c" fn lxb_css_rule_at_serialize(rule: *CssRule, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+extern "c" fn lxb_css_rule_bad_style_serialize(rule: *CssRule, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+extern "c" fn lxb_css_rule_declaration_serialize(rule: *CssRule, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+extern "c" fn lxb_css_selector_serialize_list(list: *z.CssSelectorList, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+
+// src/minimal.c
+extern "c" fn lexbor_css_stylesheet_first_rule_wrapper(sst: *CssStylesheet) ?*CssRule;
+extern "c" fn lexbor_css_rule_next_wrapper(rule: *CssRule) ?*CssRule;
+extern "c" fn lexbor_css_rule_type_wrapper(rule: *CssRule) c_int;
+extern "c" fn lexbor_css_rule_style_selectors_wrapper(rule: *CssRule) ?*z.CssSelectorList;
+extern "c" fn lexbor_css_selector_list_next_wrapper(list: *z.CssSelectorList) ?*z.CssSelectorList;
+extern "c" fn lexbor_css_rule_first_declaration_wrapper(rule: *CssRule) ?*CssRule;
+extern "c" fn lexbor_css_rule_declaration_important_wrapper(rule: *CssRule) bool;
+
+// from lexbor source: /css/rule.h
+const LXB_CSS_RULE_AT_RULE = 3;
+const LXB_CSS_RULE_STYLE = 4;
+const LXB_CSS_RULE_BAD_STYLE = 5;
+const LXB_CSS_RULE_DECLARATION = 7;
+
+pub const InlineOptions = struct {
+    /// remove the `<style>` elements once inlined; the first one is kept when there are residual rules
+    remove_style_elements: bool = true,
+    /// keep `!important` on inlined declarations
+    keep_important: bool = false,
+};
+
+pub const InlineStats = struct {
+    /// selector + declarations pairs indexed for inlining
+    rules: usize = 0,
+    /// elements whose `style` attribute was written
+    styled: usize = 0,
+    /// at-rules and non-inlinable rules kept in the residual `<style>`
+    residual_rules: usize = 0,
+    /// selectors rejected by the lexbor selector parser; their rules are kept in the residual `<style>`
+    invalid_selectors: usize = 0,
+};
+
+const Declaration = struct {
+    property: []const u8,
+    value: []const u8,
+    important: bool,
+};
+
+const Rule = struct {
+    selector: []const u8,
+    declarations: []const Declaration,
+    invalid: bool = false,
+};
+
+const Match = struct {
+    specificity: z.CssSelectorSpecificity,
+    rule: u32,
+
+    fn lessThan(_: void, a: Match, b: Match) bool {
+        if (a.specificity != b.specificity) return a.specificity < b.specificity;
+        return a.rule < b.rule;
+    }
+};
+
+const RuleList = std.ArrayList(u32);
+
+/// Pseudo-classes and pseudo-elements that depend on user interaction or generated content
+const non_inlinable_pseudos = [_][]const u8{
+    "hover",       "active",       "focus",         "focus-within", "focus-visible",
+    "visited",     "link",         "target",        "before",       "after",
+    "first-line",  "first-letter", "selection",     "placeholder",  "marker",
+};
+
+const whitespace = " \t\r\n\x0c";
+
+/// [inliner] Reusable CSS inliner.
+///
+/// The selector engine and its parsed selectors are kept across documents,
+/// which pays off when the same template stylesheet is inlined into many emails.
+pub const CssInliner = struct {
+    allocator: std.mem.Allocator,
+    engine: z.CssSelectorEngine,
+    /// stylesheet and `style` attribute parser
+    css_parser: *z.CssParser,
+    /// rules of the `style` attribute being parsed, cleaned once read
+    css_memory: *CssMemory,
+    /// stylesheet of the current document: rules, declarations, index and residual CSS
+    arena: std.heap.ArenaAllocator,
+    rules: std.ArrayList(Rule) = .empty,
+    by_id: std.StringHashMapUnmanaged(RuleList) = .empty,
+    by_class: std.StringHashMapUnmanaged(RuleList) = .empty,
+    by_tag: std.StringHashMapUnmanaged(RuleList) = .empty,
+    universal: RuleList = .empty,
+    residual: std.ArrayList(u8) = .empty,
+    /// quirks mode document: `#id` and `.class` keys are indexed and looked up in lowercase
+    quirks: bool = false,
+    // per element scratch, kept across documents
+    candidates: RuleList = .empty,
+    key: std.ArrayList(u8) = .empty,
+    matches: std.ArrayList(Match) = .empty,
+    merged: std.ArrayList(Declaration) = .empty,
+    out: std.Io.Writer.Allocating,
+
+    const Self = @This();
+
+    pub fn init(allocator: std.mem.Allocator) !Self {
+        const css_parser = lxb_css_parser_create() orelse return Err.CssParserCreateFailed;
+        errdefer _ = lxb_css_parser_destroy(css_parser, true);
+        if (lxb_css_parser_init(css_parser, null) != z._OK) return Err.CssParserInitFailed;
+
+        const css_memory = lxb_css_memory_create() orelse return error.OutOfMemory;
+        errdefer _ = lxb_css_memory_destroy(css_memory, true);
+        if (lxb_css_memory_init(css_memory, 128) != z._OK) return error.OutOfMemory;
+
+        return .{
+            .allocator = allocator,
+            .engine = try z.CssSelectorEngine.init(allocator),
+            .css_parser = css_parser,
+            .css_memory = css_memory,
+            .arena = std.heap.ArenaAllocator.init(allocator),
+            .out = std.Io.Writer.Allocating.init(allocator),
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.candidates.deinit(self.allocator);
+        self.key.deinit(self.allocator);
+        self.matches.deinit(self.allocator);
+        self.merged.deinit(self.allocator);
+        self.out.deinit();
+        self.arena.deinit();
+        self.engine.deinit();
+        _ = lxb_css_memory_destroy(self.css_memory, true);
+        _ = lxb_css_parser_destroy(self.css_parser, true);
+    }
+
+    fn reset(self: *Self) void {
+        _ = self.arena.reset(.retain_capacity);
+        self.rules = .empty;
+        self.by_id = .empty;
+        self.by_class = .empty;
+        self.by_tag = .empty;
+        self.universal = .empty;
+        self.residual = .empty;
+    }
+
+    /// [inliner] Inline the `<style>` elements of `doc` into the `style` attributes of the body elements
+    pub fn inlineDocument(self: *Self, doc: *z.HTMLDocument, options: InlineOptions) !InlineStats {
+        self.reset();
+        self.quirks = z.isQuirksMode(doc);
+        const arena = self.arena.allocator();
+        var stats: InlineStats = .{};
+
+        const root = z.documentRoot(doc) orelse return Err.DocumentRootNotFound;
+        var styles: ElementCollector = .{ .allocator = arena, .mode = .styles };
+        z.simpleWalk(root, ElementCollector.callback, &styles);
+        if (styles.failed) return error.OutOfMemory;
+
+        for (styles.elements.items) |style| {
+            const css = try z.textContent(arena, z.elementToNode(style));
+            try self.parseStylesheet(css, &stats);
+        }
+
+        if (self.rules.items.len > 0) {
+            if (z.bodyElement(doc)) |body| {
+                var elements: ElementCollector = .{ .allocator = arena, .mode = .content };
+                try elements.elements.append(arena, body);
+                z.simpleWalk(z.elementToNode(body), ElementCollector.callback, &elements);
+                if (elements.failed) return error.OutOfMemory;
+
+                for (elements.elements.items) |element| {
+                    if (try self.inlineElement(element, options, &stats)) stats.styled += 1;
+                }
+            }
+        }
+
+        if (options.remove_style_elements) {
+            for (styles.elements.items, 0..) |style, i| {
+                const node = z.elementToNode(style);
+                if (i == 0 and self.residual.items.len > 0) {
+                    try z.setContentAsText(node, self.residual.items);
+                } else {
+                    z.destroyNode_deep(node);
+                }
+            }
+        }
+
+        return stats;
+    }
+
+    fn parseStylesheet(self: *Self, css: []const u8, stats: *InlineStats) !void {
+        const sheet = lxb_css_stylesheet_parse(self.css_parser, css.ptr, css.len) orelse
+            return Err.CssStylesheetParseFailed;
+        defer _ = lxb_css_stylesheet_destroy(sheet, true);
+
+        var next = lexbor_css_stylesheet_first_rule_wrapper(sheet);
+        while (next) |rule| : (next = lexbor_css_rule_next_wrapper(rule)) {
+            switch (lexbor_css_rule_type_wrapper(rule)) {
+                LXB_CSS_RULE_STYLE => try self.addStyleRule(rule, stats),
+                LXB_CSS_RULE_AT_RULE => {
+                    try self.appendResidual(try self.serialize(rule, &lxb_css_rule_at_serialize));
+                    stats.residual_rules += 1;
+                },
+                // the selector list lexbor could not parse, kept as written for the mail clients
+                LXB_CSS_RULE_BAD_STYLE => {
+                    try self.appendResidual(try self.serialize(rule, &lxb_css_rule_bad_style_serialize));
+                    stats.invalid_selectors += 1;
+                },
+                else => {},
+            }
+        }
+    }
+
+    /// One indexed rule per selector of the list, or a residual rule for the non-inlinable ones
+    fn addStyleRule(self: *Self, rule: *CssRule, stats: *InlineStats) !void {
+        const arena = self.arena.allocator();
+        const declarations = try self.readDeclarations(rule);
+        if (declarations.len == 0) return;
+
+        var next = lexbor_css_rule_style_selectors_wrapper(rule);
+        while (next) |list| : (next = lexbor_css_selector_list_next_wrapper(list)) {
+            const selector = try arena.dupe(u8, try self.serialize(list, &lxb_css_selector_serialize_list));
+            if (selector.len == 0) continue;
+
+            if (isInlinable(selector)) {
+                try self.addRule(selector, declarations);
+                stats.rules += 1;
+            } else {
+                try self.appendResidual(selector);
+                try self.residual.append(arena, '{');
+                for (declarations, 0..) |declaration, i| {
+                    if (i > 0) try self.residual.appendSlice(arena, "; ");
+                    try self.residual.print(arena, "{s}: {s}", .{ declaration.property, declaration.value });
+                    if (declaration.important) try self.residual.appendSlice(arena, " !important");
+                }
+                try self.residual.append(arena, '}');
+                stats.residual_rules += 1;
+            }
+        }
+    }
+
+    /// Declarations of a style rule or a declaration list, copied into the arena.
+    /// Property names are lowercased; nested at-rules are skipped.
+    fn readDeclarations(self: *Self, rule: *CssRule) ![]const Declaration {
+        const arena = self.arena.allocator();
+        var declarations: std.ArrayList(Declaration) = .empty;
+
+        var next = lexbor_css_rule_first_declaration_wrapper(rule);
+        while (next) |declaration| : (next = lexbor_css_rule_next_wrapper(declaration)) {
+            if (lexbor_css_rule_type_wrapper(declaration) != LXB_CSS_RULE_DECLARATION) continue;
+
+            // "name: value", with " !important" for the properties lexbor knows
+            const text = try self.serialize(declaration, &lxb_css_rule_declaration_serialize);
+            const colon = std.mem.indexOfScalar(u8, text, ':') orelse continue;
+            const property = std.mem.trim(u8, text[0..colon], whitespace);
+            var value = std.mem.trim(u8, text[colon + 1 ..], whitespace);
+
+            const important = lexbor_css_rule_declaration_important_wrapper(declaration);
+            if (important and std.ascii.endsWithIgnoreCase(value, "!important")) {
+                value = std.mem.trimRight(u8, value[0 .. value.len - "!important".len], whitespace);
+            }
+            if (property.len == 0 or value.len == 0) continue;
+
+            try declarations.append(arena, .{
+                .property = try std.ascii.allocLowerString(arena, property),
+                .value = try arena.dupe(u8, value),
+                .important = important,
+            });
+        }
+        return declarations.items;
+    }
+
+    fn parseStyleAttribute(self: *Self, style: []const u8) ![]const Declaration {
+        if (std.mem.trim(u8, style, whitespace).len == 0) return &.{};
+        defer lxb_css_memory_clean(self.css_memory);
+        const list = lxb_css_declaration_list_parse(self.css_parser, self.css_memory, style.ptr, style.len) orelse
+            return Err.CssStylesheetParseFailed;
+        return self.readDeclarations(list);
+    }
+
+    /// `object` serialized by lexbor into `out`. Valid until the next call.
+    fn serialize(
+        self: *Self,
+        object: anytype,
+        serializer: *const fn (@TypeOf(object), SerializeCb, ?*anyopaque) callconv(.c) c_uint,
+    ) ![]const u8 {
+        self.out.clearRetainingCapacity();
+        if (serializer(object, writerCallback, &self.out.writer) != z._OK) return Err.SerializeFailed;
+        return self.out.written();
+    }
+
+    fn appendResidual(self: *Self, css: []const u8) !void {
+        const arena = self.arena.allocator();
+        if (self.residual.items.len > 0) try self.residual.append(arena, '\n');
+        try self.residual.appendSlice(arena, css);
+    }
+
+    fn addRule(self: *Self, selector: []const u8, declarations: []const Declaration) !void {
+        const arena = self.arena.allocator();
+        const index: u32 = @intCast(self.rules.items.len);
+        try self.rules.append(arena, .{ .selector = selector, .declarations = declarations });
+
+        const list = switch (indexKey(rightmostCompound(selector))) {
+            .id => |id| try getOrPutList(arena, &self.by_id, if (self.quirks) try lowerIfNeeded(arena, id) else id),
+            .class => |class| try getOrPutList(arena, &self.by_class, if (self.quirks) try lowerIfNeeded(arena, class) else class),
+            .tag => |tag| try getOrPutList(arena, &self.by_tag, try lowerIfNeeded(arena, tag)),
+            .universal => &self.universal,
+        };
+        try list.append(arena, index);
+    }
+
+    /// `#id` / `.class` index key of an attribute value: lowercased in quirks mode,
+    /// where selectors match them ASCII case-insensitively. Valid until the next call.
+    fn lookupKey(self: *Self, name: []const u8) ![]const u8 {
+        if (!self.quirks) return name;
+        for (name, 0..) |c, i| {
+            if (!std.ascii.isUpper(c)) continue;
+            self.key.clearRetainingCapacity();
+            try self.key.appendSlice(self.allocator, name);
+            _ = std.ascii.lowerString(self.key.items[i..], self.key.items[i..]);
+            return self.key.items;
+        }
+        return name;
+    }
+
+    fn inlineElement(self: *Self, element: *z.HTMLElement, options: InlineOptions, stats: *InlineStats) !bool {
+        const node = z.elementToNode(element);
+
+        self.candidates.clearRetainingCapacity();
+        try self.candidates.appendSlice(self.allocator, self.universal.items);
+        if (self.by_tag.get(z.qualifiedName_zc(element))) |list| {
+            try self.candidates.appendSlice(self.allocator, list.items);
+        }
+        if (z.getAttribute_zc(element, "id")) |id| {
+            if (self.by_id.get(try self.lookupKey(id))) |list| try self.candidates.appendSlice(self.allocator, list.items);
+        }
+        if (z.getAttribute_zc(element, "class")) |class_attr| {
+            var classes = std.mem.tokenizeAny(u8, class_attr, whitespace);
+            while (classes.next()) |class| {
+                if (self.by_class.get(try self.lookupKey(class))) |list| try self.candidates.appendSlice(self.allocator, list.items);
+            }
+        }
+        if (self.candidates.items.len == 0) return false;
+
+        // source order, and `class="a a"` must not match a rule twice
+        std.mem.sort(u32, self.candidates.items, {}, std.sort.asc(u32));
+
+        self.matches.clearRetainingCapacity();
+        var previous: ?u32 = null;
+        for (self.candidates.items) |index| {
+            if (previous == index) continue;
+            previous = index;
+
+            const rule = &self.rules.items[index];
+            if (rule.invalid) continue;
+            const matched = self.engine.matchSpecificity(node, rule.selector) catch |err| switch (err) {
+                error.CssSelectorParseFailed => {
+                    rule.invalid = true;
+                    stats.invalid_selectors += 1;
+                    continue;
+                },
+                else => return err,
+            };
+            const specificity = matched orelse continue;
+            try self.matches.append(self.allocator, .{ .specificity = specificity, .rule = index });
+        }
+        if (self.matches.items.len == 0) return false;
+
+        std.mem.sort(Match, self.matches.items, {}, Match.lessThan);
+
+        const inline_style = z.getAttribute_zc(element, "style") orelse "";
+        const inline_declarations = try self.parseStyleAttribute(inline_style);
+
+        // cascade, lowest precedence first: rules, inline style, important rules, important inline style
+        self.merged.clearRetainingCapacity();
+        for ([_]bool{ false, true }) |important| {
+            for (self.matches.items) |match| {
+                for (self.rules.items[match.rule].declarations) |declaration| {
+                    if (declaration.important == important) try self.setDeclaration(declaration);
+                }
+            }
+            for (inline_declarations) |declaration| {
+                if (declaration.important == important) try self.setDeclaration(declaration);
+            }
+        }
+
+        self.out.clearRetainingCapacity();
+        const writer = &self.out.writer;
+        for (self.merged.items, 0..) |declaration, i| {
+            if (i > 0) try writer.writeAll("; ");
+            try writer.print("{s}: {s}", .{ declaration.property, declaration.value });
+            if (declaration.important and options.keep_important) try writer.writeAll(" !important");
+        }
+
+        _ = z.setAttribute(element, "style", self.out.written()) orelse return Err.SetAttributeFailed;
+        return true;
+    }
+
+    /// Later declarations win; an overridden property moves to the end so that
+    /// shorthands and longhands keep their cascade order.
+    fn setDeclaration(self: *Self, declaration: Declaration) !void {
+        for (self.merged.items, 0..) |existing, i| {
+            if (std.ascii.eqlIgnoreCase(existing.property, declaration.property)) {
+                _ = self.merged.orderedRemove(i);
+                break;
+            }
+        }
+        try self.merged.append(self.allocator, declaration);
+    }
+};
+
+/// [inliner] Inline the `<style>` rules of `doc` into `style` attributes.
+///
+/// Use a `CssInliner` to inline many documents sharing the same stylesheet.
+/// ## Example
+/// ```
+/// const doc = try z.createDocFromString("<style>p { color: red }</style><p>Hi</p>");
+/// defer z.destroyDocument(doc);
+/// _ = try z.inlineStyles(allocator, doc, .{});
+/// // <p style="color: red">Hi</p>
+/// ---
+/// ```
+pub fn inlineStyles(allocator: std.mem.Allocator, doc: *z.HTMLDocument, options: InlineOptions) !InlineStats {
+    var inliner = try CssInliner.init(allocator);
+    defer inliner.deinit();
+    return inliner.inlineDocument(doc, options);
+}
+
+const ElementCollector = struct {
+    allocator: std.mem.Allocator,
+    mode: enum { styles, content },
+    elements: std.ArrayList(*z.HTMLElement) = .empty,
+    failed: bool = false,
+
+    fn callback(node: *z.DomNode, ctx: ?*anyopaque) callconv(.c) c_int {
+        const self = z.castContext(ElementCollector, ctx);
+        const element = z.nodeToElement(node) orelse return z._CONTINUE;
+        const tag = z.tagFromAnyElement(element);
+        const keep = switch (self.mode) {
+            .styles => tag == .style,
+            .content => tag != .style and tag != .script and tag != .template,
+        };
+        if (keep) {
+            self.elements.append(self.allocator, element) catch {
+                self.failed = true;
+                return z._STOP;
+            };
+        }
+        return z._CONTINUE;
+    }
+};
+
+fn getOrPutList(arena: std.mem.Allocator, map: *std.StringHashMapUnmanaged(RuleList), key: []const u8) !*RuleList {
+    const gop = try map.getOrPut(arena, key);
+    if (!gop.found_existing) gop.value_ptr.* = .empty;
+    return gop.value_ptr;
+}
+
+fn lowerIfNeeded(arena: std.mem.Allocator, name: []const u8) ![]const u8 {
+    for (name) |c| {
+        if (std.ascii.isUpper(c)) return std.ascii.allocLowerString(arena, name);
+    }
+    return name;
+}
+
+/// Index of the closing quote of the string opened at `open`
+fn skipString(css: []const u8, open: usize) usize {
+    const quote = css[open];
+    var i = open + 1;
+    while (i < css.len) : (i += 1) {
+        if (css[i] == '\\') {
+            i += 1;
+        } else if (css[i] == quote) {
+            return i;
+        }
+    }
+    return css.len - 1;
+}
+
+fn writerCallback(data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint {
+    const writer = z.castContext(std.Io.Writer, ctx);
+    writer.writeAll(data[0..len]) catch return 1;
+    return 0;
+}
+
+fn isInlinable(selector: []const u8) bool {
+    if (std.mem.indexOf(u8, selector, "::") != null) return false;
+
+    var pos: usize = 0;
+    while (std.mem.indexOfScalarPos(u8, selector, pos, ':')) |colon| {
+        pos = colon + 1;
+        var end = pos;
+        while (end < selector.len and isIdentChar(selector[end])) end += 1;
+        for (non_inlinable_pseudos) |pseudo| {
+            if (std.ascii.eqlIgnoreCase(selector[pos..end], pseudo)) return false;
+        }
+    }
+    return true;
+}
+
+fn isIdentChar(c: u8) bool {
+    return std.ascii.isAlphanumeric(c) or c == '-' or c == '_' or c >= 0x80;
+}
+
+/// Compound selector after the last top-level combinator
+fn rightmostCompound(selector: []const u8) []const u8 {
+    var start: usize = 0;
+    var depth: usize = 0;
+    var i: usize = 0;
+    while (i < selector.len) : (i += 1) {
+        switch (selector[i]) {
+            '\\' => i += 1,
+            '"', '\'' => i = skipString(selector, i),
+            '(', '[' => depth += 1,
+            ')', ']' => depth -|= 1,
+            ' ', '\t', '\r', '\n', '\x0c', '>', '+', '~' => if (depth == 0) {
+                start = i + 1;
+            },
+            else => {},
+        }
+    }
+    return selector[start..];
+}
+
+const IndexKey = union(enum) {
+    id: []const u8,
+    class: []const u8,
+    tag: []const u8,
+    universal,
+};
+
+/// Most selective key of a compound: `#id`, else the first `.class`, else the tag
+fn indexKey(compound: []const u8) IndexKey {
+    // escaped identifiers are left to the selector engine
+    if (std.mem.indexOfScalar(u8, compound, '\\') != null) return .universal;
+
+    var key: IndexKey = .universal;
+    var tag_end: usize = 0;
+    while (tag_end < compound.len and isIdentChar(compound[tag_end])) tag_end += 1;
+    if (tag_end > 0) key = .{ .tag = compound[0..tag_end] };
+
+    var depth: usize = 0;
+    var i: usize = tag_end;
+    while (i < compound.len) : (i += 1) {
+        switch (compound[i]) {
+            '"', '\'' => i = skipString(compound, i),
+            '(', '[' => depth += 1,
+            ')', ']' => depth -|= 1,
+            '#', '.' => |c| if (depth == 0) {
+                var end = i + 1;
+                while (end < compound.len and isIdentChar(compound[end])) end += 1;
+                if (end == i + 1) continue;
+                const name = compound[i + 1 .. end];
+                if (c == '#') return .{ .id = name };
+                if (key != .class) key = .{ .class = name };
+                i = end - 1;
+            },
+            else => {},
+        }
+    }
+    return key;
+}
+
+test "inlineStyles follows the cascade and keeps residual rules" {
+    const allocator = testing.allocator;
+    const html =
+        \\<html><head><style>
+        \\/* base */
+        \\p { color: red; margin: 0 }
+        \\.lead { color: blue }
+        \\#intro { color: green !important }
+        \\p.note, div > .note { font-weight: bold }
+        \\a:hover { color: pink }
+        \\@media (max-width: 600px) { p { color: black } }
+        \\</style><style>span { display: none }</style></head><body>
+        \\<p id="intro" class="lead" style="color: orange; padding: 1px">Intro</p>
+        \\<p class="note">Note</p>
+        \\<a href="#">Link</a>
+        \\</body></html>
+    ;
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    const stats = try inlineStyles(allocator, doc, .{});
+    try testing.expectEqual(@as(usize, 6), stats.rules);
+    try testing.expectEqual(@as(usize, 2), stats.styled);
+    try testing.expectEqual(@as(usize, 2), stats.residual_rules);
+
+    const intro = z.firstElementChild(z.bodyElement(doc).?).?;
+    try testing.expectEqualStrings("margin: 0; padding: 1px; color: green", z.getAttribute_zc(intro, "style").?);
+    const note = z.nextElementSibling(intro).?;
+    try testing.expectEqualStrings("color: red; margin: 0; font-weight: bold", z.getAttribute_zc(note, "style").?);
+    const link = z.nextElementSibling(note).?;
+    try testing.expect(z.getAttribute_zc(link, "style") == null);
+
+    // the first <style> holds the residual CSS, the second one is removed
+    const serialized = try z.outerHTML(allocator, z.nodeToElement(z.documentRoot(doc).?).?);
+    defer allocator.free(serialized);
+    try testing.expect(std.mem.indexOf(u8, serialized, "a:hover{color: pink}") != null);
+    try testing.expect(std.mem.indexOf(u8, serialized, "@media (max-width: 600px)") != null);
+    try testing.expect(std.mem.indexOf(u8, serialized, "p { color: black }") != null);
+    try testing.expect(std.mem.indexOf(u8, serialized, "span") == null);
+    try testing.expect(std.mem.indexOf(u8, serialized, ".lead") == null);
+}
+
+test "CssInliner handles strings, url(), invalid selectors and reuse across documents" {
+    const allocator = testing.allocator;
+    var inliner = try CssInliner.init(allocator);
+    defer inliner.deinit();
+
+    const html =
+        \\<style>
+        \\/* .x { color: red } */
+        \\.x { background: url(data:image/png;base64,AAA) ; content: "a;b}" }
+        \\td.cell { padding: 4px !important }
+        \\p[ { color: red }
+        \\</style>
+        \\<div class="x y x">A</div><table><tr><td class="cell" style="padding: 0">1</td></tr></table>
+    ;
+    for (0..2) |_| {
+        const doc = try z.createDocFromString(html);
+        defer z.destroyDocument(doc);
+
+        const stats = try inliner.inlineDocument(doc, .{ .keep_important = true });
+        try testing.expectEqual(@as(usize, 2), stats.rules);
+        try testing.expectEqual(@as(usize, 2), stats.styled);
+        try testing.expectEqual(@as(usize, 0), stats.residual_rules);
+        try testing.expectEqual(@as(usize, 1), stats.invalid_selectors);
+
+        const div = z.firstElementChild(z.bodyElement(doc).?).?;
+        try testing.expectEqualStrings(
+            "background: url(data:image/png;base64,AAA); content: \"a;b}\"",
+            z.getAttribute_zc(div, "style").?,
+        );
+        const tds = try z.querySelectorAll(allocator, doc, "td");
+        defer allocator.free(tds);
+        try testing.expectEqualStrings("padding: 4px !important", z.getAttribute_zc(tds[0], "style").?);
+    }
+}
+
+test "CssInliner matches class and id case-insensitively in quirks mode only" {
+    const allocator = testing.allocator;
+    var inliner = try CssInliner.init(allocator);
+    defer inliner.deinit();
+
+    const body =
+        \\<style>.Note { color: red } #Intro { margin: 0 }</style>
+        \\<p class="NOTE" id="intro">A</p>
+    ;
+    const cases = [_]struct { doctype: []const u8, styled: usize }{
+        // no doctype: quirks mode
+        .{ .doctype = "", .styled = 1 },
+        .{ .doctype = "<!DOCTYPE html>", .styled = 0 },
+    };
+    for (cases) |case| {
+        const html = try std.mem.concat(allocator, u8, &.{ case.doctype, body });
+        defer allocator.free(html);
+        const doc = try z.createDocFromString(html);
+        defer z.destroyDocument(doc);
+
+        const stats = try inliner.inlineDocument(doc, .{});
+        try testing.expectEqual(case.styled, stats.styled);
+        if (case.styled > 0) {
+            const p = z.firstElementChild(z.bodyElement(doc).?).?;
+            try testing.expectEqualStrings("color: red; margin: 0", z.getAttribute_zc(p, "style").?);
+        }
+    }
+}
+
+test "rule index keys" {
+    try testing.expectEqualStrings("a.b#c", rightmostCompound("div > p a.b#c"));
+    try testing.expectEqualStrings("[data-x=\"a b\"]", rightmostCompound("ul [data-x=\"a b\"]"));
+    try testing.expectEqualStrings("c", indexKey("a.b#c").id);
+    try testing.expectEqualStrings("b", indexKey("a.b:not(.z)").class);
+    try testing.expectEqualStrings("td", indexKey("td[colspan]").tag);
+    try testing.expect(indexKey("*") == .universal);
+    try testing.expect(isInlinable("p:first-child"));
+    try testing.expect(!isInlinable("a:HOVER span"));
+    try testing.expect(!isInlinable("p::before"));
+}
@@ -4,6 +4,7 @@ const std = @import("std");
 const z = @import("../root.zig");
 
 const Err = z.Err;
+const mutation = @import("mutation.zig");
 
 const testing = std.testing;
 const print = std.debug.print;
@@ -40,11 +41,11 @@ extern "c" fn lxb_selectors_opt_set_noi(selectors: *z.CssSelectors, opts: usize)
 // Find nodes matching selectors
 extern "c" fn lxb_selectors_find(selectors: *z.CssSelectors, root: *z.DomNode, list: *z.CssSelectorList, callback: *const fn (
     node: *z.DomNode,
-    spec: *z.CssSelectorSpecificity,
+    spec: z.CssSelectorSpecificity,
     ctx: ?*anyopaque,
 ) callconv(.c) usize, ctx: ?*anyopaque) usize;
 
-extern "c" fn lxb_selectors_match_node(selectors: *z.CssSelectors, node: *z.DomNode, list: *z.CssSelectorList, callback: *const fn (*z.DomNode, *z.CssSelectorSpecificity, ?*anyopaque) callconv(.c) usize, ctx: ?*anyopaque) usize;
+extern "c" fn lxb_selectors_match_node(selectors: *z.CssSelectors, node: *z.DomNode, list: *z.CssSelectorList, callback: *const fn (*z.DomNode, z.CssSelectorSpecificity, ?*anyopaque) callconv(.c) usize, ctx: ?*anyopaque) usize;
 
 // Cleanup selector list
 extern "c" fn lxb_css_selector_list_destroy_memory(list: *z.CssSelectorList) void;
@@ -68,6 +69,10 @@ pub const CssSelectorEngine = struct {
     initialized: bool = false,
     // Selector cache for performance
     selector_cache: std.StringHashMap(StoredSelector),
+    // Optional `querySelectorAll` results memo, see `enableResultCache`
+    results: ?*ResultCache = null,
+    // Optional per-selector profile, see `enableProfiling`
+    profiler: ?*Profiler = null,
 
     const Self = @This();
 
@@ -105,6 +110,8 @@ pub const CssSelectorEngine = struct {
 
     /// [selectors] Clean up CSS selector engine
     pub fn deinit(self: *Self) void {
+        self.disableResultCache();
+        self.disableProfiling();
         if (self.initialized) {
             // Clean up all cached selectors
             var iterator = self.selector_cache.iterator();
@@ -146,11 +153,14 @@ pub const CssSelectorEngine = struct {
             return cached;
         }
 
-        // Not cached - compile and store it
+        // Not cached - compile and store it, keyed on the owned copy so the
+        // caller's slice may be freed afterwards
         const parsed = try self.parseSelector(selector);
-        try self.selector_cache.put(selector, parsed);
+        errdefer parsed.deinit();
+        const gop = try self.selector_cache.getOrPut(parsed.original_selector);
+        gop.value_ptr.* = parsed;
 
-        return self.selector_cache.getPtr(selector).?;
+        return gop.value_ptr;
     }
 
     /// [selectors] Find first matching node using cached selector
@@ -162,6 +172,7 @@ pub const CssSelectorEngine = struct {
         if (!self.initialized) return Err.CssEngineNotInitialized;
 
         var context = FirstNodeContext.init();
+        const started = self.profileBegin();
 
         const status = lxb_selectors_find(
             self.selectors,
@@ -176,6 +187,7 @@ pub const CssSelectorEngine = struct {
             return Err.CssSelectorFindFailed;
         }
 
+        if (started) |start| self.profileEnd(start, selector.original_selector, .{ .until = .{ root_node, context.first_node } }, @intFromBool(context.first_node != null));
         return context.first_node;
     }
 
@@ -189,6 +201,7 @@ pub const CssSelectorEngine = struct {
 
         var context = FindContext.init(self.allocator);
         defer context.deinit();
+        const started = self.profileBegin();
 
         const status = lxb_selectors_find(
             self.selectors,
@@ -202,6 +215,7 @@ pub const CssSelectorEngine = struct {
             return Err.CssSelectorFindFailed;
         }
 
+        if (started) |start| self.profileEnd(start, selector.original_selector, .{ .subtree = root_node }, context.results.items.len);
         return context.results.toOwnedSlice(self.allocator);
     }
 
@@ -242,35 +256,248 @@ pub const CssSelectorEngine = struct {
         // Use cached selector for better performance
         const _selector = try self.getOrParseSelector(selector);
 
-        var context = FindContext.init(self.allocator);
-        defer context.deinit();
+        var context = MatchContext{};
+        const started = self.profileBegin();
+        const status = lxb_selectors_match_node(
+            self.selectors,
+            node,
+            _selector.selector_list,
+            matchCallback,
+            &context,
+        );
 
+        if (status != z._OK) {
+            return Err.CssSelectorMatchFailed;
+        }
+        if (started) |start| self.profileEnd(start, _selector.original_selector, .{ .nodes = 1 }, @intFromBool(context.matched));
+
+        return context.matched;
+    }
+
+    /// [selectors] Match a single node and return the specificity of the match
+    ///
+    /// Returns null when the node does not match. The packed value orders like
+    /// the cascade does (ids, then classes, then types), so it can be compared directly.
+    pub fn matchSpecificity(self: *Self, node: *z.DomNode, selector: []const u8) !?z.CssSelectorSpecificity {
+        if (!self.initialized) return Err.CssEngineNotInitialized;
+        if (!z.isTypeElement(node)) return null;
+
+        const _selector = try self.getOrParseSelector(selector);
+
+        var context = MatchContext{};
+        const started = self.profileBegin();
         const status = lxb_selectors_match_node(
             self.selectors,
             node,
             _selector.selector_list,
-            findCallback,
+            matchCallback,
             &context,
         );
 
         if (status != z._OK) {
             return Err.CssSelectorMatchFailed;
         }
+        if (started) |start| self.profileEnd(start, _selector.original_selector, .{ .nodes = 1 }, @intFromBool(context.matched));
 
-        return context.results.items.len > 0;
+        return if (context.matched) context.specificity else null;
     }
 
     /// Find matching nodes (with caching and optional type filtering)
     ///
+    /// With the result cache enabled, an unchanged document returns a copy of the memoized result.
+    ///
     /// Caller needs to free the slice
     pub fn querySelectorAll(self: *Self, root_node: *z.DomNode, selector: []const u8) ![]*z.DomNode {
         if (!self.initialized) return Err.CssEngineNotInitialized;
 
+        if (self.results != null) {
+            const shared = try self.querySelectorAllShared(root_node, selector);
+            return self.allocator.dupe(*z.DomNode, shared);
+        }
+
         // Use cached selector for better performance
         const _selector = try self.getOrParseSelector(selector);
         return self.querySelectorAllCached(root_node, _selector);
     }
 
+    /// [selectors] Record per-selector call counts, timings, visited nodes and matches
+    ///
+    /// Covers `querySelector`, `querySelectorAll`, `matchNode`, `matchSpecificity` and the `*Cached` variants.
+    /// Disabled (default), the only cost is a null check per query. Enabled, each query also
+    /// counts the nodes of the searched subtree, so keep it for diagnostics runs.
+    /// ## Example
+    /// ```
+    /// try engine.enableProfiling();
+    /// // ... run the workload
+    /// try engine.writeProfileReport(writer, .total_time, 10);
+    /// ---
+    /// ```
+    pub fn enableProfiling(self: *Self) !void {
+        if (self.profiler != null) return;
+        const profiler = try self.allocator.create(Profiler);
+        profiler.* = .{};
+        self.profiler = profiler;
+    }
+
+    /// [selectors] Stop profiling and drop the recorded profile
+    pub fn disableProfiling(self: *Self) void {
+        const profiler = self.profiler orelse return;
+        self.resetProfile();
+        profiler.entries.deinit(self.allocator);
+        self.allocator.destroy(profiler);
+        self.profiler = null;
+    }
+
+    /// [selectors] Drop the recorded profile, profiling stays enabled
+    pub fn resetProfile(self: *Self) void {
+        const profiler = self.profiler orelse return;
+        var it = profiler.entries.keyIterator();
+        while (it.next()) |key| self.allocator.free(key.*);
+        profiler.entries.clearRetainingCapacity();
+    }
+
+    /// [selectors] Recorded profile sorted in descending order of `sort`
+    ///
+    /// Caller frees the slice; the selector strings belong to the engine until `resetProfile`.
+    pub fn profileReport(self: *const Self, allocator: std.mem.Allocator, sort: ProfileSort) ![]SelectorProfile {
+        const profiler = self.profiler orelse return allocator.alloc(SelectorProfile, 0);
+        const report = try allocator.alloc(SelectorProfile, profiler.entries.count());
+        var it = profiler.entries.valueIterator();
+        var i: usize = 0;
+        while (it.next()) |profile| : (i += 1) report[i] = profile.*;
+        std.mem.sort(SelectorProfile, report, sort, SelectorProfile.greaterThan);
+        return report;
+    }
+
+    /// [selectors] Writes the `limit` first rows of the sorted profile as a table
+    pub fn writeProfileReport(self: *const Self, writer: *std.Io.Writer, sort: ProfileSort, limit: usize) !void {
+        const report = try self.profileReport(self.allocator, sort);
+        defer self.allocator.free(report);
+
+        try writer.print("{s:>8} {s:>12} {s:>10} {s:>10} {s:>12} {s:>10}  {s}\n", .{ "calls", "total ms", "mean us", "max us", "visited", "matches", "selector" });
+        for (report[0..@min(limit, report.len)]) |p| {
+            try writer.print("{d:>8} {d:>12.3} {d:>10.2} {d:>10.2} {d:>12} {d:>10}  {s}\n", .{
+                p.calls,
+                @as(f64, @floatFromInt(p.total_ns)) / 1_000_000.0,
+                @as(f64, @floatFromInt(p.meanNs())) / 1_000.0,
+                @as(f64, @floatFromInt(p.max_ns)) / 1_000.0,
+                p.nodes_visited,
+                p.matches,
+                p.selector,
+            });
+        }
+    }
+
+    /// Start time of a profiled query, null when profiling is disabled
+    inline fn profileBegin(self: *const Self) ?std.time.Instant {
+        if (self.profiler == null) return null;
+        return std.time.Instant.now() catch null;
+    }
+
+    fn profileEnd(self: *Self, start: std.time.Instant, selector: []const u8, scope: ProfileScope, matches: usize) void {
+        const now = std.time.Instant.now() catch return;
+        const elapsed = now.since(start);
+        const profiler = self.profiler orelse return;
+
+        const gop = profiler.entries.getOrPut(self.allocator, selector) catch return;
+        if (!gop.found_existing) {
+            const key = self.allocator.dupe(u8, selector) catch {
+                profiler.entries.removeByPtr(gop.key_ptr);
+                return;
+            };
+            gop.key_ptr.* = key;
+            gop.value_ptr.* = .{ .selector = key };
+        }
+        const profile = gop.value_ptr;
+        profile.calls += 1;
+        profile.total_ns += elapsed;
+        profile.max_ns = @max(profile.max_ns, elapsed);
+        profile.nodes_visited += scope.count();
+        profile.matches += matches;
+    }
+
+    /// [selectors] Memoize `querySelectorAll` results per (root, selector) until the document changes
+    ///
+    /// A result is reused while its document generation is unchanged: every mutation made through the
+    /// wrapper APIs (see `z.addMutationObserver`) bumps the generation of its document.
+    /// Changes made by calling lexbor directly are not seen: `clearResultCache` after them.
+    pub fn enableResultCache(self: *Self, options: ResultCacheOptions) !void {
+        if (self.results != null) return;
+        const cache = try self.allocator.create(ResultCache);
+        errdefer self.allocator.destroy(cache);
+        cache.* = .{ .allocator = self.allocator, .options = options };
+        try mutation.addMutationObserver(.{ .document = null, .context = cache, .callback = ResultCache.onMutation });
+        self.results = cache;
+    }
+
+    /// [selectors] Drop the memoized results and stop tracking mutations
+    pub fn disableResultCache(self: *Self) void {
+        const cache = self.results orelse return;
+        mutation.removeMutationObserver(cache);
+        cache.deinit();
+        self.allocator.destroy(cache);
+        self.results = null;
+    }
+
+    /// [selectors] Drop the memoized results, the cache stays enabled
+    pub fn clearResultCache(self: *Self) void {
+        if (self.results) |cache| cache.clear();
+    }
+
+    /// [selectors] Hit and memory statistics of the result cache, null when disabled
+    pub fn resultCacheStats(self: *const Self) ?ResultCacheStats {
+        const cache = self.results orelse return null;
+        return cache.stats;
+    }
+
+    /// [selectors] `querySelectorAll` returning the memoized slice, enabling the result cache if needed
+    ///
+    /// The slice is owned by the engine: it is valid until the next query or mutation, do not free it.
+    pub fn querySelectorAllShared(self: *Self, root_node: *z.DomNode, selector: []const u8) ![]const *z.DomNode {
+        if (!self.initialized) return Err.CssEngineNotInitialized;
+        if (self.results == null) try self.enableResultCache(.{});
+        const cache = self.results.?;
+
+        if (try cache.lookup(root_node, selector)) |nodes| return nodes;
+
+        const _selector = try self.getOrParseSelector(selector);
+        const nodes = try self.querySelectorAllCached(root_node, _selector);
+        return cache.remember(root_node, nodes);
+    }
+
+    /// [selectors] Stream the outer HTML of every node matching `selector` under `root_node`
+    ///
+    /// Matches are serialized from the selector callback, so no result slice is built;
+    /// with the result cache enabled, the memoized slice is serialized instead.
+    /// Returns the number of serialized nodes.
+    pub fn serializeMatches(self: *Self, root_node: *z.DomNode, selector: []const u8, writer: *std.Io.Writer) !usize {
+        if (!self.initialized) return Err.CssEngineNotInitialized;
+
+        if (self.results != null) {
+            const nodes = try self.querySelectorAllShared(root_node, selector);
+            try z.serializeNodesTo(writer, nodes, "");
+            return nodes.len;
+        }
+
+        const _selector = try self.getOrParseSelector(selector);
+        var context = SerializeContext{ .writer = writer };
+        const started = self.profileBegin();
+
+        const status = lxb_selectors_find(
+            self.selectors,
+            root_node,
+            _selector.selector_list,
+            serializeCallback,
+            &context,
+        );
+
+        if (context.failed) |err| return err;
+        if (status != z._OK) return Err.CssSelectorFindFailed;
+
+        if (started) |start| self.profileEnd(start, _selector.original_selector, .{ .subtree = root_node }, context.count);
+        return context.count;
+    }
+
     /// Query: Find all descendant nodes that match the selector
     ///
     /// /// Caller needs to free the slice
@@ -339,6 +566,239 @@ pub const CssSelectorEngine = struct {
     }
 };
 
+pub const ProfileSort = enum { total_time, max_time, calls, nodes_visited, matches };
+
+/// [selectors] Profile of one selector
+pub const SelectorProfile = struct {
+    selector: []const u8,
+    calls: u64 = 0,
+    total_ns: u64 = 0,
+    max_ns: u64 = 0,
+    /// element nodes in the searched scope: the subtree for `querySelectorAll`,
+    /// the nodes up to the first match for `querySelector`, 1 for `matchNode`
+    nodes_visited: u64 = 0,
+    matches: u64 = 0,
+
+    pub fn meanNs(self: SelectorProfile) u64 {
+        return if (self.calls == 0) 0 else self.total_ns / self.calls;
+    }
+
+    fn greaterThan(sort: ProfileSort, a: SelectorProfile, b: SelectorProfile) bool {
+        return switch (sort) {
+            .total_time => a.total_ns > b.total_ns,
+            .max_time => a.max_ns > b.max_ns,
+            .calls => a.calls > b.calls,
+            .nodes_visited => a.nodes_visited > b.nodes_visited,
+            .matches => a.matches > b.matches,
+        };
+    }
+};
+
+const Profiler = struct {
+    entries: std.StringHashMapUnmanaged(SelectorProfile) = .empty,
+};
+
+/// Nodes searched by a profiled query
+const ProfileScope = union(enum) {
+    subtree: *z.DomNode,
+    /// pre-order from the root up to the first match, the whole subtree without one
+    until: struct { *z.DomNode, ?*z.DomNode },
+    nodes: usize,
+
+    fn count(self: ProfileScope) usize {
+        return switch (self) {
+            .subtree => |root| countElements(root, null),
+            .until => |range| countElements(range[0], range[1]),
+            .nodes => |n| n,
+        };
+    }
+
+    fn countElements(root: *z.DomNode, stop: ?*z.DomNode) usize {
+        var total: usize = @intFromBool(z.nodeType(root) == .element);
+        if (stop == null or stop.? != root) {
+            var it = z.iterateDescendants(root);
+            while (it.next()) |current| {
+                if (z.nodeType(current) == .element) total += 1;
+                if (stop != null and stop.? == current) break;
+            }
+        }
+        return total;
+    }
+};
+
+pub const ResultCacheOptions = struct {
+    /// memory for the cached node slices and keys
+    max_bytes: usize = 1 << 20,
+    max_entries: usize = 1024,
+};
+
+pub const ResultCacheStats = struct {
+    hits: u64 = 0,
+    misses: u64 = 0,
+    /// misses on a result invalidated by a mutation
+    stale: u64 = 0,
+    evictions: u64 = 0,
+    entries: usize = 0,
+    bytes: usize = 0,
+
+    pub fn hitRate(self: ResultCacheStats) f64 {
+        const total = self.hits + self.misses;
+        if (total == 0) return 0;
+        return @as(f64, @floatFromInt(self.hits)) / @as(f64, @floatFromInt(total));
+    }
+};
+
+/// `querySelectorAll` results keyed on (root address, selector), validated by document generation
+///
+/// Heap-allocated by the engine so that its address, registered as a mutation observer, is stable.
+const ResultCache = struct {
+    allocator: std.mem.Allocator,
+    options: ResultCacheOptions,
+    stats: ResultCacheStats = .{},
+    entries: std.StringHashMapUnmanaged(CachedResult) = .empty,
+    /// bumped on each mutation; dropped with the entries of the document when it is destroyed,
+    /// so that a new document at the same address never matches old results
+    generations: std.AutoHashMapUnmanaged(*z.HTMLDocument, u64) = .empty,
+    key: std.ArrayList(u8) = .empty,
+    tick: u64 = 0,
+    /// result over the limits, owned until the next query
+    oversized: []*z.DomNode = &.{},
+
+    const CachedResult = struct {
+        document: *z.HTMLDocument,
+        generation: u64,
+        last_used: u64,
+        nodes: []*z.DomNode,
+    };
+
+    fn deinit(self: *ResultCache) void {
+        self.clear();
+        self.allocator.free(self.oversized);
+        self.entries.deinit(self.allocator);
+        self.generations.deinit(self.allocator);
+        self.key.deinit(self.allocator);
+    }
+
+    fn clear(self: *ResultCache) void {
+        var it = self.entries.iterator();
+        while (it.next()) |entry| {
+            self.allocator.free(entry.key_ptr.*);
+            self.allocator.free(entry.value_ptr.nodes);
+        }
+        self.entries.clearRetainingCapacity();
+        self.generations.clearRetainingCapacity();
+        self.stats.entries = 0;
+        self.stats.bytes = 0;
+    }
+
+    fn onMutation(context: *anyopaque, m: *const mutation.Mutation) void {
+        const self: *ResultCache = @ptrCast(@alignCast(context));
+        const document = mutation.documentOf(m.target);
+        if (m.kind == .destroyed and z.nodeType(m.target) == .document) {
+            if (self.generations.remove(document)) self.evictDocument(document);
+            return;
+        }
+        const generation = self.generations.getPtr(document) orelse return;
+        generation.* += 1;
+    }
+
+    /// Drops the entries of a destroyed document
+    fn evictDocument(self: *ResultCache, document: *z.HTMLDocument) void {
+        var it = self.entries.iterator();
+        while (it.next()) |entry| {
+            if (entry.value_ptr.document != document) continue;
+            const key = entry.key_ptr.*;
+            const nodes = entry.value_ptr.nodes;
+            // removal only leaves a tombstone: the iterator stays valid
+            self.entries.removeByPtr(entry.key_ptr);
+            self.stats.entries -= 1;
+            self.stats.bytes -= entryBytes(key.len, nodes.len);
+            self.allocator.free(key);
+            self.allocator.free(nodes);
+        }
+    }
+
+    fn entryBytes(key_len: usize, node_count: usize) usize {
+        return key_len + node_count * @sizeOf(*z.DomNode);
+    }
+
+    /// Memoized result of (root, selector) when still valid; leaves the key in `self.key`
+    fn lookup(self: *ResultCache, root: *z.DomNode, selector: []const u8) !?[]const *z.DomNode {
+        self.allocator.free(self.oversized);
+        self.oversized = &.{};
+        self.key.clearRetainingCapacity();
+        try self.key.appendSlice(self.allocator, std.mem.asBytes(&root));
+        try self.key.appendSlice(self.allocator, selector);
+        self.tick += 1;
+
+        if (self.entries.getPtr(self.key.items)) |entry| {
+            const current = self.generations.get(entry.document) orelse 0;
+            if (entry.generation == current) {
+                self.stats.hits += 1;
+                entry.last_used = self.tick;
+                return entry.nodes;
+            }
+            self.stats.stale += 1;
+        }
+        self.stats.misses += 1;
+        return null;
+    }
+
+    /// Stores `nodes` (ownership transferred) under the key of the last `lookup`
+    fn remember(self: *ResultCache, root: *z.DomNode, nodes: []*z.DomNode) ![]const *z.DomNode {
+        errdefer self.allocator.free(nodes);
+        const document = mutation.documentOf(root);
+        const gop_generation = try self.generations.getOrPut(self.allocator, document);
+        if (!gop_generation.found_existing) gop_generation.value_ptr.* = 0;
+        const generation = gop_generation.value_ptr.*;
+
+        if (self.entries.getPtr(self.key.items)) |entry| {
+            // stale entry: replace its result in place
+            self.stats.bytes = self.stats.bytes - entryBytes(self.key.items.len, entry.nodes.len) + entryBytes(self.key.items.len, nodes.len);
+            self.allocator.free(entry.nodes);
+            entry.* = .{ .document = document, .generation = generation, .last_used = self.tick, .nodes = nodes };
+            self.shrink(self.key.items);
+            return nodes;
+        }
+
+        const bytes = entryBytes(self.key.items.len, nodes.len);
+        if (bytes > self.options.max_bytes or self.options.max_entries == 0) {
+            self.oversized = nodes;
+            return nodes;
+        }
+
+        const key = try self.allocator.dupe(u8, self.key.items);
+        errdefer self.allocator.free(key);
+        try self.entries.put(self.allocator, key, .{ .document = document, .generation = generation, .last_used = self.tick, .nodes = nodes });
+        self.stats.entries += 1;
+        self.stats.bytes += bytes;
+        self.shrink(key);
+        return nodes;
+    }
+
+    /// Evicts the least recently used entries, other than `keep`, until the limits hold
+    fn shrink(self: *ResultCache, keep: []const u8) void {
+        while (self.stats.entries > self.options.max_entries or self.stats.bytes > self.options.max_bytes) {
+            var oldest: ?[]const u8 = null;
+            var oldest_tick: u64 = std.math.maxInt(u64);
+            var it = self.entries.iterator();
+            while (it.next()) |entry| {
+                if (entry.value_ptr.last_used < oldest_tick and !std.mem.eql(u8, entry.key_ptr.*, keep)) {
+                    oldest = entry.key_ptr.*;
+                    oldest_tick = entry.value_ptr.last_used;
+                }
+            }
+            const victim = oldest orelse return;
+            const removed = self.entries.fetchRemove(victim).?;
+            self.stats.entries -= 1;
+            self.stats.bytes -= entryBytes(removed.key.len, removed.value.nodes.len);
+            self.stats.evictions += 1;
+            self.allocator.free(removed.key);
+            self.allocator.free(removed.value.nodes);
+        }
+    }
+};
+
 // === CALLBACK CONTEXT
 
 const FindContext = struct {
@@ -355,13 +815,42 @@ const FindContext = struct {
 };
 
 /// Callback function for lxb_selectors_find
-fn findCallback(node: *z.DomNode, _: *z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
+fn findCallback(node: *z.DomNode, _: z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
     const context: *FindContext = @ptrCast(@alignCast(ctx.?));
     context.results.append(context.allocator, node) catch return z._STOP; // Return error status on allocation failure
 
     return z._OK;
 }
 
+const SerializeContext = struct {
+    writer: *std.Io.Writer,
+    count: usize = 0,
+    failed: ?anyerror = null,
+};
+
+fn serializeCallback(node: *z.DomNode, _: z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
+    const context: *SerializeContext = @ptrCast(@alignCast(ctx.?));
+    z.serializeTo(node, context.writer) catch |err| {
+        context.failed = err;
+        return z._STOP;
+    };
+    context.count += 1;
+    return z._OK;
+}
+
+/// Non-allocating context for single node matching
+const MatchContext = struct {
+    matched: bool = false,
+    specificity: z.CssSelectorSpecificity = 0,
+};
+
+fn matchCallback(_: *z.DomNode, spec: z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
+    const context: *MatchContext = @ptrCast(@alignCast(ctx.?));
+    if (!context.matched or spec > context.specificity) context.specificity = spec;
+    context.matched = true;
+    return z._OK;
+}
+
 // Special context for early stopping (nodes)
 const FirstNodeContext = struct {
     first_node: ?*z.DomNode,
@@ -381,7 +870,7 @@ const FirstElementContext = struct {
 };
 
 /// Callback that stops after finding first node
-fn findFirstNodeCallback(node: *z.DomNode, _: *z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
+fn findFirstNodeCallback(node: *z.DomNode, _: z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
     const context: *FirstNodeContext = @ptrCast(@alignCast(ctx.?));
     context.first_node = node;
 
@@ -391,7 +880,7 @@ fn findFirstNodeCallback(node: *z.DomNode, _: *z.CssSelectorSpecificity, ctx: ?*
 }
 
 /// Callback that stops after finding first element
-fn findFirstElementCallback(node: *z.DomNode, _: *z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
+fn findFirstElementCallback(node: *z.DomNode, _: z.CssSelectorSpecificity, ctx: ?*anyopaque) callconv(.c) usize {
     const context: *FirstElementContext = @ptrCast(@alignCast(ctx.?));
 
     if (z.nodeToElement(node)) |element| {
@@ -1309,3 +1798,121 @@ test "multiple reuse css_engine" {
     // print("{s}\n", .{details_template_html});
     // print("{s}\n", .{cart_item_template_html});
 }
+
+test "result cache follows document generations" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("<ul><li class='a'>1</li><li>2</li><li class='a'>3</li></ul>");
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    var engine = try CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+    try engine.enableResultCache(.{ .max_entries = 2 });
+
+    const first = try engine.querySelectorAllShared(body, ".a");
+    try testing.expectEqual(@as(usize, 2), first.len);
+    const again = try engine.querySelectorAllShared(body, ".a");
+    try testing.expect(first.ptr == again.ptr);
+    try testing.expectEqual(@as(u64, 1), engine.resultCacheStats().?.hits);
+
+    // a mutation invalidates the result
+    const second_li = z.nextSibling(z.firstChild(z.firstChild(body).?).?).?;
+    _ = z.setAttribute(z.nodeToElement(second_li).?, "class", "a");
+    const updated = try engine.querySelectorAllShared(body, ".a");
+    try testing.expectEqual(@as(usize, 3), updated.len);
+    try testing.expectEqual(@as(u64, 1), engine.resultCacheStats().?.stale);
+
+    // owned copies keep working
+    const owned = try engine.querySelectorAll(body, ".a");
+    defer allocator.free(owned);
+    try testing.expectEqual(@as(usize, 3), owned.len);
+
+    // another document is not invalidated by this one
+    const other = try z.createDocFromString("<p class='a'></p>");
+    defer z.destroyDocument(other);
+    _ = try engine.querySelectorAllShared(z.bodyNode(other).?, ".a");
+    _ = z.setAttribute(z.nodeToElement(second_li).?, "id", "x");
+    _ = try engine.querySelectorAllShared(z.bodyNode(other).?, ".a");
+    try testing.expectEqual(@as(u64, 3), engine.resultCacheStats().?.hits);
+
+    // limits: least recently used entry is evicted
+    _ = try engine.querySelectorAllShared(body, "li");
+    const stats = engine.resultCacheStats().?;
+    try testing.expectEqual(@as(usize, 2), stats.entries);
+    try testing.expect(stats.evictions >= 1);
+    try testing.expect(stats.hitRate() > 0);
+}
+
+test "result cache forgets destroyed documents" {
+    const allocator = testing.allocator;
+    var engine = try CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+    try engine.enableResultCache(.{});
+
+    const kept = try z.createDocFromString("<p class='a'></p>");
+    defer z.destroyDocument(kept);
+    _ = try engine.querySelectorAllShared(z.bodyNode(kept).?, ".a");
+
+    for (0..50) |_| {
+        const doc = try z.createDocFromString("<p class='a'></p><p class='a'></p>");
+        const found = try engine.querySelectorAllShared(z.bodyNode(doc).?, ".a");
+        try testing.expectEqual(@as(usize, 2), found.len);
+        z.destroyDocument(doc);
+    }
+
+    const cache = engine.results.?;
+    try testing.expectEqual(@as(u32, 1), cache.generations.count());
+    try testing.expectEqual(@as(usize, 1), engine.resultCacheStats().?.entries);
+    try testing.expectEqual(@as(u32, 1), cache.entries.count());
+
+    // the surviving document still hits
+    _ = try engine.querySelectorAllShared(z.bodyNode(kept).?, ".a");
+    try testing.expectEqual(@as(u64, 1), engine.resultCacheStats().?.hits);
+
+    engine.clearResultCache();
+    try testing.expectEqual(@as(u32, 0), cache.generations.count());
+}
+
+test "selector profiling" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("<div><p class='a'>1</p><p>2</p><section><p class='a'>3</p></section></div>");
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    var engine = try CssSelectorEngine.init(allocator);
+    defer engine.deinit();
+
+    // disabled: nothing recorded
+    _ = try engine.querySelector(body, "p");
+    const empty = try engine.profileReport(allocator, .calls);
+    defer allocator.free(empty);
+    try testing.expectEqual(@as(usize, 0), empty.len);
+
+    try engine.enableProfiling();
+    for (0..3) |_| {
+        const nodes = try engine.querySelectorAll(body, ".a");
+        allocator.free(nodes);
+    }
+    _ = try engine.querySelector(body, "section p");
+    _ = try engine.matchNode(z.firstChild(body).?, "div");
+
+    const report = try engine.profileReport(allocator, .calls);
+    defer allocator.free(report);
+    try testing.expectEqual(@as(usize, 3), report.len);
+    try testing.expectEqualStrings(".a", report[0].selector);
+    try testing.expectEqual(@as(u64, 3), report[0].calls);
+    try testing.expectEqual(@as(u64, 6), report[0].matches);
+    // body, div, 3 p, section
+    try testing.expectEqual(@as(u64, 18), report[0].nodes_visited);
+    try testing.expect(report[0].max_ns <= report[0].total_ns);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try engine.writeProfileReport(&out.writer, .total_time, 2);
+    try testing.expectEqual(@as(usize, 3), std.mem.count(u8, out.written(), "\n"));
+
+    engine.resetProfile();
+    const cleared = try engine.profileReport(allocator, .calls);
+    defer allocator.free(cleared);
+    try testing.expectEqual(@as(usize, 0), cleared.len);
+}
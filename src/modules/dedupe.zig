@@ -0,0 +1,495 @@
+//! Duplicate subtree detection across a document corpus
+//!
+//! Crawled pages repeat the same headers, footers and navigation blocks.
+//! This module computes a _structural hash_ for every subtree (tag name, attributes,
+//! text and the ordered hashes of its children) in a single iterative post-order walk,
+//! and records the subtrees above a size threshold in a `SubtreeIndex` shared by many documents.
+//!
+//! The index can then:
+//! - report the duplicated subtrees (`duplicates`),
+//! - replace the repeated occurrences in a document by a reference comment `<!--z-dup:HASH-->` (`replaceDuplicates`).
+//!
+//! The index keeps hashes and counters, plus the node of each first occurrence: that pointer is
+//! only compared with `first_doc` (to keep the first occurrence in place), never dereferenced,
+//! so documents can be destroyed once indexed.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const SubtreeHash = u64;
+
+/// Prefix of the comment that replaces a duplicated subtree
+pub const dup_ref_prefix = "z-dup:";
+
+pub const DedupeOptions = struct {
+    /// Minimum number of nodes (element, text, comment) of a subtree to be indexed
+    min_nodes: usize = 8,
+    /// Whitespace-only text nodes do not contribute to the hash
+    skip_whitespace: bool = true,
+    /// Comments do not contribute to the hash
+    skip_comments: bool = true,
+    /// Number of occurrences from which a subtree is considered duplicated
+    min_occurrences: usize = 2,
+};
+
+/// [dedupe] A duplicated subtree reported by `SubtreeIndex.duplicates`
+pub const Duplicate = struct {
+    hash: SubtreeHash,
+    /// Number of nodes in the subtree
+    nodes: usize,
+    /// Total number of occurrences in the corpus
+    occurrences: usize,
+    /// Number of distinct documents containing it
+    documents: usize,
+};
+
+const Entry = struct {
+    nodes: usize,
+    occurrences: usize,
+    documents: usize,
+    last_doc: u32,
+    // first occurrence: kept in place by `replaceDuplicates`; `first_node` is compared, never dereferenced
+    first_doc: u32,
+    first_node: *z.DomNode,
+};
+
+// -------------------------------------------------------------------------------
+// Structural hashing
+// -------------------------------------------------------------------------------
+
+const Frame = struct {
+    node: *z.DomNode,
+    hasher: std.hash.Wyhash,
+    nodes: usize,
+};
+
+/// Opens the hash frame of a node, or returns null if the node is ignored
+fn openFrame(node: *z.DomNode, options: DedupeOptions) ?Frame {
+    var hasher = std.hash.Wyhash.init(0);
+
+    switch (z.nodeType(node)) {
+        .element => {
+            const element = z.nodeToElement(node).?;
+            hasher.update("<");
+            hasher.update(z.qualifiedName_zc(element));
+            var it = z.iterateAttributes(element);
+            while (it.next()) |attr| {
+                hasher.update(&[_]u8{0});
+                hasher.update(attr.name);
+                hasher.update("=");
+                hasher.update(attr.value);
+            }
+            hasher.update(">");
+        },
+        .text => {
+            const content = z.textContent_zc(node);
+            if (options.skip_whitespace and z.isWhitespaceOnly(content)) return null;
+            hasher.update("#text");
+            hasher.update(content);
+        },
+        .comment => {
+            if (options.skip_comments) return null;
+            hasher.update("#comment");
+            hasher.update(z.commentContent_zc(z.nodeToComment(node).?));
+        },
+        .document => hasher.update("#document"),
+        .fragment => hasher.update("#document-fragment"),
+        .unknown => return null,
+    }
+    return .{ .node = node, .hasher = hasher, .nodes = 1 };
+}
+
+/// Iterative post-order walk computing the structural hash of every subtree of `root`.
+///
+/// `visitor.visit(node, hash, nodes)` is called for each element subtree with at least `options.min_nodes` nodes.
+/// Returns the hash of `root` (0 if `root` is ignored).
+fn walkHashes(
+    allocator: std.mem.Allocator,
+    root: *z.DomNode,
+    options: DedupeOptions,
+    visitor: anytype,
+) !SubtreeHash {
+    var stack: std.ArrayList(Frame) = .empty;
+    defer stack.deinit(allocator);
+    try stack.ensureTotalCapacity(allocator, 32);
+
+    if (openFrame(root, options)) |frame| try stack.append(allocator, frame);
+
+    var node = root;
+    outer: while (true) {
+        if (z.firstChild(node)) |child| {
+            node = child;
+            if (openFrame(child, options)) |frame| try stack.append(allocator, frame);
+            continue;
+        }
+
+        // leaf reached: close frames and climb until a next sibling exists
+        while (true) {
+            const hash = try closeFrame(&stack, node, options, visitor);
+            if (node == root) return hash;
+
+            if (z.nextSibling(node)) |sibling| {
+                node = sibling;
+                if (openFrame(sibling, options)) |frame| try stack.append(allocator, frame);
+                continue :outer;
+            }
+            node = z.parentNode(node) orelse return hash;
+        }
+    }
+}
+
+fn closeFrame(
+    stack: *std.ArrayList(Frame),
+    node: *z.DomNode,
+    options: DedupeOptions,
+    visitor: anytype,
+) !SubtreeHash {
+    // ignored nodes have no frame
+    if (stack.items.len == 0 or stack.items[stack.items.len - 1].node != node) return 0;
+
+    const top = &stack.items[stack.items.len - 1];
+    const hash = top.hasher.final();
+    const nodes = top.nodes;
+    stack.items.len -= 1;
+
+    if (stack.items.len > 0) {
+        const parent = &stack.items[stack.items.len - 1];
+        parent.hasher.update(std.mem.asBytes(&hash));
+        parent.nodes += nodes;
+    }
+
+    if (nodes >= options.min_nodes and z.nodeType(node) == .element) {
+        try visitor.visit(node, hash, nodes);
+    }
+    return hash;
+}
+
+const NoopVisitor = struct {
+    fn visit(_: NoopVisitor, _: *z.DomNode, _: SubtreeHash, _: usize) !void {}
+};
+
+/// [dedupe] Structural hash of a subtree: tag names, attributes (in document order), text and children order.
+///
+/// Two subtrees with the same markup (up to ignored whitespace-only text nodes and comments) have the same hash.
+/// The walk is iterative: deep trees do not overflow the stack.
+/// ## Example
+/// ```
+/// const h1 = try z.structuralHash(allocator, nav_page_1, .{});
+/// const h2 = try z.structuralHash(allocator, nav_page_2, .{});
+/// try testing.expect(h1 == h2);
+/// ---
+/// ```
+pub fn structuralHash(allocator: std.mem.Allocator, root: *z.DomNode, options: DedupeOptions) !SubtreeHash {
+    return walkHashes(allocator, root, options, NoopVisitor{});
+}
+
+// -------------------------------------------------------------------------------
+// Corpus index
+// -------------------------------------------------------------------------------
+
+/// [dedupe] Index of the subtree hashes seen across documents
+///
+/// ## Example
+/// ```
+/// var index = z.SubtreeIndex.init(allocator, .{ .min_nodes = 10 });
+/// defer index.deinit();
+///
+/// const id1 = try index.addDocument(doc1);
+/// const id2 = try index.addDocument(doc2);
+///
+/// const dups = try index.duplicates(allocator);
+/// defer allocator.free(dups);
+///
+/// // keep doc1 intact, replace the boilerplate of doc2 by `<!--z-dup:HASH-->` references
+/// _ = try index.replaceDuplicates(z.documentRoot(doc2).?, id2);
+/// ---
+/// ```
+pub const SubtreeIndex = struct {
+    allocator: std.mem.Allocator,
+    options: DedupeOptions,
+    entries: std.AutoHashMap(SubtreeHash, Entry),
+    next_doc_id: u32 = 0,
+
+    pub fn init(allocator: std.mem.Allocator, options: DedupeOptions) SubtreeIndex {
+        return .{
+            .allocator = allocator,
+            .options = options,
+            .entries = std.AutoHashMap(SubtreeHash, Entry).init(allocator),
+        };
+    }
+
+    pub fn deinit(self: *SubtreeIndex) void {
+        self.entries.deinit();
+    }
+
+    const IndexVisitor = struct {
+        index: *SubtreeIndex,
+        doc_id: u32,
+
+        fn visit(self: IndexVisitor, node: *z.DomNode, hash: SubtreeHash, nodes: usize) !void {
+            const gop = try self.index.entries.getOrPut(hash);
+            if (!gop.found_existing) {
+                gop.value_ptr.* = .{
+                    .nodes = nodes,
+                    .occurrences = 1,
+                    .documents = 1,
+                    .last_doc = self.doc_id,
+                    .first_doc = self.doc_id,
+                    .first_node = node,
+                };
+                return;
+            }
+            gop.value_ptr.occurrences += 1;
+            if (gop.value_ptr.last_doc != self.doc_id) {
+                gop.value_ptr.documents += 1;
+                gop.value_ptr.last_doc = self.doc_id;
+            }
+        }
+    };
+
+    /// [dedupe] Index every subtree of the document (from the `<html>` root). Returns the document id.
+    pub fn addDocument(self: *SubtreeIndex, doc: *z.HTMLDocument) !u32 {
+        const root = z.documentRoot(doc) orelse return Err.DocumentRootNotFound;
+        return self.addNode(root);
+    }
+
+    /// [dedupe] Index every subtree of `root` as a new document. Returns the document id.
+    pub fn addNode(self: *SubtreeIndex, root: *z.DomNode) !u32 {
+        const doc_id = self.next_doc_id;
+        self.next_doc_id += 1;
+        _ = try walkHashes(
+            self.allocator,
+            root,
+            self.options,
+            IndexVisitor{ .index = self, .doc_id = doc_id },
+        );
+        return doc_id;
+    }
+
+    /// [dedupe] Number of occurrences of a subtree hash in the corpus
+    pub fn occurrences(self: *const SubtreeIndex, hash: SubtreeHash) usize {
+        const entry = self.entries.get(hash) orelse return 0;
+        return entry.occurrences;
+    }
+
+    /// [dedupe] True if the hash occurs at least `options.min_occurrences` times
+    pub fn isDuplicate(self: *const SubtreeIndex, hash: SubtreeHash) bool {
+        return self.occurrences(hash) >= self.options.min_occurrences;
+    }
+
+    /// [dedupe] Report the duplicated subtrees, largest savings (`nodes * (occurrences - 1)`) first.
+    ///
+    /// Nested duplicates (e.g. the `<ul>` of a duplicated `<nav>`) are reported too.
+    ///
+    /// Caller owns the slice.
+    pub fn duplicates(self: *const SubtreeIndex, allocator: std.mem.Allocator) ![]Duplicate {
+        var list: std.ArrayList(Duplicate) = .empty;
+        errdefer list.deinit(allocator);
+
+        var it = self.entries.iterator();
+        while (it.next()) |kv| {
+            const entry = kv.value_ptr.*;
+            if (entry.occurrences < self.options.min_occurrences) continue;
+            try list.append(allocator, .{
+                .hash = kv.key_ptr.*,
+                .nodes = entry.nodes,
+                .occurrences = entry.occurrences,
+                .documents = entry.documents,
+            });
+        }
+
+        const items = list.items;
+        std.mem.sort(Duplicate, items, {}, struct {
+            fn savedMore(_: void, a: Duplicate, b: Duplicate) bool {
+                return a.nodes * (a.occurrences - 1) > b.nodes * (b.occurrences - 1);
+            }
+        }.savedMore);
+
+        return list.toOwnedSlice(allocator);
+    }
+
+    const CollectVisitor = struct {
+        hashes: *std.AutoHashMap(*z.DomNode, SubtreeHash),
+
+        fn visit(self: CollectVisitor, node: *z.DomNode, hash: SubtreeHash, _: usize) !void {
+            try self.hashes.put(node, hash);
+        }
+    };
+
+    /// [dedupe] Replace the duplicated subtrees of `root` by a `<!--z-dup:HASH-->` comment.
+    ///
+    /// Only the outermost duplicated subtrees are replaced. The first indexed occurrence
+    /// (document `doc_id` as returned by `addDocument`) is kept in place.
+    ///
+    /// Returns the number of replaced subtrees.
+    pub fn replaceDuplicates(self: *const SubtreeIndex, root: *z.DomNode, doc_id: u32) !usize {
+        var hashes = std.AutoHashMap(*z.DomNode, SubtreeHash).init(self.allocator);
+        defer hashes.deinit();
+
+        _ = try walkHashes(
+            self.allocator,
+            root,
+            self.options,
+            CollectVisitor{ .hashes = &hashes },
+        );
+
+        var targets: std.ArrayList(struct { node: *z.DomNode, hash: SubtreeHash }) = .empty;
+        defer targets.deinit(self.allocator);
+
+        // pre-order walk, skipping the descendants of a replaced subtree
+        if (self.replaceableHash(&hashes, root, doc_id)) |hash| {
+            try targets.append(self.allocator, .{ .node = root, .hash = hash });
+        } else {
+            var it = z.iterateDescendants(root);
+            while (it.next()) |current| {
+                const hash = self.replaceableHash(&hashes, current, doc_id) orelse continue;
+                try targets.append(self.allocator, .{ .node = current, .hash = hash });
+                it.skipSubtree();
+            }
+        }
+
+        for (targets.items) |target| {
+            var buf: [dup_ref_prefix.len + 16]u8 = undefined;
+            const data = try std.fmt.bufPrint(&buf, dup_ref_prefix ++ "{x:0>16}", .{target.hash});
+            const comment = try z.createComment(z.ownerDocument(target.node), data);
+            z.insertBefore(target.node, z.commentToNode(comment));
+            z.destroyNode_deep(target.node);
+        }
+        return targets.items.len;
+    }
+
+    /// Hash of `node` when it is a duplicate other than the first indexed occurrence
+    fn replaceableHash(
+        self: *const SubtreeIndex,
+        hashes: *const std.AutoHashMap(*z.DomNode, SubtreeHash),
+        node: *z.DomNode,
+        doc_id: u32,
+    ) ?SubtreeHash {
+        const hash = hashes.get(node) orelse return null;
+        if (!self.isDuplicate(hash)) return null;
+        if (self.entries.get(hash)) |e| {
+            if (e.first_doc == doc_id and e.first_node == node) return null;
+        }
+        return hash;
+    }
+};
+
+// -------------------------------------------------------------------------------
+// Tests
+// -------------------------------------------------------------------------------
+
+const page_a =
+    \\<html><body>
+    \\<nav><ul><li><a href="/">Home</a></li><li><a href="/blog">Blog</a></li></ul></nav>
+    \\<main><h1>First article</h1><p>Some content</p></main>
+    \\<footer><p>Copyright <b>2025</b></p><p><a href="/legal">Legal</a></p></footer>
+    \\</body></html>
+;
+
+const page_b =
+    \\<html><body>
+    \\<nav>
+    \\  <ul><li><a href="/">Home</a></li><li><a href="/blog">Blog</a></li></ul>
+    \\</nav>
+    \\<main><h1>Second article</h1><p>Other content</p></main>
+    \\<footer><p>Copyright <b>2025</b></p><p><a href="/legal">Legal</a></p></footer>
+    \\</body></html>
+;
+
+test "structuralHash ignores whitespace-only text and depends on content" {
+    const allocator = testing.allocator;
+    const doc_a = try z.createDocFromString(page_a);
+    defer z.destroyDocument(doc_a);
+    const doc_b = try z.createDocFromString(page_b);
+    defer z.destroyDocument(doc_b);
+
+    const nav_a = z.elementToNode(z.getElementByTag(z.bodyNode(doc_a).?, .nav).?);
+    const nav_b = z.elementToNode(z.getElementByTag(z.bodyNode(doc_b).?, .nav).?);
+    try testing.expectEqual(
+        try structuralHash(allocator, nav_a, .{}),
+        try structuralHash(allocator, nav_b, .{}),
+    );
+
+    const main_a = z.elementToNode(z.getElementByTag(z.bodyNode(doc_a).?, .main).?);
+    const main_b = z.elementToNode(z.getElementByTag(z.bodyNode(doc_b).?, .main).?);
+    try testing.expect(try structuralHash(allocator, main_a, .{}) !=
+        try structuralHash(allocator, main_b, .{}));
+
+    // attributes are part of the structure
+    const doc_c = try z.createDocFromString("<div class='a'><p>x</p></div><div class='b'><p>x</p></div>");
+    defer z.destroyDocument(doc_c);
+    const div1 = z.firstChild(z.bodyNode(doc_c).?).?;
+    const div2 = z.nextSibling(div1).?;
+    try testing.expect(try structuralHash(allocator, div1, .{}) !=
+        try structuralHash(allocator, div2, .{}));
+}
+
+test "SubtreeIndex reports and replaces duplicates across documents" {
+    const allocator = testing.allocator;
+    const doc_a = try z.createDocFromString(page_a);
+    defer z.destroyDocument(doc_a);
+    const doc_b = try z.createDocFromString(page_b);
+    defer z.destroyDocument(doc_b);
+
+    var index = SubtreeIndex.init(allocator, .{ .min_nodes = 5 });
+    defer index.deinit();
+
+    const id_a = try index.addDocument(doc_a);
+    const id_b = try index.addDocument(doc_b);
+    try testing.expect(id_a != id_b);
+
+    const dups = try index.duplicates(allocator);
+    defer allocator.free(dups);
+
+    // nav (8 nodes), footer (8 nodes) and the nested <ul> (7 nodes)
+    try testing.expect(dups.len == 3);
+    for (dups) |dup| {
+        try testing.expect(dup.occurrences == 2);
+        try testing.expect(dup.documents == 2);
+    }
+    try testing.expect(dups[0].nodes >= dups[1].nodes);
+
+    // doc_a keeps its first occurrences
+    try testing.expect(try index.replaceDuplicates(z.documentRoot(doc_a).?, id_a) == 0);
+
+    // doc_b: nav and footer are replaced, not the nested <ul>
+    try testing.expect(try index.replaceDuplicates(z.documentRoot(doc_b).?, id_b) == 2);
+
+    const body_b = z.bodyNode(doc_b).?;
+    try testing.expect(z.getElementByTag(body_b, .nav) == null);
+    try testing.expect(z.getElementByTag(body_b, .footer) == null);
+    try testing.expect(z.getElementByTag(body_b, .main) != null);
+
+    const html = try z.innerHTML(allocator, z.nodeToElement(body_b).?);
+    defer allocator.free(html);
+    try testing.expect(std.mem.count(u8, html, "<!--" ++ dup_ref_prefix) == 2);
+}
+
+test "duplicates within a single document" {
+    const allocator = testing.allocator;
+    const html =
+        \\<div><section><h2>Card</h2><p>Body <em>text</em></p></section>
+        \\<section><h2>Card</h2><p>Body <em>text</em></p></section>
+        \\<section><h2>Other</h2><p>Body <em>text</em></p></section></div>
+    ;
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    var index = SubtreeIndex.init(allocator, .{ .min_nodes = 6 });
+    defer index.deinit();
+    const id = try index.addDocument(doc);
+
+    const div = z.firstChild(z.bodyNode(doc).?).?;
+    const first_section = z.firstChild(div).?;
+    const hash = try structuralHash(allocator, first_section, .{});
+    try testing.expect(index.occurrences(hash) == 2);
+    try testing.expect(index.isDuplicate(hash));
+
+    // the first <section> is kept, the second one is replaced
+    try testing.expect(try index.replaceDuplicates(div, id) == 1);
+    try testing.expect(z.firstChild(div).? == first_section);
+}
@@ -0,0 +1,282 @@
+//! Whole-document copies into fresh lexbor arenas
+//!
+//! `compactDocument` re-imports a document in document order into a new document:
+//! nodes, attributes and text are allocated contiguously by lexbor's arenas,
+//! and the memory scattered by past mutations is released with the old document.
+//! Handles to the old nodes are translated with the returned remap.
+//!
+//! `forkDocument` runs the same copy without touching the source: a parsed layout is kept
+//! as a read-only base and each request renders into its own fork.
+//! It is a plain deep import of every node, not a copy-on-write or shared-arena fork:
+//! it saves tokenizing and tree construction, but still allocates the whole tree.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const CompactOptions = struct {
+    /// build the old node -> new node map
+    remap: bool = true,
+    /// destroy the old document once copied
+    destroy_old: bool = true,
+};
+
+/// [compact] A compacted document and the translation of the old node handles
+pub const CompactedDocument = struct {
+    allocator: std.mem.Allocator,
+    document: *z.HTMLDocument,
+    /// old node -> new node, empty when `CompactOptions.remap` is false
+    remap: std.AutoHashMapUnmanaged(*z.DomNode, *z.DomNode) = .empty,
+
+    /// Releases the remap only: the document is owned by the caller
+    pub fn deinit(self: *CompactedDocument) void {
+        self.remap.deinit(self.allocator);
+    }
+
+    /// [compact] New node of an old node handle
+    pub fn node(self: *const CompactedDocument, old: *z.DomNode) ?*z.DomNode {
+        return self.remap.get(old);
+    }
+
+    /// [compact] New element of an old element handle
+    pub fn element(self: *const CompactedDocument, old: *z.HTMLElement) ?*z.HTMLElement {
+        const new = self.remap.get(z.elementToNode(old)) orelse return null;
+        return z.nodeToElement(new);
+    }
+};
+
+/// [compact] Copy `doc` in document order into a fresh document.
+///
+/// The `<html>`, `<head>` and `<body>` elements of the new document are the ones created by the
+/// parser, so `bodyElement` and friends keep working; every other node is a deep import.
+/// A parsed document always has them; a hand-built one without them gains empty ones.
+/// With `destroy_old` (default), `doc` is destroyed: translate handles with the result's remap,
+/// whose keys are only compared, never dereferenced.
+///
+/// ## Example
+/// ```
+/// var compacted = try z.compactDocument(allocator, doc, .{});
+/// defer compacted.deinit();
+/// defer z.destroyDocument(compacted.document);
+/// const same_div = compacted.element(div).?;
+/// ---
+/// ```
+pub fn compactDocument(allocator: std.mem.Allocator, doc: *z.HTMLDocument, options: CompactOptions) !CompactedDocument {
+    const old_root = z.documentRoot(doc) orelse return Err.DocumentRootNotFound;
+    const old_doc_node = z.parentNode(old_root) orelse return Err.DocumentRootNotFound;
+
+    const copy = try importDocument(doc);
+    errdefer z.destroyDocument(copy.document);
+    const new_root = z.documentRoot(copy.document) orelse return Err.DocumentRootNotFound;
+    const new_doc_node = z.parentNode(new_root) orelse return Err.DocumentRootNotFound;
+
+    // a parser-created <head> or <body> without counterpart is kept out of the lockstep remap walk
+    for (copy.unused) |maybe| if (maybe) |extra| z.removeNode(extra);
+    defer {
+        var i = copy.unused.len;
+        while (i > 0) : (i -= 1) {
+            const extra = copy.unused[i - 1] orelse continue;
+            if (z.firstChild(new_root)) |first| z.insertBefore(first, extra) else z.appendChild(new_root, extra);
+        }
+    }
+
+    var result: CompactedDocument = .{ .allocator = allocator, .document = copy.document };
+    errdefer result.deinit();
+    if (options.remap) try buildRemap(allocator, &result.remap, old_doc_node, new_doc_node);
+
+    if (options.destroy_old) z.destroyDocument(doc);
+    return result;
+}
+
+/// [compact] Private mutable copy of a shared, read-only `base` document.
+///
+/// Meant for per-request rendering: parse the layout once, then fork it for each request
+/// instead of re-parsing the HTML string. `base` is only read, so several threads may fork
+/// the same base as long as nobody mutates it.
+/// The fork owns its arenas: destroy it with `destroyDocument`, independently of `base`.
+/// Every node of `base` is deep-imported, so the cost is linear in the size of `base`;
+/// nothing is shared with it.
+///
+/// ## Example
+/// ```
+/// const base = try z.createDocFromString(layout_html);
+/// defer z.destroyDocument(base);
+///
+/// const page = try z.forkDocument(base);
+/// defer z.destroyDocument(page);
+/// try z.setContentAsText(z.elementToNode(z.getElementById(z.bodyNode(page).?, "user").?), "Ada");
+/// ---
+/// ```
+pub fn forkDocument(base: *z.HTMLDocument) !*z.HTMLDocument {
+    const copy = try importDocument(base);
+    return copy.document;
+}
+
+const ImportedDocument = struct {
+    document: *z.HTMLDocument,
+    /// parser-created <head> and <body> of `document` with no counterpart in the source
+    unused: [2]?*z.DomNode,
+};
+
+/// Imports `doc` in document order into a fresh parser-created document
+fn importDocument(doc: *z.HTMLDocument) !ImportedDocument {
+    const old_root = z.documentRoot(doc) orelse return Err.DocumentRootNotFound;
+    const old_doc_node = z.parentNode(old_root) orelse return Err.DocumentRootNotFound;
+
+    const new_doc = try z.createDocFromString("");
+    errdefer z.destroyDocument(new_doc);
+    const new_root = z.documentRoot(new_doc) orelse return Err.DocumentRootNotFound;
+    const new_doc_node = z.parentNode(new_root) orelse return Err.DocumentRootNotFound;
+    const new_body = z.bodyNode(new_doc) orelse return Err.NoBodyElement;
+    var new_head: ?*z.DomNode = z.firstChild(new_root);
+    while (new_head) |head| : (new_head = z.nextSibling(head)) {
+        if (z.isHtmlTag(head, z.LXB_TAG_HEAD)) break;
+    }
+
+    // doctype and comments around <html>
+    var before_root = true;
+    var child = z.firstChild(old_doc_node);
+    while (child) |current| : (child = z.nextSibling(current)) {
+        if (current == old_root) {
+            before_root = false;
+            continue;
+        }
+        const imported = z.importNode(current, new_doc) orelse return Err.ImportNodeFailed;
+        if (before_root) z.insertBefore(new_root, imported) else z.appendChild(new_doc_node, imported);
+    }
+
+    // <html>: the parser-created <head> and <body> are moved in place of the old ones
+    try copyAttributes(z.nodeToElement(old_root).?, z.nodeToElement(new_root).?);
+    var reused_head = false;
+    var reused_body = false;
+    child = z.firstChild(old_root);
+    while (child) |current| : (child = z.nextSibling(current)) {
+        var target: ?*z.DomNode = null;
+        if (!reused_head and new_head != null and z.isHtmlTag(current, z.LXB_TAG_HEAD)) {
+            target = new_head;
+            reused_head = true;
+        } else if (!reused_body and z.isHtmlTag(current, z.LXB_TAG_BODY)) {
+            target = new_body;
+            reused_body = true;
+        }
+
+        if (target) |container| {
+            z.removeNode(container);
+            z.appendChild(new_root, container);
+            try copyAttributes(z.nodeToElement(current).?, z.nodeToElement(container).?);
+            var grandchild = z.firstChild(current);
+            while (grandchild) |inner| : (grandchild = z.nextSibling(inner)) {
+                const imported = z.importNode(inner, new_doc) orelse return Err.ImportNodeFailed;
+                z.appendChild(container, imported);
+            }
+        } else {
+            const imported = z.importNode(current, new_doc) orelse return Err.ImportNodeFailed;
+            z.appendChild(new_root, imported);
+        }
+    }
+
+    return .{
+        .document = new_doc,
+        .unused = .{
+            if (reused_head) null else new_head,
+            if (reused_body) null else new_body,
+        },
+    };
+}
+
+fn copyAttributes(from: *z.HTMLElement, to: *z.HTMLElement) !void {
+    var attrs = z.iterateAttributes(from);
+    while (attrs.next()) |attr| {
+        _ = z.setAttribute(to, attr.name, attr.value) orelse return Err.SetAttributeFailed;
+    }
+}
+
+/// Both trees have the same shape: walk them in lockstep
+fn buildRemap(
+    allocator: std.mem.Allocator,
+    remap: *std.AutoHashMapUnmanaged(*z.DomNode, *z.DomNode),
+    old_root: *z.DomNode,
+    new_root: *z.DomNode,
+) !void {
+    try remap.put(allocator, old_root, new_root);
+    var old_it = z.iterateDescendants(old_root);
+    var new_it = z.iterateDescendants(new_root);
+    while (old_it.next()) |old_node| {
+        const new_node = new_it.next() orelse return Err.ImportNodeFailed;
+        try remap.put(allocator, old_node, new_node);
+    }
+}
+
+test "compactDocument keeps content and remaps handles" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<!DOCTYPE html><html lang="en"><head><title>T</title></head><body class="page"><ul id="list"><li>one</li><li>two</li></ul><p>text</p></body></html>
+    );
+
+    // scatter the document with mutations
+    const body = z.bodyNode(doc).?;
+    const list = z.firstChild(body).?;
+    var li = z.firstChild(list);
+    while (li) |item| : (li = z.nextSibling(item)) {
+        const span = try z.createElement(doc, "span");
+        try z.setContentAsText(z.elementToNode(span), "new");
+        z.insertBefore(z.firstChild(item).?, z.elementToNode(span));
+        _ = z.setAttribute(z.nodeToElement(item).?, "data-x", "1");
+    }
+    const p = z.nextSibling(list).?;
+    z.removeNode(p);
+    z.destroyNode(p);
+
+    const before = try z.outerHTML(allocator, z.nodeToElement(z.documentRoot(doc).?).?);
+    defer allocator.free(before);
+    const list_element = z.nodeToElement(list).?;
+
+    var compacted = try compactDocument(allocator, doc, .{});
+    defer compacted.deinit();
+    defer z.destroyDocument(compacted.document);
+
+    const new_doc = compacted.document;
+    const after = try z.outerHTML(allocator, z.nodeToElement(z.documentRoot(new_doc).?).?);
+    defer allocator.free(after);
+    try testing.expectEqualStrings(before, after);
+
+    const new_list = compacted.element(list_element).?;
+    try testing.expectEqualStrings("list", z.getAttribute_zc(new_list, "id").?);
+    try testing.expect(z.parentNode(z.elementToNode(new_list)) == z.bodyNode(new_doc).?);
+    try testing.expectEqualStrings("page", z.getAttribute_zc(z.bodyElement(new_doc).?, "class").?);
+    try testing.expect(z.nodeType(z.firstChild(z.parentNode(z.documentRoot(new_doc).?).?).?) != .element);
+}
+
+test "forkDocument gives independent copies of a base" {
+    const allocator = testing.allocator;
+    const base = try z.createDocFromString(
+        \\<!DOCTYPE html><html><head><title>Layout</title></head><body><h1 id="user">{user}</h1></body></html>
+    );
+    defer z.destroyDocument(base);
+    const base_html = try z.outerHTML(allocator, z.nodeToElement(z.documentRoot(base).?).?);
+    defer allocator.free(base_html);
+
+    const names = [_][]const u8{ "Ada", "Linus" };
+    for (names) |name| {
+        const page = try forkDocument(base);
+        defer z.destroyDocument(page);
+        try testing.expect(page != base);
+
+        const fork_html = try z.outerHTML(allocator, z.nodeToElement(z.documentRoot(page).?).?);
+        defer allocator.free(fork_html);
+        try testing.expectEqualStrings(base_html, fork_html);
+
+        const h1 = z.firstChild(z.bodyNode(page).?).?;
+        try z.setContentAsText(h1, name);
+        const text = try z.textContent(allocator, h1);
+        defer allocator.free(text);
+        try testing.expectEqualStrings(name, text);
+    }
+
+    const after = try z.outerHTML(allocator, z.nodeToElement(z.documentRoot(base).?).?);
+    defer allocator.free(after);
+    try testing.expectEqualStrings(base_html, after);
+}
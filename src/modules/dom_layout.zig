@@ -0,0 +1,216 @@
+//! Zig mirrors of the lexbor DOM node and element layouts
+//!
+//! Mirrors `lxb_dom_node_t`, the head of `lxb_dom_element_t` and `lxb_dom_character_data_t`
+//! from the bundled headers (`lexbor/dom/interfaces/*.h`), so that navigation, node type,
+//! tag id and text data reads are inlined field loads instead of `_noi` calls.
+//!
+//! The layout is checked twice at build time:
+//! - here, with `comptime` offset assertions;
+//! - in `src/minimal.c`, with the same offsets asserted against the C headers.
+//! A test also compares both sides through `lexbor_dom_layout_wrapper`.
+
+const std = @import("std");
+const z = @import("../root.zig");
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// `lxb_dom_node_t`
+pub const DomNodeLayout = extern struct {
+    /// `lxb_dom_event_target_t`
+    events: ?*anyopaque,
+    /// tag id for elements (`lxb_tag_id_t`), lowercase, without prefix
+    local_name: usize,
+    prefix: usize,
+    /// namespace id (`lxb_ns_id_t`)
+    ns: usize,
+    /// `lxb_dom_document_t`, which starts with the `lxb_html_document_t` of HTML documents
+    owner_document: ?*z.HTMLDocument,
+    next: ?*z.DomNode,
+    prev: ?*z.DomNode,
+    parent: ?*z.DomNode,
+    first_child: ?*z.DomNode,
+    last_child: ?*z.DomNode,
+    user: ?*anyopaque,
+    /// `lxb_dom_node_type_t`
+    type: c_uint,
+};
+
+/// Head of `lxb_dom_element_t`: the fields after `attr_class` are not mirrored,
+/// so this struct is only used through pointers, never by value.
+pub const DomElementLayout = extern struct {
+    node: DomNodeLayout,
+    upper_name: usize,
+    qualified_name: usize,
+    is_value: ?*anyopaque,
+    first_attr: ?*z.DomAttr,
+    last_attr: ?*z.DomAttr,
+    attr_id: ?*z.DomAttr,
+    attr_class: ?*z.DomAttr,
+};
+
+/// `lexbor_str_t`
+pub const LexborStr = extern struct {
+    data: ?[*]u8,
+    length: usize,
+};
+
+/// `lxb_dom_character_data_t`: text, comment, CDATA and processing instruction nodes
+pub const CharacterDataLayout = extern struct {
+    node: DomNodeLayout,
+    data: LexborStr,
+};
+
+/// Head of `lxb_dom_document_t`, which `lxb_html_document_t` starts with:
+/// only used through pointers, never by value.
+pub const DomDocumentLayout = extern struct {
+    node: DomNodeLayout,
+    /// `lxb_dom_document_cmode_t`
+    compat_mode: c_uint,
+};
+
+/// `LXB_DOM_DOCUMENT_CMODE_QUIRKS` from `lexbor/dom/interfaces/document.h`
+pub const LXB_DOM_DOCUMENT_CMODE_QUIRKS: c_uint = 0x01;
+
+/// `LXB_NS_HTML` from `lexbor/ns/const.h`
+pub const LXB_NS_HTML: usize = 0x02;
+
+const ptr_size = @sizeOf(usize);
+
+comptime {
+    const checks = .{
+        .{ "local_name", 1 }, .{ "prefix", 2 },     .{ "ns", 3 },
+        .{ "owner_document", 4 }, .{ "next", 5 },    .{ "prev", 6 },
+        .{ "parent", 7 },     .{ "first_child", 8 }, .{ "last_child", 9 },
+        .{ "user", 10 },      .{ "type", 11 },
+    };
+    inline for (checks) |check| {
+        if (@offsetOf(DomNodeLayout, check[0]) != check[1] * ptr_size)
+            @compileError("lxb_dom_node_t layout mismatch on field " ++ check[0]);
+    }
+    if (@sizeOf(DomNodeLayout) != 12 * ptr_size) @compileError("lxb_dom_node_t size mismatch");
+    if (@offsetOf(DomElementLayout, "first_attr") != 15 * ptr_size) @compileError("lxb_dom_element_t layout mismatch");
+    if (@offsetOf(DomElementLayout, "attr_class") != 18 * ptr_size) @compileError("lxb_dom_element_t layout mismatch");
+    if (@offsetOf(CharacterDataLayout, "data") != 12 * ptr_size) @compileError("lxb_dom_character_data_t layout mismatch");
+    if (@offsetOf(LexborStr, "length") != ptr_size) @compileError("lexbor_str_t layout mismatch");
+    if (@offsetOf(DomDocumentLayout, "compat_mode") != 12 * ptr_size) @compileError("lxb_dom_document_t layout mismatch");
+}
+
+/// [layout] View a node through its layout mirror
+pub inline fn node(n: *z.DomNode) *DomNodeLayout {
+    return @ptrCast(@alignCast(n));
+}
+
+/// [layout] View an element through its layout mirror
+pub inline fn element(e: *z.HTMLElement) *DomElementLayout {
+    return @ptrCast(@alignCast(e));
+}
+
+/// [layout] True when the document was parsed in quirks mode (no or legacy doctype)
+///
+/// Limited-quirks documents are not included: they match selectors like standards mode.
+pub inline fn isQuirksMode(doc: *z.HTMLDocument) bool {
+    const layout: *DomDocumentLayout = @ptrCast(@alignCast(doc));
+    return layout.compat_mode == LXB_DOM_DOCUMENT_CMODE_QUIRKS;
+}
+
+/// [layout] Raw `lxb_dom_node_type_t` of a node
+pub inline fn nodeTypeId(n: *z.DomNode) u32 {
+    return @intCast(node(n).type);
+}
+
+/// [layout] lexbor tag id of a node (`lxb_tag_id_t`), meaningful for element nodes
+pub inline fn tagId(n: *z.DomNode) usize {
+    return node(n).local_name;
+}
+
+/// [layout] True when `n` is an HTML-namespace element with tag id `tag_id`
+pub inline fn isHtmlTag(n: *z.DomNode, tag_id: usize) bool {
+    const layout = node(n);
+    return layout.local_name == tag_id and layout.ns == LXB_NS_HTML;
+}
+
+/// [layout] Data of a character data node (text, comment) as a borrowed slice, no copy
+///
+/// Only valid for nodes whose type is text, comment, CDATA or processing instruction.
+pub inline fn characterData(n: *z.DomNode) []const u8 {
+    const layout: *CharacterDataLayout = @ptrCast(@alignCast(n));
+    const data = layout.data.data orelse return "";
+    return data[0..layout.data.length];
+}
+
+extern "c" fn lexbor_dom_layout_wrapper(count: *usize) [*]const usize;
+
+test "layout mirrors match the C headers" {
+    var count: usize = 0;
+    const offsets = lexbor_dom_layout_wrapper(&count);
+    const expected = [_]usize{
+        @sizeOf(DomNodeLayout),
+        @offsetOf(DomNodeLayout, "local_name"),
+        @offsetOf(DomNodeLayout, "ns"),
+        @offsetOf(DomNodeLayout, "owner_document"),
+        @offsetOf(DomNodeLayout, "next"),
+        @offsetOf(DomNodeLayout, "prev"),
+        @offsetOf(DomNodeLayout, "parent"),
+        @offsetOf(DomNodeLayout, "first_child"),
+        @offsetOf(DomNodeLayout, "last_child"),
+        @offsetOf(DomNodeLayout, "type"),
+        @offsetOf(DomElementLayout, "first_attr"),
+        @offsetOf(DomElementLayout, "attr_id"),
+        @offsetOf(DomElementLayout, "attr_class"),
+        @offsetOf(CharacterDataLayout, "data"),
+        @offsetOf(LexborStr, "length"),
+        @offsetOf(DomDocumentLayout, "compat_mode"),
+    };
+    try testing.expectEqual(expected.len, count);
+    try testing.expectEqualSlices(usize, &expected, offsets[0..count]);
+}
+
+test "field reads agree with lexbor" {
+    const doc = try z.createDocFromString("<div id=\"a\"><p>x</p><!-- c --><template></template></div>");
+    defer z.destroyDocument(doc);
+
+    const div = z.firstChild(z.bodyNode(doc).?).?;
+    const p = z.firstChild(div).?;
+    try testing.expect(node(p).parent == div);
+    try testing.expect(node(div).owner_document == doc);
+    try testing.expect(nodeTypeId(p) == z.LXB_DOM_NODE_TYPE_ELEMENT);
+    try testing.expect(nodeTypeId(z.firstChild(p).?) == z.LXB_DOM_NODE_TYPE_TEXT);
+    try testing.expect(nodeTypeId(z.nextSibling(p).?) == z.LXB_DOM_NODE_TYPE_COMMENT);
+    try testing.expectEqualStrings("x", characterData(z.firstChild(p).?));
+    try testing.expectEqualStrings(" c ", characterData(z.nextSibling(p).?));
+    try testing.expect(isHtmlTag(z.lastChild(div).?, z.LXB_TAG_TEMPLATE));
+    try testing.expect(element(z.nodeToElement(div).?).attr_id != null);
+    try testing.expect(element(z.nodeToElement(p).?).attr_id == null);
+    try testing.expect(isQuirksMode(doc));
+
+    const standards = try z.createDocFromString("<!DOCTYPE html><p>x</p>");
+    defer z.destroyDocument(standards);
+    try testing.expect(!isQuirksMode(standards));
+}
+
+test "tag id constants agree with lexbor" {
+    const doc = try z.createDocFromString("");
+    defer z.destroyDocument(doc);
+
+    const tags = [_]struct { []const u8, u32 }{
+        .{ "body", z.LXB_TAG_BODY },         .{ "br", z.LXB_TAG_BR },             .{ "button", z.LXB_TAG_BUTTON },
+        .{ "code", z.LXB_TAG_CODE },         .{ "datalist", z.LXB_TAG_DATALIST }, .{ "fieldset", z.LXB_TAG_FIELDSET },
+        .{ "head", z.LXB_TAG_HEAD },         .{ "input", z.LXB_TAG_INPUT },       .{ "legend", z.LXB_TAG_LEGEND },
+        .{ "meta", z.LXB_TAG_META },         .{ "optgroup", z.LXB_TAG_OPTGROUP }, .{ "option", z.LXB_TAG_OPTION },
+        .{ "pre", z.LXB_TAG_PRE },           .{ "script", z.LXB_TAG_SCRIPT },     .{ "select", z.LXB_TAG_SELECT },
+        .{ "style", z.LXB_TAG_STYLE },       .{ "tbody", z.LXB_TAG_TBODY },       .{ "td", z.LXB_TAG_TD },
+        .{ "template", z.LXB_TAG_TEMPLATE }, .{ "textarea", z.LXB_TAG_TEXTAREA }, .{ "tfoot", z.LXB_TAG_TFOOT },
+        .{ "th", z.LXB_TAG_TH },             .{ "thead", z.LXB_TAG_THEAD },       .{ "tr", z.LXB_TAG_TR },
+    };
+    for (tags) |tag| {
+        const created = z.elementToNode(try z.createElement(doc, tag[0]));
+        defer z.destroyNode_deep(created);
+        try testing.expectEqual(@as(usize, tag[1]), tagId(created));
+        try testing.expect(tag[1] < z.LXB_TAG__LAST_ENTRY);
+    }
+    // custom elements get ids past the known ones
+    const custom = z.elementToNode(try z.createElement(doc, "x-card"));
+    defer z.destroyNode_deep(custom);
+    try testing.expect(tagId(custom) >= z.LXB_TAG__LAST_ENTRY);
+}
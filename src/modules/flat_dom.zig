@@ -0,0 +1,528 @@
+//! Flat, read-only structure-of-arrays view of a document for analytics
+//!
+//! Nodes are stored in document (pre-)order, one column per property:
+//! tag id, node type, parent / first child / next sibling / subtree end indices,
+//! attribute ranges and text ranges into a single string buffer.
+//!
+//! - the descendants of node `i` are the contiguous range `i + 1 .. subtree_end[i]`;
+//! - tag scans compare 16 tag ids at a time with `@Vector`;
+//! - the view is a snapshot: later DOM mutations are not reflected.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// [flat] Index of a node in a `FlatDom`
+pub const NodeIndex = u32;
+
+/// [flat] Missing parent, child or sibling
+pub const none: NodeIndex = std.math.maxInt(NodeIndex);
+
+/// [flat] Tag id of custom elements (lexbor gives them dynamic ids) and of non-element nodes
+pub const custom_tag: u16 = std.math.maxInt(u16);
+pub const no_tag: u16 = 0; // LXB_TAG__UNDEF
+
+/// [flat] Byte range into `FlatDom.strings`
+pub const Span = struct {
+    start: u32 = 0,
+    len: u32 = 0,
+};
+
+pub const FlatAttribute = struct {
+    name: Span,
+    value: Span,
+};
+
+/// [flat] Half-open range of node indices
+pub const Range = struct {
+    start: NodeIndex,
+    end: NodeIndex,
+};
+
+const lanes = 16;
+const TagVector = @Vector(lanes, u16);
+
+pub const FlatDom = struct {
+    allocator: std.mem.Allocator,
+    /// lexbor tag id, `custom_tag` for custom elements, `no_tag` for non-elements
+    tags: []u16,
+    /// `lxb_dom_node_type_t`
+    types: []u8,
+    parent: []NodeIndex,
+    first_child: []NodeIndex,
+    next_sibling: []NodeIndex,
+    /// end (exclusive) of the subtree of each node
+    subtree_end: []NodeIndex,
+    /// attributes of node `i` are `attributes[attr_start[i]..attr_start[i + 1]]`
+    attr_start: []u32,
+    attributes: []FlatAttribute,
+    /// data of text and comment nodes
+    text: []Span,
+    /// `id` and `class` attribute values, empty when absent
+    ids: []Span,
+    classes: []Span,
+    /// every string of the view
+    strings: []u8,
+    /// live node of each index, valid while the document is alive
+    nodes: []*z.DomNode,
+    /// owned qualified names of the tags seen, for `tagId`
+    tag_names: std.StringHashMapUnmanaged(u16),
+
+    const Self = @This();
+
+    /// [flat] Build the flat view of the whole document
+    pub fn build(allocator: std.mem.Allocator, doc: *z.HTMLDocument) !Self {
+        const root = z.documentRoot(doc) orelse return Err.DocumentRootNotFound;
+        return buildFrom(allocator, root);
+    }
+
+    /// [flat] Build the flat view of `root` and its descendants
+    pub fn buildFrom(allocator: std.mem.Allocator, root: *z.DomNode) !Self {
+        const count = countNodes(root);
+
+        var builder = try Builder.init(allocator, count);
+        errdefer builder.deinit();
+        try builder.walk(root);
+        return builder.finish();
+    }
+
+    pub fn deinit(self: *Self) void {
+        const allocator = self.allocator;
+        allocator.free(self.tags);
+        allocator.free(self.types);
+        allocator.free(self.parent);
+        allocator.free(self.first_child);
+        allocator.free(self.next_sibling);
+        allocator.free(self.subtree_end);
+        allocator.free(self.attr_start);
+        allocator.free(self.attributes);
+        allocator.free(self.text);
+        allocator.free(self.ids);
+        allocator.free(self.classes);
+        allocator.free(self.strings);
+        allocator.free(self.nodes);
+        var names = self.tag_names.keyIterator();
+        while (names.next()) |name| allocator.free(name.*);
+        self.tag_names.deinit(allocator);
+    }
+
+    /// [flat] Number of nodes
+    pub fn len(self: *const Self) NodeIndex {
+        return @intCast(self.tags.len);
+    }
+
+    /// [flat] Range of all the nodes
+    pub fn all(self: *const Self) Range {
+        return .{ .start = 0, .end = self.len() };
+    }
+
+    /// [flat] Range of the descendants of `i`
+    pub fn descendants(self: *const Self, i: NodeIndex) Range {
+        return .{ .start = i + 1, .end = self.subtree_end[i] };
+    }
+
+    pub fn string(self: *const Self, span: Span) []const u8 {
+        return self.strings[span.start..][0..span.len];
+    }
+
+    pub fn nodeType(self: *const Self, i: NodeIndex) z.NodeType {
+        return switch (self.types[i]) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => .element,
+            z.LXB_DOM_NODE_TYPE_TEXT => .text,
+            z.LXB_DOM_NODE_TYPE_COMMENT => .comment,
+            z.LXB_DOM_NODE_TYPE_DOCUMENT => .document,
+            z.LXB_DOM_NODE_TYPE_FRAGMENT => .fragment,
+            else => .unknown,
+        };
+    }
+
+    /// [flat] Tag id used in the tag column for a lowercase tag name, null when absent from the view
+    pub fn tagId(self: *const Self, name: []const u8) ?u16 {
+        return self.tag_names.get(name);
+    }
+
+    /// [flat] Attributes of node `i`
+    pub fn attributesOf(self: *const Self, i: NodeIndex) []const FlatAttribute {
+        return self.attributes[self.attr_start[i]..self.attr_start[i + 1]];
+    }
+
+    /// [flat] Attribute value of node `i`
+    pub fn attribute(self: *const Self, i: NodeIndex, name: []const u8) ?[]const u8 {
+        for (self.attributesOf(i)) |attr| {
+            if (std.mem.eql(u8, self.string(attr.name), name)) return self.string(attr.value);
+        }
+        return null;
+    }
+
+    /// [flat] Data of a text or comment node
+    pub fn textOf(self: *const Self, i: NodeIndex) []const u8 {
+        return self.string(self.text[i]);
+    }
+
+    /// [flat] First node with tag `tag` in `range`, scanning 16 tag ids at a time
+    pub fn nextTag(self: *const Self, tag: u16, range: Range) ?NodeIndex {
+        const needle: TagVector = @splat(tag);
+        var i: usize = range.start;
+        const end: usize = range.end;
+        while (i + lanes <= end) : (i += lanes) {
+            const chunk: TagVector = self.tags[i..][0..lanes].*;
+            const mask: u16 = @bitCast(chunk == needle);
+            if (mask != 0) return @intCast(i + @ctz(mask));
+        }
+        while (i < end) : (i += 1) {
+            if (self.tags[i] == tag) return @intCast(i);
+        }
+        return null;
+    }
+
+    /// [flat] Number of nodes with tag `tag` in `range`
+    pub fn countTag(self: *const Self, tag: u16, range: Range) usize {
+        const needle: TagVector = @splat(tag);
+        var count: usize = 0;
+        var i: usize = range.start;
+        const end: usize = range.end;
+        while (i + lanes <= end) : (i += lanes) {
+            const chunk: TagVector = self.tags[i..][0..lanes].*;
+            const mask: u16 = @bitCast(chunk == needle);
+            count += @popCount(mask);
+        }
+        while (i < end) : (i += 1) {
+            if (self.tags[i] == tag) count += 1;
+        }
+        return count;
+    }
+
+    /// [flat] Iterate the nodes with tag `tag` in `range`
+    pub fn tagIterator(self: *const Self, tag: u16, range: Range) TagIterator {
+        return .{ .flat = self, .tag = tag, .range = range };
+    }
+
+    /// [flat] Index of the first element with `id`
+    pub fn findById(self: *const Self, id: []const u8) ?NodeIndex {
+        for (self.ids, 0..) |span, i| {
+            if (span.len == id.len and std.mem.eql(u8, self.string(span), id)) return @intCast(i);
+        }
+        return null;
+    }
+
+    /// [flat] True when the `class` attribute of `i` contains the token `class_name`
+    pub fn hasClass(self: *const Self, i: NodeIndex, class_name: []const u8) bool {
+        const span = self.classes[i];
+        if (span.len < class_name.len) return false;
+        var tokens = std.mem.tokenizeAny(u8, self.string(span), " \t\r\n\x0c");
+        while (tokens.next()) |token| {
+            if (std.mem.eql(u8, token, class_name)) return true;
+        }
+        return false;
+    }
+
+    /// [flat] Iterate the elements having the class `class_name` in `range`
+    pub fn classIterator(self: *const Self, class_name: []const u8, range: Range) ClassIterator {
+        return .{ .flat = self, .class_name = class_name, .pos = range.start, .end = range.end };
+    }
+
+    /// [flat] Concatenated text of the descendants of `i`, like `textContent`
+    pub fn textContent(self: *const Self, i: NodeIndex, writer: *std.Io.Writer) !void {
+        if (self.types[i] == z.LXB_DOM_NODE_TYPE_TEXT) return writer.writeAll(self.textOf(i));
+        const range = self.descendants(i);
+        for (self.types[range.start..range.end], range.start..) |node_type, j| {
+            if (node_type == z.LXB_DOM_NODE_TYPE_TEXT) try writer.writeAll(self.string(self.text[j]));
+        }
+    }
+
+    /// [flat] Children of `i`
+    pub fn children(self: *const Self, i: NodeIndex) ChildIterator {
+        return .{ .flat = self, .next_index = self.first_child[i] };
+    }
+};
+
+pub const TagIterator = struct {
+    flat: *const FlatDom,
+    tag: u16,
+    range: Range,
+
+    pub fn next(self: *TagIterator) ?NodeIndex {
+        const found = self.flat.nextTag(self.tag, self.range) orelse {
+            self.range.start = self.range.end;
+            return null;
+        };
+        self.range.start = found + 1;
+        return found;
+    }
+};
+
+pub const ClassIterator = struct {
+    flat: *const FlatDom,
+    class_name: []const u8,
+    pos: NodeIndex,
+    end: NodeIndex,
+
+    pub fn next(self: *ClassIterator) ?NodeIndex {
+        while (self.pos < self.end) {
+            const i = self.pos;
+            self.pos += 1;
+            if (self.flat.hasClass(i, self.class_name)) return i;
+        }
+        return null;
+    }
+};
+
+pub const ChildIterator = struct {
+    flat: *const FlatDom,
+    next_index: NodeIndex,
+
+    pub fn next(self: *ChildIterator) ?NodeIndex {
+        if (self.next_index == none) return null;
+        const i = self.next_index;
+        self.next_index = self.flat.next_sibling[i];
+        return i;
+    }
+};
+
+/// Pre-order count, used to size the columns exactly
+fn countNodes(root: *z.DomNode) usize {
+    var count: usize = 1;
+    var it = z.iterateDescendants(root);
+    while (it.next()) |_| count += 1;
+    return count;
+}
+
+const Builder = struct {
+    allocator: std.mem.Allocator,
+    flat: FlatDom,
+    count: NodeIndex = 0,
+    attributes: std.ArrayList(FlatAttribute) = .empty,
+    strings: std.ArrayList(u8) = .empty,
+    /// last child recorded for each node, to link siblings
+    last_child: []NodeIndex,
+    seen_tags: std.StaticBitSet(z.LXB_TAG__LAST_ENTRY) = .initEmpty(),
+
+    fn init(allocator: std.mem.Allocator, count: usize) !Builder {
+        if (count >= none) return error.OutOfMemory;
+
+        var flat: FlatDom = .{
+            .allocator = allocator,
+            .tags = &.{},
+            .types = &.{},
+            .parent = &.{},
+            .first_child = &.{},
+            .next_sibling = &.{},
+            .subtree_end = &.{},
+            .attr_start = &.{},
+            .attributes = &.{},
+            .text = &.{},
+            .ids = &.{},
+            .classes = &.{},
+            .strings = &.{},
+            .nodes = &.{},
+            .tag_names = .empty,
+        };
+        errdefer flat.deinit();
+        flat.tags = try allocator.alloc(u16, count);
+        flat.types = try allocator.alloc(u8, count);
+        flat.parent = try allocator.alloc(NodeIndex, count);
+        flat.first_child = try allocator.alloc(NodeIndex, count);
+        flat.next_sibling = try allocator.alloc(NodeIndex, count);
+        flat.subtree_end = try allocator.alloc(NodeIndex, count);
+        flat.attr_start = try allocator.alloc(u32, count + 1);
+        flat.text = try allocator.alloc(Span, count);
+        flat.ids = try allocator.alloc(Span, count);
+        flat.classes = try allocator.alloc(Span, count);
+        flat.nodes = try allocator.alloc(*z.DomNode, count);
+
+        return .{
+            .allocator = allocator,
+            .flat = flat,
+            .last_child = try allocator.alloc(NodeIndex, count),
+        };
+    }
+
+    fn deinit(self: *Builder) void {
+        self.attributes.deinit(self.allocator);
+        self.strings.deinit(self.allocator);
+        self.allocator.free(self.last_child);
+        self.flat.deinit();
+    }
+
+    fn finish(self: *Builder) !FlatDom {
+        self.flat.attr_start[self.count] = @intCast(self.attributes.items.len);
+        self.flat.attributes = try self.attributes.toOwnedSlice(self.allocator);
+        self.flat.strings = try self.strings.toOwnedSlice(self.allocator);
+        self.allocator.free(self.last_child);
+        return self.flat;
+    }
+
+    fn addString(self: *Builder, s: []const u8) !Span {
+        const start: u32 = @intCast(self.strings.items.len);
+        try self.strings.appendSlice(self.allocator, s);
+        return .{ .start = start, .len = @intCast(s.len) };
+    }
+
+    /// Iterative pre-order walk; `ancestors` holds the indices of the open elements
+    fn walk(self: *Builder, root: *z.DomNode) !void {
+        var ancestors: std.ArrayList(NodeIndex) = .empty;
+        defer ancestors.deinit(self.allocator);
+
+        var node = root;
+        while (true) {
+            const parent = if (ancestors.items.len > 0) ancestors.items[ancestors.items.len - 1] else none;
+            const i = try self.record(node, parent);
+
+            if (z.firstChild(node)) |child| {
+                try ancestors.append(self.allocator, i);
+                node = child;
+                continue;
+            }
+            self.flat.subtree_end[i] = self.count;
+
+            // climb until a next sibling, closing the subtrees on the way
+            var current = node;
+            while (true) {
+                if (current == root) return;
+                if (z.nextSibling(current)) |next| {
+                    node = next;
+                    break;
+                }
+                current = z.parentNode(current) orelse return;
+                const closed = ancestors.pop() orelse return;
+                self.flat.subtree_end[closed] = self.count;
+            }
+        }
+    }
+
+    fn record(self: *Builder, node: *z.DomNode, parent: NodeIndex) !NodeIndex {
+        const flat = &self.flat;
+        const i = self.count;
+        self.count += 1;
+
+        const node_type = z.nodeTypeId(node);
+        flat.types[i] = @intCast(node_type);
+        flat.tags[i] = no_tag;
+        flat.parent[i] = parent;
+        flat.first_child[i] = none;
+        flat.next_sibling[i] = none;
+        flat.subtree_end[i] = i + 1;
+        flat.attr_start[i] = @intCast(self.attributes.items.len);
+        flat.text[i] = .{};
+        flat.ids[i] = .{};
+        flat.classes[i] = .{};
+        flat.nodes[i] = node;
+        self.last_child[i] = none;
+
+        if (parent != none) {
+            const previous = self.last_child[parent];
+            if (previous == none) flat.first_child[parent] = i else flat.next_sibling[previous] = i;
+            self.last_child[parent] = i;
+        }
+
+        switch (node_type) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {
+                const element = z.nodeToElement(node).?;
+                const tag_id = z.nodeTagId(node);
+                if (tag_id < z.LXB_TAG__LAST_ENTRY) {
+                    flat.tags[i] = @intCast(tag_id);
+                    if (!self.seen_tags.isSet(tag_id)) {
+                        self.seen_tags.set(tag_id);
+                        const name = try self.allocator.dupe(u8, z.qualifiedName_zc(element));
+                        errdefer self.allocator.free(name);
+                        try flat.tag_names.put(self.allocator, name, flat.tags[i]);
+                    }
+                } else {
+                    flat.tags[i] = custom_tag;
+                }
+
+                var attrs = z.iterateAttributes(element);
+                while (attrs.next()) |attr| {
+                    const name = try self.addString(attr.name);
+                    const value = try self.addString(attr.value);
+                    try self.attributes.append(self.allocator, .{ .name = name, .value = value });
+                    if (std.mem.eql(u8, attr.name, "id")) {
+                        flat.ids[i] = value;
+                    } else if (std.mem.eql(u8, attr.name, "class")) {
+                        flat.classes[i] = value;
+                    }
+                }
+            },
+            z.LXB_DOM_NODE_TYPE_TEXT, z.LXB_DOM_NODE_TYPE_COMMENT => {
+                flat.text[i] = try self.addString(z.characterData(node));
+            },
+            else => {},
+        }
+        return i;
+    }
+};
+
+test "FlatDom columns and queries" {
+    const allocator = testing.allocator;
+    const html =
+        \\<div id="main" class="box wide"><p>Hello <b>bold</b></p><!-- note --><p class="wide">World</p></div><x-card>custom</x-card>
+    ;
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    var flat = try FlatDom.build(allocator, doc);
+    defer flat.deinit();
+
+    // html, head, body, div, p, "Hello ", b, "bold", comment, p, "World", x-card, "custom"
+    try testing.expectEqual(@as(NodeIndex, 13), flat.len());
+    try testing.expectEqual(flat.len(), flat.subtree_end[0]);
+
+    const div = flat.findById("main").?;
+    try testing.expectEqual(@as(NodeIndex, 3), div);
+    try testing.expectEqual(@as(NodeIndex, 11), flat.subtree_end[div]);
+    try testing.expect(flat.nodes[div] == z.firstChild(z.bodyNode(doc).?).?);
+    try testing.expectEqualStrings("box wide", flat.attribute(div, "class").?);
+
+    const p = flat.tagId("p").?;
+    try testing.expectEqual(@as(usize, 2), flat.countTag(p, flat.all()));
+    try testing.expectEqual(@as(usize, 2), flat.countTag(p, flat.descendants(div)));
+    try testing.expect(flat.tagId("x-card") == null);
+    try testing.expectEqual(@as(usize, 1), flat.countTag(custom_tag, flat.all()));
+
+    var wide = flat.classIterator("wide", flat.all());
+    try testing.expectEqual(div, wide.next().?);
+    try testing.expectEqual(@as(NodeIndex, 9), wide.next().?);
+    try testing.expect(wide.next() == null);
+
+    var children = flat.children(div);
+    try testing.expectEqual(@as(NodeIndex, 4), children.next().?);
+    try testing.expect(flat.nodeType(children.next().?) == .comment);
+    try testing.expectEqual(@as(NodeIndex, 9), children.next().?);
+    try testing.expect(children.next() == null);
+    try testing.expectEqual(div, flat.parent[9]);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try flat.textContent(div, &out.writer);
+    try testing.expectEqualStrings("Hello boldWorld", out.written());
+    try testing.expectEqualStrings(" note ", flat.textOf(8));
+}
+
+test "FlatDom tag scan crosses vector lanes" {
+    const allocator = testing.allocator;
+    var html: std.ArrayList(u8) = .empty;
+    defer html.deinit(allocator);
+    for (0..100) |i| {
+        try html.appendSlice(allocator, if (i % 7 == 0) "<a></a>" else "<span></span>");
+    }
+    const doc = try z.createDocFromString(html.items);
+    defer z.destroyDocument(doc);
+
+    var flat = try FlatDom.build(allocator, doc);
+    defer flat.deinit();
+
+    const a = flat.tagId("a").?;
+    try testing.expectEqual(@as(usize, 15), flat.countTag(a, flat.all()));
+    var it = flat.tagIterator(a, flat.all());
+    var n: usize = 0;
+    var previous: NodeIndex = 0;
+    while (it.next()) |i| : (n += 1) {
+        try testing.expect(i > previous);
+        try testing.expect(flat.tags[i] == a);
+        previous = i;
+    }
+    try testing.expectEqual(@as(usize, 15), n);
+}
@@ -0,0 +1,634 @@
+//! Form data: the entries a form submits, and their `application/x-www-form-urlencoded` encoding
+//!
+//! "Constructing the entry list" of the HTML spec, for a parsed page (the values are the attribute values):
+//! - the controls are `input`, `button`, `select` and `textarea` with a non-empty `name`, in tree order;
+//! - a control belongs to the form with the `id` given by its `form` attribute, or else to its form ancestor;
+//! - skipped: disabled controls (`disabled`, or inside a disabled `fieldset` but not in its first `legend`),
+//!   controls in a `datalist`, buttons other than the submitter, unchecked checkboxes and radios;
+//! - a `select` submits its selected options that are not disabled. A single select without a `selected`
+//!   option submits its first enabled option;
+//! - checkboxes and radios without `value` submit "on", a hidden `_charset_` submits "UTF-8", a file input
+//!   an empty file name, and `dirname` adds the direction ("ltr", or "rtl" from `dir`).
+//!
+//! One walk over the form, or over its whole tree when it has an `id`, since controls outside may point to it.
+//! Names and values are slices of the document, except the values the iterator builds in its scratch buffer:
+//! option text with collapsed whitespace, and option or textarea text split over several nodes.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const FormEntry = struct {
+    name: []const u8,
+    value: []const u8,
+    /// the control submitting the entry
+    control: *z.HTMLElement,
+    /// written after `name`: the ".x" and ".y" entries of an image submitter
+    suffix: []const u8 = "",
+};
+
+/// [forms] Iterator over the entries of `form`, submitted by `submitter` (a submit button, or null)
+///
+/// Keep the document alive while using the entries. A value built by the iterator is valid until the next call.
+/// ## Example
+/// ```
+/// var it = z.iterateForm(allocator, form, null);
+/// defer it.deinit();
+/// while (try it.next()) |entry| print("{s}={s}\n", .{ entry.name, entry.value });
+/// ---
+/// ```
+pub fn iterateForm(allocator: std.mem.Allocator, form: *z.HTMLElement, submitter: ?*z.HTMLElement) FormIterator {
+    const form_node = z.elementToNode(form);
+    const form_id = z.getAttribute_zc(form, "id");
+    var root = form_node;
+    if (form_id != null) {
+        while (z.parentNode(root)) |parent| root = parent;
+    }
+    // the walk starts at the form: count the disabled fieldsets around it
+    var disabled: usize = 0;
+    if (root == form_node) {
+        var ancestor = z.parentNode(form_node);
+        while (ancestor) |node| {
+            if (isExemptLegend(node)) {
+                ancestor = z.parentNode(z.parentNode(node).?);
+                continue;
+            }
+            if (isDisabledFieldset(node)) disabled += 1;
+            ancestor = z.parentNode(node);
+        }
+    }
+    return .{
+        .allocator = allocator,
+        .form = form_node,
+        .form_id = form_id,
+        .submitter = submitter,
+        .root = root,
+        .node = root,
+        .inside_form = root == form_node,
+        .disabled = disabled,
+    };
+}
+
+pub const FormData = struct {
+    entries: []FormEntry,
+    /// the values built by the iterator; the other names and values are borrowed from the document
+    text: []u8,
+
+    pub fn deinit(self: FormData, allocator: std.mem.Allocator) void {
+        allocator.free(self.entries);
+        allocator.free(self.text);
+    }
+};
+
+/// [forms] The entries of `form`, submitted by `submitter` (a submit button, or null)
+///
+/// Caller owns the result and frees it with `deinit`.
+/// ## Example
+/// ```
+/// const form = z.getElementById(body, "login").?;
+/// const data = try z.collectForm(allocator, form, null);
+/// defer data.deinit(allocator);
+/// ---
+/// ```
+pub fn collectForm(allocator: std.mem.Allocator, form: *z.HTMLElement, submitter: ?*z.HTMLElement) !FormData {
+    var entries: std.ArrayList(FormEntry) = .empty;
+    errdefer entries.deinit(allocator);
+    var text: std.ArrayList(u8) = .empty;
+    errdefer text.deinit(allocator);
+    // built values are copied into `text` and pointed to once it no longer moves
+    const Built = struct { entry: usize, start: usize, len: usize };
+    var built: std.ArrayList(Built) = .empty;
+    defer built.deinit(allocator);
+
+    var it = iterateForm(allocator, form, submitter);
+    defer it.deinit();
+    while (try it.next()) |entry| {
+        if (it.isBuilt(entry.value)) {
+            try built.append(allocator, .{ .entry = entries.items.len, .start = text.items.len, .len = entry.value.len });
+            try text.appendSlice(allocator, entry.value);
+        }
+        try entries.append(allocator, entry);
+    }
+
+    const owned_text = try text.toOwnedSlice(allocator);
+    errdefer allocator.free(owned_text);
+    for (built.items) |value| entries.items[value.entry].value = owned_text[value.start..][0..value.len];
+    return .{ .entries = try entries.toOwnedSlice(allocator), .text = owned_text };
+}
+
+/// [forms] Writes `entries` as `application/x-www-form-urlencoded`
+///
+/// Line breaks become CRLF (`%0D%0A`), spaces `+`, and every byte but `*-._` and ASCII alphanumerics is
+/// percent-encoded.
+pub fn writeFormUrlEncoded(writer: *std.Io.Writer, entries: []const FormEntry) !void {
+    for (entries, 0..) |entry, i| {
+        if (i > 0) try writer.writeByte('&');
+        try writeEntry(writer, entry);
+    }
+}
+
+/// [forms] Streams the entries of `form` as `application/x-www-form-urlencoded` into `writer`
+///
+/// `allocator` only backs the iterator scratch buffer, for the values it builds.
+/// Returns the number of entries written.
+/// ## Example
+/// ```
+/// var body: std.Io.Writer.Allocating = .init(allocator);
+/// defer body.deinit();
+/// _ = try z.serializeForm(allocator, &body.writer, form, submit_button);
+/// // POST body.written() with Content-Type: application/x-www-form-urlencoded
+/// ---
+/// ```
+pub fn serializeForm(allocator: std.mem.Allocator, writer: *std.Io.Writer, form: *z.HTMLElement, submitter: ?*z.HTMLElement) !usize {
+    var it = iterateForm(allocator, form, submitter);
+    defer it.deinit();
+    var count: usize = 0;
+    while (try it.next()) |entry| : (count += 1) {
+        if (count > 0) try writer.writeByte('&');
+        try writeEntry(writer, entry);
+    }
+    return count;
+}
+
+fn writeEntry(writer: *std.Io.Writer, entry: FormEntry) !void {
+    try writeUrlEncoded(writer, entry.name);
+    try writeUrlEncoded(writer, entry.suffix);
+    try writer.writeByte('=');
+    try writeUrlEncoded(writer, entry.value);
+}
+
+fn writeUrlEncoded(writer: *std.Io.Writer, text: []const u8) !void {
+    var start: usize = 0;
+    var i: usize = 0;
+    while (i < text.len) : (i += 1) {
+        const c = text[i];
+        switch (c) {
+            'a'...'z', 'A'...'Z', '0'...'9', '*', '-', '.', '_' => continue,
+            else => {},
+        }
+        try writer.writeAll(text[start..i]);
+        switch (c) {
+            ' ' => try writer.writeByte('+'),
+            '\r', '\n' => {
+                try writer.writeAll("%0D%0A");
+                if (c == '\r' and i + 1 < text.len and text[i + 1] == '\n') i += 1;
+            },
+            else => try writer.print("%{X:0>2}", .{c}),
+        }
+        start = i + 1;
+    }
+    try writer.writeAll(text[start..]);
+}
+
+pub const FormIterator = struct {
+    allocator: std.mem.Allocator,
+    form: *z.DomNode,
+    form_id: ?[]const u8,
+    submitter: ?*z.HTMLElement,
+    root: *z.DomNode,
+    /// last node visited, null at the end
+    node: ?*z.DomNode,
+    /// the children of `node` are walked next
+    descend: bool = true,
+    inside_form: bool,
+    /// disabled fieldsets around the current node, minus the first legends they are in
+    disabled: usize = 0,
+    /// entry to return before walking on: `dirname`, the ".y" of an image
+    pending: ?FormEntry = null,
+    /// multiple select whose options are being returned
+    select: ?*z.DomNode = null,
+    select_name: []const u8 = "",
+    option: ?*z.DomNode = null,
+    /// scratch buffer of the value being returned, when it is not a slice of the document
+    text: std.ArrayList(u8) = .empty,
+
+    pub fn deinit(self: *FormIterator) void {
+        self.text.deinit(self.allocator);
+    }
+
+    pub fn next(self: *FormIterator) !?FormEntry {
+        while (true) {
+            if (self.pending) |entry| {
+                self.pending = null;
+                return entry;
+            }
+            if (self.select) |select| {
+                while (nextOption(select, self.option)) |option| {
+                    self.option = option;
+                    if (z.hasAttribute(z.nodeToElement(option).?, "selected") and !isOptionDisabled(option)) {
+                        return .{ .name = self.select_name, .value = try self.optionValue(option), .control = z.nodeToElement(select).? };
+                    }
+                }
+                self.select = null;
+            }
+            const node = self.advance() orelse return null;
+            if (try self.entryOf(node)) |entry| return entry;
+        }
+    }
+
+    /// Next node in tree order, leaving the nodes that end before it
+    fn advance(self: *FormIterator) ?*z.DomNode {
+        var node = self.node orelse return null;
+        if (self.descend) {
+            if (z.firstChild(node)) |child| return self.visit(child);
+        }
+        while (node != self.root) {
+            self.exit(node);
+            if (z.nextSibling(node)) |next_sibling| return self.visit(next_sibling);
+            node = z.parentNode(node).?;
+        }
+        self.node = null;
+        return null;
+    }
+
+    fn visit(self: *FormIterator, node: *z.DomNode) *z.DomNode {
+        self.node = node;
+        self.descend = self.enter(node);
+        return node;
+    }
+
+    /// Returns true when the children must be walked
+    fn enter(self: *FormIterator, node: *z.DomNode) bool {
+        if (z.nodeTypeId(node) != z.LXB_DOM_NODE_TYPE_ELEMENT) return false;
+        if (node == self.form) self.inside_form = true;
+        switch (z.nodeTagId(node)) {
+            z.LXB_TAG_INPUT, z.LXB_TAG_BUTTON, z.LXB_TAG_SELECT, z.LXB_TAG_TEXTAREA, z.LXB_TAG_DATALIST, z.LXB_TAG_TEMPLATE => return false,
+            z.LXB_TAG_FIELDSET => if (isDisabledFieldset(node)) {
+                self.disabled += 1;
+            },
+            z.LXB_TAG_LEGEND => if (isExemptLegend(node)) {
+                self.disabled -= 1;
+            },
+            else => {},
+        }
+        return true;
+    }
+
+    fn exit(self: *FormIterator, node: *z.DomNode) void {
+        if (z.nodeTypeId(node) != z.LXB_DOM_NODE_TYPE_ELEMENT) return;
+        if (node == self.form) self.inside_form = false;
+        switch (z.nodeTagId(node)) {
+            z.LXB_TAG_FIELDSET => if (isDisabledFieldset(node)) {
+                self.disabled -= 1;
+            },
+            z.LXB_TAG_LEGEND => if (isExemptLegend(node)) {
+                self.disabled += 1;
+            },
+            else => {},
+        }
+    }
+
+    fn isSubmitter(self: *const FormIterator, control: *z.HTMLElement) bool {
+        const submitter = self.submitter orelse return false;
+        return submitter == control;
+    }
+
+    fn owns(self: *const FormIterator, control: *z.HTMLElement) bool {
+        const form_id = z.getAttribute_zc(control, "form") orelse return self.inside_form;
+        return if (self.form_id) |id| std.mem.eql(u8, form_id, id) else false;
+    }
+
+    /// The entry of a control, or null; a multiple select starts returning its options
+    fn entryOf(self: *FormIterator, node: *z.DomNode) !?FormEntry {
+        const tag = z.nodeTagId(node);
+        switch (tag) {
+            z.LXB_TAG_INPUT, z.LXB_TAG_BUTTON, z.LXB_TAG_SELECT, z.LXB_TAG_TEXTAREA => {},
+            else => return null,
+        }
+        if (!z.isHtmlTag(node, tag)) return null;
+        const control = z.nodeToElement(node).?;
+        if (!self.owns(control) or self.disabled > 0 or z.hasAttribute(control, "disabled")) return null;
+        const name = z.getAttribute_zc(control, "name") orelse "";
+
+        switch (tag) {
+            z.LXB_TAG_BUTTON => {
+                if (!self.isSubmitter(control) or name.len == 0) return null;
+                return .{ .name = name, .value = z.getAttribute_zc(control, "value") orelse "", .control = control };
+            },
+            z.LXB_TAG_TEXTAREA => {
+                if (name.len == 0) return null;
+                self.queueDirname(control);
+                return .{ .name = name, .value = try self.ownText(node), .control = control };
+            },
+            z.LXB_TAG_SELECT => {
+                if (name.len == 0) return null;
+                if (z.hasAttribute(control, "multiple")) {
+                    self.select = node;
+                    self.select_name = name;
+                    self.option = null;
+                    return null;
+                }
+                const option = selectedOption(control) orelse return null;
+                if (isOptionDisabled(option)) return null;
+                return .{ .name = name, .value = try self.optionValue(option), .control = control };
+            },
+            else => return self.inputEntry(control, name),
+        }
+    }
+
+    fn inputEntry(self: *FormIterator, control: *z.HTMLElement, name: []const u8) ?FormEntry {
+        const value = z.getAttribute_zc(control, "value");
+        const input_type = InputType.of(control);
+        switch (input_type) {
+            .image => {
+                if (!self.isSubmitter(control)) return null;
+                // the click coordinates are unknown: the origin
+                self.pending = .{ .name = name, .suffix = if (name.len == 0) "y" else ".y", .value = "0", .control = control };
+                return .{ .name = name, .suffix = if (name.len == 0) "x" else ".x", .value = "0", .control = control };
+            },
+            .reset, .button => return null,
+            else => {},
+        }
+        if (name.len == 0) return null;
+        return .{ .name = name, .control = control, .value = switch (input_type) {
+            .submit => if (self.isSubmitter(control)) value orelse "" else return null,
+            .checkbox, .radio => if (z.hasAttribute(control, "checked")) value orelse "on" else return null,
+            .file => "",
+            .hidden => if (std.ascii.eqlIgnoreCase(name, "_charset_")) "UTF-8" else value orelse "",
+            .text, .search => blk: {
+                self.queueDirname(control);
+                break :blk value orelse "";
+            },
+            .other => value orelse "",
+            .image, .reset, .button => unreachable,
+        } };
+    }
+
+    /// `value` is in the scratch buffer: valid until the next call to `next`
+    pub fn isBuilt(self: *const FormIterator, value: []const u8) bool {
+        const start = @intFromPtr(self.text.items.ptr);
+        const at = @intFromPtr(value.ptr);
+        return value.len > 0 and at >= start and at < start + self.text.items.len;
+    }
+
+    /// `value`, or the text of the option with its whitespace stripped and collapsed
+    fn optionValue(self: *FormIterator, option: *z.DomNode) ![]const u8 {
+        if (z.getAttribute_zc(z.nodeToElement(option).?, "value")) |value| return value;
+        const text = std.mem.trim(u8, try self.ownText(option), &std.ascii.whitespace);
+        if (!needsCollapse(text)) return text;
+
+        // collapsing only shrinks the text: done in place in the scratch buffer
+        if (self.isBuilt(text)) {
+            std.mem.copyForwards(u8, self.text.items, text);
+            self.text.shrinkRetainingCapacity(text.len);
+        } else {
+            self.text.clearRetainingCapacity();
+            try self.text.appendSlice(self.allocator, text);
+        }
+        const items = self.text.items;
+        var len: usize = 0;
+        var space = false;
+        for (items) |c| {
+            if (std.ascii.isWhitespace(c)) {
+                space = true;
+                continue;
+            }
+            if (space) {
+                items[len] = ' ';
+                len += 1;
+                space = false;
+            }
+            items[len] = c;
+            len += 1;
+        }
+        self.text.shrinkRetainingCapacity(len);
+        return self.text.items;
+    }
+
+    /// Text of an option or textarea: its single text node as is, or its text descendants joined in the scratch buffer
+    fn ownText(self: *FormIterator, node: *z.DomNode) ![]const u8 {
+        const child = z.firstChild(node) orelse return "";
+        if (z.nextSibling(child) == null and z.nodeTypeId(child) == z.LXB_DOM_NODE_TYPE_TEXT) return z.characterData(child);
+
+        self.text.clearRetainingCapacity();
+        var it = z.iterateDescendants(node);
+        while (it.next()) |descendant| {
+            if (z.nodeTypeId(descendant) == z.LXB_DOM_NODE_TYPE_TEXT) {
+                try self.text.appendSlice(self.allocator, z.characterData(descendant));
+            }
+        }
+        return self.text.items;
+    }
+
+    fn queueDirname(self: *FormIterator, control: *z.HTMLElement) void {
+        const dirname = z.getAttribute_zc(control, "dirname") orelse return;
+        if (dirname.len == 0) return;
+        const dir = z.getAttribute_zc(control, "dir") orelse "";
+        self.pending = .{
+            .name = dirname,
+            .value = if (std.ascii.eqlIgnoreCase(dir, "rtl")) "rtl" else "ltr",
+            .control = control,
+        };
+    }
+};
+
+const InputType = enum {
+    text,
+    search,
+    checkbox,
+    radio,
+    submit,
+    image,
+    reset,
+    button,
+    file,
+    hidden,
+    /// the types submitting their `value` as is
+    other,
+
+    const names = std.StaticStringMapWithEql(InputType, std.static_string_map.eqlAsciiIgnoreCase).initComptime(.{
+        .{ "text", .text },
+        .{ "search", .search },
+        .{ "checkbox", .checkbox },
+        .{ "radio", .radio },
+        .{ "submit", .submit },
+        .{ "image", .image },
+        .{ "reset", .reset },
+        .{ "button", .button },
+        .{ "file", .file },
+        .{ "hidden", .hidden },
+        .{ "password", .other },
+        .{ "email", .other },
+        .{ "url", .other },
+        .{ "tel", .other },
+        .{ "number", .other },
+        .{ "range", .other },
+        .{ "color", .other },
+        .{ "date", .other },
+        .{ "month", .other },
+        .{ "week", .other },
+        .{ "time", .other },
+        .{ "datetime-local", .other },
+    });
+
+    /// a missing or unknown `type` is `text`
+    fn of(control: *z.HTMLElement) InputType {
+        return names.get(z.getAttribute_zc(control, "type") orelse return .text) orelse .text;
+    }
+};
+
+fn isDisabledFieldset(node: *z.DomNode) bool {
+    return z.isHtmlTag(node, z.LXB_TAG_FIELDSET) and z.hasAttribute(z.nodeToElement(node).?, "disabled");
+}
+
+/// The first `legend` child of a disabled fieldset: its content stays enabled
+fn isExemptLegend(node: *z.DomNode) bool {
+    if (!z.isHtmlTag(node, z.LXB_TAG_LEGEND)) return false;
+    const parent = z.parentNode(node) orelse return false;
+    if (!isDisabledFieldset(parent)) return false;
+    var child = z.firstChild(parent);
+    while (child) |sibling| : (child = z.nextSibling(sibling)) {
+        if (z.isHtmlTag(sibling, z.LXB_TAG_LEGEND)) return sibling == node;
+    }
+    return false;
+}
+
+/// The options of a select in tree order: its `option` children and those of its `optgroup` children
+fn nextOption(select: *z.DomNode, previous: ?*z.DomNode) ?*z.DomNode {
+    var parent = if (previous) |option| z.parentNode(option).? else select;
+    var candidate = if (previous) |option| z.nextSibling(option) else z.firstChild(select);
+    while (true) {
+        const node = candidate orelse {
+            if (parent == select) return null;
+            candidate = z.nextSibling(parent);
+            parent = select;
+            continue;
+        };
+        if (z.isHtmlTag(node, z.LXB_TAG_OPTION)) return node;
+        if (parent == select and z.isHtmlTag(node, z.LXB_TAG_OPTGROUP)) {
+            parent = node;
+            candidate = z.firstChild(node);
+            continue;
+        }
+        candidate = z.nextSibling(node);
+    }
+}
+
+/// The option of a single select: the last `selected` one, or the first enabled one when it shows one row
+fn selectedOption(select: *z.HTMLElement) ?*z.DomNode {
+    const select_node = z.elementToNode(select);
+    var selected: ?*z.DomNode = null;
+    var first_enabled: ?*z.DomNode = null;
+    var option = nextOption(select_node, null);
+    while (option) |node| : (option = nextOption(select_node, node)) {
+        if (z.hasAttribute(z.nodeToElement(node).?, "selected")) selected = node;
+        if (first_enabled == null and !isOptionDisabled(node)) first_enabled = node;
+    }
+    if (selected != null) return selected;
+    const size = std.fmt.parseInt(usize, z.getAttribute_zc(select, "size") orelse "1", 10) catch 1;
+    return if (size <= 1) first_enabled else null;
+}
+
+fn isOptionDisabled(option: *z.DomNode) bool {
+    if (z.hasAttribute(z.nodeToElement(option).?, "disabled")) return true;
+    const parent = z.parentNode(option) orelse return false;
+    return z.isHtmlTag(parent, z.LXB_TAG_OPTGROUP) and z.hasAttribute(z.nodeToElement(parent).?, "disabled");
+}
+
+/// A whitespace run other than a single space
+fn needsCollapse(text: []const u8) bool {
+    var previous_space = false;
+    for (text) |c| {
+        if (!std.ascii.isWhitespace(c)) {
+            previous_space = false;
+            continue;
+        }
+        if (c != ' ' or previous_space) return true;
+        previous_space = true;
+    }
+    return false;
+}
+
+test "collectForm" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<input name="outside" value="o" form="f">
+        \\<form id="f">
+        \\  <input name="q" value="a b&amp;c"><input type="password" name="pw" value="é">
+        \\  <input type="hidden" name="_charset_"><input name="" value="no name">
+        \\  <input type="checkbox" name="c1" checked><input type="checkbox" name="c2" value="x">
+        \\  <input type="radio" name="r" value="1"><input type="RADIO" name="r" value="2" checked>
+        \\  <input name="off" value="1" disabled><input name="away" value="1" form="other">
+        \\  <select name="s"><option disabled>d</option><option> First </option><option>Second</option></select>
+        \\  <select name="m" multiple><optgroup label="g" disabled><option selected>g1</option></optgroup>
+        \\    <option selected value="v1">one</option><option>two</option><optgroup><option selected>three</option></optgroup></select>
+        \\  <textarea name="t" dirname="t.dir">line1
+        \\line2</textarea>
+        \\  <fieldset disabled><legend><input name="legend" value="1"></legend><input name="fieldset" value="1"></fieldset>
+        \\  <datalist><input name="listed" value="1"></datalist>
+        \\  <input type="file" name="upload"><input type="reset" name="reset">
+        \\  <input type="submit" name="go" value="Go"><button name="b" value="bv">B</button><input type="image" name="pic">
+        \\</form>
+    );
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+    const form = z.getElementById(body, "f").?;
+
+    const expected = "outside=o&q=a+b%26c&pw=%C3%A9&_charset_=UTF-8&c1=on&r=2&s=First&m=v1&m=three" ++
+        "&t=line1%0D%0Aline2&t.dir=ltr&legend=1&upload=";
+
+    const data = try collectForm(allocator, form, null);
+    defer data.deinit(allocator);
+    const entries = data.entries;
+    try testing.expectEqual(13, entries.len);
+    try testing.expectEqualStrings("outside", entries[0].name);
+    try testing.expectEqualStrings("SELECT", z.tagName_zc(entries[7].control));
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try writeFormUrlEncoded(&out.writer, entries);
+    try testing.expectEqualStrings(expected, out.written());
+
+    // submitters
+    const Case = struct { submitter: []const u8, count: usize, tail: []const u8 };
+    for ([_]Case{
+        .{ .submitter = "go", .count = 14, .tail = "&go=Go" },
+        .{ .submitter = "b", .count = 14, .tail = "&b=bv" },
+        .{ .submitter = "pic", .count = 15, .tail = "&pic.x=0&pic.y=0" },
+    }) |case| {
+        var it = z.iterateDescendants(z.elementToNode(form));
+        const submitter = while (it.next()) |node| {
+            const element = z.nodeToElement(node) orelse continue;
+            const name = z.getAttribute_zc(element, "name") orelse continue;
+            if (std.mem.eql(u8, name, case.submitter)) break element;
+        } else unreachable;
+
+        out.clearRetainingCapacity();
+        try testing.expectEqual(case.count, try serializeForm(allocator, &out.writer, form, submitter));
+        try testing.expect(std.mem.startsWith(u8, out.written(), expected));
+        try testing.expectEqualStrings(case.tail, out.written()[expected.len..]);
+    }
+}
+
+test "option text: whitespace collapsed, text split over several nodes" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<form id="f">
+        \\  <select name="city"><option selected>  New   York
+        \\  </option></select>
+        \\  <select name="m" multiple><option selected>A<!-- x -->B</option><option selected> C <!-- y -->  D </option></select>
+        \\</form>
+    );
+    defer z.destroyDocument(doc);
+    const form = z.getElementById(z.bodyNode(doc).?, "f").?;
+
+    var it = iterateForm(allocator, form, null);
+    defer it.deinit();
+    const city = (try it.next()).?;
+    try testing.expectEqualStrings("New York", city.value);
+    try testing.expect(it.isBuilt(city.value));
+    try testing.expectEqualStrings("AB", (try it.next()).?.value);
+    try testing.expectEqualStrings("C D", (try it.next()).?.value);
+    try testing.expect((try it.next()) == null);
+
+    // the built values outlive the iterator
+    const data = try collectForm(allocator, form, null);
+    defer data.deinit(allocator);
+    try testing.expectEqual(3, data.entries.len);
+    try testing.expectEqualStrings("New York", data.entries[0].value);
+    try testing.expectEqualStrings("AB", data.entries[1].value);
+    try testing.expectEqualStrings("C D", data.entries[2].value);
+}
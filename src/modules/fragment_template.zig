@@ -18,6 +18,7 @@
 const std = @import("std");
 const z = @import("../root.zig");
 const Err = z.Err;
+const mutation = @import("mutation.zig");
 
 const testing = std.testing;
 const print = std.debug.print;
@@ -32,7 +33,6 @@ extern "c" fn lexbor_element_to_template_wrapper(element: *z.HTMLElement) ?*z.HT
 
 extern "c" fn lexbor_html_template_content_wrapper(template: *z.HTMLTemplateElement) *z.DocumentFragment;
 extern "c" fn lexbor_html_template_to_node_wrapper(template: *z.HTMLTemplateElement) *z.DomNode;
-extern "c" fn lexbor_html_tree_node_is_wrapper(node: *z.DomNode, tag_id: u32) bool;
 
 extern "c" fn lxb_dom_document_create_document_fragment(doc: *z.HTMLDocument) ?*z.DocumentFragment;
 extern "c" fn lxb_dom_document_fragment_interface_destroy(document_fragment: *z.DocumentFragment) *z.DocumentFragment;
@@ -141,6 +141,7 @@ pub fn createDocumentFragment(doc: *z.HTMLDocument) !*z.DocumentFragment {
 
 /// [fragment] Destroys a document fragment
 pub fn destroyDocumentFragment(fragment: *z.DocumentFragment) void {
+    mutation.notify(.{ .kind = .destroyed, .target = fragmentToNode(fragment) });
     _ = lxb_dom_document_fragment_interface_destroy(fragment);
     return;
 }
@@ -158,6 +159,10 @@ pub fn appendFragment(parent: *z.DomNode, fragment: ?*z.DomNode) !void {
     // Check if this is a true DocumentFragment
     if (z.isTypeFragment(fragment.?)) {
         // Use the lexbor DOM-spec function for true DocumentFragments
+        var moved = z.firstChild(fragment.?);
+        while (moved) |child| : (moved = z.nextSibling(child)) {
+            mutation.notify(.{ .kind = .child_added, .target = parent, .node = child });
+        }
         const result = lxb_dom_node_append_child(parent, fragment.?);
         // LXB_DOM_EXCEPTION_OK = -1, all other values are errors
         if (result != -1) {
@@ -467,12 +472,15 @@ pub fn createTemplate(doc: *z.HTMLDocument) !*z.HTMLTemplateElement {
 
 /// [template] Destroy a template in the document
 pub fn destroyTemplate(template: *z.HTMLTemplateElement) void {
+    const node = templateToNode(template);
+    mutation.notifyRemove(node);
+    mutation.notify(.{ .kind = .destroyed, .target = node });
     _ = lxb_html_template_element_interface_destroy(template);
 }
 
 /// [template] Check if a node is a template element
 pub fn isTemplate(node: *z.DomNode) bool {
-    return lexbor_html_tree_node_is_wrapper(node, z.LXB_TAG_TEMPLATE);
+    return z.isHtmlTag(node, z.LXB_TAG_TEMPLATE);
 }
 
 /// [template] Cast template to node
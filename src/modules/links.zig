@@ -0,0 +1,588 @@
+//! Link extraction: URL-bearing attributes collected in one walk and resolved with `lexbor/url`
+//!
+//! Collected attributes:
+//! - `href` of `<a>`, `<area>`, `<link>`
+//! - `src` of `<img>`, `<source>`, `<script>`, `<iframe>`, `<embed>`, `<audio>`, `<video>`, `<track>`
+//! - `srcset` of `<img>`, `<source>` (one link per candidate)
+//! - `poster` of `<video>`, `action` of `<form>`
+//!
+//! URLs are resolved against the first `<base href>` of the document, itself resolved against the page URL.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// [links] An extracted link. Strings live in the `LinkList` arena.
+pub const Link = struct {
+    element: *z.HTMLElement,
+    tag: z.HtmlTag,
+    /// attribute name: "href", "src", "srcset", "poster" or "action"
+    attribute: []const u8,
+    /// attribute value (or `srcset` candidate) as written in the document
+    raw: []const u8,
+    /// absolute URL, `null` when the URL can not be resolved
+    url: ?[]const u8,
+};
+
+pub const LinkOptions = struct {
+    /// one link per `srcset` candidate
+    srcset: bool = true,
+    /// resolve URLs against `<base href>` / page URL
+    resolve: bool = true,
+    /// drop `javascript:` links
+    skip_javascript: bool = true,
+    /// drop same-document links (`href="#top"`)
+    skip_fragments: bool = false,
+};
+
+/// [links] Extracted links and the arena owning their strings
+pub const LinkList = struct {
+    arena: std.heap.ArenaAllocator,
+    items: []Link,
+
+    pub fn deinit(self: *LinkList) void {
+        self.arena.deinit();
+    }
+};
+
+/// URL-bearing attributes per tag
+fn urlAttributes(tag: z.HtmlTag) []const []const u8 {
+    return switch (tag) {
+        .a, .area, .link => &.{"href"},
+        .img, .source => &.{ "src", "srcset" },
+        .script, .iframe, .embed, .audio, .track => &.{"src"},
+        .video => &.{ "src", "poster" },
+        .form => &.{"action"},
+        else => &.{},
+    };
+}
+
+/// [links] Reusable link extractor: owns a URL parser and a bounded cache of absolute `<base href>` URLs
+///
+/// Pages of the same site often share an absolute `<base href>`: it is parsed once.
+/// Page URLs and relative `<base href>` values are parsed per document and not kept.
+/// ## Example
+/// ```
+/// var extractor = try z.LinkExtractor.init(allocator);
+/// defer extractor.deinit();
+///
+/// var links = try extractor.extract(allocator, doc, "https://example.com/blog/", .{});
+/// defer links.deinit();
+/// for (links.items) |link| print("{s}\n", .{link.url orelse link.raw});
+/// ---
+/// ```
+pub const LinkExtractor = struct {
+    allocator: std.mem.Allocator,
+    parser: z.UrlParser,
+    /// absolute `<base href>` values, cleared when `max_cached_bases` is reached
+    base_cache: std.StringHashMap(*z.Url),
+    scratch: std.ArrayList(u8) = .empty,
+
+    pub fn init(allocator: std.mem.Allocator) !LinkExtractor {
+        return .{
+            .allocator = allocator,
+            .parser = try z.UrlParser.init(),
+            .base_cache = std.StringHashMap(*z.Url).init(allocator),
+        };
+    }
+
+    const max_cached_bases = 256;
+
+    pub fn deinit(self: *LinkExtractor) void {
+        self.clearBaseCache();
+        self.base_cache.deinit();
+        self.scratch.deinit(self.allocator);
+        self.parser.deinit();
+    }
+
+    /// [links] Parsed absolute `<base href>` from the cache (parsed and cached on first use)
+    ///
+    /// Null when `href` is not an absolute URL: it then depends on the page URL and is not cached.
+    pub fn baseUrl(self: *LinkExtractor, href: []const u8) !?*const z.Url {
+        if (self.base_cache.get(href)) |url| return url;
+        const url = self.parser.parse(null, href) catch return null;
+        errdefer self.parser.destroyUrl(url);
+        if (self.base_cache.count() >= max_cached_bases) self.clearBaseCache();
+        const key = try self.allocator.dupe(u8, href);
+        errdefer self.allocator.free(key);
+        try self.base_cache.put(key, url);
+        return url;
+    }
+
+    fn clearBaseCache(self: *LinkExtractor) void {
+        var it = self.base_cache.iterator();
+        while (it.next()) |entry| {
+            self.allocator.free(entry.key_ptr.*);
+            self.parser.destroyUrl(entry.value_ptr.*);
+        }
+        self.base_cache.clearRetainingCapacity();
+    }
+
+    /// [links] Collect and resolve the links of a document in one walk.
+    ///
+    /// `page_url` is the URL the document was fetched from (may be empty when unknown).
+    /// Caller must `deinit()` the returned `LinkList`.
+    pub fn extract(
+        self: *LinkExtractor,
+        allocator: std.mem.Allocator,
+        doc: *z.HTMLDocument,
+        page_url: []const u8,
+        options: LinkOptions,
+    ) !LinkList {
+        var result = LinkList{ .arena = std.heap.ArenaAllocator.init(allocator), .items = &.{} };
+        errdefer result.arena.deinit();
+        const arena = result.arena.allocator();
+
+        const root = z.documentRoot(doc) orelse return result;
+
+        var context = CollectContext{
+            .allocator = arena,
+            .options = options,
+        };
+        z.simpleWalk(root, collectCallback, &context);
+        if (context.failed) return error.OutOfMemory;
+
+        if (options.resolve) {
+            var page: ?*z.Url = null;
+            if (page_url.len > 0) page = self.parser.parse(null, page_url) catch null;
+            defer if (page) |url| self.parser.destroyUrl(url);
+            var base: ?*const z.Url = page;
+
+            // a `<base href>` relative to the page URL is not cached
+            var relative_base: ?*z.Url = null;
+            defer if (relative_base) |url| self.parser.destroyUrl(url);
+
+            if (context.base_href) |href| {
+                if (try self.baseUrl(href)) |url| {
+                    base = url;
+                } else if (page) |page_base| {
+                    relative_base = self.parser.parse(page_base, href) catch null;
+                    if (relative_base) |url| base = url;
+                }
+            }
+            for (context.links.items) |*link| {
+                link.url = try self.resolve(arena, base, link.raw);
+            }
+        }
+
+        result.items = context.links.items;
+        return result;
+    }
+
+    fn resolve(self: *LinkExtractor, arena: std.mem.Allocator, base: ?*const z.Url, raw: []const u8) !?[]const u8 {
+        const url = self.parser.parse(base, std.mem.trim(u8, raw, " \t\n\r")) catch return null;
+        defer self.parser.destroyUrl(url);
+
+        self.scratch.clearRetainingCapacity();
+        try z.UrlParser.serializeAppend(self.allocator, url, &self.scratch, false);
+        return try arena.dupe(u8, self.scratch.items);
+    }
+};
+
+const CollectContext = struct {
+    allocator: std.mem.Allocator,
+    options: LinkOptions,
+    links: std.ArrayList(Link) = .empty,
+    base_href: ?[]const u8 = null,
+    failed: bool = false,
+
+    fn add(self: *CollectContext, element: *z.HTMLElement, tag: z.HtmlTag, attribute: []const u8, raw: []const u8) !void {
+        const trimmed = std.mem.trim(u8, raw, " \t\n\r");
+        if (trimmed.len == 0) return;
+        if (self.options.skip_javascript and std.ascii.startsWithIgnoreCase(trimmed, "javascript:")) return;
+        if (self.options.skip_fragments and trimmed[0] == '#') return;
+
+        try self.links.append(self.allocator, .{
+            .element = element,
+            .tag = tag,
+            .attribute = attribute,
+            .raw = try self.allocator.dupe(u8, trimmed),
+            .url = null,
+        });
+    }
+};
+
+fn collectCallback(node: *z.DomNode, ctx: ?*anyopaque) callconv(.c) c_int {
+    const context = z.castContext(CollectContext, ctx);
+    const element = z.nodeToElement(node) orelse return z._CONTINUE;
+    const tag = z.tagFromElement(element) orelse return z._CONTINUE;
+
+    if (tag == .base) {
+        if (context.base_href == null) {
+            if (z.getAttribute_zc(element, "href")) |href| {
+                context.base_href = context.allocator.dupe(u8, href) catch {
+                    context.failed = true;
+                    return z._STOP;
+                };
+            }
+        }
+        return z._CONTINUE;
+    }
+
+    for (urlAttributes(tag)) |attribute| {
+        const value = z.getAttribute_zc(element, attribute) orelse continue;
+
+        if (std.mem.eql(u8, attribute, "srcset")) {
+            if (!context.options.srcset) continue;
+            var it = z.iterateSrcset(value);
+            while (it.next()) |candidate| {
+                context.add(element, tag, attribute, candidate.url) catch {
+                    context.failed = true;
+                    return z._STOP;
+                };
+            }
+            continue;
+        }
+        context.add(element, tag, attribute, value) catch {
+            context.failed = true;
+            return z._STOP;
+        };
+    }
+    return z._CONTINUE;
+}
+
+/// [links] Collect and resolve every URL-bearing attribute of the document in one walk.
+///
+/// One-shot version of `LinkExtractor.extract`: use a `LinkExtractor` to reuse the URL parser
+/// and the base URL cache across documents.
+///
+/// Caller must `deinit()` the returned `LinkList`.
+/// ## Example
+/// ```
+/// var links = try z.extractLinks(allocator, doc, "https://example.com/", .{});
+/// defer links.deinit();
+/// ---
+/// ```
+pub fn extractLinks(
+    allocator: std.mem.Allocator,
+    doc: *z.HTMLDocument,
+    page_url: []const u8,
+    options: LinkOptions,
+) !LinkList {
+    var extractor = try LinkExtractor.init(allocator);
+    defer extractor.deinit();
+    return extractor.extract(allocator, doc, page_url, options);
+}
+
+// -------------------------------------------------------------------------------
+// URL rewriting
+// -------------------------------------------------------------------------------
+
+/// [links] A URL found by `rewriteUrls`, passed to the rewriter
+pub const UrlRewriteInput = struct {
+    element: *z.HTMLElement,
+    tag: z.HtmlTag,
+    /// "href", "src", "srcset", "poster", "action" or "style"
+    attribute: []const u8,
+    /// URL as written in the document (one `srcset` candidate, one CSS `url()`)
+    raw: []const u8,
+    /// URL resolved against the base, `null` when it can not be parsed
+    url: ?*const z.Url,
+};
+
+const PendingAttribute = struct {
+    name: []const u8,
+    start: usize,
+    end: usize,
+};
+
+fn UrlRewriter(comptime Ctx: type, comptime rewriter: anytype) type {
+    return struct {
+        const Self = @This();
+
+        ctx: Ctx,
+        parser: *z.UrlParser,
+        base: ?*const z.Url,
+        // the rewriter writes a new URL here
+        out: std.Io.Writer.Allocating,
+        // new attribute values of the current element
+        values: std.ArrayList(u8) = .empty,
+        pending: [4]PendingAttribute = undefined,
+        pending_len: usize = 0,
+        rewritten: usize = 0,
+        err: ?anyerror = null,
+
+        fn callback(node: *z.DomNode, ctx: ?*anyopaque) callconv(.c) c_int {
+            const self = z.castContext(Self, ctx);
+            const element = z.nodeToElement(node) orelse return z._CONTINUE;
+            self.visit(element) catch |err| {
+                self.err = err;
+                return z._STOP;
+            };
+            return z._CONTINUE;
+        }
+
+        fn visit(self: *Self, element: *z.HTMLElement) !void {
+            const tag = z.tagFromAnyElement(element);
+            self.values.clearRetainingCapacity();
+            self.pending_len = 0;
+
+            for (urlAttributes(tag)) |attribute| {
+                const value = z.getAttribute_zc(element, attribute) orelse continue;
+                if (std.mem.eql(u8, attribute, "srcset")) {
+                    var it = z.iterateSrcset(value);
+                    try self.rewriteSpans(element, tag, attribute, value, &it);
+                } else {
+                    try self.rewriteValue(element, tag, attribute, value);
+                }
+            }
+            if (z.getAttribute_zc(element, "style")) |style| {
+                var it = z.iterateCssUrls(style);
+                try self.rewriteSpans(element, tag, "style", style, &it);
+            }
+
+            if (self.pending_len == 0) return;
+
+            // all new values are computed: apply them in one call
+            var pairs: [4]z.AttributePair = undefined;
+            for (self.pending[0..self.pending_len], 0..) |p, i| {
+                pairs[i] = .{ .name = p.name, .value = self.values.items[p.start..p.end] };
+            }
+            z.setAttributes(element, pairs[0..self.pending_len]) orelse return Err.SetAttributeFailed;
+        }
+
+        /// Calls the rewriter; returns the new URL (valid until the next call) or null when unchanged
+        fn rewriteOne(self: *Self, element: *z.HTMLElement, tag: z.HtmlTag, attribute: []const u8, raw: []const u8) !?[]const u8 {
+            const url: ?*z.Url = self.parser.parse(self.base, raw) catch null;
+            defer if (url) |u| self.parser.destroyUrl(u);
+
+            self.out.clearRetainingCapacity();
+            const changed = try rewriter(self.ctx, UrlRewriteInput{
+                .element = element,
+                .tag = tag,
+                .attribute = attribute,
+                .raw = raw,
+                .url = url,
+            }, &self.out.writer);
+            if (!changed) return null;
+            self.rewritten += 1;
+            return self.out.written();
+        }
+
+        fn rewriteValue(self: *Self, element: *z.HTMLElement, tag: z.HtmlTag, attribute: []const u8, value: []const u8) !void {
+            const raw = std.mem.trim(u8, value, " \t\n\r");
+            if (raw.len == 0) return;
+            const new_url = try self.rewriteOne(element, tag, attribute, raw) orelse return;
+
+            const start = self.values.items.len;
+            try self.values.appendSlice(self.out.allocator, new_url);
+            self.addPending(attribute, start);
+        }
+
+        /// Rewrites the URLs of a `srcset` or `style` value; the value is rebuilt only if one URL changed
+        fn rewriteSpans(self: *Self, element: *z.HTMLElement, tag: z.HtmlTag, attribute: []const u8, value: []const u8, it: anytype) !void {
+            const start = self.values.items.len;
+            var copied: usize = 0;
+            var changed = false;
+
+            while (it.next()) |span| {
+                const new_url = try self.rewriteOne(element, tag, attribute, span.url) orelse continue;
+                changed = true;
+                try self.values.appendSlice(self.out.allocator, value[copied..span.start]);
+                try self.values.appendSlice(self.out.allocator, new_url);
+                copied = span.start + span.url.len;
+            }
+            if (!changed) return;
+            try self.values.appendSlice(self.out.allocator, value[copied..]);
+            self.addPending(attribute, start);
+        }
+
+        fn addPending(self: *Self, name: []const u8, start: usize) void {
+            self.pending[self.pending_len] = .{ .name = name, .start = start, .end = self.values.items.len };
+            self.pending_len += 1;
+        }
+    };
+}
+
+/// [links] Rewrite every URL-bearing attribute under `root` in one walk.
+///
+/// Covers the attributes of `extractLinks`, each `srcset` candidate and the `url()` of `style` attributes.
+/// Each URL is parsed with `lexbor/url` against `base_url` (may be empty) and passed to
+/// `rewriter(ctx, input: UrlRewriteInput, writer: *std.Io.Writer) !bool`
+/// which writes the replacement and returns `true`, or returns `false` to keep the URL.
+///
+/// Unchanged URLs cost no allocation: attribute values are only rebuilt when a URL changes,
+/// and the new values of an element are applied with a single `setAttributes` call.
+///
+/// Returns the number of rewritten URLs.
+/// ## Example
+/// ```
+/// const Proxy = struct {
+///     fn rewrite(_: void, input: z.UrlRewriteInput, w: *std.Io.Writer) !bool {
+///         const url = input.url orelse return false;
+///         try w.writeAll("https://proxy.local/?u=");
+///         try z.UrlParser.serializeTo(url, w, false);
+///         return true;
+///     }
+/// };
+/// _ = try z.rewriteUrls(allocator, z.bodyNode(doc).?, "https://example.com/", {}, Proxy.rewrite);
+/// ---
+/// ```
+pub fn rewriteUrls(
+    allocator: std.mem.Allocator,
+    root: *z.DomNode,
+    base_url: []const u8,
+    ctx: anytype,
+    comptime rewriter: anytype,
+) !usize {
+    var parser = try z.UrlParser.init();
+    defer parser.deinit();
+
+    const base: ?*const z.Url = if (base_url.len > 0) try parser.parse(null, base_url) else null;
+
+    const Rewriter = UrlRewriter(@TypeOf(ctx), rewriter);
+    var state = Rewriter{
+        .ctx = ctx,
+        .parser = &parser,
+        .base = base,
+        .out = std.Io.Writer.Allocating.init(allocator),
+    };
+    defer state.out.deinit();
+    defer state.values.deinit(allocator);
+
+    if (z.nodeToElement(root)) |element| try state.visit(element);
+    z.simpleWalk(root, Rewriter.callback, &state);
+    if (state.err) |err| return err;
+
+    return state.rewritten;
+}
+
+test "extractLinks resolves against base href and page URL" {
+    const allocator = testing.allocator;
+    const html =
+        \\<html><head>
+        \\<base href="/static/">
+        \\<link rel="stylesheet" href="css/main.css">
+        \\</head><body>
+        \\<a href="https://other.org/x">Other</a>
+        \\<a href="javascript:void(0)">JS</a>
+        \\<a href="#top">Top</a>
+        \\<img src="img/a.png" srcset="img/a-1x.png 1x, img/a-2x.png 2x">
+        \\<video poster="p.jpg"><source src="v.mp4"></video>
+        \\<form action="../submit"></form>
+        \\</body></html>
+    ;
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+
+    var links = try extractLinks(allocator, doc, "https://Example.com/blog/post.html", .{});
+    defer links.deinit();
+
+    const expected = [_][2][]const u8{
+        .{ "css/main.css", "https://example.com/static/css/main.css" },
+        .{ "https://other.org/x", "https://other.org/x" },
+        .{ "#top", "https://example.com/static/#top" },
+        .{ "img/a.png", "https://example.com/static/img/a.png" },
+        .{ "img/a-1x.png", "https://example.com/static/img/a-1x.png" },
+        .{ "img/a-2x.png", "https://example.com/static/img/a-2x.png" },
+        .{ "p.jpg", "https://example.com/static/p.jpg" },
+        .{ "v.mp4", "https://example.com/static/v.mp4" },
+        .{ "../submit", "https://example.com/submit" },
+    };
+    try testing.expect(links.items.len == expected.len);
+    for (expected, links.items) |exp, link| {
+        try testing.expectEqualStrings(exp[0], link.raw);
+        try testing.expectEqualStrings(exp[1], link.url.?);
+    }
+    try testing.expect(links.items[0].tag == .link);
+    try testing.expectEqualStrings("srcset", links.items[4].attribute);
+}
+
+test "LinkExtractor reuses cached base URLs and handles unresolved links" {
+    const allocator = testing.allocator;
+    var extractor = try LinkExtractor.init(allocator);
+    defer extractor.deinit();
+
+    const doc = try z.createDocFromString("<a href='a.html'>a</a><a href='#x'>x</a>");
+    defer z.destroyDocument(doc);
+
+    for (0..3) |i| {
+        var page: [32]u8 = undefined;
+        const page_url = try std.fmt.bufPrint(&page, "https://example.com/{d}/", .{i});
+        var links = try extractor.extract(allocator, doc, page_url, .{ .skip_fragments = true });
+        defer links.deinit();
+        try testing.expect(links.items.len == 1);
+        try testing.expect(std.mem.endsWith(u8, links.items[0].url.?, "/a.html"));
+    }
+    // page URLs are not kept
+    try testing.expect(extractor.base_cache.count() == 0);
+
+    const with_base = try z.createDocFromString("<base href='https://cdn.example.com/s/'><a href='a.html'>a</a>");
+    defer z.destroyDocument(with_base);
+    for (0..3) |_| {
+        var links = try extractor.extract(allocator, with_base, "https://example.com/", .{});
+        defer links.deinit();
+        try testing.expectEqualStrings("https://cdn.example.com/s/a.html", links.items[0].url.?);
+    }
+    try testing.expect(extractor.base_cache.count() == 1);
+
+    // no page URL: relative links stay unresolved
+    var links = try extractor.extract(allocator, doc, "", .{});
+    defer links.deinit();
+    try testing.expect(links.items.len == 2);
+    try testing.expect(links.items[0].url == null);
+}
+
+const TestProxy = struct {
+    fn rewrite(keep_host: []const u8, input: UrlRewriteInput, w: *std.Io.Writer) !bool {
+        if (std.mem.startsWith(u8, input.raw, keep_host)) return false;
+        const url = input.url orelse return false;
+        try w.writeAll("https://proxy.test/?u=");
+        try z.UrlParser.serializeTo(url, w, false);
+        return true;
+    }
+
+    fn keep(_: void, _: UrlRewriteInput, _: *std.Io.Writer) !bool {
+        return false;
+    }
+};
+
+test "rewriteUrls rewrites href, srcset and style url()" {
+    const allocator = testing.allocator;
+    const html =
+        \\<div><a href="/a">A</a><a href="https://keep.org/">K</a>
+        \\<img src="i.png" srcset="i-1x.png 1x, https://keep.org/i.png 2x">
+        \\<p style="background: url('bg.png') no-repeat; color: red">x</p></div>
+    ;
+    const doc = try z.createDocFromString(html);
+    defer z.destroyDocument(doc);
+    const div = z.firstChild(z.bodyNode(doc).?).?;
+
+    const count = try rewriteUrls(allocator, div, "https://example.com/dir/page.html", @as([]const u8, "https://keep.org"), TestProxy.rewrite);
+    try testing.expect(count == 4);
+
+    const a = z.nodeToElement(z.firstChild(div).?).?;
+    try testing.expectEqualStrings("https://proxy.test/?u=https://example.com/a", z.getAttribute_zc(a, "href").?);
+    const kept = z.nextElementSibling(a).?;
+    try testing.expectEqualStrings("https://keep.org/", z.getAttribute_zc(kept, "href").?);
+
+    const img = z.nextElementSibling(kept).?;
+    try testing.expectEqualStrings("https://proxy.test/?u=https://example.com/dir/i.png", z.getAttribute_zc(img, "src").?);
+    try testing.expectEqualStrings(
+        "https://proxy.test/?u=https://example.com/dir/i-1x.png 1x, https://keep.org/i.png 2x",
+        z.getAttribute_zc(img, "srcset").?,
+    );
+
+    const p = z.nextElementSibling(img).?;
+    try testing.expectEqualStrings(
+        "background: url('https://proxy.test/?u=https://example.com/dir/bg.png') no-repeat; color: red",
+        z.getAttribute_zc(p, "style").?,
+    );
+}
+
+test "rewriteUrls keeps the document untouched when nothing changes" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("<a href='x.html' style='background:url(a.png)'>x</a><img srcset='a.png 1x'>");
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    const before = try z.innerHTML(allocator, z.nodeToElement(body).?);
+    defer allocator.free(before);
+    try testing.expect(try rewriteUrls(allocator, body, "", {}, TestProxy.keep) == 0);
+    const after = try z.innerHTML(allocator, z.nodeToElement(body).?);
+    defer allocator.free(after);
+    try testing.expectEqualStrings(before, after);
+}
@@ -0,0 +1,445 @@
+//! HTML to Markdown, streamed into a writer
+//!
+//! One iterative walk over the DOM: each element is dispatched on its `HtmlTag`, read from
+//! the lexbor tag id through a comptime table, and Markdown is written as the walk goes.
+//! No intermediate string is built; the only state is a fixed-size stack of open lists.
+//! Breaks, blockquote and list prefixes come from `text_layout.zig`, shared with `plain_text.zig`.
+//!
+//! Converted: headings, paragraphs, line breaks, rules, lists (nested, ordered), links,
+//! images, emphasis, strikethrough, inline code, `<pre>` blocks (with the `language-*` class
+//! of an inner `<code>`), blockquotes and tables (GFM pipe tables, the first row as header).
+//! `<head>`, `<script>`, `<style>`, `<template>`, `<noscript>` and form controls are skipped, and so are
+//! elements outside the HTML namespace with their subtree (inline `<svg>` and `<math>`).
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+const text_layout = @import("text_layout.zig");
+const tagOf = text_layout.tagOf;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const MarkdownOptions = struct {
+    /// `![alt](src)` for images, nothing when false
+    images: bool = true,
+    /// `[text](href)` for links, the text alone when false
+    links: bool = true,
+    /// backslash-escape the Markdown punctuation found in text
+    escape: bool = true,
+};
+
+/// [markdown] Converts `root` and its subtree to Markdown, written to `writer`
+///
+/// `root` can be the document, `<html>`, `<body>` or any element.
+/// Whitespace is collapsed as a browser would, except in `<pre>`.
+/// ## Example
+/// ```
+/// var out: std.Io.Writer.Allocating = .init(allocator);
+/// defer out.deinit();
+/// try z.toMarkdown(&out.writer, z.bodyNode(doc).?, .{});
+/// ---
+/// ```
+pub fn toMarkdown(writer: *std.Io.Writer, root: *z.DomNode, options: MarkdownOptions) !void {
+    var converter: Converter = .{ .layout = .{ .writer = writer, .bullet = "- " }, .options = options };
+    try text_layout.walk(root, &converter);
+    if (converter.layout.written) try writer.writeByte('\n');
+}
+
+const Converter = struct {
+    layout: text_layout.Layout,
+    options: MarkdownOptions,
+
+    code_depth: usize = 0,
+    /// backticks around the open code span, and whether the content is padded by a space
+    code_fence: usize = 1,
+    code_padded: bool = false,
+    /// backticks around the open `<pre>` block
+    pre_fence: usize = 3,
+    table_depth: usize = 0,
+    table_row: usize = 0,
+    row_cells: usize = 0,
+
+    /// Returns true when the children must be walked
+    fn enter(self: *Converter, node: *z.DomNode) !bool {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {},
+            z.LXB_DOM_NODE_TYPE_TEXT => {
+                try self.text(z.characterData(node));
+                return false;
+            },
+            z.LXB_DOM_NODE_TYPE_DOCUMENT, z.LXB_DOM_NODE_TYPE_FRAGMENT => return true,
+            else => return false,
+        }
+        if (text_layout.isForeign(node)) return false;
+
+        const out = &self.layout;
+        const tag = tagOf(node) orelse return true;
+        switch (tag) {
+            .head, .script, .style, .template, .noscript, .select, .textarea, .button, .input => return false,
+            .h1, .h2, .h3, .h4, .h5, .h6 => {
+                out.blockBreak(2);
+                try out.beginInline();
+                const level = @intFromEnum(tag) - @intFromEnum(z.HtmlTag.h1) + 1;
+                try out.writer.splatByteAll('#', level);
+                try out.writer.writeByte(' ');
+                out.line_start = true;
+            },
+            .p, .figure, .dl, .details, .address, .fieldset => out.blockBreak(2),
+            .div, .section, .article, .header, .footer, .main, .nav, .aside, .hgroup, .dialog, .form, .figcaption, .summary, .dt, .dd, .caption => out.blockBreak(1),
+            .br => out.lineBreak(),
+            .hr => {
+                out.blockBreak(2);
+                try out.beginInline();
+                try out.writer.writeAll("---");
+                out.blockBreak(2);
+            },
+            .ul, .ol, .menu => out.openList(tag == .ol),
+            .li => try out.listItem(),
+            .blockquote => out.openQuote(),
+            .pre => {
+                if (out.pre_depth == 0) {
+                    out.blockBreak(2);
+                    try out.beginInline();
+                    self.pre_fence = @max(3, backticks(node).longest + 1);
+                    try out.writer.splatByteAll('`', self.pre_fence);
+                    try out.writer.writeAll(codeLanguage(node));
+                    try out.newline(false);
+                }
+                out.openPre();
+            },
+            .code, .kbd, .samp => {
+                if (out.pre_depth == 0 and self.code_depth == 0) {
+                    const ticks = backticks(node);
+                    self.code_fence = ticks.longest + 1;
+                    self.code_padded = ticks.edge;
+                    try out.beginInline();
+                    try out.writer.splatByteAll('`', self.code_fence);
+                    if (self.code_padded) try out.writer.writeByte(' ');
+                }
+                self.code_depth += 1;
+            },
+            .strong, .b => try self.openMarker("**"),
+            .em, .i => try self.openMarker("_"),
+            .del, .s => try self.openMarker("~~"),
+            .a => if (self.linkTarget(node) != null) try self.openMarker("["),
+            .img => {
+                if (self.options.images) try self.image(node);
+                return false;
+            },
+            .table => {
+                out.blockBreak(2);
+                self.table_depth += 1;
+                if (self.table_depth == 1) self.table_row = 0;
+            },
+            .tr => if (self.table_depth == 1) {
+                out.blockBreak(1);
+                try out.beginInline();
+                try out.writer.writeByte('|');
+                self.row_cells = 0;
+            },
+            .td, .th => if (self.table_depth == 1) {
+                try out.writer.writeByte(' ');
+                out.in_cell = true;
+                out.line_start = true;
+                out.pending_space = false;
+            },
+            else => {},
+        }
+        return true;
+    }
+
+    fn exit(self: *Converter, node: *z.DomNode) !void {
+        const out = &self.layout;
+        const tag = tagOf(node) orelse return;
+        switch (tag) {
+            .h1, .h2, .h3, .h4, .h5, .h6, .p, .figure, .dl, .details, .address, .fieldset => out.blockBreak(2),
+            .div, .section, .article, .header, .footer, .main, .nav, .aside, .hgroup, .dialog, .form, .figcaption, .summary, .dt, .dd, .caption, .li => out.blockBreak(1),
+            .ul, .ol, .menu => out.closeList(),
+            .blockquote => out.closeQuote(),
+            .pre => {
+                out.pre_depth -= 1;
+                if (out.pre_depth == 0) {
+                    try out.newline(false);
+                    try out.writer.splatByteAll('`', self.pre_fence);
+                    out.wrote();
+                    out.blockBreak(2);
+                }
+            },
+            .code, .kbd, .samp => {
+                self.code_depth -= 1;
+                if (out.pre_depth == 0 and self.code_depth == 0) {
+                    if (self.code_padded) try out.writer.writeByte(' ');
+                    try out.writer.splatByteAll('`', self.code_fence);
+                }
+            },
+            .strong, .b => try out.writer.writeAll("**"),
+            .em, .i => try out.writer.writeByte('_'),
+            .del, .s => try out.writer.writeAll("~~"),
+            .a => if (self.linkTarget(node)) |href| {
+                try out.writer.writeAll("](");
+                try out.writer.writeAll(href);
+                try out.writer.writeByte(')');
+            },
+            .table => {
+                self.table_depth -= 1;
+                out.blockBreak(2);
+            },
+            .tr => if (self.table_depth == 1) {
+                if (self.table_row == 0 and self.row_cells > 0) {
+                    try out.newline(false);
+                    try out.writer.writeByte('|');
+                    for (0..self.row_cells) |_| try out.writer.writeAll(" --- |");
+                    out.wrote();
+                }
+                self.table_row += 1;
+                out.blockBreak(1);
+            },
+            .td, .th => if (self.table_depth == 1) {
+                try out.writer.writeAll(" |");
+                out.in_cell = false;
+                self.row_cells += 1;
+                out.pending_space = false;
+            },
+            else => {},
+        }
+    }
+
+    // --- text
+
+    fn text(self: *Converter, data: []const u8) !void {
+        if (self.layout.pre_depth > 0) return self.layout.preText(data);
+
+        var i: usize = 0;
+        while (i < data.len) {
+            if (std.ascii.isWhitespace(data[i])) {
+                self.layout.pending_space = true;
+                i += 1;
+                continue;
+            }
+            var end = i + 1;
+            while (end < data.len and !std.ascii.isWhitespace(data[end])) end += 1;
+            const line_start = self.layout.line_start or self.layout.pending_newlines > 0;
+            try self.layout.beginInline();
+            try self.escaped(data[i..end], line_start);
+            i = end;
+        }
+    }
+
+    /// `line_start`: the word starts a line, where `#`, `>`, `-`, `+` and `1.` would start a block
+    fn escaped(self: *Converter, word: []const u8, line_start: bool) !void {
+        const writer = self.layout.writer;
+        if (!self.options.escape or self.code_depth > 0) return writer.writeAll(word);
+        const block_mark = if (line_start) blockMark(word) else null;
+        var start: usize = 0;
+        for (word, 0..) |c, i| {
+            const escape = block_mark == i or switch (c) {
+                '\\', '*', '_', '`', '[', ']' => true,
+                '|' => self.layout.in_cell,
+                else => false,
+            };
+            if (!escape) continue;
+            try writer.writeAll(word[start..i]);
+            try writer.writeByte('\\');
+            start = i;
+        }
+        try writer.writeAll(word[start..]);
+    }
+
+    // --- elements
+
+    fn openMarker(self: *Converter, marker: []const u8) !void {
+        try self.layout.beginInline();
+        try self.layout.writer.writeAll(marker);
+        self.layout.line_start = true;
+    }
+
+    fn linkTarget(self: *Converter, node: *z.DomNode) ?[]const u8 {
+        if (!self.options.links) return null;
+        const href = z.getAttribute_zc(z.nodeToElement(node).?, "href") orelse return null;
+        if (href.len == 0 or std.ascii.startsWithIgnoreCase(href, "javascript:")) return null;
+        return href;
+    }
+
+    fn image(self: *Converter, node: *z.DomNode) !void {
+        const element = z.nodeToElement(node).?;
+        const src = z.getAttribute_zc(element, "src") orelse return;
+        const writer = self.layout.writer;
+        try self.layout.beginInline();
+        try writer.writeAll("![");
+        try self.escaped(z.getAttribute_zc(element, "alt") orelse "", false);
+        try writer.writeAll("](");
+        try writer.writeAll(src);
+        try writer.writeByte(')');
+    }
+};
+
+/// Index of the character to escape so that the first word of a line does not start a block:
+/// a heading, a blockquote, a list item, a rule or a setext underline
+fn blockMark(word: []const u8) ?usize {
+    switch (word[0]) {
+        '#', '>' => return 0,
+        '-', '+', '=' => return if (std.mem.allEqual(u8, word, word[0])) 0 else null,
+        '0'...'9' => {
+            // "1." or "1)"
+            const digits = std.mem.indexOfNone(u8, word, "0123456789") orelse return null;
+            if (digits + 1 == word.len and (word[digits] == '.' or word[digits] == ')')) return digits;
+            return null;
+        },
+        else => return null,
+    }
+}
+
+const Backticks = struct {
+    /// longest run of backticks
+    longest: usize = 0,
+    /// the text starts or ends with a backtick
+    edge: bool = false,
+};
+
+/// Backtick runs in the text of `node`: a code span or fence must be longer than any of them
+fn backticks(node: *z.DomNode) Backticks {
+    var result: Backticks = .{};
+    var run: usize = 0;
+    var seen = false;
+    var last: u8 = 0;
+    var it = z.iterateDescendants(node);
+    while (it.next()) |child| {
+        if (z.nodeTypeId(child) != z.LXB_DOM_NODE_TYPE_TEXT) continue;
+        for (z.characterData(child)) |c| {
+            if (c == '`') {
+                run += 1;
+                result.longest = @max(result.longest, run);
+            } else run = 0;
+            if (std.ascii.isWhitespace(c)) continue;
+            if (!seen and c == '`') result.edge = true;
+            seen = true;
+            last = c;
+        }
+    }
+    if (last == '`') result.edge = true;
+    return result;
+}
+
+/// `x` of a `language-x` class on the `<code>` child of a `<pre>`
+fn codeLanguage(pre: *z.DomNode) []const u8 {
+    const code = z.firstElementChild(z.nodeToElement(pre).?) orelse return "";
+    if (tagOf(z.elementToNode(code)) != .code) return "";
+    const class = z.getAttribute_zc(code, "class") orelse return "";
+    var tokens = std.mem.tokenizeAny(u8, class, &std.ascii.whitespace);
+    while (tokens.next()) |token| {
+        if (std.mem.startsWith(u8, token, "language-")) return token["language-".len..];
+    }
+    return "";
+}
+
+test "toMarkdown" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<html><head><title>skip</title><style>p {}</style></head><body>
+        \\<h1>Title  <em>here</em></h1>
+        \\<p>Some <strong>bold</strong>, a <a href="/x">link</a> and <code>a_b</code>.<br>Next line with 2*3.</p>
+        \\<ul><li>one</li><li>two<ol><li>inner</li><li>more</li></ol></li></ul>
+        \\<pre><code class="language-zig">const x = 1;
+        \\return x;
+        \\</code></pre>
+        \\<blockquote><p>quoted</p><p>twice</p></blockquote>
+        \\<table><tr><th>Name</th><th>Value</th></tr><tr><td>a|b</td><td>1</td></tr></table>
+        \\<p><img src="i.png" alt="pic"><script>alert(1)</script></p><hr>
+        \\</body></html>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try toMarkdown(&out.writer, z.documentRoot(doc).?, .{});
+    try testing.expectEqualStrings(
+        \\# Title _here_
+        \\
+        \\Some **bold**, a [link](/x) and `a_b`.
+        \\Next line with 2\*3.
+        \\
+        \\- one
+        \\- two
+        \\  1. inner
+        \\  2. more
+        \\
+        \\```zig
+        \\const x = 1;
+        \\return x;
+        \\```
+        \\
+        \\> quoted
+        \\>
+        \\> twice
+        \\
+        \\| Name | Value |
+        \\| --- | --- |
+        \\| a\|b | 1 |
+        \\
+        \\![pic](i.png)
+        \\
+        \\---
+        \\
+    , out.written());
+
+    out.clearRetainingCapacity();
+    try toMarkdown(&out.writer, z.bodyNode(doc).?, .{ .links = false, .images = false, .escape = false });
+    try testing.expect(std.mem.indexOf(u8, out.written(), "a link and") != null);
+    try testing.expect(std.mem.indexOf(u8, out.written(), "pic") == null);
+    try testing.expect(std.mem.indexOf(u8, out.written(), "2*3") != null);
+}
+
+test "toMarkdown skips inline svg and math" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<p>Before <svg viewBox="0 0 1 1"><title>icon</title><text>inside</text><foreignObject><p>deep</p></foreignObject></svg> after</p>
+        \\<p><math><mi>x</mi></math>end</p>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try toMarkdown(&out.writer, z.bodyNode(doc).?, .{});
+    try testing.expectEqualStrings("Before after\n\nend\n", out.written());
+}
+
+test "toMarkdown escapes block starts and fences code past its backticks" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<p># not a heading</p><p>&gt; not a quote</p><p>- not a list</p><p>+ nor this</p>
+        \\<p>1. not ordered<br>12) nor this</p><p>a - b # c 1. d</p>
+        \\<p>Use <code>a``b</code> and <code>`x`</code></p>
+        \\<pre>```zig
+        \\x
+        \\```</pre>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try toMarkdown(&out.writer, z.bodyNode(doc).?, .{});
+    try testing.expectEqualStrings(
+        \\\# not a heading
+        \\
+        \\\> not a quote
+        \\
+        \\\- not a list
+        \\
+        \\\+ nor this
+        \\
+        \\1\. not ordered
+        \\12\) nor this
+        \\
+        \\a - b # c 1. d
+        \\
+        \\Use ```a``b``` and `` `x` ``
+        \\
+        \\````
+        \\```zig
+        \\x
+        \\```
+        \\````
+        \\
+    , out.written());
+}
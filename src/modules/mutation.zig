@@ -0,0 +1,388 @@
+//! Mutation notifications from the wrapper APIs
+//!
+//! The mutating functions of `core`, `attributes`, `text_content`, `parsing` and `fragment_template`
+//! report each change here **before** applying it, so old values and old parents are still readable.
+//! Consumers (serialization cache, mutation recorder, query caches) register an observer for one document.
+//!
+//! With no observer registered, a notification is a single thread-local load and a branch.
+//! Observers are thread-local: they see the mutations made on the thread that registered them,
+//! which matches lexbor documents being single-threaded.
+//!
+//! Changes made by calling lexbor directly, bypassing the wrappers, are not reported.
+//!
+//! `MutationRecorder` logs the mutations of a document into a fixed-size ring buffer,
+//! so incremental consumers (indexes, caches, diffing) can catch up in O(changes).
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const MutationKind = enum(u8) {
+    /// `node` is about to be inserted under `target`
+    child_added,
+    /// `node` is about to be removed from `target`
+    child_removed,
+    /// all children of `target` are about to be replaced (inner HTML, text content, re-parse)
+    children_replaced,
+    /// the attribute `name` of the element `target` is about to be set or removed
+    attribute,
+    /// the data of the text or comment node `target` is about to change
+    character_data,
+    /// `target` and its subtree are about to be freed
+    destroyed,
+};
+
+pub const Mutation = struct {
+    kind: MutationKind,
+    target: *z.DomNode,
+    /// added or removed child
+    node: ?*z.DomNode = null,
+    /// attribute name, borrowed for the duration of the callback
+    name: []const u8 = "",
+};
+
+/// [mutation] Callback run for each mutation of the observed document
+pub const MutationObserver = struct {
+    /// null: every document of the thread
+    document: ?*z.HTMLDocument,
+    context: *anyopaque,
+    callback: *const fn (context: *anyopaque, mutation: *const Mutation) void,
+};
+
+const max_observers = 8;
+
+threadlocal var observers: [max_observers]MutationObserver = undefined;
+threadlocal var observer_count: usize = 0;
+
+/// [mutation] Register `observer` on the current thread
+///
+/// At most 8 observers are active at once.
+pub fn addMutationObserver(observer: MutationObserver) !void {
+    if (observer_count == max_observers) return Err.TooManyObservers;
+    observers[observer_count] = observer;
+    observer_count += 1;
+}
+
+/// [mutation] Unregister the observer registered with `context`
+pub fn removeMutationObserver(context: *anyopaque) void {
+    var i: usize = 0;
+    while (i < observer_count) {
+        if (observers[i].context == context) {
+            observer_count -= 1;
+            observers[i] = observers[observer_count];
+        } else i += 1;
+    }
+}
+
+/// Reports a mutation, called by the mutating wrappers
+pub inline fn notify(mutation: Mutation) void {
+    if (observer_count == 0) return;
+    dispatch(&mutation);
+}
+
+fn dispatch(mutation: *const Mutation) void {
+    const doc = documentOf(mutation.target);
+    for (observers[0..observer_count]) |observer| {
+        if (observer.document) |observed| if (observed != doc) continue;
+        observer.callback(observer.context, mutation);
+    }
+}
+
+/// Reports a change of the whole document: re-parse, clean or destroy.
+/// The target is the document node.
+pub inline fn notifyDocument(kind: MutationKind, doc: *z.HTMLDocument) void {
+    if (observer_count == 0) return;
+    dispatch(&.{ .kind = kind, .target = @ptrCast(@alignCast(doc)) });
+}
+
+/// [mutation] Document of a mutation target, the document node included
+pub fn documentOf(node: *z.DomNode) *z.HTMLDocument {
+    if (z.nodeType(node) == .document) return @ptrCast(@alignCast(node));
+    return z.ownerDocument(node);
+}
+
+/// Reports the removal of `node` from its parent, if any
+pub inline fn notifyRemove(node: *z.DomNode) void {
+    if (observer_count == 0) return;
+    if (z.parentNode(node)) |parent| dispatch(&.{ .kind = .child_removed, .target = parent, .node = node });
+}
+
+test "observers only see their document" {
+    const Counter = struct {
+        kinds: [8]MutationKind = undefined,
+        count: usize = 0,
+
+        fn callback(context: *anyopaque, mutation: *const Mutation) void {
+            const self: *@This() = @ptrCast(@alignCast(context));
+            if (self.count < self.kinds.len) self.kinds[self.count] = mutation.kind;
+            self.count += 1;
+        }
+    };
+
+    const doc = try z.createDocFromString("<p>a</p>");
+    defer z.destroyDocument(doc);
+    const other = try z.createDocFromString("<p>b</p>");
+    defer z.destroyDocument(other);
+
+    var counter: Counter = .{};
+    try addMutationObserver(.{ .document = doc, .context = &counter, .callback = Counter.callback });
+    defer removeMutationObserver(&counter);
+
+    const p = z.firstChild(z.bodyNode(doc).?).?;
+    _ = z.setAttribute(z.nodeToElement(p).?, "id", "x");
+    try z.replaceText(z.firstChild(p).?, "c");
+    const span = try z.createElement(doc, "span");
+    z.appendChild(p, z.elementToNode(span));
+    z.removeNode(z.elementToNode(span));
+    z.destroyNode(z.elementToNode(span));
+    try z.setContentAsText(p, "d");
+    z.destroyTemplate(try z.createTemplate(doc));
+    z.destroyDocumentFragment(try z.createDocumentFragment(doc));
+
+    _ = z.setAttribute(z.nodeToElement(z.firstChild(z.bodyNode(other).?).?).?, "id", "y");
+
+    try testing.expectEqual(@as(usize, 8), counter.count);
+    try testing.expectEqualSlices(
+        MutationKind,
+        &.{ .attribute, .character_data, .child_added, .child_removed, .destroyed, .children_replaced, .destroyed, .destroyed },
+        counter.kinds[0..8],
+    );
+
+    removeMutationObserver(&counter);
+    _ = z.setAttribute(z.nodeToElement(p).?, "id", "z");
+    try testing.expectEqual(@as(usize, 8), counter.count);
+}
+
+// ---------------------------------------------------------------------------------
+// Mutation recorder
+
+/// [mutation] A recorded mutation
+///
+/// `target` and `node` are handles only: the nodes may have been destroyed since, compare them, do not dereference
+/// them without knowing they are alive.
+pub const MutationRecord = struct {
+    /// position in the log, increasing by one per mutation
+    sequence: u64,
+    kind: MutationKind,
+    target: *z.DomNode,
+    node: ?*z.DomNode,
+    /// attribute name
+    name: []const u8,
+    /// attribute value or character data before the change,
+    /// null when there was none or when the bytes were overwritten in the value ring
+    old_value: ?[]const u8,
+};
+
+pub const MutationRecorderOptions = struct {
+    /// records kept, older ones are overwritten
+    capacity: usize = 1024,
+    /// bytes of the ring keeping attribute names and old values; 0 disables old values
+    value_bytes: usize = 64 * 1024,
+};
+
+/// [mutation] Logs the mutations of one document into a ring buffer
+///
+/// Consumers remember `nextSequence()` and later read what changed with `since()`.
+/// When the ring has overwritten records they did not read, `since()` returns null: rescan.
+///
+/// ## Example
+/// ```
+/// var recorder = try z.MutationRecorder.init(allocator, doc, .{});
+/// defer recorder.deinit();
+/// try recorder.start();
+///
+/// const seen = recorder.nextSequence();
+/// _ = z.setAttribute(div, "class", "active");
+///
+/// var changes = recorder.since(seen) orelse return rebuildIndex(doc);
+/// while (changes.next()) |record| updateIndex(record);
+/// ---
+/// ```
+pub const MutationRecorder = struct {
+    allocator: std.mem.Allocator,
+    document: *z.HTMLDocument,
+    records: []Record,
+    values: []u8,
+    /// total records logged, the next sequence number
+    sequence: u64 = 0,
+    /// total bytes logged in `values`
+    value_head: u64 = 0,
+    /// sequence of the last `clear`
+    cleared: u64 = 0,
+    recording: bool = false,
+
+    const Self = @This();
+
+    /// Logical range of the value ring
+    const Span = struct {
+        start: u64 = 0,
+        len: u32 = 0,
+        present: bool = false,
+    };
+
+    const Record = struct {
+        target: *z.DomNode,
+        node: ?*z.DomNode,
+        name: Span,
+        old_value: Span,
+        kind: MutationKind,
+    };
+
+    pub fn init(allocator: std.mem.Allocator, document: *z.HTMLDocument, options: MutationRecorderOptions) !Self {
+        const records = try allocator.alloc(Record, @max(options.capacity, 1));
+        errdefer allocator.free(records);
+        const values = try allocator.alloc(u8, options.value_bytes);
+        return .{ .allocator = allocator, .document = document, .records = records, .values = values };
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.stop();
+        self.allocator.free(self.records);
+        self.allocator.free(self.values);
+    }
+
+    /// [mutation] Start recording: the recorder must keep its address until `stop` or `deinit`
+    pub fn start(self: *Self) !void {
+        if (self.recording) return;
+        try addMutationObserver(.{ .document = self.document, .context = self, .callback = onMutation });
+        self.recording = true;
+    }
+
+    /// [mutation] Stop recording, the log is kept
+    pub fn stop(self: *Self) void {
+        if (!self.recording) return;
+        removeMutationObserver(self);
+        self.recording = false;
+    }
+
+    /// [mutation] Forget every record, sequence numbers keep increasing
+    pub fn clear(self: *Self) void {
+        self.value_head += self.values.len;
+        self.cleared = self.sequence;
+    }
+
+    /// [mutation] Sequence number of the next mutation
+    pub fn nextSequence(self: *const Self) u64 {
+        return self.sequence;
+    }
+
+    /// [mutation] Records from `sequence` on, oldest first; null when some of them were overwritten
+    pub fn since(self: *const Self, sequence: u64) ?Iterator {
+        if (sequence < self.oldest()) return null;
+        return .{ .recorder = self, .sequence = @min(sequence, self.sequence) };
+    }
+
+    /// Sequence of the oldest record kept
+    fn oldest(self: *const Self) u64 {
+        const kept = @min(self.sequence, self.records.len);
+        return @max(self.sequence - kept, self.cleared);
+    }
+
+    pub const Iterator = struct {
+        recorder: *const Self,
+        sequence: u64,
+
+        pub fn next(self: *Iterator) ?MutationRecord {
+            if (self.sequence >= self.recorder.sequence) return null;
+            const record = self.recorder.records[@intCast(self.sequence % self.recorder.records.len)];
+            defer self.sequence += 1;
+            return .{
+                .sequence = self.sequence,
+                .kind = record.kind,
+                .target = record.target,
+                .node = record.node,
+                .name = self.recorder.value(record.name) orelse "",
+                .old_value = self.recorder.value(record.old_value),
+            };
+        }
+    };
+
+    fn value(self: *const Self, span: Span) ?[]const u8 {
+        if (!span.present or self.value_head - span.start > self.values.len) return null;
+        if (span.len == 0) return "";
+        const offset: usize = @intCast(span.start % self.values.len);
+        return self.values[offset..][0..span.len];
+    }
+
+    /// Copies `bytes` into the value ring; a value never wraps around the end of the ring
+    fn storeValue(self: *Self, bytes: ?[]const u8) Span {
+        const data = bytes orelse return .{};
+        if (self.values.len == 0) return .{};
+        if (data.len > self.values.len or data.len > std.math.maxInt(u32)) return .{};
+        if (data.len == 0) return .{ .start = self.value_head, .present = true };
+
+        var start = self.value_head;
+        const offset: usize = @intCast(start % self.values.len);
+        if (offset + data.len > self.values.len) start += self.values.len - offset;
+        @memcpy(self.values[@intCast(start % self.values.len)..][0..data.len], data);
+        self.value_head = start + data.len;
+        return .{ .start = start, .len = @intCast(data.len), .present = true };
+    }
+
+    fn onMutation(context: *anyopaque, m: *const Mutation) void {
+        const self: *Self = @ptrCast(@alignCast(context));
+        const old_value: ?[]const u8 = switch (m.kind) {
+            .attribute => if (z.nodeToElement(m.target)) |element| z.getAttribute_zc(element, m.name) else null,
+            .character_data => z.characterData(m.target),
+            else => null,
+        };
+        self.records[@intCast(self.sequence % self.records.len)] = .{
+            .target = m.target,
+            .node = m.node,
+            .kind = m.kind,
+            .name = if (m.kind == .attribute) self.storeValue(m.name) else .{},
+            .old_value = self.storeValue(old_value),
+        };
+        self.sequence += 1;
+    }
+};
+
+test "MutationRecorder logs changes and old values" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("<p class=\"a\">text</p>");
+    defer z.destroyDocument(doc);
+    const p = z.firstChild(z.bodyNode(doc).?).?;
+
+    var recorder = try MutationRecorder.init(allocator, doc, .{ .capacity = 4, .value_bytes = 64 });
+    defer recorder.deinit();
+
+    // disabled: nothing is logged
+    _ = z.setAttribute(z.nodeToElement(p).?, "class", "b");
+    try testing.expectEqual(@as(u64, 0), recorder.nextSequence());
+
+    try recorder.start();
+    const seen = recorder.nextSequence();
+    _ = z.setAttribute(z.nodeToElement(p).?, "class", "c");
+    try z.replaceText(z.firstChild(p).?, "new");
+    const span = try z.createElement(doc, "span");
+    z.appendChild(p, z.elementToNode(span));
+
+    var changes = recorder.since(seen).?;
+    const first = changes.next().?;
+    try testing.expectEqual(MutationKind.attribute, first.kind);
+    try testing.expectEqualStrings("class", first.name);
+    try testing.expectEqualStrings("b", first.old_value.?);
+    const second = changes.next().?;
+    try testing.expectEqual(MutationKind.character_data, second.kind);
+    try testing.expectEqualStrings("text", second.old_value.?);
+    const third = changes.next().?;
+    try testing.expect(third.kind == .child_added and third.target == p and third.node.? == z.elementToNode(span));
+    try testing.expect(changes.next() == null);
+
+    // overflow: the consumer has to rescan
+    for (0..4) |_| _ = z.setAttribute(z.nodeToElement(p).?, "id", "x");
+    try testing.expect(recorder.since(seen) == null);
+    try testing.expect(recorder.since(recorder.nextSequence() - 4) != null);
+
+    recorder.clear();
+    try testing.expect(recorder.since(seen + 1) == null);
+    var empty = recorder.since(recorder.nextSequence()).?;
+    try testing.expect(empty.next() == null);
+
+    recorder.stop();
+    _ = z.setAttribute(z.nodeToElement(p).?, "id", "y");
+    try testing.expectEqual(seen + 7, recorder.nextSequence());
+}
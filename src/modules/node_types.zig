@@ -18,23 +18,15 @@ pub const NodeType = enum(u8) {
 ///
 /// Values are: `.text`, `.comment`, `.document`, `.fragment`, `.element`, `.unknown`.
 pub inline fn nodeType(node: *z.DomNode) NodeType {
-    const node_name = z.nodeName_zc(node);
-
-    // Fast string comparison - most common cases first
-    if (std.mem.eql(u8, node_name, "#text")) {
-        return .text;
-    } else if (std.mem.eql(u8, node_name, "#comment")) {
-        return .comment;
-    } else if (std.mem.eql(u8, node_name, "#document")) {
-        return .document;
-    } else if (std.mem.eql(u8, node_name, "#document-fragment")) {
-        return .fragment;
-    } else if (node_name.len > 0 and node_name[0] != '#') {
-        // Regular node names (DIV, P, SPAN, STRONG, EM...)
-        return .element;
-    } else {
-        return .unknown;
-    }
+    // `lxb_dom_node_t.type`, read through the layout mirror
+    return switch (z.nodeTypeId(node)) {
+        z.LXB_DOM_NODE_TYPE_ELEMENT => .element,
+        z.LXB_DOM_NODE_TYPE_TEXT => .text,
+        z.LXB_DOM_NODE_TYPE_COMMENT => .comment,
+        z.LXB_DOM_NODE_TYPE_DOCUMENT => .document,
+        z.LXB_DOM_NODE_TYPE_FRAGMENT => .fragment,
+        else => .unknown,
+    };
 }
 
 /// [node_types] human-readable type name (Inlined )
@@ -9,6 +9,7 @@
 const std = @import("std");
 const z = @import("../root.zig");
 const Err = z.Err;
+const mutation = @import("mutation.zig");
 
 const testing = std.testing;
 const print = std.debug.print;
@@ -98,6 +99,7 @@ extern "c" fn lxb_html_document_parse_fragment(
 /// try z.parseString(doc, "<div></div>"); //<-- replaces with a <div>
 /// ```
 pub fn parseString(doc: *z.HTMLDocument, html: []const u8) !void {
+    mutation.notifyDocument(.children_replaced, doc);
     if (lxb_html_document_parse(doc, html.ptr, html.len) != z._OK) {
         return Err.ParseFailed;
     }
@@ -150,6 +152,7 @@ test "createDocFromString" {
 /// Uses Lexbor's built-in sanitization which handles most security concerns.
 /// For 90% of use cases, this is sufficient and recommended.
 pub fn setInnerHTML(element: *z.HTMLElement, content: []const u8) !*z.HTMLElement {
+    mutation.notify(.{ .kind = .children_replaced, .target = z.elementToNode(element) });
     return lxb_html_element_inner_html_set(element, content.ptr, content.len) orelse Err.FragmentParseFailed;
 }
 
@@ -0,0 +1,286 @@
+//! HTML to plain text, streamed into a writer
+//!
+//! Renders a (sanitized) DOM the way a text mail client shows it: block elements on their
+//! own lines, paragraphs separated by a blank line, `<br>` as a newline, list markers,
+//! `> ` quoted blockquotes, preformatted text as is, and link targets as numbered footnotes
+//! listed after the text. Optional word wrapping at a given width.
+//!
+//! Single pass over the DOM, with the walk, tag table and block layout of `text_layout.zig`
+//! shared with `markdown.zig`; this module keeps the element dispatch, wrapping and links.
+//! The only allocation is the list of footnote targets, borrowed from the document.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+const text_layout = @import("text_layout.zig");
+const tagOf = text_layout.tagOf;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const LinkStyle = enum {
+    /// `text [1]`, then `[1] https://...` after the text; a repeated target reuses its number
+    footnotes,
+    /// `text <https://...>`
+    inline_url,
+    /// the link text alone
+    none,
+};
+
+pub const PlainTextOptions = struct {
+    links: LinkStyle = .footnotes,
+    /// wrap lines at this width (78 for mail), 0 to disable. Preformatted text is not wrapped.
+    wrap: usize = 0,
+    /// `[alt]` for images with an `alt` text
+    image_alt: bool = true,
+};
+
+/// [plain_text] Renders `root` and its subtree as plain text into `writer`
+///
+/// The footnote targets are slices of the document: keep it alive until this returns.
+/// ## Example
+/// ```
+/// var out: std.Io.Writer.Allocating = .init(allocator);
+/// defer out.deinit();
+/// try z.toPlainText(allocator, &out.writer, z.bodyNode(doc).?, .{ .wrap = 78 });
+/// ---
+/// ```
+pub fn toPlainText(allocator: std.mem.Allocator, writer: *std.Io.Writer, root: *z.DomNode, options: PlainTextOptions) !void {
+    var renderer: Renderer = .{ .allocator = allocator, .layout = .{ .writer = writer, .bullet = "* " }, .options = options };
+    defer renderer.footnotes.deinit(allocator);
+    try text_layout.walk(root, &renderer);
+
+    const written = renderer.layout.written;
+    if (renderer.footnotes.items.len > 0) {
+        try writer.writeAll(if (written) "\n\n" else "");
+        for (renderer.footnotes.items, 1..) |href, i| {
+            try writer.print("[{d}] {s}\n", .{ i, href });
+        }
+    } else if (written) try writer.writeByte('\n');
+}
+
+const Renderer = struct {
+    allocator: std.mem.Allocator,
+    layout: text_layout.Layout,
+    options: PlainTextOptions,
+    /// link targets, borrowed from the document
+    footnotes: std.ArrayList([]const u8) = .empty,
+
+    table_depth: usize = 0,
+    row_cells: usize = 0,
+
+    /// Returns true when the children must be walked
+    fn enter(self: *Renderer, node: *z.DomNode) !bool {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {},
+            z.LXB_DOM_NODE_TYPE_TEXT => {
+                try self.text(z.characterData(node));
+                return false;
+            },
+            z.LXB_DOM_NODE_TYPE_DOCUMENT, z.LXB_DOM_NODE_TYPE_FRAGMENT => return true,
+            else => return false,
+        }
+        if (text_layout.isForeign(node)) return false;
+
+        const out = &self.layout;
+        const tag = tagOf(node) orelse return true;
+        switch (tag) {
+            .head, .script, .style, .template, .noscript, .select, .textarea, .button, .input => return false,
+            .h1, .h2, .h3, .h4, .h5, .h6, .p, .figure, .dl, .details, .address, .fieldset => out.blockBreak(2),
+            .div, .section, .article, .header, .footer, .main, .nav, .aside, .hgroup, .dialog, .form, .figcaption, .summary, .dt, .dd, .caption => out.blockBreak(1),
+            .br => out.lineBreak(),
+            .hr => {
+                out.blockBreak(2);
+                try out.beginInline();
+                try out.put("----------");
+                out.blockBreak(2);
+            },
+            .ul, .ol, .menu => out.openList(tag == .ol),
+            .li => try out.listItem(),
+            .blockquote => out.openQuote(),
+            .pre => {
+                out.blockBreak(2);
+                out.openPre();
+            },
+            .img => {
+                if (self.options.image_alt) {
+                    const alt = z.getAttribute_zc(z.nodeToElement(node).?, "alt") orelse "";
+                    if (std.mem.trim(u8, alt, &std.ascii.whitespace).len > 0) {
+                        out.pending_space = true;
+                        try self.word("[");
+                        try out.put(alt);
+                        try out.put("]");
+                    }
+                }
+                return false;
+            },
+            .table => {
+                out.blockBreak(2);
+                self.table_depth += 1;
+            },
+            .tr => if (self.table_depth == 1) {
+                out.blockBreak(1);
+                self.row_cells = 0;
+            },
+            .td, .th => if (self.table_depth == 1) {
+                // cells on one line, two spaces apart
+                if (self.row_cells > 0 and !out.line_start) try out.put("  ");
+                out.pending_space = false;
+            },
+            else => {},
+        }
+        return true;
+    }
+
+    fn exit(self: *Renderer, node: *z.DomNode) !void {
+        const out = &self.layout;
+        const tag = tagOf(node) orelse return;
+        switch (tag) {
+            .h1, .h2, .h3, .h4, .h5, .h6, .p, .figure, .dl, .details, .address, .fieldset => out.blockBreak(2),
+            .div, .section, .article, .header, .footer, .main, .nav, .aside, .hgroup, .dialog, .form, .figcaption, .summary, .dt, .dd, .caption, .li => out.blockBreak(1),
+            .ul, .ol, .menu => out.closeList(),
+            .blockquote => out.closeQuote(),
+            .pre => {
+                out.pre_depth -= 1;
+                out.blockBreak(2);
+            },
+            .a => try self.linkEnd(node),
+            .table => {
+                self.table_depth -= 1;
+                out.blockBreak(2);
+            },
+            .tr => if (self.table_depth == 1) out.blockBreak(1),
+            .td, .th => if (self.table_depth == 1) {
+                self.row_cells += 1;
+            },
+            else => {},
+        }
+    }
+
+    // --- text
+
+    fn text(self: *Renderer, data: []const u8) !void {
+        if (self.layout.pre_depth > 0) return self.layout.preText(data);
+
+        var i: usize = 0;
+        while (i < data.len) {
+            if (std.ascii.isWhitespace(data[i])) {
+                self.layout.pending_space = true;
+                i += 1;
+                continue;
+            }
+            var end = i + 1;
+            while (end < data.len and !std.ascii.isWhitespace(data[end])) end += 1;
+            try self.word(data[i..end]);
+            i = end;
+        }
+    }
+
+    /// A word, wrapped to the next line when it does not fit
+    fn word(self: *Renderer, bytes: []const u8) !void {
+        const out = &self.layout;
+        if (self.options.wrap > 0 and out.pending_space and out.pending_newlines == 0 and !out.line_start and
+            out.column + 1 + bytes.len > self.options.wrap)
+        {
+            try out.newline(false);
+        }
+        try out.beginInline();
+        try out.put(bytes);
+    }
+
+    // --- elements
+
+    fn linkEnd(self: *Renderer, node: *z.DomNode) !void {
+        if (self.options.links == .none or self.layout.block_start) return;
+        const href = z.getAttribute_zc(z.nodeToElement(node).?, "href") orelse return;
+        if (href.len == 0 or href[0] == '#' or std.ascii.startsWithIgnoreCase(href, "javascript:")) return;
+
+        switch (self.options.links) {
+            .footnotes => {
+                const number = for (self.footnotes.items, 1..) |known, i| {
+                    if (std.mem.eql(u8, known, href)) break i;
+                } else blk: {
+                    try self.footnotes.append(self.allocator, href);
+                    break :blk self.footnotes.items.len;
+                };
+                var buffer: [24]u8 = undefined;
+                try self.layout.put(std.fmt.bufPrint(&buffer, " [{d}]", .{number}) catch unreachable);
+            },
+            .inline_url => {
+                try self.layout.put(" <");
+                try self.layout.put(href);
+                try self.layout.put(">");
+            },
+            .none => unreachable,
+        }
+    }
+};
+
+test "toPlainText" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<div><h1>Your order</h1>
+        \\<p>Hello   <b>Ada</b>,<br>thanks for your <a href="https://shop.example/orders/1">order</a>.</p>
+        \\<ul><li>Book</li><li>Pen<ol><li>blue</li><li>red</li></ol></li></ul>
+        \\<blockquote><p>Quoted</p><p>text</p></blockquote>
+        \\<pre>  indented
+        \\    code
+        \\</pre>
+        \\<table><tr><th>Item</th><th>Price</th></tr><tr><td>Book</td><td>12</td></tr></table>
+        \\<p>See the <a href="https://shop.example/orders/1">order</a> or <a href="#top">top</a>.<img src="x.png" alt="logo"></p>
+        \\<style>p { color: red }</style></div>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try toPlainText(allocator, &out.writer, z.bodyNode(doc).?, .{});
+    try testing.expectEqualStrings(
+        \\Your order
+        \\
+        \\Hello Ada,
+        \\thanks for your order [1].
+        \\
+        \\* Book
+        \\* Pen
+        \\  1. blue
+        \\  2. red
+        \\
+        \\> Quoted
+        \\>
+        \\> text
+        \\
+        \\  indented
+        \\    code
+        \\
+        \\Item  Price
+        \\Book  12
+        \\
+        \\See the order [1] or top. [logo]
+        \\
+        \\[1] https://shop.example/orders/1
+        \\
+    , out.written());
+
+    out.clearRetainingCapacity();
+    try toPlainText(allocator, &out.writer, z.firstChild(z.bodyNode(doc).?).?, .{ .links = .inline_url, .wrap = 20 });
+    // words move to the next line at 20 columns, a long URL stays whole
+    var lines = std.mem.splitScalar(u8, out.written(), '\n');
+    while (lines.next()) |line| {
+        if (std.mem.indexOf(u8, line, "<https") == null) try testing.expect(line.len <= 20);
+    }
+    try testing.expect(std.mem.indexOf(u8, out.written(), "order <https://shop.example/orders/1>") != null);
+}
+
+test "toPlainText skips inline svg" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<p><svg width="16" height="16"><title>cart</title><text>icon</text></svg> Your cart</p>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try toPlainText(allocator, &out.writer, z.bodyNode(doc).?, .{});
+    try testing.expectEqualStrings("Your cart\n", out.written());
+}
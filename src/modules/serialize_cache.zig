@@ -0,0 +1,354 @@
+//! Subtree serialization cache with mutation-driven invalidation
+//!
+//! Re-serializing a large page after a small change walks the whole tree again.
+//! `SerializeCache` keeps the serialized bytes of the subtrees above a size threshold and
+//! invalidates them through the mutation notifications of the wrapper APIs (see `mutation.zig`):
+//! a mutation drops the cached chunks of the node and of all its ancestors.
+//!
+//! A cached subtree is stored as a list of chunks: its own bytes (tags, small children) and
+//! references to its cached children. A re-serialization after a mutation only re-renders the
+//! path from the root to the mutated node, and writes the result with one vectored write.
+//!
+//! Mutations made by calling lexbor directly, or inside `<template>` content, are not tracked.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+const mutation = @import("mutation.zig");
+
+const testing = std.testing;
+const print = std.debug.print;
+
+pub const SerializeCacheOptions = struct {
+    /// subtrees serializing to fewer bytes are not cached on their own, only inside their parent.
+    /// When a parent is dirty its small children are re-rendered: lower it for wide, flat trees.
+    min_bytes: usize = 512,
+};
+
+pub const SerializeCacheStats = struct {
+    /// cached subtrees
+    entries: usize = 0,
+    /// bytes owned by the cached subtrees, references to children excluded
+    bytes: usize = 0,
+    /// cached subtrees reused by a serialization
+    hits: usize = 0,
+    /// subtrees cached
+    stored: usize = 0,
+    /// subtrees dropped by mutations
+    evictions: usize = 0,
+};
+
+const Chunk = union(enum) {
+    bytes: []const u8,
+    node: *z.DomNode,
+};
+
+const Entry = struct {
+    chunks: []Chunk,
+    owned: []u8,
+    /// serialized length, cached children included
+    len: usize,
+};
+
+/// chunk of the serialization in progress: a range of `scratch` or a cached subtree
+const Pending = union(enum) {
+    fresh: struct { start: usize, end: usize },
+    node: *z.DomNode,
+};
+
+/// [serialize_cache] Serialization cache for one document
+///
+/// The cache registers itself as a mutation observer on its first use:
+/// keep it at a stable address from then on, and `deinit` it before destroying the document.
+///
+/// ## Example
+/// ```
+/// var cache = z.SerializeCache.init(allocator, doc, .{});
+/// defer cache.deinit();
+///
+/// try cache.serializeTo(z.documentRoot(doc).?, writer); // full render, fills the cache
+/// _ = z.setAttribute(button, "disabled", "");
+/// try cache.serializeTo(z.documentRoot(doc).?, writer); // re-renders the path to `button` only
+/// ---
+/// ```
+pub const SerializeCache = struct {
+    allocator: std.mem.Allocator,
+    document: *z.HTMLDocument,
+    options: SerializeCacheOptions,
+    entries: std.AutoHashMapUnmanaged(*z.DomNode, Entry) = .empty,
+    stats: SerializeCacheStats = .{},
+    observing: bool = false,
+    pending: std.ArrayList(Pending) = .empty,
+    slices: std.ArrayList([]const u8) = .empty,
+    scratch: std.Io.Writer.Allocating,
+
+    const Self = @This();
+
+    pub fn init(allocator: std.mem.Allocator, document: *z.HTMLDocument, options: SerializeCacheOptions) Self {
+        return .{
+            .allocator = allocator,
+            .document = document,
+            .options = options,
+            .scratch = .init(allocator),
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        if (self.observing) mutation.removeMutationObserver(self);
+        self.clear();
+        self.entries.deinit(self.allocator);
+        self.pending.deinit(self.allocator);
+        self.slices.deinit(self.allocator);
+        self.scratch.deinit();
+    }
+
+    /// [serialize_cache] Drop every cached subtree
+    pub fn clear(self: *Self) void {
+        var it = self.entries.valueIterator();
+        while (it.next()) |entry| self.freeEntry(entry.*);
+        self.entries.clearRetainingCapacity();
+        self.stats.entries = 0;
+        self.stats.bytes = 0;
+    }
+
+    /// [serialize_cache] Streams the outer HTML of `node` into `writer`, reusing the clean cached subtrees
+    ///
+    /// Same output as `z.serializeTo`. Nodes of another document are serialized without the cache.
+    pub fn serializeTo(self: *Self, node: *z.DomNode, writer: *std.Io.Writer) !void {
+        if (z.ownerDocument(node) != self.document) return z.serializeTo(node, writer);
+        if (!self.observing) {
+            try mutation.addMutationObserver(.{ .document = self.document, .context = self, .callback = onMutation });
+            self.observing = true;
+        }
+
+        self.pending.clearRetainingCapacity();
+        self.slices.clearRetainingCapacity();
+        self.scratch.clearRetainingCapacity();
+
+        if (z.nodeType(node) == .document) {
+            var child = z.firstChild(node);
+            while (child) |current| : (child = z.nextSibling(current)) _ = try self.render(current);
+        } else {
+            _ = try self.render(node);
+        }
+
+        const fresh = self.scratch.written();
+        for (self.pending.items) |chunk| switch (chunk) {
+            .fresh => |range| try self.slices.append(self.allocator, fresh[range.start..range.end]),
+            .node => |cached| try self.expand(cached),
+        };
+        try writer.writeVecAll(self.slices.items);
+    }
+
+    /// [serialize_cache] Outer HTML of `element` as an owned string
+    pub fn outerHTML(self: *Self, allocator: std.mem.Allocator, element: *z.HTMLElement) ![]u8 {
+        var out: std.Io.Writer.Allocating = .init(allocator);
+        errdefer out.deinit();
+        try self.serializeTo(z.elementToNode(element), &out.writer);
+        return out.toOwnedSlice();
+    }
+
+    /// Renders `node` into `pending`, returns its serialized length
+    fn render(self: *Self, node: *z.DomNode) !usize {
+        if (self.entries.get(node)) |entry| {
+            self.stats.hits += 1;
+            try self.pending.append(self.allocator, .{ .node = node });
+            return entry.len;
+        }
+
+        const frame = self.pending.items.len;
+        var len: usize = 0;
+        if (isContainer(node)) {
+            len += try self.renderFresh(frame, node, .start_tag);
+            var child = z.firstChild(node);
+            while (child) |current| : (child = z.nextSibling(current)) len += try self.render(current);
+            len += try self.renderFresh(frame, node, .end_tag);
+        } else {
+            len += try self.renderFresh(frame, node, .tree);
+        }
+
+        if (len >= self.options.min_bytes) try self.store(node, frame, len);
+        return len;
+    }
+
+    /// Element whose children are rendered one by one; templates and void elements are leaves
+    fn isContainer(node: *z.DomNode) bool {
+        if (z.nodeType(node) != .element or z.firstChild(node) == null) return false;
+        return !z.isTemplate(node) and !z.isVoid(node);
+    }
+
+    fn renderFresh(self: *Self, frame: usize, node: *z.DomNode, part: enum { start_tag, end_tag, tree }) !usize {
+        const start = self.scratch.written().len;
+        const writer = &self.scratch.writer;
+        switch (part) {
+            .start_tag => try z.serializeShallowTo(node, writer),
+            .end_tag => try writer.print("</{s}>", .{z.qualifiedName_zc(z.nodeToElement(node).?)}),
+            .tree => try z.serializeTo(node, writer),
+        }
+        const end = self.scratch.written().len;
+
+        // extend the previous range of the same subtree when contiguous
+        const items = self.pending.items;
+        if (items.len > frame) {
+            const last = &items[items.len - 1];
+            switch (last.*) {
+                .fresh => |*range| if (range.end == start) {
+                    range.end = end;
+                    return end - start;
+                },
+                .node => {},
+            }
+        }
+        try self.pending.append(self.allocator, .{ .fresh = .{ .start = start, .end = end } });
+        return end - start;
+    }
+
+    /// Moves `pending[frame..]` into a cache entry for `node`
+    fn store(self: *Self, node: *z.DomNode, frame: usize, len: usize) !void {
+        const parts = self.pending.items[frame..];
+        var owned_len: usize = 0;
+        for (parts) |chunk| switch (chunk) {
+            .fresh => |range| owned_len += range.end - range.start,
+            .node => {},
+        };
+
+        const chunks = try self.allocator.alloc(Chunk, parts.len);
+        errdefer self.allocator.free(chunks);
+        const owned = try self.allocator.alloc(u8, owned_len);
+        errdefer self.allocator.free(owned);
+
+        const fresh = self.scratch.written();
+        var offset: usize = 0;
+        for (parts, chunks) |chunk, *out| switch (chunk) {
+            .fresh => |range| {
+                const bytes = owned[offset..][0 .. range.end - range.start];
+                @memcpy(bytes, fresh[range.start..range.end]);
+                offset += bytes.len;
+                out.* = .{ .bytes = bytes };
+            },
+            .node => |cached| out.* = .{ .node = cached },
+        };
+
+        try self.entries.put(self.allocator, node, .{ .chunks = chunks, .owned = owned, .len = len });
+        self.stats.stored += 1;
+        self.stats.entries += 1;
+        self.stats.bytes += owned_len;
+
+        self.pending.shrinkRetainingCapacity(frame);
+        self.pending.appendAssumeCapacity(.{ .node = node });
+    }
+
+    fn expand(self: *Self, node: *z.DomNode) !void {
+        const entry = self.entries.get(node) orelse return Err.SerializeFailed;
+        for (entry.chunks) |chunk| switch (chunk) {
+            .bytes => |bytes| try self.slices.append(self.allocator, bytes),
+            .node => |cached| try self.expand(cached),
+        };
+    }
+
+    fn freeEntry(self: *Self, entry: Entry) void {
+        self.allocator.free(entry.chunks);
+        self.allocator.free(entry.owned);
+    }
+
+    fn evict(self: *Self, node: *z.DomNode) void {
+        const removed = self.entries.fetchRemove(node) orelse return;
+        self.stats.entries -= 1;
+        self.stats.bytes -= removed.value.owned.len;
+        self.stats.evictions += 1;
+        self.freeEntry(removed.value);
+    }
+
+    /// `node` and its ancestors
+    fn evictPath(self: *Self, node: *z.DomNode) void {
+        var current: ?*z.DomNode = node;
+        while (current) |n| : (current = z.parentNode(n)) self.evict(n);
+    }
+
+    /// `root` and its descendants: detached or destroyed nodes must not keep entries,
+    /// their address can be reused by new nodes
+    fn evictSubtree(self: *Self, root: *z.DomNode) void {
+        self.evict(root);
+        var it = z.iterateDescendants(root);
+        while (it.next()) |n| {
+            if (self.entries.count() == 0) return;
+            self.evict(n);
+        }
+    }
+
+    fn onMutation(context: *anyopaque, m: *const mutation.Mutation) void {
+        const self: *Self = @ptrCast(@alignCast(context));
+        if (self.entries.count() == 0) return;
+        switch (m.kind) {
+            .child_added, .attribute, .character_data => self.evictPath(m.target),
+            .child_removed => {
+                if (m.node) |child| self.evictSubtree(child);
+                self.evictPath(m.target);
+            },
+            .children_replaced => {
+                var child = z.firstChild(m.target);
+                while (child) |current| : (child = z.nextSibling(current)) self.evictSubtree(current);
+                self.evictPath(m.target);
+            },
+            .destroyed => if (z.nodeType(m.target) == .document) self.clear() else self.evictSubtree(m.target),
+        }
+    }
+};
+
+test "SerializeCache output follows mutations" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<main><section id="a"><h2>A</h2><p>one <b>two</b></p><br><template><i>t</i></template></section>
+        \\<section id="b"><ul><li>x</li><li>y</li></ul><!-- note --></section></main>
+    );
+    defer z.destroyDocument(doc);
+    const root = z.documentRoot(doc).?;
+
+    var cache = SerializeCache.init(allocator, doc, .{ .min_bytes = 16 });
+    defer cache.deinit();
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    var expected: std.Io.Writer.Allocating = .init(allocator);
+    defer expected.deinit();
+
+    const check = struct {
+        fn run(c: *SerializeCache, node: *z.DomNode, o: *std.Io.Writer.Allocating, e: *std.Io.Writer.Allocating) !void {
+            o.clearRetainingCapacity();
+            e.clearRetainingCapacity();
+            try c.serializeTo(node, &o.writer);
+            try z.serializeTo(node, &e.writer);
+            try testing.expectEqualStrings(e.written(), o.written());
+        }
+    }.run;
+
+    try check(&cache, root, &out, &expected);
+    try testing.expect(cache.stats.entries > 0);
+    try testing.expectEqual(@as(usize, 0), cache.stats.hits);
+
+    // untouched: the root entry alone is reused
+    try check(&cache, root, &out, &expected);
+    try testing.expectEqual(@as(usize, 1), cache.stats.hits);
+
+    const b = z.getElementById(root, "b").?;
+    _ = z.setAttribute(b, "class", "changed");
+    try check(&cache, root, &out, &expected);
+    try testing.expect(cache.stats.evictions > 0);
+
+    const li = z.firstChild(z.firstChild(z.elementToNode(b)).?).?;
+    try z.setContentAsText(li, "replaced");
+    try check(&cache, root, &out, &expected);
+
+    const a = z.elementToNode(z.getElementById(root, "a").?);
+    const p = z.nextSibling(z.firstChild(a).?).?;
+    z.removeNode(p);
+    z.appendChild(z.elementToNode(b), p);
+    try check(&cache, root, &out, &expected);
+
+    z.destroyNode(z.firstChild(a).?);
+    _ = try z.setInnerHTML(z.nodeToElement(p).?, "<em>new</em> content");
+    try check(&cache, root, &out, &expected);
+
+    // whole document, doctype-less
+    try check(&cache, z.parentNode(root).?, &out, &expected);
+}
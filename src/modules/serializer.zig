@@ -28,6 +28,12 @@ extern "c" fn lxb_html_serialize_deep_str(node: *z.DomNode, str: *lxbString) c_i
 //outerHTML
 extern "c" fn lxb_html_serialize_tree_str(node: *z.DomNode, str: *lxbString) usize;
 
+const SerializeCb = *const fn (data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint;
+// node alone: start tag of an element
+extern "c" fn lxb_html_serialize_cb(node: *z.DomNode, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+// node and subtree
+extern "c" fn lxb_html_serialize_tree_cb(node: *z.DomNode, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+
 extern "c" fn lxb_html_serialize_pretty_tree_cb(
     node: *z.DomNode,
     opt: usize,
@@ -125,6 +131,108 @@ test "inner/outerHTML" {
     try testing.expectEqualStrings("<p>hi</p>", inner);
 }
 
+/// [serializer] Streams the outer HTML of `node` into `writer`
+///
+/// Unlike `outerHTML`, no intermediate string is built in the document's memory.
+pub fn serializeTo(node: *z.DomNode, writer: *std.Io.Writer) !void {
+    if (lxb_html_serialize_tree_cb(node, writerCallback, writer) != z._OK) {
+        return Err.SerializeFailed;
+    }
+}
+
+/// [serializer] Streams `node` without its children: the start tag of an element, the whole node otherwise
+pub fn serializeShallowTo(node: *z.DomNode, writer: *std.Io.Writer) !void {
+    if (lxb_html_serialize_cb(node, writerCallback, writer) != z._OK) {
+        return Err.SerializeFailed;
+    }
+}
+
+/// [serializer] Streams the outer HTML of each node into `writer`, `separator` between two nodes
+///
+/// One pass into one writer: no per-node string, unlike calling `outerHTML` in a loop.
+/// ## Example
+/// ```
+/// var out: std.Io.Writer.Allocating = .init(allocator);
+/// defer out.deinit();
+/// try z.serializeNodesTo(&out.writer, items, "\n");
+/// ---
+/// ```
+pub fn serializeNodesTo(writer: *std.Io.Writer, nodes: []const *z.DomNode, separator: []const u8) !void {
+    for (nodes, 0..) |node, i| {
+        if (i > 0 and separator.len > 0) try writer.writeAll(separator);
+        try serializeTo(node, writer);
+    }
+}
+
+/// [serializer] Streams the outer HTML of every element matching `selector` under `root`
+///
+/// The matches are serialized while the selector engine finds them, without collecting them first.
+/// Returns the number of serialized elements.
+/// ## Example
+/// ```
+/// var engine = try z.createCssEngine(allocator);
+/// defer engine.deinit();
+/// const count = try z.serializeMatches(&engine, body, "article.post", &out.writer);
+/// ---
+/// ```
+pub fn serializeMatches(engine: *z.CssSelectorEngine, root: *z.DomNode, selector: []const u8, writer: *std.Io.Writer) !usize {
+    return engine.serializeMatches(root, selector, writer);
+}
+
+test "serializeNodesTo / serializeMatches" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("<ul><li>a</li><li class=\"x\">b</li><li class=\"x\"><i>c</i></li></ul>");
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    const items = try z.childNodes(allocator, z.firstChild(body).?);
+    defer allocator.free(items);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try serializeNodesTo(&out.writer, items, "\n");
+    try testing.expectEqualStrings("<li>a</li>\n<li class=\"x\">b</li>\n<li class=\"x\"><i>c</i></li>", out.written());
+
+    var engine = try z.createCssEngine(allocator);
+    defer engine.deinit();
+
+    out.clearRetainingCapacity();
+    try testing.expectEqual(@as(usize, 2), try serializeMatches(&engine, body, "li.x", &out.writer));
+    try testing.expectEqualStrings("<li class=\"x\">b</li><li class=\"x\"><i>c</i></li>", out.written());
+
+    // same output through the result cache
+    try engine.enableResultCache(.{});
+    out.clearRetainingCapacity();
+    try testing.expectEqual(@as(usize, 2), try serializeMatches(&engine, body, "li.x", &out.writer));
+    try testing.expectEqualStrings("<li class=\"x\">b</li><li class=\"x\"><i>c</i></li>", out.written());
+
+    out.clearRetainingCapacity();
+    try testing.expectEqual(@as(usize, 0), try serializeMatches(&engine, body, "p", &out.writer));
+    try testing.expectEqualStrings("", out.written());
+}
+
+fn writerCallback(data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint {
+    const writer = z.castContext(std.Io.Writer, ctx);
+    writer.writeAll(data[0..len]) catch return 1;
+    return 0;
+}
+
+test "serializeTo / serializeShallowTo" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("<div class=\"a\"><p>hi &amp; bye</p><br></div>");
+    defer z.destroyDocument(doc);
+    const div = z.firstChild(z.bodyNode(doc).?).?;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try serializeTo(div, &out.writer);
+    try testing.expectEqualStrings("<div class=\"a\"><p>hi &amp; bye</p><br></div>", out.written());
+
+    out.clearRetainingCapacity();
+    try serializeShallowTo(div, &out.writer);
+    try testing.expectEqualStrings("<div class=\"a\">", out.written());
+}
+
 // ===================================================================================
 
 /// Context used by the "styler" callback
@@ -343,6 +451,322 @@ test "what does std.mem.endsWith, std.mem.eql find?" {
     try testing.expect(std.mem.eql(u8, t2, "=\""));
 }
 
+// ===================================================================================
+// Buffered pretty printer
+
+/// `LXB_DOM_NODE_TYPE_DOCUMENT_TYPE`
+const LXB_DOM_NODE_TYPE_DOCUMENT_TYPE: u32 = 0x0A;
+
+pub const PrettyOptions = struct {
+    /// ANSI colours: turn off for files and pipes
+    colour: bool = true,
+    /// spaces per nesting level
+    indent: u8 = 2,
+};
+
+/// [serializer] Pretty prints `node` and its subtree into `writer`
+///
+/// Unlike `prettyPrint`, nothing goes through `std.debug.print`: pass a buffered writer
+/// (file, socket, `std.Io.Writer.Allocating`) and flush it afterwards.
+/// The tree is walked iteratively, so the depth is unbounded, and the style of each tag id
+/// is resolved once per call. Whitespace-only text is dropped and text is trimmed;
+/// the content of `<template>` elements is not printed.
+/// ## Example
+/// ```
+/// var buffer: [64 * 1024]u8 = undefined;
+/// var file_writer = file.writer(&buffer);
+/// try z.prettyPrintTo(z.documentRoot(doc).?, &file_writer.interface, .{ .colour = false });
+/// try file_writer.interface.flush();
+/// ---
+/// ```
+pub fn prettyPrintTo(node: *z.DomNode, writer: *std.Io.Writer, options: PrettyOptions) !void {
+    var printer: PrettyPrinter = .{ .writer = writer, .options = options };
+    switch (z.nodeType(node)) {
+        // transparent containers: print their children at depth 0
+        .document, .fragment => {
+            var it = z.iterateChildren(node);
+            while (it.next()) |child| try printer.printTree(child);
+        },
+        else => try printer.printTree(node),
+    }
+}
+
+const TagInfo = struct {
+    style: []const u8,
+    tag: ?z.HtmlTag,
+    is_void: bool,
+    /// script and style content is written as is
+    raw_text: bool,
+};
+
+const PrettyPrinter = struct {
+    writer: *std.Io.Writer,
+    options: PrettyOptions,
+    /// indexed by lexbor tag id, filled on first use
+    tags: [z.LXB_TAG__LAST_ENTRY]?TagInfo = @splat(null),
+
+    fn printTree(self: *PrettyPrinter, root: *z.DomNode) !void {
+        var node = root;
+        var depth: usize = 0;
+        while (true) {
+            if (try self.open(node, depth)) {
+                node = z.firstChild(node).?;
+                depth += 1;
+                continue;
+            }
+            // climb until a next sibling, closing the elements left behind
+            while (node != root) {
+                if (z.nextSibling(node)) |next| {
+                    node = next;
+                    break;
+                }
+                node = z.parentNode(node).?;
+                depth -= 1;
+                try self.close(node, depth);
+            } else return;
+        }
+    }
+
+    /// Writes the node, or the start tag of an element with block content.
+    /// Returns true when the children must be walked.
+    fn open(self: *PrettyPrinter, node: *z.DomNode, depth: usize) !bool {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {},
+            z.LXB_DOM_NODE_TYPE_TEXT => {
+                const text = std.mem.trim(u8, z.characterData(node), &std.ascii.whitespace);
+                if (text.len == 0) return false;
+                try self.indent(depth);
+                try self.writeText(node, text);
+                try self.writer.writeByte('\n');
+                return false;
+            },
+            z.LXB_DOM_NODE_TYPE_COMMENT => {
+                try self.indent(depth);
+                try self.styled(z.Style.DIM_WHITE, "<!--");
+                try self.styled(z.Style.DIM_WHITE, z.characterData(node));
+                try self.styled(z.Style.DIM_WHITE, "-->");
+                try self.writer.writeByte('\n');
+                return false;
+            },
+            LXB_DOM_NODE_TYPE_DOCUMENT_TYPE => {
+                try self.indent(depth);
+                try self.styled(z.SyntaxStyle.brackets, "<!DOCTYPE ");
+                try self.styled(z.SyntaxStyle.text, z.nodeName_zc(node));
+                try self.styled(z.SyntaxStyle.brackets, ">");
+                try self.writer.writeByte('\n');
+                return false;
+            },
+            else => return false,
+        }
+
+        const element = z.nodeToElement(node).?;
+        const info = self.tagInfo(element);
+        const name = z.qualifiedName_zc(element);
+
+        try self.indent(depth);
+        try self.styled(z.SyntaxStyle.brackets, "<");
+        try self.styled(info.style, name);
+        try self.writeAttributes(element, info);
+        try self.styled(z.SyntaxStyle.brackets, ">");
+        if (info.is_void) {
+            try self.writer.writeByte('\n');
+            return false;
+        }
+
+        // empty element or single text child: one line
+        const first = z.firstChild(node);
+        const inline_text = if (first) |child|
+            z.nextSibling(child) == null and z.nodeTypeId(child) == z.LXB_DOM_NODE_TYPE_TEXT
+        else
+            true;
+        if (inline_text) {
+            if (first) |text_node| {
+                try self.writeText(text_node, std.mem.trim(u8, z.characterData(text_node), &std.ascii.whitespace));
+            }
+            try self.endTag(name, info);
+            return false;
+        }
+
+        try self.writer.writeByte('\n');
+        return true;
+    }
+
+    fn close(self: *PrettyPrinter, node: *z.DomNode, depth: usize) !void {
+        const element = z.nodeToElement(node) orelse return;
+        try self.indent(depth);
+        try self.endTag(z.qualifiedName_zc(element), self.tagInfo(element));
+    }
+
+    fn endTag(self: *PrettyPrinter, name: []const u8, info: TagInfo) !void {
+        try self.styled(z.SyntaxStyle.brackets, "</");
+        try self.styled(info.style, name);
+        try self.styled(z.SyntaxStyle.brackets, ">");
+        try self.writer.writeByte('\n');
+    }
+
+    fn writeAttributes(self: *PrettyPrinter, element: *z.HTMLElement, info: TagInfo) !void {
+        var attrs = z.iterateAttributes(element);
+        while (attrs.next()) |attr| {
+            try self.writer.writeByte(' ');
+            const name_style = if (!self.options.colour)
+                ""
+            else if (info.tag) |tag|
+                if (html_spec.isAttributeAllowedEnum(tag, attr.name)) z.SyntaxStyle.attribute else z.SyntaxStyle.danger
+            else if (std.mem.startsWith(u8, attr.name, "on"))
+                z.SyntaxStyle.danger
+            else
+                z.SyntaxStyle.attribute;
+            try self.styled(name_style, attr.name);
+            if (attr.value.len == 0) continue;
+
+            try self.styled(z.Style.DIM_WHITE, "=\"");
+            const value_style = if (self.options.colour and z.isDangerousAttributeValue(attr.value))
+                z.SyntaxStyle.danger
+            else
+                z.SyntaxStyle.attr_value;
+            try self.startStyle(value_style);
+            try writeEscaped(self.writer, attr.value, true);
+            try self.endStyle();
+            try self.styled(z.Style.DIM_WHITE, "\"");
+        }
+    }
+
+    fn writeText(self: *PrettyPrinter, node: *z.DomNode, text: []const u8) !void {
+        const raw = if (z.parentNode(node)) |parent|
+            if (z.nodeToElement(parent)) |element| self.tagInfo(element).raw_text else false
+        else
+            false;
+        try self.startStyle(z.SyntaxStyle.text);
+        if (raw) try self.writer.writeAll(text) else try writeEscaped(self.writer, text, false);
+        try self.endStyle();
+    }
+
+    fn tagInfo(self: *PrettyPrinter, element: *z.HTMLElement) TagInfo {
+        const id = z.nodeTagId(z.elementToNode(element));
+        if (id < z.LXB_TAG__LAST_ENTRY) {
+            if (self.tags[id]) |info| return info;
+            const info = resolveTagInfo(element);
+            self.tags[id] = info;
+            return info;
+        }
+        // custom elements get dynamic ids
+        return resolveTagInfo(element);
+    }
+
+    fn resolveTagInfo(element: *z.HTMLElement) TagInfo {
+        const tag = z.tagFromElement(element) orelse return .{
+            .style = z.Style.DIM_WHITE,
+            .tag = null,
+            .is_void = false,
+            .raw_text = false,
+        };
+        return .{
+            .style = z.getStyleForElementEnum(tag) orelse z.Style.WHITE,
+            .tag = tag,
+            .is_void = tag.isVoid(),
+            .raw_text = tag == .script or tag == .style,
+        };
+    }
+
+    fn indent(self: *PrettyPrinter, depth: usize) !void {
+        try self.writer.splatByteAll(' ', depth * self.options.indent);
+    }
+
+    fn styled(self: *PrettyPrinter, style: []const u8, text: []const u8) !void {
+        try self.startStyle(style);
+        try self.writer.writeAll(text);
+        try self.endStyle();
+    }
+
+    inline fn startStyle(self: *PrettyPrinter, style: []const u8) !void {
+        if (self.options.colour) try self.writer.writeAll(style);
+    }
+
+    inline fn endStyle(self: *PrettyPrinter) !void {
+        if (self.options.colour) try self.writer.writeAll(z.Style.RESET);
+    }
+};
+
+/// Writes `text` with `&`, `<`, `>` (and `"` in attribute values) escaped, in runs
+fn writeEscaped(writer: *std.Io.Writer, text: []const u8, attribute: bool) !void {
+    var start: usize = 0;
+    for (text, 0..) |c, i| {
+        const entity: []const u8 = switch (c) {
+            '&' => "&amp;",
+            '<' => "&lt;",
+            '>' => "&gt;",
+            '"' => if (attribute) "&quot;" else continue,
+            else => continue,
+        };
+        try writer.writeAll(text[start..i]);
+        try writer.writeAll(entity);
+        start = i + 1;
+    }
+    try writer.writeAll(text[start..]);
+}
+
+test "prettyPrintTo" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<!DOCTYPE html><html><head><title>T</title></head><body>
+        \\<div class="card" hidden><p>a &amp; b</p><!-- note --><br><span></span>
+        \\text <em>x</em></div><script>if (a < b) go();</script></body></html>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try prettyPrintTo(z.documentRoot(doc).?, &out.writer, .{ .colour = false });
+    try testing.expectEqualStrings(
+        \\<html>
+        \\  <head>
+        \\    <title>T</title>
+        \\  </head>
+        \\  <body>
+        \\    <div class="card" hidden>
+        \\      <p>a &amp; b</p>
+        \\      <!-- note -->
+        \\      <br>
+        \\      <span></span>
+        \\      text
+        \\      <em>x</em>
+        \\    </div>
+        \\    <script>if (a < b) go();</script>
+        \\  </body>
+        \\</html>
+        \\
+    , out.written());
+
+    // the document node prints the doctype too
+    out.clearRetainingCapacity();
+    try prettyPrintTo(z.parentNode(z.documentRoot(doc).?).?, &out.writer, .{ .colour = false, .indent = 0 });
+    try testing.expect(std.mem.startsWith(u8, out.written(), "<!DOCTYPE html>\n<html>\n<head>\n"));
+
+    out.clearRetainingCapacity();
+    try prettyPrintTo(z.bodyNode(doc).?, &out.writer, .{});
+    try testing.expect(std.mem.indexOf(u8, out.written(), z.Style.RESET) != null);
+}
+
+test "prettyPrintTo walks deep trees iteratively" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString("");
+    defer z.destroyDocument(doc);
+
+    const levels = 2_000;
+    var parent = z.bodyNode(doc).?;
+    for (0..levels) |_| {
+        const div = z.elementToNode(try z.createElement(doc, "div"));
+        z.appendChild(parent, div);
+        parent = div;
+    }
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try prettyPrintTo(z.bodyNode(doc).?, &out.writer, .{ .colour = false, .indent = 1 });
+    // <body>, levels - 1 open/close pairs and the innermost <div></div>
+    try testing.expectEqual(@as(usize, 2 * levels + 1), std.mem.count(u8, out.written(), "\n"));
+}
+
 test "outerNodeHTML" {
     const allocator = testing.allocator;
     const doc = try z.createDocFromString("<p>test</p>");
@@ -428,34 +852,41 @@ test "web component" {
     _ = html;
 }
 
-/// [tree] Debug: Walk and print DOM tree
-fn walkTree(node: *z.DomNode, depth: u8) void {
-    var child = z.firstChild(node);
-    while (child != null) {
-        const name = if (z.isTypeElement(child.?)) z.qualifiedName_zc(z.nodeToElement(child.?).?) else z.nodeName_zc(child.?);
+/// [tree] Debug: Walk and print DOM tree, iteratively
+fn walkTree(root: *z.DomNode, writer: *std.Io.Writer) !void {
+    var depth: usize = 0;
+    var node = z.firstChild(root) orelse return;
+    while (true) {
+        const name = if (z.nodeToElement(node)) |element| z.qualifiedName_zc(element) else z.nodeName_zc(node);
 
         // Convert string to enum and use fast lookup
         const tag_enum = z.stringToEnum(z.HtmlTag, name);
         const ansi_colour = if (tag_enum) |tag| z.getStyleForElementEnum(tag) orelse z.Style.DIM_WHITE else z.Style.DIM_WHITE;
-        const ansi_reset = z.Style.RESET;
-        const indent = switch (@min(depth, 10)) {
-            0 => "",
-            1 => "  ",
-            2 => "    ",
-            3 => "      ",
-            4 => "        ",
-            5 => "          ",
-            else => "            ",
-        };
-        z.print("{s}{s}{s}{s}\n", .{ indent, ansi_colour, name, ansi_reset });
+        try writer.splatByteAll(' ', 2 * @min(depth, 6));
+        try writer.print("{s}{s}{s}\n", .{ ansi_colour, name, z.Style.RESET });
 
-        walkTree(child.?, depth + 1);
-        child = z.nextSibling(child.?);
+        if (z.firstChild(node)) |child| {
+            node = child;
+            depth += 1;
+            continue;
+        }
+        while (true) {
+            if (z.nextSibling(node)) |next| {
+                node = next;
+                break;
+            }
+            if (depth == 0) return;
+            node = z.parentNode(node).?;
+            depth -= 1;
+        }
     }
 }
 
 /// [tree] Debug: print document structure (for debugging)
 pub fn printDocStruct(doc: *z.HTMLDocument) !void {
     const root = z.documentRoot(doc).?;
-    walkTree(root, 0);
+    var buffer: [4096]u8 = undefined;
+    var stderr = std.fs.File.stderr().writer(&buffer);
+    try walkTree(root, &stderr.interface);
+    try stderr.interface.flush();
 }
@@ -0,0 +1,334 @@
+//! Structured data extraction: microdata, JSON-LD and OpenGraph in one walk
+//!
+//! `extractStructuredData` visits the document once and writes one JSON object:
+//! ```json
+//! {"microdata":[{"type":"https://schema.org/Product","properties":[{"name":"name","value":"Widget"}]}],
+//!  "jsonld":[{"@type":"Product","name":"Widget"}],
+//!  "opengraph":[{"property":"og:title","content":"Widget"}]}
+//! ```
+//! - microdata items are written while walking. Properties keep the document order (a name may repeat).
+//!   A value is the `content`, `src`, `href`, `data`, `value` or `datetime` attribute depending on the tag,
+//!   a nested item when the element is also an `itemscope`, or else the text with whitespace collapsed;
+//! - JSON-LD blocks are copied as is from the `<script>` text, blocks that are not valid JSON are skipped;
+//! - `<meta property="og:* article:* product:* ...">` and `<meta name="twitter:*">` are kept in order.
+//!
+//! JSON-LD and OpenGraph values are borrowed slices of the DOM, written after the walk: nothing is copied.
+//!
+//! Not covered: `itemref`; an `itemprop` inside a text-valued property is part of its text;
+//! an item nested in another item without `itemprop` is skipped (it would need buffering).
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// deeper nested items are read as plain properties
+const max_item_depth = 32;
+
+/// `<meta property>` prefixes of the OpenGraph vocabularies
+const opengraph_prefixes = [_][]const u8{ "og:", "article:", "product:", "book:", "profile:", "music:", "video:", "fb:" };
+
+pub const StructuredDataCounts = struct {
+    /// top-level microdata items
+    microdata: usize = 0,
+    jsonld: usize = 0,
+    opengraph: usize = 0,
+};
+
+/// [structured] Writes the microdata items, JSON-LD blocks and OpenGraph tags of `doc` as one JSON object
+///
+/// `allocator` holds the borrowed JSON-LD and OpenGraph slices until they are written, and validates JSON-LD.
+/// ## Example
+/// ```
+/// var out: std.Io.Writer.Allocating = .init(allocator);
+/// defer out.deinit();
+/// const counts = try z.extractStructuredData(allocator, doc, &out.writer);
+/// // out.written(): {"microdata":[...],"jsonld":[...],"opengraph":[...]}
+/// ---
+/// ```
+pub fn extractStructuredData(allocator: std.mem.Allocator, doc: *z.HTMLDocument, writer: *std.Io.Writer) !StructuredDataCounts {
+    var extractor: Extractor = .{ .allocator = allocator, .writer = writer };
+    defer extractor.jsonld.deinit(allocator);
+    defer extractor.opengraph.deinit(allocator);
+
+    try writer.writeAll("{\"microdata\":[");
+    if (z.documentRoot(doc)) |root| {
+        var node = root;
+        while (true) {
+            if (try extractor.enter(node)) {
+                if (z.firstChild(node)) |child| {
+                    node = child;
+                    continue;
+                }
+            }
+            try extractor.exit(node);
+            while (node != root) {
+                if (z.nextSibling(node)) |next| {
+                    node = next;
+                    break;
+                }
+                node = z.parentNode(node).?;
+                try extractor.exit(node);
+            } else break;
+        }
+    }
+
+    try writer.writeAll("],\"jsonld\":[");
+    for (extractor.jsonld.items, 0..) |block, i| {
+        if (i > 0) try writer.writeByte(',');
+        try writer.writeAll(block);
+    }
+
+    try writer.writeAll("],\"opengraph\":[");
+    for (extractor.opengraph.items, 0..) |tag, i| {
+        if (i > 0) try writer.writeByte(',');
+        try writer.writeAll("{\"property\":");
+        try writeString(writer, tag.name);
+        try writer.writeAll(",\"content\":");
+        try writeString(writer, tag.value);
+        try writer.writeByte('}');
+    }
+    try writer.writeAll("]}");
+
+    return .{
+        .microdata = extractor.top_items,
+        .jsonld = extractor.jsonld.items.len,
+        .opengraph = extractor.opengraph.items.len,
+    };
+}
+
+const Item = struct {
+    node: *z.DomNode,
+    /// the item is the value of a property of the enclosing item
+    property: bool,
+    /// nothing is written for this item and its properties
+    muted: bool = false,
+    first: bool = true,
+};
+
+const Extractor = struct {
+    allocator: std.mem.Allocator,
+    writer: *std.Io.Writer,
+    items: [max_item_depth]Item = undefined,
+    depth: usize = 0,
+    top_items: usize = 0,
+    /// element of the text-valued property being written
+    capture: ?*z.DomNode = null,
+    capture_started: bool = false,
+    capture_space: bool = false,
+    jsonld: std.ArrayList([]const u8) = .empty,
+    opengraph: std.ArrayList(z.AttributePair) = .empty,
+
+    /// Returns true when the children must be visited
+    fn enter(self: *Extractor, node: *z.DomNode) !bool {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {},
+            z.LXB_DOM_NODE_TYPE_TEXT => {
+                if (self.capture != null) try self.text(z.characterData(node));
+                return false;
+            },
+            else => return false,
+        }
+        if (self.capture != null) return true;
+
+        const element = z.nodeToElement(node).?;
+        if (z.isHtmlTag(node, z.LXB_TAG_SCRIPT)) {
+            try self.script(node, element);
+            return false;
+        }
+        if (z.isHtmlTag(node, z.LXB_TAG_META)) try self.meta(element);
+
+        const itemprop = z.getAttribute_zc(element, "itemprop");
+        const itemscope = z.hasAttribute(element, "itemscope") and self.depth < max_item_depth;
+        if (itemprop == null and !itemscope) return true;
+
+        if (self.depth == 0) {
+            // a property outside of any item is ignored
+            if (!itemscope) return true;
+            if (self.top_items > 0) try self.writer.writeByte(',');
+            self.top_items += 1;
+            try self.openItem(node, element, false);
+            return true;
+        }
+
+        const parent = &self.items[self.depth - 1];
+        if (parent.muted or itemprop == null) {
+            if (itemscope) {
+                self.items[self.depth] = .{ .node = node, .property = false, .muted = true };
+                self.depth += 1;
+            }
+            return true;
+        }
+
+        if (!parent.first) try self.writer.writeByte(',');
+        parent.first = false;
+        try self.writer.writeAll("{\"name\":");
+        try writeString(self.writer, std.mem.trim(u8, itemprop.?, &std.ascii.whitespace));
+        try self.writer.writeAll(",\"value\":");
+        if (itemscope) {
+            try self.openItem(node, element, true);
+        } else if (valueAttribute(element)) |attribute| {
+            try writeString(self.writer, z.getAttribute_zc(element, attribute) orelse "");
+            try self.writer.writeByte('}');
+        } else {
+            try self.writer.writeByte('"');
+            self.capture = node;
+            self.capture_started = false;
+            self.capture_space = false;
+        }
+        return true;
+    }
+
+    fn exit(self: *Extractor, node: *z.DomNode) !void {
+        if (self.capture == node) {
+            try self.writer.writeAll("\"}");
+            self.capture = null;
+            return;
+        }
+        if (self.depth == 0 or self.items[self.depth - 1].node != node) return;
+        self.depth -= 1;
+        const item = self.items[self.depth];
+        if (item.muted) return;
+        try self.writer.writeAll("]}");
+        if (item.property) try self.writer.writeByte('}');
+    }
+
+    fn openItem(self: *Extractor, node: *z.DomNode, element: *z.HTMLElement, property: bool) !void {
+        try self.writer.writeAll("{\"type\":");
+        if (z.getAttribute_zc(element, "itemtype")) |item_type| {
+            try writeString(self.writer, std.mem.trim(u8, item_type, &std.ascii.whitespace));
+        } else try self.writer.writeAll("null");
+        if (z.getAttribute_zc(element, "itemid")) |id| {
+            try self.writer.writeAll(",\"id\":");
+            try writeString(self.writer, id);
+        }
+        try self.writer.writeAll(",\"properties\":[");
+        self.items[self.depth] = .{ .node = node, .property = property };
+        self.depth += 1;
+    }
+
+    /// Text of a property, whitespace runs collapsed and trimmed
+    fn text(self: *Extractor, data: []const u8) !void {
+        if (data.len == 0) return;
+        if (std.ascii.isWhitespace(data[0])) self.capture_space = true;
+        var words = std.mem.tokenizeAny(u8, data, &std.ascii.whitespace);
+        while (words.next()) |word| {
+            if (self.capture_space and self.capture_started) try self.writer.writeByte(' ');
+            try writeEscaped(self.writer, word);
+            self.capture_started = true;
+            self.capture_space = true;
+        }
+        self.capture_space = std.ascii.isWhitespace(data[data.len - 1]);
+    }
+
+    fn script(self: *Extractor, node: *z.DomNode, element: *z.HTMLElement) !void {
+        const script_type = z.getAttribute_zc(element, "type") orelse return;
+        if (!std.ascii.eqlIgnoreCase(std.mem.trim(u8, script_type, &std.ascii.whitespace), "application/ld+json")) return;
+        const child = z.firstChild(node) orelse return;
+        const block = std.mem.trim(u8, z.characterData(child), &std.ascii.whitespace);
+        if (block.len == 0 or !try std.json.validate(self.allocator, block)) return;
+        try self.jsonld.append(self.allocator, block);
+    }
+
+    fn meta(self: *Extractor, element: *z.HTMLElement) !void {
+        const content = z.getAttribute_zc(element, "content") orelse return;
+        if (z.getAttribute_zc(element, "property")) |property| {
+            for (opengraph_prefixes) |prefix| {
+                if (std.mem.startsWith(u8, property, prefix)) {
+                    return self.opengraph.append(self.allocator, .{ .name = property, .value = content });
+                }
+            }
+        } else if (z.getAttribute_zc(element, "name")) |name| {
+            if (std.mem.startsWith(u8, name, "twitter:")) {
+                try self.opengraph.append(self.allocator, .{ .name = name, .value = content });
+            }
+        }
+    }
+};
+
+/// The attribute holding the value of an `itemprop` element, null when the value is its text
+fn valueAttribute(element: *z.HTMLElement) ?[]const u8 {
+    const tag = z.tagFromElement(element) orelse return null;
+    return switch (tag) {
+        .meta => "content",
+        .audio, .embed, .iframe, .img, .source, .track, .video => "src",
+        .a, .area, .link => "href",
+        .object => "data",
+        .data, .meter => "value",
+        .time => if (z.hasAttribute(element, "datetime")) "datetime" else null,
+        else => null,
+    };
+}
+
+fn writeString(writer: *std.Io.Writer, value: []const u8) !void {
+    try writer.writeByte('"');
+    try writeEscaped(writer, value);
+    try writer.writeByte('"');
+}
+
+/// JSON string escaping, without the quotes
+fn writeEscaped(writer: *std.Io.Writer, value: []const u8) !void {
+    var start: usize = 0;
+    for (value, 0..) |c, i| {
+        const escape: []const u8 = switch (c) {
+            '"' => "\\\"",
+            '\\' => "\\\\",
+            '\n' => "\\n",
+            '\r' => "\\r",
+            '\t' => "\\t",
+            0...8, 0x0b...0x0c, 0x0e...0x1f => {
+                try writer.writeAll(value[start..i]);
+                try writer.print("\\u{x:0>4}", .{c});
+                start = i + 1;
+                continue;
+            },
+            else => continue,
+        };
+        try writer.writeAll(value[start..i]);
+        try writer.writeAll(escape);
+        start = i + 1;
+    }
+    try writer.writeAll(value[start..]);
+}
+
+test "extractStructuredData" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<html><head>
+        \\<meta property="og:title" content="Acme &quot;Widget&quot;">
+        \\<meta property="og:image" content="/a.png">
+        \\<meta name="twitter:card" content="summary">
+        \\<meta name="description" content="not OpenGraph">
+        \\<script type="application/ld+json">
+        \\  {"@type":"Product","name":"Widget"}
+        \\</script>
+        \\<script type="application/ld+json">{ broken</script>
+        \\</head><body>
+        \\<div itemscope itemtype="https://schema.org/Product">
+        \\  <h1 itemprop="name">  Acme
+        \\     <b>Widget</b> </h1>
+        \\  <img itemprop="image" src="/w.png" alt="">
+        \\  <div itemprop="offers" itemscope itemtype="https://schema.org/Offer">
+        \\    <meta itemprop="priceCurrency" content="EUR">
+        \\    <span itemprop="price">9.99</span>
+        \\  </div>
+        \\</div>
+        \\<p itemprop="orphan">no item</p>
+        \\</body></html>
+    );
+    defer z.destroyDocument(doc);
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    const counts = try extractStructuredData(allocator, doc, &out.writer);
+
+    try testing.expectEqualStrings(
+        \\{"microdata":[{"type":"https://schema.org/Product","properties":[{"name":"name","value":"Acme Widget"},{"name":"image","value":"/w.png"},{"name":"offers","value":{"type":"https://schema.org/Offer","properties":[{"name":"priceCurrency","value":"EUR"},{"name":"price","value":"9.99"}]}}]}],"jsonld":[{"@type":"Product","name":"Widget"}],"opengraph":[{"property":"og:title","content":"Acme \"Widget\""},{"property":"og:image","content":"/a.png"},{"property":"twitter:card","content":"summary"}]}
+    , out.written());
+    try testing.expectEqual(StructuredDataCounts{ .microdata = 1, .jsonld = 1, .opengraph = 3 }, counts);
+
+    // the output is valid JSON
+    try testing.expect(try std.json.validate(allocator, out.written()));
+}
@@ -0,0 +1,416 @@
+//! Table extraction: `<table>` to a column grid, CSV or TSV
+//!
+//! Rows are read from `<thead>`, `<tbody>`, `<tfoot>` (and `<tr>` children of the table) in document order,
+//! nested tables are not rows of the outer one. `colspan` and `rowspan` are expanded into a grid as in the
+//! HTML table model: a spanned cell fills every slot it covers, `rowspan="0"` runs to the end of its row group,
+//! and rowspans stop at row group boundaries.
+//!
+//! - `extractTable` builds a `Table`: one text buffer for all the cells, and columns as contiguous slices;
+//! - `extractTableTo` streams CSV or TSV into a writer, one reused buffer for the current field.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// HTML limits for `colspan` and `rowspan`
+const max_colspan = 1000;
+const max_rowspan = 65534;
+
+pub const TableSection = enum { head, body, foot };
+
+pub const TableFormat = enum { csv, tsv };
+
+pub const TableOptions = struct {
+    /// whitespace runs (and `<br>`) become one space, cells are trimmed
+    normalize_whitespace: bool = true,
+    /// a spanned cell repeats its text in every slot, otherwise the extra slots are empty
+    repeat_spans: bool = true,
+    /// `extractTableTo` only
+    format: TableFormat = .csv,
+};
+
+/// [tables] A table as a grid of columns; the cells are slices of one text buffer
+pub const Table = struct {
+    allocator: std.mem.Allocator,
+    /// text of all the cells
+    text: []u8,
+    /// column-major: `cells[column * rows + row]`, "" for a missing cell
+    cells: [][]const u8,
+    /// row group of each row
+    sections: []TableSection,
+    rows: usize,
+    columns: usize,
+
+    pub fn deinit(self: *Table) void {
+        self.allocator.free(self.text);
+        self.allocator.free(self.cells);
+        self.allocator.free(self.sections);
+    }
+
+    pub fn cell(self: *const Table, row: usize, column_index: usize) []const u8 {
+        return self.cells[column_index * self.rows + row];
+    }
+
+    /// The cells of a column, top to bottom
+    pub fn column(self: *const Table, index: usize) []const []const u8 {
+        return self.cells[index * self.rows ..][0..self.rows];
+    }
+};
+
+/// [tables] Reads `table` into a `Table`, spans expanded
+///
+/// Caller must `deinit` the result.
+/// ## Example
+/// ```
+/// var table = try z.extractTable(allocator, table_element, .{});
+/// defer table.deinit();
+/// for (table.column(2)) |amount| total += try std.fmt.parseFloat(f64, amount);
+/// ---
+/// ```
+pub fn extractTable(allocator: std.mem.Allocator, table: *z.HTMLElement, options: TableOptions) !Table {
+    var rows: RowIterator = .{ .allocator = allocator, .child = z.firstElementChild(table) };
+    defer rows.deinit();
+    var text: std.Io.Writer.Allocating = .init(allocator);
+    defer text.deinit();
+
+    // row-major spans into `text`, rows of different widths
+    var spans: std.ArrayList(Span) = .empty;
+    defer spans.deinit(allocator);
+    var row_starts: std.ArrayList(usize) = .empty;
+    defer row_starts.deinit(allocator);
+    var sections: std.ArrayList(TableSection) = .empty;
+    defer sections.deinit(allocator);
+
+    var columns: usize = 0;
+    var previous_start: usize = 0;
+    while (try rows.next()) |row| {
+        const start = spans.items.len;
+        for (row.slots, 0..) |slot, c| {
+            const node = slot.cell orelse {
+                try spans.append(allocator, .{});
+                continue;
+            };
+            if (slot.first) {
+                const from = text.written().len;
+                try writeCellText(&text.writer, node, options.normalize_whitespace);
+                try spans.append(allocator, .{ .start = from, .end = text.written().len });
+            } else if (!options.repeat_spans) {
+                try spans.append(allocator, .{});
+            } else if (c > 0 and row.slots[c - 1].cell == node) {
+                // colspan: same text as the slot on the left
+                try spans.append(allocator, spans.items[start + c - 1]);
+            } else {
+                // rowspan: same text as the slot above
+                try spans.append(allocator, spans.items[previous_start + c]);
+            }
+        }
+        try row_starts.append(allocator, start);
+        try sections.append(allocator, row.section);
+        columns = @max(columns, row.slots.len);
+        previous_start = start;
+    }
+
+    const row_count = row_starts.items.len;
+    const owned_sections = try sections.toOwnedSlice(allocator);
+    errdefer allocator.free(owned_sections);
+    const owned_text = try text.toOwnedSlice();
+    errdefer allocator.free(owned_text);
+    const cells = try allocator.alloc([]const u8, row_count * columns);
+    @memset(cells, "");
+    for (row_starts.items, 0..) |start, r| {
+        const end = if (r + 1 < row_count) row_starts.items[r + 1] else spans.items.len;
+        for (spans.items[start..end], 0..) |span, c| cells[c * row_count + r] = owned_text[span.start..span.end];
+    }
+
+    return .{
+        .allocator = allocator,
+        .text = owned_text,
+        .cells = cells,
+        .sections = owned_sections,
+        .rows = row_count,
+        .columns = columns,
+    };
+}
+
+/// [tables] Streams `table` as CSV or TSV into `writer`, one line per row, and returns the number of rows
+///
+/// Rows are not padded to the widest row. CSV fields are quoted when needed (RFC 4180);
+/// TSV fields have their tabs and newlines replaced by spaces.
+/// ## Example
+/// ```
+/// var out: std.Io.Writer.Allocating = .init(allocator);
+/// defer out.deinit();
+/// _ = try z.extractTableTo(allocator, table_element, &out.writer, .{ .format = .tsv });
+/// ---
+/// ```
+pub fn extractTableTo(allocator: std.mem.Allocator, table: *z.HTMLElement, writer: *std.Io.Writer, options: TableOptions) !usize {
+    var rows: RowIterator = .{ .allocator = allocator, .child = z.firstElementChild(table) };
+    defer rows.deinit();
+    var field: std.Io.Writer.Allocating = .init(allocator);
+    defer field.deinit();
+
+    const separator: u8 = switch (options.format) {
+        .csv => ',',
+        .tsv => '\t',
+    };
+    var count: usize = 0;
+    while (try rows.next()) |row| {
+        for (row.slots, 0..) |slot, c| {
+            if (c > 0) try writer.writeByte(separator);
+            const node = slot.cell orelse continue;
+            if (!slot.first and !options.repeat_spans) continue;
+            field.clearRetainingCapacity();
+            try writeCellText(&field.writer, node, options.normalize_whitespace);
+            try writeField(writer, field.written(), options.format);
+        }
+        try writer.writeByte('\n');
+        count += 1;
+    }
+    return count;
+}
+
+const Span = struct {
+    start: usize = 0,
+    end: usize = 0,
+};
+
+/// A grid slot: the cell covering it, `first` for its top-left slot
+const Slot = struct {
+    cell: ?*z.DomNode = null,
+    first: bool = true,
+};
+
+const Row = struct {
+    section: TableSection,
+    slots: []const Slot,
+};
+
+/// Cell carried down by a rowspan
+const Pending = struct {
+    cell: ?*z.DomNode = null,
+    remaining: u32 = 0,
+};
+
+/// Rows of a table as grid slots; the slice returned by `next` is reused
+const RowIterator = struct {
+    allocator: std.mem.Allocator,
+    /// next child of the table to read
+    child: ?*z.HTMLElement,
+    /// next row of the current row group
+    row: ?*z.HTMLElement = null,
+    section: TableSection = .body,
+    slots: std.ArrayList(Slot) = .empty,
+    pending: std.ArrayList(Pending) = .empty,
+
+    fn deinit(self: *RowIterator) void {
+        self.slots.deinit(self.allocator);
+        self.pending.deinit(self.allocator);
+    }
+
+    fn next(self: *RowIterator) !?Row {
+        const row = self.nextRow() orelse return null;
+        self.slots.clearRetainingCapacity();
+
+        var column: usize = 0;
+        var it = z.iterateElementChildren(row);
+        while (it.next()) |cell| {
+            const node = z.elementToNode(cell);
+            if (!z.isHtmlTag(node, z.LXB_TAG_TD) and !z.isHtmlTag(node, z.LXB_TAG_TH)) continue;
+            // slots taken by rowspans from the rows above
+            while (column < self.pending.items.len and self.pending.items[column].remaining > 0) : (column += 1) {
+                try self.carry(column);
+            }
+            const colspan = spanValue(cell, "colspan", max_colspan) orelse 1;
+            const rowspan = spanValue(cell, "rowspan", max_rowspan) orelse 1;
+            // `rowspan="0"`: to the end of the row group
+            const remaining: u32 = if (rowspan == 0) std.math.maxInt(u32) else rowspan - 1;
+            for (0..@max(colspan, 1)) |k| {
+                try self.place(column + k, .{ .cell = node, .first = k == 0 });
+                self.pending.items[column + k] = .{ .cell = node, .remaining = remaining };
+            }
+            column += @max(colspan, 1);
+        }
+        while (column < self.pending.items.len) : (column += 1) {
+            if (self.pending.items[column].remaining > 0) try self.carry(column);
+        }
+        return .{ .section = self.section, .slots = self.slots.items };
+    }
+
+    fn carry(self: *RowIterator, column: usize) !void {
+        const pending = &self.pending.items[column];
+        try self.place(column, .{ .cell = pending.cell, .first = false });
+        pending.remaining -= 1;
+    }
+
+    fn place(self: *RowIterator, column: usize, slot: Slot) !void {
+        while (self.slots.items.len <= column) try self.slots.append(self.allocator, .{});
+        while (self.pending.items.len <= column) try self.pending.append(self.allocator, .{});
+        self.slots.items[column] = slot;
+    }
+
+    fn nextRow(self: *RowIterator) ?*z.HTMLElement {
+        while (true) {
+            if (self.row) |row| {
+                self.row = nextTr(z.nextElementSibling(row));
+                return row;
+            }
+            const child = self.child orelse return null;
+            self.child = z.nextElementSibling(child);
+            const node = z.elementToNode(child);
+            if (z.isHtmlTag(node, z.LXB_TAG_TR)) {
+                self.section = .body;
+                return child;
+            }
+            self.section = if (z.isHtmlTag(node, z.LXB_TAG_THEAD))
+                .head
+            else if (z.isHtmlTag(node, z.LXB_TAG_TBODY))
+                .body
+            else if (z.isHtmlTag(node, z.LXB_TAG_TFOOT))
+                .foot
+            else
+                continue;
+            // rowspans do not cross row groups
+            self.pending.clearRetainingCapacity();
+            self.row = nextTr(z.firstElementChild(child));
+        }
+    }
+};
+
+/// `element` or its first following sibling that is a `<tr>`
+fn nextTr(element: ?*z.HTMLElement) ?*z.HTMLElement {
+    var current = element;
+    while (current) |e| : (current = z.nextElementSibling(e)) {
+        if (z.isHtmlTag(z.elementToNode(e), z.LXB_TAG_TR)) return e;
+    }
+    return null;
+}
+
+/// `colspan` / `rowspan` value, null when absent or invalid
+fn spanValue(cell: *z.HTMLElement, name: []const u8, max: u32) ?u32 {
+    const raw = z.getAttribute_zc(cell, name) orelse return null;
+    const value = std.fmt.parseInt(u32, std.mem.trim(u8, raw, &std.ascii.whitespace), 10) catch return null;
+    return @min(value, max);
+}
+
+/// Text of the cell subtree, without `<script>`, `<style>` and `<template>` content
+fn writeCellText(writer: *std.Io.Writer, cell: *z.DomNode, normalize: bool) !void {
+    var started = false;
+    var space = false;
+    var it = z.iterateDescendants(cell);
+    while (it.next()) |node| {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_ELEMENT => {
+                if (z.isHtmlTag(node, z.LXB_TAG_SCRIPT) or z.isHtmlTag(node, z.LXB_TAG_STYLE) or
+                    z.isHtmlTag(node, z.LXB_TAG_TEMPLATE)) it.skipSubtree();
+                if (z.isHtmlTag(node, z.LXB_TAG_BR)) {
+                    if (normalize) space = true else try writer.writeByte('\n');
+                }
+            },
+            z.LXB_DOM_NODE_TYPE_TEXT => {
+                const data = z.characterData(node);
+                if (!normalize) {
+                    try writer.writeAll(data);
+                    continue;
+                }
+                if (data.len == 0) continue;
+                if (std.ascii.isWhitespace(data[0])) space = true;
+                var words = std.mem.tokenizeAny(u8, data, &std.ascii.whitespace);
+                while (words.next()) |word| {
+                    if (space and started) try writer.writeByte(' ');
+                    try writer.writeAll(word);
+                    started = true;
+                    space = true;
+                }
+                space = std.ascii.isWhitespace(data[data.len - 1]);
+            },
+            else => {},
+        }
+    }
+}
+
+fn writeField(writer: *std.Io.Writer, value: []const u8, format: TableFormat) !void {
+    switch (format) {
+        .csv => {
+            if (std.mem.indexOfAny(u8, value, ",\"\r\n") == null) return writer.writeAll(value);
+            try writer.writeByte('"');
+            var start: usize = 0;
+            while (std.mem.indexOfScalarPos(u8, value, start, '"')) |quote| {
+                try writer.writeAll(value[start .. quote + 1]);
+                try writer.writeByte('"');
+                start = quote + 1;
+            }
+            try writer.writeAll(value[start..]);
+            try writer.writeByte('"');
+        },
+        .tsv => {
+            var start: usize = 0;
+            while (std.mem.indexOfAnyPos(u8, value, start, "\t\r\n")) |i| {
+                try writer.writeAll(value[start..i]);
+                try writer.writeByte(' ');
+                start = i + 1;
+            }
+            try writer.writeAll(value[start..]);
+        },
+    }
+}
+
+test "extractTable / extractTableTo" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<table>
+        \\<caption>Quarter</caption>
+        \\<thead><tr><th>Name</th><th colspan="2">Range</th></tr></thead>
+        \\<tbody>
+        \\<tr><td rowspan="2">  Alpha
+        \\   co </td><td>1</td><td>2</td></tr>
+        \\<tr><td>3</td><td>"4", x</td></tr>
+        \\<tr><td>Beta<br>Gamma</td><td rowspan="0">5</td></tr>
+        \\<tr><td>Delta <table><tr><td>nested</td></tr></table></td></tr>
+        \\</tbody>
+        \\<tbody><tr><td>Z</td><td>6</td><td>7</td></tr></tbody>
+        \\<tfoot><tr><td>Total</td><td colspan="2">28</td></tr></tfoot>
+        \\</table>
+    );
+    defer z.destroyDocument(doc);
+    const table_element = z.firstElementChild(z.bodyElement(doc).?).?;
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try testing.expectEqual(7, try extractTableTo(allocator, table_element, &out.writer, .{}));
+    try testing.expectEqualStrings(
+        \\Name,Range,Range
+        \\Alpha co,1,2
+        \\Alpha co,3,"""4"", x"
+        \\Beta Gamma,5
+        \\Delta nested,5
+        \\Z,6,7
+        \\Total,28,28
+        \\
+    , out.written());
+
+    out.clearRetainingCapacity();
+    _ = try extractTableTo(allocator, table_element, &out.writer, .{ .format = .tsv, .repeat_spans = false });
+    try testing.expectEqualStrings("Name\tRange\t\n", out.written()[0 .. std.mem.indexOfScalar(u8, out.written(), '\n').? + 1]);
+
+    var table = try extractTable(allocator, table_element, .{});
+    defer table.deinit();
+    try testing.expectEqual(7, table.rows);
+    try testing.expectEqual(3, table.columns);
+    try testing.expectEqual(TableSection.head, table.sections[0]);
+    try testing.expectEqual(TableSection.foot, table.sections[6]);
+    try testing.expectEqualStrings("Alpha co", table.cell(2, 0));
+    try testing.expectEqualStrings("Range", table.cell(0, 2));
+    try testing.expectEqualStrings("", table.cell(3, 2));
+    const amounts = table.column(1);
+    try testing.expectEqual(7, amounts.len);
+    try testing.expectEqualStrings("5", amounts[4]);
+    try testing.expectEqualStrings("28", amounts[6]);
+
+    var sparse = try extractTable(allocator, table_element, .{ .repeat_spans = false });
+    defer sparse.deinit();
+    try testing.expectEqualStrings("", sparse.cell(2, 0));
+    try testing.expectEqualStrings("", sparse.cell(0, 2));
+}
@@ -6,6 +6,7 @@ const std = @import("std");
 const z = @import("../root.zig");
 const print = std.debug.print;
 const Err = z.Err;
+const mutation = @import("mutation.zig");
 
 const testing = std.testing;
 
@@ -145,6 +146,10 @@ pub fn textContent_zc(node: *z.DomNode) []const u8 {
 /// ---
 /// ```
 pub fn setContentAsText(node: *z.DomNode, content: []const u8) !void {
+    mutation.notify(.{
+        .kind = if (z.nodeType(node) == .element) .children_replaced else .character_data,
+        .target = node,
+    });
     const status = lxb_dom_node_text_content_set(
         node,
         content.ptr,
@@ -209,6 +214,7 @@ pub fn replaceText(node: ?*z.DomNode, text: []const u8) !void {
     if (z.nodeType(node.?) != .text) return Err.NotTextNode;
 
     const current_len = z.textContent_zc(node.?).len;
+    mutation.notify(.{ .kind = .character_data, .target = node.? });
 
     if (lxb_dom_character_data_replace(
         node.?,
@@ -0,0 +1,263 @@
+//! Block and line layout shared by the text renderers (`markdown.zig`, `plain_text.zig`)
+//!
+//! - `walk`: the iterative DOM walk, calling `enter` / `exit` on the renderer;
+//! - `tagOf`: the `HtmlTag` of an element from its lexbor tag id, through a comptime table;
+//! - `Layout`: block breaks, blank lines, pending spaces, blockquote and list prefixes,
+//!   list markers and preformatted lines.
+//!
+//! Breaks are delayed: a block asks for N newlines, and they are written with the line prefix
+//! only when inline content follows, so that nested blocks never stack blank lines.
+//! The renderers keep the output-specific parts: the element dispatch, the inline markers
+//! and how words are written (Markdown escaping, plain text wrapping).
+
+const std = @import("std");
+const z = @import("../root.zig");
+
+/// [text_layout] Pre-order walk of `root`, `root` included.
+///
+/// `renderer.enter(node) !bool` returns true when the children must be walked;
+/// `renderer.exit(node) !void` is called once the children are done, or right after `enter`.
+pub fn walk(root: *z.DomNode, renderer: anytype) !void {
+    var node = root;
+    while (true) {
+        if (try renderer.enter(node)) {
+            if (z.firstChild(node)) |child| {
+                node = child;
+                continue;
+            }
+        }
+        try renderer.exit(node);
+        while (node != root) {
+            if (z.nextSibling(node)) |next| {
+                node = next;
+                break;
+            }
+            node = z.parentNode(node).?;
+            try renderer.exit(node);
+        } else break;
+    }
+}
+
+// from lexbor source: /tag/const.h
+const tag_ids = [_]struct { usize, z.HtmlTag }{
+    .{ 0x0006, .a },          .{ 0x0009, .address },  .{ 0x0013, .article },    .{ 0x0014, .aside },
+    .{ 0x0016, .b },          .{ 0x001e, .blockquote }, .{ 0x0020, .br },       .{ 0x0021, .button },
+    .{ 0x0023, .caption },    .{ 0x0027, .code },     .{ 0x002c, .dd },         .{ 0x002d, .del },
+    .{ 0x002f, .details },    .{ 0x0031, .dialog },   .{ 0x0033, .div },        .{ 0x0034, .dl },
+    .{ 0x0035, .dt },         .{ 0x0036, .em },       .{ 0x0051, .fieldset },   .{ 0x0052, .figcaption },
+    .{ 0x0053, .figure },     .{ 0x0055, .footer },   .{ 0x0057, .form },       .{ 0x005b, .h1 },
+    .{ 0x005c, .h2 },         .{ 0x005d, .h3 },       .{ 0x005e, .h4 },         .{ 0x005f, .h5 },
+    .{ 0x0060, .h6 },         .{ 0x0061, .head },     .{ 0x0062, .header },     .{ 0x0063, .hgroup },
+    .{ 0x0064, .hr },         .{ 0x0066, .i },        .{ 0x0069, .img },        .{ 0x006a, .input },
+    .{ 0x006d, .kbd },        .{ 0x0071, .li },       .{ 0x0075, .main },       .{ 0x007b, .menu },
+    .{ 0x0086, .nav },        .{ 0x008b, .noscript }, .{ 0x008d, .ol },         .{ 0x0091, .p },
+    .{ 0x0096, .pre },        .{ 0x009f, .s },        .{ 0x00a0, .samp },       .{ 0x00a1, .script },
+    .{ 0x00a2, .section },    .{ 0x00a3, .select },   .{ 0x00aa, .strong },     .{ 0x00ab, .style },
+    .{ 0x00ad, .summary },    .{ 0x00b0, .table },    .{ 0x00b2, .td },
+    .{ 0x00b3, .template },   .{ 0x00b4, .textarea }, .{ 0x00b7, .th },         .{ 0x00bb, .tr },
+    .{ 0x00bf, .ul },
+};
+
+/// lexbor tag id -> `HtmlTag`, for the tags the renderers handle
+const tag_table: [z.LXB_TAG__LAST_ENTRY]?z.HtmlTag = blk: {
+    var table: [z.LXB_TAG__LAST_ENTRY]?z.HtmlTag = @splat(null);
+    for (tag_ids) |entry| table[entry[0]] = entry[1];
+    break :blk table;
+};
+
+/// [text_layout] `HtmlTag` of an HTML element from its lexbor tag id, null for the tags the renderers ignore
+pub fn tagOf(node: *z.DomNode) ?z.HtmlTag {
+    if (z.nodeTypeId(node) != z.LXB_DOM_NODE_TYPE_ELEMENT) return null;
+    const id = z.nodeTagId(node);
+    if (id >= z.LXB_TAG__LAST_ENTRY or !z.isHtmlTag(node, id)) return null;
+    return tag_table[id];
+}
+
+/// [text_layout] True for an element outside the HTML namespace: inline `<svg>` and `<math>` and their content
+pub fn isForeign(node: *z.DomNode) bool {
+    return z.nodeTypeId(node) == z.LXB_DOM_NODE_TYPE_ELEMENT and !z.isHtmlTag(node, z.nodeTagId(node));
+}
+
+pub const max_lists = 16;
+
+pub const ListFrame = struct {
+    ordered: bool,
+    counter: u32 = 0,
+    /// width of the item marker: continuation lines are indented by it
+    width: u8 = 2,
+};
+
+/// [text_layout] Line state of a text renderer writing into `writer`
+pub const Layout = struct {
+    writer: *std.Io.Writer,
+    /// marker of unordered list items
+    bullet: []const u8,
+
+    /// something was written
+    written: bool = false,
+    /// nothing written since the last block start: breaks are not needed
+    block_start: bool = true,
+    /// nothing written on the current line, apart from its prefix
+    line_start: bool = true,
+    pending_newlines: u8 = 0,
+    /// blockquote depth when the pending break was requested: the blank lines use it
+    break_quote_depth: usize = 0,
+    pending_space: bool = false,
+    /// output column of the current line, counted by `put` and `newline`
+    column: usize = 0,
+    /// inside a table cell kept on one line: breaks become spaces
+    in_cell: bool = false,
+
+    lists: [max_lists]ListFrame = undefined,
+    list_depth: usize = 0,
+    quote_depth: usize = 0,
+    pre_depth: usize = 0,
+    /// newlines of a preformatted block not written yet: trailing ones are dropped
+    pre_newlines: usize = 0,
+
+    const Self = @This();
+
+    pub fn put(self: *Self, bytes: []const u8) !void {
+        try self.writer.writeAll(bytes);
+        self.column += bytes.len;
+    }
+
+    // --- breaks and prefixes
+
+    pub fn blockBreak(self: *Self, newlines: u8) void {
+        if (self.in_cell) {
+            self.pending_space = true;
+            return;
+        }
+        if (self.block_start) return;
+        self.requestNewlines(newlines);
+    }
+
+    pub fn lineBreak(self: *Self) void {
+        if (self.in_cell) {
+            self.pending_space = true;
+            return;
+        }
+        self.requestNewlines(1);
+    }
+
+    fn requestNewlines(self: *Self, newlines: u8) void {
+        if (self.pending_newlines == 0) self.break_quote_depth = self.quote_depth;
+        self.pending_newlines = @max(self.pending_newlines, newlines);
+    }
+
+    /// Before inline content: pending newlines with their prefix, or a pending space
+    pub fn beginInline(self: *Self) !void {
+        if (self.pending_newlines > 0) {
+            try self.flushNewlines(false);
+        } else if (self.pending_space and !self.line_start) {
+            try self.put(" ");
+        }
+        self.wrote();
+    }
+
+    /// Raw output was written: the next break is needed
+    pub fn wrote(self: *Self) void {
+        self.pending_space = false;
+        self.line_start = false;
+        self.block_start = false;
+        self.written = true;
+    }
+
+    fn flushNewlines(self: *Self, marker: bool) !void {
+        // blank lines stay inside a blockquote only when the break started inside it
+        const blank_quotes = @min(self.quote_depth, self.break_quote_depth);
+        for (1..self.pending_newlines) |_| {
+            try self.writer.writeByte('\n');
+            for (0..blank_quotes) |i| try self.writer.writeAll(if (i == 0) ">" else " >");
+        }
+        self.pending_newlines = 0;
+        try self.newline(marker);
+    }
+
+    /// Newline, then the blockquote and list prefix. `marker` leaves out the innermost list indent.
+    pub fn newline(self: *Self, marker: bool) !void {
+        if (self.written) try self.writer.writeByte('\n');
+        self.column = 0;
+        for (0..self.quote_depth) |_| try self.put("> ");
+        const lists = @min(self.list_depth, max_lists);
+        const indented = if (marker and lists > 0) lists - 1 else lists;
+        for (self.lists[0..indented]) |frame| {
+            try self.writer.splatByteAll(' ', frame.width);
+            self.column += frame.width;
+        }
+        self.line_start = true;
+        self.block_start = true;
+        self.pending_space = false;
+    }
+
+    // --- blocks
+
+    pub fn openList(self: *Self, ordered: bool) void {
+        self.blockBreak(if (self.list_depth == 0) 2 else 1);
+        if (self.list_depth < max_lists) self.lists[self.list_depth] = .{ .ordered = ordered };
+        self.list_depth += 1;
+    }
+
+    pub fn closeList(self: *Self) void {
+        self.list_depth -= 1;
+        self.blockBreak(if (self.list_depth == 0) 2 else 1);
+    }
+
+    pub fn listItem(self: *Self) !void {
+        if (self.list_depth == 0) {
+            self.blockBreak(1);
+            return;
+        }
+        // a fresh line for the marker, except for a list starting an item ("- - x")
+        if (self.pending_newlines > 0 or !self.block_start) try self.flushNewlines(true);
+
+        const frame = &self.lists[@min(self.list_depth, max_lists) - 1];
+        frame.counter += 1;
+        if (frame.ordered) {
+            var buffer: [16]u8 = undefined;
+            const marker = std.fmt.bufPrint(&buffer, "{d}. ", .{frame.counter}) catch unreachable;
+            try self.put(marker);
+            frame.width = @intCast(marker.len);
+        } else {
+            try self.put(self.bullet);
+        }
+        self.wrote();
+        self.line_start = true;
+        self.block_start = true;
+    }
+
+    pub fn openQuote(self: *Self) void {
+        self.blockBreak(2);
+        self.quote_depth += 1;
+    }
+
+    pub fn closeQuote(self: *Self) void {
+        self.quote_depth -= 1;
+        self.blockBreak(2);
+    }
+
+    pub fn openPre(self: *Self) void {
+        self.pre_depth += 1;
+        self.pre_newlines = 0;
+    }
+
+    /// Preformatted content as is, lines prefixed; newlines are delayed to drop the trailing ones
+    pub fn preText(self: *Self, data: []const u8) !void {
+        var lines = std.mem.splitScalar(u8, data, '\n');
+        var first = true;
+        while (lines.next()) |line| {
+            if (!first) self.pre_newlines += 1;
+            first = false;
+            if (line.len == 0) continue;
+            if (self.pending_newlines > 0 or self.block_start) {
+                try self.beginInline();
+            } else {
+                while (self.pre_newlines > 0) : (self.pre_newlines -= 1) try self.newline(false);
+            }
+            self.pre_newlines = 0;
+            try self.put(line);
+            self.wrote();
+        }
+    }
+};
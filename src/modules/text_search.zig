@@ -0,0 +1,268 @@
+//! Full-text search over the text nodes of a subtree, several needles at once
+//!
+//! The bytes that can start a needle are looked for a vector at a time (`@Vector` compares, one per
+//! distinct first byte, up to `max_vector_bytes`), or with a 256-entry table when there are more.
+//! The needles are grouped by first byte, so a candidate position is only checked against the needles
+//! starting with its byte. Every occurrence is reported, overlapping ones included, as a
+//! (text node, byte offset, needle index) triple.
+//!
+//! A match must fit in one text node: "foo<b>bar</b>" does not contain "foobar".
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+const vector_len = std.simd.suggestVectorLength(u8) orelse 16;
+const Block = @Vector(vector_len, u8);
+const Mask = std.meta.Int(.unsigned, vector_len);
+
+/// more distinct first bytes than this are looked up in a table, byte by byte
+const max_vector_bytes = 4;
+/// the needle groups are kept in the matcher: at most this many needles per search
+pub const max_needles = 256;
+
+pub const FindTextOptions = struct {
+    /// ASCII case-insensitive
+    ignore_case: bool = false,
+    /// do not search the content of `<script>` and `<style>`
+    skip_raw_text: bool = true,
+};
+
+pub const TextMatch = struct {
+    /// the text node
+    node: *z.DomNode,
+    /// byte offset in the node data
+    offset: usize,
+    /// index in `needles`
+    needle: usize,
+};
+
+/// [search] Calls `onMatch(context, match)` for each occurrence of each needle in the text of `root`
+///
+/// `onMatch: fn (@TypeOf(context), TextMatch) !bool` returns false to stop the search.
+/// Matches come in document order, then by offset.
+/// Returns the number of matches reported. Empty needles are ignored; more than `max_needles` is an error.
+/// ## Example
+/// ```
+/// const Highlighter = struct {
+///     fn onMatch(self: *@This(), m: z.TextMatch) !bool { ... return true; }
+/// };
+/// var highlighter: Highlighter = .{};
+/// _ = try z.findText(body, &.{ "zig", "lexbor" }, .{ .ignore_case = true }, &highlighter, Highlighter.onMatch);
+/// ---
+/// ```
+pub fn findText(
+    root: *z.DomNode,
+    needles: []const []const u8,
+    options: FindTextOptions,
+    context: anytype,
+    comptime onMatch: anytype,
+) !usize {
+    const matcher: Matcher = try .init(needles, options.ignore_case);
+    if (matcher.start_count == 0) return 0;
+
+    var count: usize = 0;
+    if (z.nodeTypeId(root) == z.LXB_DOM_NODE_TYPE_TEXT) {
+        _ = try matcher.scan(root, context, onMatch, &count);
+        return count;
+    }
+    var it = z.iterateDescendants(root);
+    while (it.next()) |node| {
+        switch (z.nodeTypeId(node)) {
+            z.LXB_DOM_NODE_TYPE_TEXT => if (!try matcher.scan(node, context, onMatch, &count)) break,
+            z.LXB_DOM_NODE_TYPE_ELEMENT => if (options.skip_raw_text and
+                (z.isHtmlTag(node, z.LXB_TAG_SCRIPT) or z.isHtmlTag(node, z.LXB_TAG_STYLE))) it.skipSubtree(),
+            else => {},
+        }
+    }
+    return count;
+}
+
+/// [search] All the occurrences of `needles` in the text of `root`
+///
+/// Caller owns the slice.
+/// ## Example
+/// ```
+/// const matches = try z.findTextAll(allocator, body, &.{"total"}, .{ .ignore_case = true });
+/// defer allocator.free(matches);
+/// for (matches) |m| print("{d}\n", .{m.offset});
+/// ---
+/// ```
+pub fn findTextAll(allocator: std.mem.Allocator, root: *z.DomNode, needles: []const []const u8, options: FindTextOptions) ![]TextMatch {
+    var collector: Collector = .{ .allocator = allocator };
+    errdefer collector.matches.deinit(allocator);
+    _ = try findText(root, needles, options, &collector, Collector.append);
+    return collector.matches.toOwnedSlice(allocator);
+}
+
+const Collector = struct {
+    allocator: std.mem.Allocator,
+    matches: std.ArrayList(TextMatch) = .empty,
+
+    fn append(self: *Collector, match: TextMatch) !bool {
+        try self.matches.append(self.allocator, match);
+        return true;
+    }
+};
+
+const Matcher = struct {
+    needles: []const []const u8,
+    ignore_case: bool,
+    /// bytes that can start a match (both cases with `ignore_case`)
+    starts: [256]bool = @splat(false),
+    /// the same bytes, while there are at most `max_vector_bytes` of them
+    start_bytes: [max_vector_bytes]u8 = undefined,
+    start_count: usize = 0,
+    min_len: usize = std.math.maxInt(usize),
+    /// needle indices grouped by first byte (lowercased with `ignore_case`), in index order:
+    /// the group of byte `b` is `order[groups[b]..groups[b + 1]]`
+    order: [max_needles]u8 = undefined,
+    groups: [257]u16 = @splat(0),
+
+    fn init(needles: []const []const u8, ignore_case: bool) !Matcher {
+        if (needles.len > max_needles) return Err.TooManyNeedles;
+        var self: Matcher = .{ .needles = needles, .ignore_case = ignore_case };
+        for (needles) |needle| {
+            if (needle.len == 0) continue;
+            self.min_len = @min(self.min_len, needle.len);
+            if (ignore_case) {
+                self.addStart(std.ascii.toLower(needle[0]));
+                self.addStart(std.ascii.toUpper(needle[0]));
+            } else self.addStart(needle[0]);
+            self.groups[@as(usize, self.groupOf(needle[0])) + 1] += 1;
+        }
+
+        // counting sort of the needle indices by group
+        for (1..self.groups.len) |i| self.groups[i] += self.groups[i - 1];
+        var next: [256]u16 = self.groups[0..256].*;
+        for (needles, 0..) |needle, index| {
+            if (needle.len == 0) continue;
+            const group = self.groupOf(needle[0]);
+            self.order[next[group]] = @intCast(index);
+            next[group] += 1;
+        }
+        return self;
+    }
+
+    fn groupOf(self: *const Matcher, byte: u8) u8 {
+        return if (self.ignore_case) std.ascii.toLower(byte) else byte;
+    }
+
+    fn addStart(self: *Matcher, byte: u8) void {
+        if (self.starts[byte]) return;
+        self.starts[byte] = true;
+        if (self.start_count < max_vector_bytes) self.start_bytes[self.start_count] = byte;
+        self.start_count += 1;
+    }
+
+    /// Returns false when `onMatch` stopped the search
+    fn scan(self: *const Matcher, node: *z.DomNode, context: anytype, comptime onMatch: anytype, count: *usize) !bool {
+        const data = z.characterData(node);
+        if (data.len < self.min_len) return true;
+
+        var i: usize = 0;
+        if (self.start_count <= max_vector_bytes) {
+            while (i + vector_len <= data.len) : (i += vector_len) {
+                const block: Block = data[i..][0..vector_len].*;
+                var mask: Mask = 0;
+                for (self.start_bytes[0..self.start_count]) |byte| {
+                    mask |= @as(Mask, @bitCast(block == @as(Block, @splat(byte))));
+                }
+                while (mask != 0) : (mask &= mask - 1) {
+                    if (!try self.verify(node, data, i + @ctz(mask), context, onMatch, count)) return false;
+                }
+            }
+        }
+        while (i < data.len) : (i += 1) {
+            if (self.starts[data[i]] and !try self.verify(node, data, i, context, onMatch, count)) return false;
+        }
+        return true;
+    }
+
+    /// Reports the needles found at `at`, among those starting with its byte
+    fn verify(self: *const Matcher, node: *z.DomNode, data: []const u8, at: usize, context: anytype, comptime onMatch: anytype, count: *usize) !bool {
+        const group = self.groupOf(data[at]);
+        for (self.order[self.groups[group]..self.groups[@as(usize, group) + 1]]) |index| {
+            const needle = self.needles[index];
+            if (needle.len > data.len - at) continue;
+            const candidate = data[at..][0..needle.len];
+            const found = if (self.ignore_case)
+                std.ascii.eqlIgnoreCase(candidate, needle)
+            else
+                std.mem.eql(u8, candidate, needle);
+            if (!found) continue;
+            count.* += 1;
+            if (!try onMatch(context, .{ .node = node, .offset = at, .needle = index })) return false;
+        }
+        return true;
+    }
+};
+
+test "findText" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<div><p>The Quick fox, the quick dog</p><script>quick()</script><p>QUICK <b>brown</b> quickly</p>
+        \\<style>.quick {}</style><!-- quick --></div>
+    );
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    const matches = try findTextAll(allocator, body, &.{ "quick", "fox", "" }, .{ .ignore_case = true });
+    defer allocator.free(matches);
+    const expected = [_]struct { text: []const u8, offset: usize, needle: usize }{
+        .{ .text = "The Quick fox, the quick dog", .offset = 4, .needle = 0 },
+        .{ .text = "The Quick fox, the quick dog", .offset = 10, .needle = 1 },
+        .{ .text = "The Quick fox, the quick dog", .offset = 19, .needle = 0 },
+        .{ .text = "QUICK ", .offset = 0, .needle = 0 },
+        .{ .text = " quickly", .offset = 1, .needle = 0 },
+    };
+    try testing.expectEqual(expected.len, matches.len);
+    for (expected, matches) |e, m| {
+        try testing.expectEqualStrings(e.text, z.characterData(m.node));
+        try testing.expectEqual(e.offset, m.offset);
+        try testing.expectEqual(e.needle, m.needle);
+    }
+
+    // case-sensitive, raw text included
+    const exact = try findTextAll(allocator, body, &.{"quick"}, .{ .skip_raw_text = false });
+    defer allocator.free(exact);
+    try testing.expectEqual(4, exact.len);
+
+    // stop at the first match
+    const First = struct {
+        fn onMatch(first: *?TextMatch, m: TextMatch) !bool {
+            first.* = m;
+            return false;
+        }
+    };
+    var first: ?TextMatch = null;
+    try testing.expectEqual(1, try findText(body, &.{"fox"}, .{}, &first, First.onMatch));
+    try testing.expectEqual(10, first.?.offset);
+
+    // more first bytes than the vector path takes, across block boundaries
+    var text: std.Io.Writer.Allocating = .init(allocator);
+    defer text.deinit();
+    for (0..50) |i| try text.writer.print("<i>{d}</i> lorem ipsum needle dolor sit amet; ", .{i});
+    _ = try z.setInnerHTML(z.nodeToElement(body).?, text.written());
+    const many = try findTextAll(allocator, body, &.{ "needle", "amet", "sit", "lorem", "zzz" }, .{});
+    defer allocator.free(many);
+    try testing.expectEqual(200, many.len);
+    const one = try findTextAll(allocator, body, &.{"needle"}, .{});
+    defer allocator.free(one);
+    try testing.expectEqual(50, one.len);
+    for (one) |m| try testing.expectEqualStrings("needle", z.characterData(m.node)[m.offset..][0..6]);
+
+    // needles sharing a first byte: reported in needle order at the same offset
+    const shared = try findTextAll(allocator, body, &.{ "lorem", "sit", "lo", "s" }, .{});
+    defer allocator.free(shared);
+    try testing.expectEqual(300, shared.len);
+    try testing.expectEqual(0, shared[0].needle);
+    try testing.expectEqual(2, shared[1].needle);
+    try testing.expectEqual(shared[0].offset, shared[1].offset);
+
+    const too_many: [max_needles + 1][]const u8 = @splat("x");
+    try testing.expectError(Err.TooManyNeedles, findTextAll(allocator, body, &too_many, .{}));
+}
@@ -0,0 +1,608 @@
+//! URL parsing and serialization with the bundled `lexbor/url` (WHATWG URL standard)
+//!
+//! A `UrlParser` wraps a `lxb_url_parser_t` and its memory pool.
+//! Parsed `*Url` are owned by the parser: release them one by one with `destroyUrl`
+//! or all at once with `UrlParser.deinit`.
+//!
+//! The WHATWG parser already normalizes what it resolves: scheme and host are lowercased,
+//! internationalized hosts are converted to ASCII (IDNA), default ports are dropped and
+//! dot-segments are removed from the path.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// Opaque `lxb_url_t`
+pub const Url = opaque {};
+const LxbUrlParser = opaque {};
+
+const SerializeCb = *const fn (data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint;
+
+extern "c" fn lxb_url_parser_create() ?*LxbUrlParser;
+extern "c" fn lxb_url_parser_init(parser: *LxbUrlParser, mraw: ?*anyopaque) c_uint;
+extern "c" fn lxb_url_parser_clean(parser: *LxbUrlParser) void;
+extern "c" fn lxb_url_parser_destroy(parser: *LxbUrlParser, destroy_self: bool) ?*LxbUrlParser;
+extern "c" fn lxb_url_parser_memory_destroy(parser: *LxbUrlParser) void;
+extern "c" fn lxb_url_parse(parser: *LxbUrlParser, base_url: ?*const Url, data: [*]const u8, length: usize) ?*Url;
+extern "c" fn lxb_url_destroy(url: *Url) ?*Url;
+extern "c" fn lxb_url_serialize(url: *const Url, cb: SerializeCb, ctx: ?*anyopaque, exclude_fragment: bool) c_uint;
+
+const LxbIdna = opaque {};
+const PunycodeEncodeCb = *const fn (data: [*]const u8, len: usize, ctx: ?*anyopaque, unchanged: bool) callconv(.c) c_uint;
+
+extern "c" fn lxb_unicode_idna_create() ?*LxbIdna;
+extern "c" fn lxb_unicode_idna_init(idna: *LxbIdna) c_uint;
+extern "c" fn lxb_unicode_idna_clean(idna: *LxbIdna) void;
+extern "c" fn lxb_unicode_idna_destroy(idna: *LxbIdna, self_destroy: bool) ?*LxbIdna;
+extern "c" fn lxb_unicode_idna_to_ascii(idna: *LxbIdna, data: [*]const u8, length: usize, cb: SerializeCb, ctx: ?*anyopaque, flags: c_uint) c_uint;
+extern "c" fn lxb_unicode_idna_to_unicode(idna: *LxbIdna, data: [*]const u8, length: usize, cb: SerializeCb, ctx: ?*anyopaque, flags: c_uint) c_uint;
+extern "c" fn lxb_punycode_encode(data: [*]const u8, length: usize, cb: PunycodeEncodeCb, ctx: ?*anyopaque) c_uint;
+extern "c" fn lxb_punycode_decode(data: [*]const u8, length: usize, cb: SerializeCb, ctx: ?*anyopaque) c_uint;
+
+/// [url] WHATWG URL parser bound to its own memory pool
+///
+/// ## Example
+/// ```
+/// var parser = try z.UrlParser.init();
+/// defer parser.deinit();
+///
+/// const base = try parser.parse(null, "https://example.com/blog/");
+/// const url = try parser.parse(base, "../img/a.png");
+/// defer parser.destroyUrl(url);
+///
+/// const href = try z.UrlParser.serializeAlloc(allocator, url);
+/// defer allocator.free(href);
+/// // "https://example.com/img/a.png"
+/// ---
+/// ```
+pub const UrlParser = struct {
+    parser: *LxbUrlParser,
+
+    pub fn init() !UrlParser {
+        const parser = lxb_url_parser_create() orelse return Err.UrlParserCreateFailed;
+        if (lxb_url_parser_init(parser, null) != z._OK) {
+            _ = lxb_url_parser_destroy(parser, true);
+            return Err.UrlParserInitFailed;
+        }
+        return .{ .parser = parser };
+    }
+
+    /// Destroys the parser and every URL it produced
+    pub fn deinit(self: *UrlParser) void {
+        lxb_url_parser_memory_destroy(self.parser);
+        _ = lxb_url_parser_destroy(self.parser, true);
+    }
+
+    /// [url] Parse `input`, resolved against `base` when given.
+    ///
+    /// Returns `Err.UrlParseFailed` for invalid URLs (e.g. a relative URL without base).
+    pub fn parse(self: *UrlParser, base: ?*const Url, input: []const u8) !*Url {
+        lxb_url_parser_clean(self.parser);
+        return lxb_url_parse(self.parser, base, input.ptr, input.len) orelse Err.UrlParseFailed;
+    }
+
+    /// [url] Release a single URL
+    pub fn destroyUrl(_: *UrlParser, url: *Url) void {
+        _ = lxb_url_destroy(url);
+    }
+
+    /// [url] Serialize a URL into a writer
+    pub fn serializeTo(url: *const Url, writer: *std.Io.Writer, exclude_fragment: bool) !void {
+        if (lxb_url_serialize(url, writerCallback, writer, exclude_fragment) != z._OK) {
+            return Err.SerializeFailed;
+        }
+    }
+
+    /// [url] Serialize a URL by appending to an `ArrayList(u8)`
+    pub fn serializeAppend(allocator: std.mem.Allocator, url: *const Url, list: *std.ArrayList(u8), exclude_fragment: bool) !void {
+        var ctx = ListContext{ .allocator = allocator, .list = list };
+        if (lxb_url_serialize(url, listCallback, &ctx, exclude_fragment) != z._OK) {
+            return Err.SerializeFailed;
+        }
+    }
+
+    /// [url] Serialize a URL into an owned slice
+    ///
+    /// Caller needs to free the slice
+    pub fn serializeAlloc(allocator: std.mem.Allocator, url: *const Url) ![]u8 {
+        var list: std.ArrayList(u8) = .empty;
+        errdefer list.deinit(allocator);
+        try serializeAppend(allocator, url, &list, false);
+        return list.toOwnedSlice(allocator);
+    }
+};
+
+const ListContext = struct {
+    allocator: std.mem.Allocator,
+    list: *std.ArrayList(u8),
+};
+
+fn listCallback(data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint {
+    const context = z.castContext(ListContext, ctx);
+    context.list.appendSlice(context.allocator, data[0..len]) catch return 1;
+    return 0;
+}
+
+fn writerCallback(data: [*]const u8, len: usize, ctx: ?*anyopaque) callconv(.c) c_uint {
+    const writer = z.castContext(std.Io.Writer, ctx);
+    writer.writeAll(data[0..len]) catch return 1;
+    return 0;
+}
+
+// -------------------------------------------------------------------------------
+// srcset
+// -------------------------------------------------------------------------------
+
+/// [url] A URL inside an attribute value (`srcset` candidate, CSS `url()`) and its byte offset
+pub const UrlSpan = struct {
+    url: []const u8,
+    start: usize,
+};
+
+/// [url] Zero-copy iterator over the URLs of a `srcset` attribute value
+///
+/// Follows the HTML "parse a srcset attribute" steps: URLs are whitespace-delimited,
+/// trailing commas are stripped, descriptors (`2x`, `300w`, ...) are skipped.
+pub const SrcsetIterator = struct {
+    value: []const u8,
+    pos: usize = 0,
+
+    pub fn next(self: *SrcsetIterator) ?UrlSpan {
+        const v = self.value;
+        // skip whitespace and commas
+        while (self.pos < v.len and (isSpace(v[self.pos]) or v[self.pos] == ',')) self.pos += 1;
+        if (self.pos >= v.len) return null;
+
+        const start = self.pos;
+        while (self.pos < v.len and !isSpace(v[self.pos])) self.pos += 1;
+        var end = self.pos;
+
+        if (v[end - 1] == ',') {
+            // "a.png," : no descriptors
+            while (end > start and v[end - 1] == ',') end -= 1;
+        } else {
+            // skip descriptors up to the next comma outside parentheses
+            var in_parens = false;
+            while (self.pos < v.len) : (self.pos += 1) {
+                switch (v[self.pos]) {
+                    '(' => in_parens = true,
+                    ')' => in_parens = false,
+                    ',' => if (!in_parens) break,
+                    else => {},
+                }
+            }
+        }
+        if (end == start) return self.next();
+        return .{ .url = v[start..end], .start = start };
+    }
+};
+
+fn isSpace(c: u8) bool {
+    return c == ' ' or c == '\t' or c == '\n' or c == '\r' or c == 0x0c;
+}
+
+/// [url] Returns a `SrcsetIterator` over a `srcset` attribute value
+pub fn iterateSrcset(value: []const u8) SrcsetIterator {
+    return .{ .value = value };
+}
+
+// -------------------------------------------------------------------------------
+// CSS url()
+// -------------------------------------------------------------------------------
+
+/// [url] Zero-copy iterator over the `url(...)` references of a CSS declaration block (`style` attribute)
+///
+/// Handles `url(a.png)`, `url( "a.png" )` and `url('a.png')`; the returned span excludes quotes and spaces.
+pub const CssUrlIterator = struct {
+    value: []const u8,
+    pos: usize = 0,
+
+    pub fn next(self: *CssUrlIterator) ?UrlSpan {
+        const v = self.value;
+        while (self.pos + 4 <= v.len) {
+            const found = std.ascii.indexOfIgnoreCasePos(v, self.pos, "url(") orelse {
+                self.pos = v.len;
+                return null;
+            };
+            var i = found + 4;
+            while (i < v.len and isSpace(v[i])) i += 1;
+            if (i >= v.len) break;
+
+            var start = i;
+            var end: usize = undefined;
+            if (v[i] == '"' or v[i] == '\'') {
+                const quote = v[i];
+                start = i + 1;
+                end = std.mem.indexOfScalarPos(u8, v, start, quote) orelse v.len;
+                self.pos = end;
+            } else {
+                end = std.mem.indexOfScalarPos(u8, v, start, ')') orelse v.len;
+                self.pos = end;
+                while (end > start and isSpace(v[end - 1])) end -= 1;
+            }
+            if (end > start) return .{ .url = v[start..end], .start = start };
+        }
+        self.pos = v.len;
+        return null;
+    }
+};
+
+/// [url] Returns a `CssUrlIterator` over a CSS declaration block
+pub fn iterateCssUrls(value: []const u8) CssUrlIterator {
+    return .{ .value = value };
+}
+
+// -------------------------------------------------------------------------------
+// IDNA & punycode
+// -------------------------------------------------------------------------------
+
+/// [url] IDNA processing (UTS #46) with the bundled `lexbor/unicode`
+///
+/// ## Example
+/// ```
+/// var idna = try z.Idna.init();
+/// defer idna.deinit();
+/// try idna.toAscii("Bücher.example", writer); // "xn--bcher-kva.example"
+/// ---
+/// ```
+pub const Idna = struct {
+    idna: *LxbIdna,
+
+    pub fn init() !Idna {
+        const idna = lxb_unicode_idna_create() orelse return Err.IdnaInitFailed;
+        if (lxb_unicode_idna_init(idna) != z._OK) {
+            _ = lxb_unicode_idna_destroy(idna, true);
+            return Err.IdnaInitFailed;
+        }
+        return .{ .idna = idna };
+    }
+
+    pub fn deinit(self: *Idna) void {
+        _ = lxb_unicode_idna_destroy(self.idna, true);
+    }
+
+    /// [url] Domain name to ASCII ("xn--" labels), lowercased and mapped
+    pub fn toAscii(self: *Idna, domain: []const u8, writer: *std.Io.Writer) !void {
+        lxb_unicode_idna_clean(self.idna);
+        if (lxb_unicode_idna_to_ascii(self.idna, domain.ptr, domain.len, writerCallback, writer, 0) != z._OK) {
+            return Err.IdnaFailed;
+        }
+    }
+
+    /// [url] Domain name to Unicode (decodes "xn--" labels)
+    pub fn toUnicode(self: *Idna, domain: []const u8, writer: *std.Io.Writer) !void {
+        lxb_unicode_idna_clean(self.idna);
+        if (lxb_unicode_idna_to_unicode(self.idna, domain.ptr, domain.len, writerCallback, writer, 0) != z._OK) {
+            return Err.IdnaFailed;
+        }
+    }
+};
+
+fn punycodeCallback(data: [*]const u8, len: usize, ctx: ?*anyopaque, _: bool) callconv(.c) c_uint {
+    return writerCallback(data, len, ctx);
+}
+
+/// [url] Punycode (RFC 3492) encoding of a single UTF-8 label, without the "xn--" prefix
+pub fn punycodeEncode(label: []const u8, writer: *std.Io.Writer) !void {
+    if (lxb_punycode_encode(label.ptr, label.len, punycodeCallback, writer) != z._OK) {
+        return Err.IdnaFailed;
+    }
+}
+
+/// [url] Punycode (RFC 3492) decoding of a single label (without the "xn--" prefix) to UTF-8
+pub fn punycodeDecode(label: []const u8, writer: *std.Io.Writer) !void {
+    if (lxb_punycode_decode(label.ptr, label.len, writerCallback, writer) != z._OK) {
+        return Err.IdnaFailed;
+    }
+}
+
+// -------------------------------------------------------------------------------
+// URL normalization & dedupe
+// -------------------------------------------------------------------------------
+
+/// Normalization beyond the WHATWG parser (lowercased scheme/host, IDNA to ASCII,
+/// default port removal, dot-segment removal are always applied).
+pub const UrlNormalizeOptions = struct {
+    /// drop `#fragment`
+    strip_fragment: bool = true,
+    /// sort the `&`-separated query parameters
+    sort_query: bool = false,
+    /// drop a trailing empty `?`
+    drop_empty_query: bool = true,
+};
+
+/// [url] Reusable URL normalizer: one parser and one scratch buffer for any number of URLs
+///
+/// ## Example
+/// ```
+/// var normalizer = try z.UrlNormalizer.init(allocator, .{ .sort_query = true });
+/// defer normalizer.deinit();
+///
+/// const url = try normalizer.normalize("HTTP://Bücher.Example:80/a/./b/../c?b=2&a=1#top");
+/// // "http://xn--bcher-kva.example/a/c?a=1&b=2" (valid until the next call)
+/// ---
+/// ```
+pub const UrlNormalizer = struct {
+    allocator: std.mem.Allocator,
+    parser: UrlParser,
+    options: UrlNormalizeOptions,
+    base: ?*Url = null,
+    scratch: std.ArrayList(u8) = .empty,
+    params: std.ArrayList([]const u8) = .empty,
+
+    pub fn init(allocator: std.mem.Allocator, options: UrlNormalizeOptions) !UrlNormalizer {
+        return .{
+            .allocator = allocator,
+            .parser = try UrlParser.init(),
+            .options = options,
+        };
+    }
+
+    pub fn deinit(self: *UrlNormalizer) void {
+        self.scratch.deinit(self.allocator);
+        self.params.deinit(self.allocator);
+        self.parser.deinit();
+    }
+
+    /// [url] Relative inputs are resolved against this base URL
+    pub fn setBase(self: *UrlNormalizer, base_url: []const u8) !void {
+        if (self.base) |base| {
+            self.parser.destroyUrl(base);
+            self.base = null;
+        }
+        self.base = try self.parser.parse(null, base_url);
+    }
+
+    /// [url] Normalized form of `input`; the slice is valid until the next call
+    pub fn normalize(self: *UrlNormalizer, input: []const u8) ![]const u8 {
+        const url = try self.parser.parse(self.base, std.mem.trim(u8, input, " \t\n\r"));
+        defer self.parser.destroyUrl(url);
+
+        self.scratch.clearRetainingCapacity();
+        try UrlParser.serializeAppend(self.allocator, url, &self.scratch, self.options.strip_fragment);
+
+        // the serializer escapes `?` and `#` before the query; a fragment can contain `?`
+        const query_end = std.mem.indexOfScalar(u8, self.scratch.items, '#') orelse self.scratch.items.len;
+        const query_start = std.mem.indexOfScalar(u8, self.scratch.items[0..query_end], '?') orelse return self.scratch.items;
+
+        if (self.options.drop_empty_query and query_end == query_start + 1) {
+            const fragment_len = self.scratch.items.len - query_end;
+            std.mem.copyForwards(u8, self.scratch.items[query_start..], self.scratch.items[query_end..]);
+            self.scratch.shrinkRetainingCapacity(query_start + fragment_len);
+            return self.scratch.items;
+        }
+        if (self.options.sort_query) try self.sortQuery(query_start + 1, query_end);
+        return self.scratch.items;
+    }
+
+    fn sortQuery(self: *UrlNormalizer, start: usize, end: usize) !void {
+        const query_len = end - start;
+        self.params.clearRetainingCapacity();
+
+        // the sorted query is built after the URL, then copied back in place
+        try self.scratch.ensureUnusedCapacity(self.allocator, query_len);
+        const query = self.scratch.items[start..end];
+        var it = std.mem.splitScalar(u8, query, '&');
+        while (it.next()) |param| try self.params.append(self.allocator, param);
+
+        std.mem.sort([]const u8, self.params.items, {}, struct {
+            fn lessThan(_: void, a: []const u8, b: []const u8) bool {
+                return std.mem.lessThan(u8, a, b);
+            }
+        }.lessThan);
+
+        const url_len = self.scratch.items.len;
+        for (self.params.items, 0..) |param, i| {
+            if (i > 0) self.scratch.appendAssumeCapacity('&');
+            self.scratch.appendSliceAssumeCapacity(param);
+        }
+        @memcpy(self.scratch.items[start..end], self.scratch.items[url_len..]);
+        self.scratch.shrinkRetainingCapacity(url_len);
+    }
+
+    /// [url] Normalize `input` into a writer
+    pub fn normalizeTo(self: *UrlNormalizer, input: []const u8, writer: *std.Io.Writer) !void {
+        try writer.writeAll(try self.normalize(input));
+    }
+
+    /// [url] Batch mode: writes one normalized URL per line, invalid inputs are skipped.
+    ///
+    /// Returns the number of URLs written.
+    pub fn normalizeBatch(self: *UrlNormalizer, inputs: []const []const u8, writer: *std.Io.Writer) !usize {
+        var written: usize = 0;
+        for (inputs) |input| {
+            const normalized = self.normalize(input) catch |err| switch (err) {
+                error.UrlParseFailed => continue,
+                else => return err,
+            };
+            try writer.writeAll(normalized);
+            try writer.writeByte('\n');
+            written += 1;
+        }
+        return written;
+    }
+};
+
+/// [url] Set of normalized URLs for deduplication
+///
+/// Normalized URLs are stored once in an arena; `add` costs no allocation for already seen URLs.
+/// ## Example
+/// ```
+/// var set = try z.UrlSet.init(allocator, .{});
+/// defer set.deinit();
+/// _ = try set.add("https://Example.com/a");   // true
+/// _ = try set.add("https://example.com:443/a#x"); // false
+/// ---
+/// ```
+pub const UrlSet = struct {
+    arena: std.heap.ArenaAllocator,
+    set: std.StringHashMapUnmanaged(void) = .empty,
+    normalizer: UrlNormalizer,
+
+    pub fn init(allocator: std.mem.Allocator, options: UrlNormalizeOptions) !UrlSet {
+        return .{
+            .arena = std.heap.ArenaAllocator.init(allocator),
+            .normalizer = try UrlNormalizer.init(allocator, options),
+        };
+    }
+
+    pub fn deinit(self: *UrlSet) void {
+        self.set.deinit(self.normalizer.allocator);
+        self.normalizer.deinit();
+        self.arena.deinit();
+    }
+
+    /// [url] Adds the normalized URL. Returns `true` if it was not in the set.
+    pub fn add(self: *UrlSet, input: []const u8) !bool {
+        const normalized = try self.normalizer.normalize(input);
+        const gop = try self.set.getOrPut(self.normalizer.allocator, normalized);
+        if (gop.found_existing) return false;
+        gop.key_ptr.* = self.arena.allocator().dupe(u8, normalized) catch |err| {
+            self.set.removeByPtr(gop.key_ptr);
+            return err;
+        };
+        return true;
+    }
+
+    /// [url] True if the normalized URL is in the set
+    pub fn contains(self: *UrlSet, input: []const u8) !bool {
+        return self.set.contains(try self.normalizer.normalize(input));
+    }
+
+    pub fn count(self: *const UrlSet) usize {
+        return self.set.count();
+    }
+};
+
+// -------------------------------------------------------------------------------
+// Tests
+// -------------------------------------------------------------------------------
+
+test "UrlParser resolves and normalizes" {
+    const allocator = testing.allocator;
+    var parser = try UrlParser.init();
+    defer parser.deinit();
+
+    const base = try parser.parse(null, "HTTPS://Example.COM:443/blog/post/");
+    const cases = [_][2][]const u8{
+        .{ "../img/a.png", "https://example.com/blog/img/a.png" },
+        .{ "/root", "https://example.com/root" },
+        .{ "?q=1#top", "https://example.com/blog/post/?q=1#top" },
+        .{ "//cdn.example.org/x.js", "https://cdn.example.org/x.js" },
+        .{ "http://example.com:80/./a/../b", "http://example.com/b" },
+    };
+    for (cases) |case| {
+        const url = try parser.parse(base, case[0]);
+        defer parser.destroyUrl(url);
+        const href = try UrlParser.serializeAlloc(allocator, url);
+        defer allocator.free(href);
+        try testing.expectEqualStrings(case[1], href);
+    }
+
+    try testing.expectError(Err.UrlParseFailed, parser.parse(null, "relative/path"));
+}
+
+test "UrlParser.serializeTo writer" {
+    var parser = try UrlParser.init();
+    defer parser.deinit();
+
+    var buf: [128]u8 = undefined;
+    var writer = std.Io.Writer.fixed(&buf);
+    const url = try parser.parse(null, "https://example.com/a#frag");
+    try UrlParser.serializeTo(url, &writer, true);
+    try testing.expectEqualStrings("https://example.com/a", writer.buffered());
+}
+
+test "iterateSrcset" {
+    var it = iterateSrcset("  a.png 1x, b.png 2x,c.png,  d(1).png 300w  ");
+    try testing.expectEqualStrings("a.png", it.next().?.url);
+    try testing.expectEqualStrings("b.png", it.next().?.url);
+    try testing.expectEqualStrings("c.png", it.next().?.url);
+    const last = it.next().?;
+    try testing.expectEqualStrings("d(1).png", last.url);
+    try testing.expect(last.start == 29);
+    try testing.expect(it.next() == null);
+
+    var empty = iterateSrcset(" , ");
+    try testing.expect(empty.next() == null);
+}
+
+test "iterateCssUrls" {
+    const style = "background: URL( 'bg.png' ) no-repeat; mask: url(\"m.svg\"); list-style: url(dot.gif );";
+    var it = iterateCssUrls(style);
+    const first = it.next().?;
+    try testing.expectEqualStrings("bg.png", first.url);
+    try testing.expectEqualStrings("bg.png", style[first.start .. first.start + first.url.len]);
+    try testing.expectEqualStrings("m.svg", it.next().?.url);
+    try testing.expectEqualStrings("dot.gif", it.next().?.url);
+    try testing.expect(it.next() == null);
+
+    var none = iterateCssUrls("color: red");
+    try testing.expect(none.next() == null);
+}
+
+test "Idna and punycode" {
+    var idna = try Idna.init();
+    defer idna.deinit();
+
+    var buf: [128]u8 = undefined;
+    var writer = std.Io.Writer.fixed(&buf);
+    try idna.toAscii("Bücher.Example", &writer);
+    try testing.expectEqualStrings("xn--bcher-kva.example", writer.buffered());
+
+    writer = std.Io.Writer.fixed(&buf);
+    try idna.toUnicode("xn--bcher-kva.example", &writer);
+    try testing.expectEqualStrings("bücher.example", writer.buffered());
+
+    writer = std.Io.Writer.fixed(&buf);
+    try punycodeEncode("bücher", &writer);
+    try testing.expectEqualStrings("bcher-kva", writer.buffered());
+
+    writer = std.Io.Writer.fixed(&buf);
+    try punycodeDecode("bcher-kva", &writer);
+    try testing.expectEqualStrings("bücher", writer.buffered());
+}
+
+test "UrlNormalizer" {
+    const allocator = testing.allocator;
+    var normalizer = try UrlNormalizer.init(allocator, .{ .sort_query = true });
+    defer normalizer.deinit();
+
+    try testing.expectEqualStrings(
+        "http://xn--bcher-kva.example/a/c?a=1&b=2",
+        try normalizer.normalize("HTTP://Bücher.Example:80/a/./b/../c?b=2&a=1#top"),
+    );
+    try testing.expectEqualStrings("https://example.com/", try normalizer.normalize("  https://EXAMPLE.com:443?#x "));
+
+    // a `?` in the fragment is not a query
+    var keep_fragment = try UrlNormalizer.init(allocator, .{ .sort_query = true, .strip_fragment = false });
+    defer keep_fragment.deinit();
+    try testing.expectEqualStrings("http://a/p#x?b=2&a=1", try keep_fragment.normalize("http://a/p#x?b=2&a=1"));
+    try testing.expectEqualStrings("http://a/p?a=1&b=2#x?d&c", try keep_fragment.normalize("http://a/p?b=2&a=1#x?d&c"));
+    try testing.expectEqualStrings("http://a/p#?", try keep_fragment.normalize("http://a/p?#?"));
+
+    try normalizer.setBase("https://example.com/blog/");
+    try testing.expectEqualStrings("https://example.com/img/a.png", try normalizer.normalize("../img/a.png"));
+
+    var buf: [256]u8 = undefined;
+    var writer = std.Io.Writer.fixed(&buf);
+    const written = try normalizer.normalizeBatch(&.{ "a", "http://[bad", "/b?z=1&y=2" }, &writer);
+    try testing.expect(written == 2);
+    try testing.expectEqualStrings("https://example.com/blog/a\nhttps://example.com/b?y=2&z=1\n", writer.buffered());
+}
+
+test "UrlSet dedupes equivalent URLs" {
+    const allocator = testing.allocator;
+    var set = try UrlSet.init(allocator, .{});
+    defer set.deinit();
+
+    try testing.expect(try set.add("https://Example.com/a"));
+    try testing.expect(!try set.add("https://example.com:443/./a#section"));
+    try testing.expect(try set.add("https://example.com/b"));
+    try testing.expect(!try set.add("HTTPS://EXAMPLE.COM/b"));
+    try testing.expect(try set.contains("https://example.COM/a"));
+    try testing.expect(set.count() == 2);
+}
@@ -0,0 +1,1135 @@
+//! XPath 1.0 subset, compiled to step plans
+//!
+//! Location paths, absolute (`/`, `//`) or relative to the context node, with:
+//! - the axes `child`, `descendant`, `descendant-or-self`, `self`, `parent`, `ancestor`, and `attribute`
+//!   as the last step, with the abbreviations `//`, `.`, `..` and `@`;
+//! - the node tests: a name (ASCII case-insensitive), `*`, `text()`, `node()`;
+//! - predicates: numbers (`[2]`), `=`, `!=`, `<`, `<=`, `>`, `>=`, `and`, `or`, `( )`, string and number
+//!   literals, the relative operands `@name`, `.`, `text()`, `name`, `*`, and the functions `position()`,
+//!   `last()`, `count()`, `not()`, `true()`, `false()`, `contains()`, `starts-with()`, `ends-with()`,
+//!   `normalize-space()`, `string-length()`, `string()`, `name()`, `local-name()`.
+//!
+//! Not covered: unions (`|`), arithmetic, variables, the other axes, multi-step paths in predicates.
+//!
+//! A path is parsed once into an `XPathPlan` (steps and predicate expressions), cached by `XPathEngine` as
+//! `CssSelectorEngine.selector_cache` does for selectors. `//name[...]` runs as one pre-order walk with
+//! positions counted per parent, and a name test compares lexbor tag ids once it has seen the id of the name.
+//! Results are in document order, without duplicates.
+
+const std = @import("std");
+const z = @import("../root.zig");
+const Err = z.Err;
+
+const testing = std.testing;
+const print = std.debug.print;
+
+/// predicates per step
+const max_predicates = 4;
+
+const Axis = enum {
+    child,
+    descendant,
+    descendant_or_self,
+    self,
+    parent,
+    ancestor,
+    /// `//name`: `descendant-or-self::node()/child::name` in one walk
+    descendant_child,
+};
+
+const NodeTest = union(enum) {
+    name: []const u8,
+    any_element,
+    text,
+    node,
+};
+
+const Step = struct {
+    axis: Axis,
+    node_test: NodeTest,
+    first_predicate: usize = 0,
+    predicate_count: usize = 0,
+    /// a predicate reads `position()` or `last()`
+    positional: bool = false,
+    /// lexbor tag id of the name test, learned from the first matching element
+    tag_id: usize = 0,
+};
+
+const Predicate = struct {
+    expr: u32,
+    /// a number is compared to `position()`
+    numeric: bool,
+    uses_last: bool,
+};
+
+const Op = enum { @"or", @"and", eq, ne, lt, le, gt, ge };
+
+const NodeKind = enum { attribute, self, text, child };
+
+const Function = enum {
+    position,
+    last,
+    count,
+    not,
+    @"true",
+    @"false",
+    contains,
+    starts_with,
+    ends_with,
+    normalize_space,
+    string_length,
+    string,
+    name,
+    local_name,
+};
+
+const Operand = struct {
+    kind: NodeKind,
+    name: []const u8 = "",
+};
+
+const Binary = struct {
+    op: Op,
+    lhs: u32,
+    rhs: u32,
+};
+
+const Call = struct {
+    function: Function,
+    args: [2]u32 = .{ 0, 0 },
+    arg_count: u8 = 0,
+};
+
+const Expr = union(enum) {
+    number: f64,
+    string: []const u8,
+    nodes: Operand,
+    binary: Binary,
+    call: Call,
+};
+
+const axes = std.StaticStringMap(Axis).initComptime(.{
+    .{ "child", .child },
+    .{ "descendant", .descendant },
+    .{ "descendant-or-self", .descendant_or_self },
+    .{ "self", .self },
+    .{ "parent", .parent },
+    .{ "ancestor", .ancestor },
+});
+
+const functions = std.StaticStringMap(Function).initComptime(.{
+    .{ "position", .position },
+    .{ "last", .last },
+    .{ "count", .count },
+    .{ "not", .not },
+    .{ "true", .@"true" },
+    .{ "false", .@"false" },
+    .{ "contains", .contains },
+    .{ "starts-with", .starts_with },
+    .{ "ends-with", .ends_with },
+    .{ "normalize-space", .normalize_space },
+    .{ "string-length", .string_length },
+    .{ "string", .string },
+    .{ "name", .name },
+    .{ "local-name", .local_name },
+});
+
+/// [min, max] number of arguments
+fn arity(function: Function) [2]u8 {
+    return switch (function) {
+        .position, .last, .@"true", .@"false", .name, .local_name => .{ 0, 0 },
+        .count, .not => .{ 1, 1 },
+        .contains, .starts_with, .ends_with => .{ 2, 2 },
+        .normalize_space, .string_length, .string => .{ 0, 1 },
+    };
+}
+
+/// [xpath] A compiled path; names and literals are slices of `source`
+pub const XPathPlan = struct {
+    allocator: std.mem.Allocator,
+    source: []const u8,
+    absolute: bool,
+    steps: []Step,
+    predicates: []Predicate,
+    exprs: []Expr,
+    /// name of the final `@name` step
+    attribute: ?[]const u8,
+
+    pub fn deinit(self: *const XPathPlan) void {
+        self.allocator.free(self.exprs);
+        self.allocator.free(self.predicates);
+        self.allocator.free(self.steps);
+        self.allocator.free(self.source);
+    }
+};
+
+/// [xpath] Parses `xpath` into a plan, `Err.XPathParseFailed` outside of the supported subset
+///
+/// Caller must `deinit` the plan. `XPathEngine` compiles and caches plans itself.
+pub fn compileXPath(allocator: std.mem.Allocator, xpath: []const u8) !XPathPlan {
+    const source = try allocator.dupe(u8, xpath);
+    errdefer allocator.free(source);
+
+    var parser: Parser = .{ .allocator = allocator, .source = source };
+    defer parser.deinit();
+    try parser.path();
+
+    const steps = try parser.steps.toOwnedSlice(allocator);
+    errdefer allocator.free(steps);
+    const predicates = try parser.predicates.toOwnedSlice(allocator);
+    errdefer allocator.free(predicates);
+    const exprs = try parser.exprs.toOwnedSlice(allocator);
+
+    return .{
+        .allocator = allocator,
+        .source = source,
+        .absolute = parser.absolute,
+        .steps = steps,
+        .predicates = predicates,
+        .exprs = exprs,
+        .attribute = parser.attribute,
+    };
+}
+
+/// [xpath] One-shot `XPathEngine.select` from the document root element
+///
+/// Caller needs to free the slice.
+pub fn xpathSelect(allocator: std.mem.Allocator, doc: *z.HTMLDocument, xpath: []const u8) ![]*z.DomNode {
+    var engine: XPathEngine = .init(allocator);
+    defer engine.deinit();
+    const root = z.documentRoot(doc) orelse return Err.DocumentRootNotFound;
+    return engine.select(root, xpath);
+}
+
+/// [xpath] Evaluates XPath paths, keeping the compiled plans
+///
+/// ## Example
+/// ```
+/// var engine: z.XPathEngine = .init(allocator);
+/// defer engine.deinit();
+/// const cells = try engine.select(body, "//table[@id='prices']//tr/td[2]");
+/// defer allocator.free(cells);
+/// const links = try engine.selectValues(body, "//nav//a/@href");
+/// defer allocator.free(links);
+/// ---
+/// ```
+pub const XPathEngine = struct {
+    allocator: std.mem.Allocator,
+    /// compiled plans, keyed on their own copy of the path
+    plan_cache: std.StringHashMap(XPathPlan),
+    /// strings built by predicates (`normalize-space`, numbers, element string values),
+    /// reset for each predicate, and the joined values of `selectValues`
+    scratch: std.heap.ArenaAllocator,
+    /// positions per depth for `//name[...]`
+    slots: std.ArrayList(Slot) = .empty,
+    /// axis nodes of one context node, for the steps filtered as lists
+    candidates: std.ArrayList(*z.DomNode) = .empty,
+
+    const Self = @This();
+
+    pub fn init(allocator: std.mem.Allocator) Self {
+        return .{
+            .allocator = allocator,
+            .plan_cache = std.StringHashMap(XPathPlan).init(allocator),
+            .scratch = std.heap.ArenaAllocator.init(allocator),
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        var iterator = self.plan_cache.valueIterator();
+        while (iterator.next()) |plan| plan.deinit();
+        self.plan_cache.deinit();
+        self.scratch.deinit();
+        self.slots.deinit(self.allocator);
+        self.candidates.deinit(self.allocator);
+    }
+
+    /// [xpath] Get or compile a cached plan
+    pub fn compile(self: *Self, xpath: []const u8) !*XPathPlan {
+        if (self.plan_cache.getPtr(xpath)) |cached| return cached;
+
+        const plan = try compileXPath(self.allocator, xpath);
+        errdefer plan.deinit();
+        const gop = try self.plan_cache.getOrPut(plan.source);
+        gop.value_ptr.* = plan;
+        return gop.value_ptr;
+    }
+
+    /// [xpath] Nodes selected by `xpath` from `root`, in document order
+    ///
+    /// A path ending with `@name` is for `selectValues`: `Err.XPathAttributeResult`.
+    /// Caller needs to free the slice.
+    pub fn select(self: *Self, root: *z.DomNode, xpath: []const u8) ![]*z.DomNode {
+        const plan = try self.compile(xpath);
+        if (plan.attribute != null) return Err.XPathAttributeResult;
+        var nodes = try self.run(root, plan);
+        errdefer nodes.deinit(self.allocator);
+        return nodes.toOwnedSlice(self.allocator);
+    }
+
+    /// [xpath] String values of the nodes selected by `xpath`, or the attribute values for a final `@name`
+    ///
+    /// Attribute and text values are borrowed from the document; the string value of an element
+    /// with several text descendants is joined in the engine and valid until its next query.
+    /// Caller needs to free the slice.
+    pub fn selectValues(self: *Self, root: *z.DomNode, xpath: []const u8) ![][]const u8 {
+        const plan = try self.compile(xpath);
+        var nodes = try self.run(root, plan);
+        defer nodes.deinit(self.allocator);
+
+        _ = self.scratch.reset(.retain_capacity);
+        var values: std.ArrayList([]const u8) = try .initCapacity(self.allocator, nodes.items.len);
+        errdefer values.deinit(self.allocator);
+        for (nodes.items) |node| {
+            if (plan.attribute) |name| {
+                const element = z.nodeToElement(node) orelse continue;
+                values.appendAssumeCapacity(z.getAttribute_zc(element, name) orelse continue);
+            } else values.appendAssumeCapacity(try stringValue(self.scratch.allocator(), node));
+        }
+        return values.toOwnedSlice(self.allocator);
+    }
+
+    fn run(self: *Self, root: *z.DomNode, plan: *XPathPlan) !std.ArrayList(*z.DomNode) {
+        var current: std.ArrayList(*z.DomNode) = .empty;
+        errdefer current.deinit(self.allocator);
+        var next: std.ArrayList(*z.DomNode) = .empty;
+        defer next.deinit(self.allocator);
+
+        try current.append(self.allocator, if (plan.absolute) treeTop(root) else root);
+        // the node set is in document order; `disjoint` when no node contains another
+        var disjoint = true;
+        for (plan.steps) |*step| {
+            next.clearRetainingCapacity();
+            disjoint = try self.apply(plan, step, current.items, disjoint, &next);
+            std.mem.swap(std.ArrayList(*z.DomNode), &current, &next);
+        }
+        return current;
+    }
+
+    /// Appends the step results in document order, returns whether they are disjoint
+    fn apply(self: *Self, plan: *const XPathPlan, step: *Step, input: []const *z.DomNode, disjoint: bool, out: *std.ArrayList(*z.DomNode)) !bool {
+        switch (step.axis) {
+            .descendant_child => {
+                // positions are per parent: a context inside the previous one adds nothing
+                var last: ?*z.DomNode = null;
+                for (input) |context| {
+                    if (last) |previous| if (isInside(context, previous)) continue;
+                    last = context;
+                    try self.walk(plan, step, context, out);
+                }
+                return out.items.len <= 1;
+            },
+            .child => {
+                for (input) |context| {
+                    var slot: Slot = .{ .parent = context };
+                    var child = z.firstChild(context);
+                    while (child) |node| : (child = z.nextSibling(node)) {
+                        if (matchesTest(step, node) and try self.passes(plan, step, node, &slot)) {
+                            try out.append(self.allocator, node);
+                        }
+                    }
+                }
+                if (!disjoint) try self.normalize(out);
+                return disjoint;
+            },
+            .descendant, .descendant_or_self => if (!step.positional) {
+                var last: ?*z.DomNode = null;
+                for (input) |context| {
+                    if (last) |previous| if (isInside(context, previous)) continue;
+                    last = context;
+                    if (step.axis == .descendant_or_self) try self.keep(plan, step, context, out);
+                    var it = z.iterateDescendants(context);
+                    while (it.next()) |node| try self.keep(plan, step, node, out);
+                }
+                return out.items.len <= 1;
+            },
+            else => {},
+        }
+
+        // positions in axis order, for each context node
+        for (input) |context| {
+            self.candidates.clearRetainingCapacity();
+            try self.collect(step, context);
+            try self.filter(plan, step);
+            try out.appendSlice(self.allocator, self.candidates.items);
+        }
+        if (step.axis == .self) return disjoint;
+        try self.normalize(out);
+        return out.items.len <= 1;
+    }
+
+    /// `//name[...]`: pre-order walk under `context`, positions counted per parent
+    fn walk(self: *Self, plan: *const XPathPlan, step: *Step, context: *z.DomNode, out: *std.ArrayList(*z.DomNode)) !void {
+        self.slots.clearRetainingCapacity();
+        var node = z.firstChild(context) orelse return;
+        var depth: usize = 0;
+        while (true) {
+            if (matchesTest(step, node)) {
+                const slot = if (step.positional) try self.slotAt(depth, z.parentNode(node).?) else null;
+                if (try self.passes(plan, step, node, slot)) try out.append(self.allocator, node);
+            }
+            if (z.firstChild(node)) |child| {
+                node = child;
+                depth += 1;
+                continue;
+            }
+            while (z.nextSibling(node) == null) {
+                if (depth == 0) return;
+                node = z.parentNode(node).?;
+                depth -= 1;
+            }
+            node = z.nextSibling(node).?;
+        }
+    }
+
+    fn slotAt(self: *Self, depth: usize, parent: *z.DomNode) !*Slot {
+        while (self.slots.items.len <= depth) try self.slots.append(self.allocator, .{});
+        const slot = &self.slots.items[depth];
+        if (slot.parent == null or slot.parent.? != parent) slot.* = .{ .parent = parent };
+        return slot;
+    }
+
+    fn keep(self: *Self, plan: *const XPathPlan, step: *Step, node: *z.DomNode, out: *std.ArrayList(*z.DomNode)) !void {
+        if (matchesTest(step, node) and try self.passes(plan, step, node, null)) try out.append(self.allocator, node);
+    }
+
+    /// Nodes of the axis from `context` that pass the node test, in axis order
+    fn collect(self: *Self, step: *Step, context: *z.DomNode) !void {
+        switch (step.axis) {
+            .self => if (matchesTest(step, context)) try self.candidates.append(self.allocator, context),
+            .parent => if (z.parentNode(context)) |parent| {
+                if (matchesTest(step, parent)) try self.candidates.append(self.allocator, parent);
+            },
+            .ancestor => {
+                var ancestor = z.parentNode(context);
+                while (ancestor) |node| : (ancestor = z.parentNode(node)) {
+                    if (matchesTest(step, node)) try self.candidates.append(self.allocator, node);
+                }
+            },
+            .descendant, .descendant_or_self => {
+                if (step.axis == .descendant_or_self and matchesTest(step, context)) {
+                    try self.candidates.append(self.allocator, context);
+                }
+                var it = z.iterateDescendants(context);
+                while (it.next()) |node| {
+                    if (matchesTest(step, node)) try self.candidates.append(self.allocator, node);
+                }
+            },
+            .child, .descendant_child => unreachable,
+        }
+    }
+
+    /// Applies the predicates one after the other to `candidates`
+    fn filter(self: *Self, plan: *const XPathPlan, step: *const Step) !void {
+        for (plan.predicates[step.first_predicate..][0..step.predicate_count]) |predicate| {
+            const size = self.candidates.items.len;
+            var kept: usize = 0;
+            for (0..size) |i| {
+                const node = self.candidates.items[i];
+                if (try self.accepts(plan, predicate, .{ .node = node, .position = i + 1, .size = size })) {
+                    self.candidates.items[kept] = node;
+                    kept += 1;
+                }
+            }
+            self.candidates.shrinkRetainingCapacity(kept);
+        }
+    }
+
+    /// Predicates of a step on a child of `slot.parent`; without a slot, positions are not tracked
+    fn passes(self: *Self, plan: *const XPathPlan, step: *Step, node: *z.DomNode, slot: ?*Slot) EvalError!bool {
+        for (plan.predicates[step.first_predicate..][0..step.predicate_count], 0..) |predicate, k| {
+            var position: usize = 0;
+            var size: usize = 0;
+            if (slot) |s| {
+                s.counts[k] += 1;
+                position = s.counts[k];
+                if (predicate.uses_last) size = try self.siblingCount(plan, step, s, k);
+            }
+            if (!try self.accepts(plan, predicate, .{ .node = node, .position = position, .size = size })) return false;
+        }
+        return true;
+    }
+
+    /// Children of `slot.parent` passing the node test and the predicates before `k`, for `last()`
+    fn siblingCount(self: *Self, plan: *const XPathPlan, step: *Step, slot: *Slot, k: usize) EvalError!usize {
+        if (slot.sizes[k]) |size| return size;
+        var counts: [max_predicates]usize = @splat(0);
+        var size: usize = 0;
+        var child = z.firstChild(slot.parent.?);
+        siblings: while (child) |node| : (child = z.nextSibling(node)) {
+            if (!matchesTest(step, node)) continue;
+            for (plan.predicates[step.first_predicate..][0..k], 0..) |predicate, j| {
+                counts[j] += 1;
+                const last = if (predicate.uses_last) try self.siblingCount(plan, step, slot, j) else 0;
+                if (!try self.accepts(plan, predicate, .{ .node = node, .position = counts[j], .size = last })) continue :siblings;
+            }
+            size += 1;
+        }
+        slot.sizes[k] = size;
+        return size;
+    }
+
+    fn accepts(self: *Self, plan: *const XPathPlan, predicate: Predicate, context: Context) EvalError!bool {
+        _ = self.scratch.reset(.retain_capacity);
+        const value = try self.eval(plan, predicate.expr, context);
+        if (predicate.numeric) return (try toNumber(value)) == @as(f64, @floatFromInt(context.position));
+        return toBoolean(value);
+    }
+
+    fn eval(self: *Self, plan: *const XPathPlan, index: u32, context: Context) EvalError!Value {
+        return switch (plan.exprs[index]) {
+            .number => |number| .{ .number = number },
+            .string => |string| .{ .string = string },
+            .nodes => |operand| .{ .nodes = .{
+                .kind = operand.kind,
+                .name = operand.name,
+                .node = context.node,
+                .arena = self.scratch.allocator(),
+            } },
+            .binary => |binary| switch (binary.op) {
+                .@"or" => .{ .boolean = toBoolean(try self.eval(plan, binary.lhs, context)) or
+                    toBoolean(try self.eval(plan, binary.rhs, context)) },
+                .@"and" => .{ .boolean = toBoolean(try self.eval(plan, binary.lhs, context)) and
+                    toBoolean(try self.eval(plan, binary.rhs, context)) },
+                else => .{ .boolean = try compare(
+                    binary.op,
+                    try self.eval(plan, binary.lhs, context),
+                    try self.eval(plan, binary.rhs, context),
+                ) },
+            },
+            .call => |call| try self.callFunction(plan, call, context),
+        };
+    }
+
+    fn callFunction(self: *Self, plan: *const XPathPlan, call: Call, context: Context) EvalError!Value {
+        const args = call.args[0..call.arg_count];
+        switch (call.function) {
+            .position => return .{ .number = @floatFromInt(context.position) },
+            .last => return .{ .number = @floatFromInt(context.size) },
+            .count => {
+                const value = try self.eval(plan, args[0], context);
+                var it = value.nodes.values();
+                var count: usize = 0;
+                while (it.nextNode() != null) count += 1;
+                return .{ .number = @floatFromInt(count) };
+            },
+            .not => return .{ .boolean = !toBoolean(try self.eval(plan, args[0], context)) },
+            .@"true" => return .{ .boolean = true },
+            .@"false" => return .{ .boolean = false },
+            .contains, .starts_with, .ends_with => {
+                const haystack = try self.toString(try self.eval(plan, args[0], context));
+                const needle = try self.toString(try self.eval(plan, args[1], context));
+                return .{ .boolean = switch (call.function) {
+                    .contains => std.mem.indexOf(u8, haystack, needle) != null,
+                    .starts_with => std.mem.startsWith(u8, haystack, needle),
+                    else => std.mem.endsWith(u8, haystack, needle),
+                } };
+            },
+            .normalize_space => {
+                const text = try self.argString(plan, args, context);
+                const arena = self.scratch.allocator();
+                var normalized: std.ArrayList(u8) = .empty;
+                var words = std.mem.tokenizeAny(u8, text, &std.ascii.whitespace);
+                while (words.next()) |word| {
+                    if (normalized.items.len > 0) try normalized.append(arena, ' ');
+                    try normalized.appendSlice(arena, word);
+                }
+                return .{ .string = normalized.items };
+            },
+            .string_length => {
+                const text = try self.argString(plan, args, context);
+                return .{ .number = @floatFromInt(std.unicode.utf8CountCodepoints(text) catch text.len) };
+            },
+            .string => return .{ .string = try self.argString(plan, args, context) },
+            .name, .local_name => {
+                const element = z.nodeToElement(context.node) orelse return .{ .string = "" };
+                return .{ .string = z.qualifiedName_zc(element) };
+            },
+        }
+    }
+
+    /// The first argument as a string, or the string-value of the context node
+    fn argString(self: *Self, plan: *const XPathPlan, args: []const u32, context: Context) EvalError![]const u8 {
+        if (args.len == 0) return stringValue(self.scratch.allocator(), context.node);
+        return self.toString(try self.eval(plan, args[0], context));
+    }
+
+    fn toString(self: *Self, value: Value) EvalError![]const u8 {
+        return switch (value) {
+            .string => |string| string,
+            .boolean => |boolean| if (boolean) "true" else "false",
+            .number => |number| if (number == @trunc(number) and @abs(number) < 1e15)
+                try std.fmt.allocPrint(self.scratch.allocator(), "{d}", .{@as(i64, @intFromFloat(number))})
+            else
+                try std.fmt.allocPrint(self.scratch.allocator(), "{d}", .{number}),
+            .nodes => |nodes| blk: {
+                var it = nodes.values();
+                break :blk (try it.next()) orelse "";
+            },
+        };
+    }
+
+    /// Sorts `nodes` in document order and removes the duplicates
+    fn normalize(self: *Self, nodes: *std.ArrayList(*z.DomNode)) !void {
+        if (nodes.items.len <= 1) return;
+        var set: std.AutoHashMapUnmanaged(*z.DomNode, void) = .empty;
+        defer set.deinit(self.allocator);
+        for (nodes.items) |node| try set.put(self.allocator, node, {});
+
+        const top = treeTop(nodes.items[0]);
+        nodes.clearRetainingCapacity();
+        if (set.remove(top)) nodes.appendAssumeCapacity(top);
+        var it = z.iterateDescendants(top);
+        while (set.count() > 0) {
+            const node = it.next() orelse break;
+            if (set.remove(node)) nodes.appendAssumeCapacity(node);
+        }
+    }
+};
+
+const EvalError = std.mem.Allocator.Error;
+
+const Context = struct {
+    node: *z.DomNode,
+    position: usize,
+    size: usize,
+};
+
+/// Children counted so far under `parent`, per predicate
+const Slot = struct {
+    parent: ?*z.DomNode = null,
+    counts: [max_predicates]usize = @splat(0),
+    sizes: [max_predicates]?usize = @splat(null),
+};
+
+const Value = union(enum) {
+    number: f64,
+    string: []const u8,
+    boolean: bool,
+    nodes: Nodes,
+};
+
+/// A relative operand of a predicate, evaluated from `node`
+const Nodes = struct {
+    kind: NodeKind,
+    name: []const u8,
+    node: *z.DomNode,
+    /// engine scratch, for the string values of elements
+    arena: std.mem.Allocator,
+
+    fn values(self: Nodes) NodeValues {
+        return .{
+            .nodes = self,
+            .current = if (self.kind == .text or self.kind == .child) z.firstChild(self.node) else self.node,
+        };
+    }
+};
+
+/// String values of the nodes of an operand
+const NodeValues = struct {
+    nodes: Nodes,
+    current: ?*z.DomNode,
+
+    fn next(self: *NodeValues) EvalError!?[]const u8 {
+        const node = self.nextNode() orelse return null;
+        if (self.nodes.kind == .attribute) return z.getAttribute_zc(z.nodeToElement(node).?, self.nodes.name);
+        return try stringValue(self.nodes.arena, node);
+    }
+
+    /// Next node of the operand, without its string value; for `@name`, the element holding it
+    fn nextNode(self: *NodeValues) ?*z.DomNode {
+        while (self.current) |node| {
+            switch (self.nodes.kind) {
+                .attribute => {
+                    self.current = null;
+                    const element = z.nodeToElement(node) orelse return null;
+                    return if (z.getAttribute_zc(element, self.nodes.name) != null) node else null;
+                },
+                .self => {
+                    self.current = null;
+                    return node;
+                },
+                .text => {
+                    self.current = z.nextSibling(node);
+                    if (z.nodeTypeId(node) == z.LXB_DOM_NODE_TYPE_TEXT) return node;
+                },
+                .child => {
+                    self.current = z.nextSibling(node);
+                    const element = z.nodeToElement(node) orelse continue;
+                    if (std.mem.eql(u8, self.nodes.name, "*") or
+                        std.ascii.eqlIgnoreCase(z.qualifiedName_zc(element), self.nodes.name)) return node;
+                },
+            }
+        }
+        return null;
+    }
+};
+
+fn matchesTest(step: *Step, node: *z.DomNode) bool {
+    switch (step.node_test) {
+        .node => return true,
+        .text => return z.nodeTypeId(node) == z.LXB_DOM_NODE_TYPE_TEXT,
+        .any_element => return z.nodeTypeId(node) == z.LXB_DOM_NODE_TYPE_ELEMENT,
+        .name => |name| {
+            if (z.nodeTypeId(node) != z.LXB_DOM_NODE_TYPE_ELEMENT) return false;
+            if (step.tag_id != 0) return z.nodeTagId(node) == step.tag_id;
+            if (!std.ascii.eqlIgnoreCase(z.qualifiedName_zc(z.nodeToElement(node).?), name)) return false;
+            const id = z.nodeTagId(node);
+            if (id < z.LXB_TAG__LAST_ENTRY) step.tag_id = id;
+            return true;
+        },
+    }
+}
+
+/// XPath string-value: the data of text and comments, the descendant text of the others.
+///
+/// A single text descendant is returned as is; several are joined in `arena`.
+fn stringValue(arena: std.mem.Allocator, node: *z.DomNode) EvalError![]const u8 {
+    switch (z.nodeTypeId(node)) {
+        z.LXB_DOM_NODE_TYPE_TEXT, z.LXB_DOM_NODE_TYPE_COMMENT => return z.characterData(node),
+        else => {},
+    }
+    var single: ?[]const u8 = null;
+    var joined: std.ArrayList(u8) = .empty;
+    var it = z.iterateDescendants(node);
+    while (it.next()) |descendant| {
+        if (z.nodeTypeId(descendant) != z.LXB_DOM_NODE_TYPE_TEXT) continue;
+        const data = z.characterData(descendant);
+        if (data.len == 0) continue;
+        if (single) |first| {
+            if (joined.items.len == 0) try joined.appendSlice(arena, first);
+            try joined.appendSlice(arena, data);
+        } else single = data;
+    }
+    return if (joined.items.len > 0) joined.items else single orelse "";
+}
+
+fn treeTop(node: *z.DomNode) *z.DomNode {
+    var top = node;
+    while (z.parentNode(top)) |parent| top = parent;
+    return top;
+}
+
+/// True when `node` is a descendant of `ancestor`
+fn isInside(node: *z.DomNode, ancestor: *z.DomNode) bool {
+    var current = z.parentNode(node);
+    while (current) |parent| : (current = z.parentNode(parent)) {
+        if (parent == ancestor) return true;
+    }
+    return false;
+}
+
+fn toBoolean(value: Value) bool {
+    return switch (value) {
+        .boolean => |boolean| boolean,
+        .number => |number| number != 0 and !std.math.isNan(number),
+        .string => |string| string.len > 0,
+        .nodes => |nodes| blk: {
+            var it = nodes.values();
+            break :blk it.nextNode() != null;
+        },
+    };
+}
+
+fn toNumber(value: Value) EvalError!f64 {
+    return switch (value) {
+        .number => |number| number,
+        .boolean => |boolean| if (boolean) 1 else 0,
+        .string => |string| parseNumber(string),
+        .nodes => |nodes| blk: {
+            var it = nodes.values();
+            break :blk if (try it.next()) |string| parseNumber(string) else std.math.nan(f64);
+        },
+    };
+}
+
+fn parseNumber(text: []const u8) f64 {
+    const trimmed = std.mem.trim(u8, text, &std.ascii.whitespace);
+    if (trimmed.len == 0) return std.math.nan(f64);
+    return std.fmt.parseFloat(f64, trimmed) catch std.math.nan(f64);
+}
+
+/// XPath 1.0 comparison; an operand with nodes compares each of its string values
+fn compare(op: Op, lhs: Value, rhs: Value) EvalError!bool {
+    const equality = op == .eq or op == .ne;
+    if (equality and (lhs == .boolean or rhs == .boolean)) {
+        return (toBoolean(lhs) == toBoolean(rhs)) == (op == .eq);
+    }
+    if (lhs == .nodes) {
+        var it = lhs.nodes.values();
+        while (try it.next()) |string| if (try compare(op, .{ .string = string }, rhs)) return true;
+        return false;
+    }
+    if (rhs == .nodes) {
+        var it = rhs.nodes.values();
+        while (try it.next()) |string| if (try compare(op, lhs, .{ .string = string })) return true;
+        return false;
+    }
+    if (equality) {
+        const equal = if (lhs == .number or rhs == .number)
+            (try toNumber(lhs)) == (try toNumber(rhs))
+        else
+            std.mem.eql(u8, lhs.string, rhs.string);
+        return equal == (op == .eq);
+    }
+    const a = try toNumber(lhs);
+    const b = try toNumber(rhs);
+    return switch (op) {
+        .lt => a < b,
+        .le => a <= b,
+        .gt => a > b,
+        .ge => a >= b,
+        else => unreachable,
+    };
+}
+
+const ParseError = Err || std.mem.Allocator.Error;
+
+const Parser = struct {
+    allocator: std.mem.Allocator,
+    source: []const u8,
+    pos: usize = 0,
+    absolute: bool = false,
+    attribute: ?[]const u8 = null,
+    steps: std.ArrayList(Step) = .empty,
+    predicates: std.ArrayList(Predicate) = .empty,
+    exprs: std.ArrayList(Expr) = .empty,
+
+    fn deinit(self: *Parser) void {
+        self.steps.deinit(self.allocator);
+        self.predicates.deinit(self.allocator);
+        self.exprs.deinit(self.allocator);
+    }
+
+    fn path(self: *Parser) ParseError!void {
+        var descendant = false;
+        if (self.eat("//")) {
+            self.absolute = true;
+            descendant = true;
+        } else if (self.eat("/")) {
+            self.absolute = true;
+            if (self.atEnd()) return;
+        }
+        while (true) {
+            try self.step(descendant);
+            if (self.eat("//")) {
+                descendant = true;
+            } else if (self.eat("/")) {
+                descendant = false;
+            } else break;
+            // `@name` must be the last step
+            if (self.attribute != null) return Err.XPathParseFailed;
+        }
+        if (!self.atEnd()) return Err.XPathParseFailed;
+    }
+
+    fn step(self: *Parser, descendant: bool) ParseError!void {
+        var axis: Axis = .child;
+        var node_test: NodeTest = .node;
+        if (self.eat("..")) {
+            axis = .parent;
+        } else if (self.eat(".")) {
+            axis = .self;
+        } else {
+            var attribute = self.eat("@");
+            if (!attribute) {
+                const start = self.pos;
+                if (self.name()) |word| {
+                    if (self.eat("::")) {
+                        if (std.mem.eql(u8, word, "attribute")) {
+                            attribute = true;
+                        } else axis = axes.get(word) orelse return Err.XPathParseFailed;
+                    } else self.pos = start;
+                }
+            }
+            if (attribute) {
+                if (descendant) try self.steps.append(self.allocator, .{ .axis = .descendant_or_self, .node_test = .node });
+                self.attribute = self.name() orelse return Err.XPathParseFailed;
+                return;
+            }
+            node_test = try self.nodeTest();
+        }
+
+        var new_step: Step = .{ .axis = axis, .node_test = node_test, .first_predicate = self.predicates.items.len };
+        while (self.eat("[")) {
+            const root = try self.orExpr();
+            if (!self.eat("]")) return Err.XPathParseFailed;
+            const predicate = self.predicateOf(root);
+            new_step.positional = new_step.positional or predicate.numeric or predicate.uses_last or self.uses(root, .position);
+            try self.predicates.append(self.allocator, predicate);
+        }
+        new_step.predicate_count = self.predicates.items.len - new_step.first_predicate;
+        if (new_step.predicate_count > max_predicates) return Err.XPathParseFailed;
+
+        if (descendant) {
+            if (axis == .child) {
+                new_step.axis = .descendant_child;
+            } else try self.steps.append(self.allocator, .{ .axis = .descendant_or_self, .node_test = .node });
+        }
+        try self.steps.append(self.allocator, new_step);
+    }
+
+    fn nodeTest(self: *Parser) ParseError!NodeTest {
+        if (self.eat("*")) return .any_element;
+        const word = self.name() orelse return Err.XPathParseFailed;
+        if (!self.eat("(")) return .{ .name = word };
+        if (!self.eat(")")) return Err.XPathParseFailed;
+        if (std.mem.eql(u8, word, "text")) return .text;
+        if (std.mem.eql(u8, word, "node")) return .node;
+        return Err.XPathParseFailed;
+    }
+
+    fn predicateOf(self: *const Parser, root: u32) Predicate {
+        const numeric = switch (self.exprs.items[root]) {
+            .number => true,
+            .call => |call| switch (call.function) {
+                .position, .last, .count, .string_length => true,
+                else => false,
+            },
+            else => false,
+        };
+        return .{ .expr = root, .numeric = numeric, .uses_last = self.uses(root, .last) };
+    }
+
+    fn uses(self: *const Parser, index: u32, function: Function) bool {
+        return switch (self.exprs.items[index]) {
+            .binary => |binary| self.uses(binary.lhs, function) or self.uses(binary.rhs, function),
+            .call => |call| blk: {
+                if (call.function == function) break :blk true;
+                for (call.args[0..call.arg_count]) |arg| {
+                    if (self.uses(arg, function)) break :blk true;
+                }
+                break :blk false;
+            },
+            else => false,
+        };
+    }
+
+    fn orExpr(self: *Parser) ParseError!u32 {
+        var lhs = try self.andExpr();
+        while (self.eatWord("or")) {
+            const rhs = try self.andExpr();
+            lhs = try self.add(.{ .binary = .{ .op = .@"or", .lhs = lhs, .rhs = rhs } });
+        }
+        return lhs;
+    }
+
+    fn andExpr(self: *Parser) ParseError!u32 {
+        var lhs = try self.equality();
+        while (self.eatWord("and")) {
+            const rhs = try self.equality();
+            lhs = try self.add(.{ .binary = .{ .op = .@"and", .lhs = lhs, .rhs = rhs } });
+        }
+        return lhs;
+    }
+
+    fn equality(self: *Parser) ParseError!u32 {
+        const lhs = try self.relational();
+        const op: Op = if (self.eat("!=")) .ne else if (self.eat("=")) .eq else return lhs;
+        const rhs = try self.relational();
+        return self.add(.{ .binary = .{ .op = op, .lhs = lhs, .rhs = rhs } });
+    }
+
+    fn relational(self: *Parser) ParseError!u32 {
+        const lhs = try self.primary();
+        const op: Op = if (self.eat("<="))
+            .le
+        else if (self.eat("<"))
+            .lt
+        else if (self.eat(">="))
+            .ge
+        else if (self.eat(">"))
+            .gt
+        else
+            return lhs;
+        const rhs = try self.primary();
+        return self.add(.{ .binary = .{ .op = op, .lhs = lhs, .rhs = rhs } });
+    }
+
+    fn primary(self: *Parser) ParseError!u32 {
+        if (self.atEnd()) return Err.XPathParseFailed;
+        const c = self.source[self.pos];
+        if (c == '\'' or c == '"') {
+            const end = std.mem.indexOfScalarPos(u8, self.source, self.pos + 1, c) orelse return Err.XPathParseFailed;
+            const literal = self.source[self.pos + 1 .. end];
+            self.pos = end + 1;
+            return self.add(.{ .string = literal });
+        }
+        if (std.ascii.isDigit(c) or (c == '.' and self.pos + 1 < self.source.len and std.ascii.isDigit(self.source[self.pos + 1]))) {
+            const start = self.pos;
+            while (self.pos < self.source.len and (std.ascii.isDigit(self.source[self.pos]) or self.source[self.pos] == '.')) self.pos += 1;
+            const number = std.fmt.parseFloat(f64, self.source[start..self.pos]) catch return Err.XPathParseFailed;
+            return self.add(.{ .number = number });
+        }
+        if (self.eat("(")) {
+            const inner = try self.orExpr();
+            if (!self.eat(")")) return Err.XPathParseFailed;
+            return inner;
+        }
+        if (self.eat("@")) {
+            const attribute = self.name() orelse return Err.XPathParseFailed;
+            return self.add(.{ .nodes = .{ .kind = .attribute, .name = attribute } });
+        }
+        if (self.eat("..")) return Err.XPathParseFailed;
+        if (self.eat(".")) return self.add(.{ .nodes = .{ .kind = .self } });
+        if (self.eat("*")) return self.add(.{ .nodes = .{ .kind = .child, .name = "*" } });
+
+        const word = self.name() orelse return Err.XPathParseFailed;
+        if (!self.eat("(")) return self.add(.{ .nodes = .{ .kind = .child, .name = word } });
+        if (std.mem.eql(u8, word, "text")) {
+            if (!self.eat(")")) return Err.XPathParseFailed;
+            return self.add(.{ .nodes = .{ .kind = .text } });
+        }
+        var call: Call = .{ .function = functions.get(word) orelse return Err.XPathParseFailed };
+        if (!self.eat(")")) {
+            while (true) {
+                if (call.arg_count == call.args.len) return Err.XPathParseFailed;
+                call.args[call.arg_count] = try self.orExpr();
+                call.arg_count += 1;
+                if (self.eat(")")) break;
+                if (!self.eat(",")) return Err.XPathParseFailed;
+            }
+        }
+        const bounds = arity(call.function);
+        if (call.arg_count < bounds[0] or call.arg_count > bounds[1]) return Err.XPathParseFailed;
+        if (call.function == .count and self.exprs.items[call.args[0]] != .nodes) return Err.XPathParseFailed;
+        return self.add(.{ .call = call });
+    }
+
+    fn add(self: *Parser, expr: Expr) ParseError!u32 {
+        try self.exprs.append(self.allocator, expr);
+        return @intCast(self.exprs.items.len - 1);
+    }
+
+    fn skipSpace(self: *Parser) void {
+        while (self.pos < self.source.len and std.ascii.isWhitespace(self.source[self.pos])) self.pos += 1;
+    }
+
+    fn atEnd(self: *Parser) bool {
+        self.skipSpace();
+        return self.pos >= self.source.len;
+    }
+
+    fn eat(self: *Parser, literal: []const u8) bool {
+        self.skipSpace();
+        if (!std.mem.startsWith(u8, self.source[self.pos..], literal)) return false;
+        self.pos += literal.len;
+        return true;
+    }
+
+    /// `eat` for an operator name, not the start of a longer name
+    fn eatWord(self: *Parser, word: []const u8) bool {
+        self.skipSpace();
+        if (!std.mem.startsWith(u8, self.source[self.pos..], word)) return false;
+        const end = self.pos + word.len;
+        if (end < self.source.len and isNameChar(self.source[end])) return false;
+        self.pos = end;
+        return true;
+    }
+
+    fn name(self: *Parser) ?[]const u8 {
+        self.skipSpace();
+        const start = self.pos;
+        if (start >= self.source.len or !(std.ascii.isAlphabetic(self.source[start]) or self.source[start] == '_')) return null;
+        while (self.pos < self.source.len and isNameChar(self.source[self.pos])) self.pos += 1;
+        return self.source[start..self.pos];
+    }
+};
+
+fn isNameChar(c: u8) bool {
+    return std.ascii.isAlphanumeric(c) or c == '-' or c == '_' or c == '.';
+}
+
+test "XPathEngine" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<div id="main">
+        \\  <ul class="menu"><li><a href="/a">Alpha</a></li><li class="x"><a href="/b"> Beta  item </a></li><li><a>Gamma</a></li></ul>
+        \\  <table><tbody><tr><td>1</td><td>2</td></tr><tr><td>3</td><td>4</td></tr></tbody></table>
+        \\  <div><p>one</p><div><p>two</p></div></div>
+        \\</div>
+    );
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    var engine: XPathEngine = .init(allocator);
+    defer engine.deinit();
+
+    const Case = struct { xpath: []const u8, values: []const []const u8 };
+    const cases = [_]Case{
+        .{ .xpath = "//li", .values = &.{ "Alpha", "Beta  item", "Gamma" } },
+        .{ .xpath = "//li[2]/a", .values = &.{"Beta  item"} },
+        .{ .xpath = "//a[normalize-space(.) = 'Beta item']/@href", .values = &.{"/b"} },
+        .{ .xpath = "//a/@href", .values = &.{ "/a", "/b" } },
+        .{ .xpath = "//a[not(@href)]", .values = &.{"Gamma"} },
+        .{ .xpath = "//tr/td[1]", .values = &.{ "1", "3" } },
+        .{ .xpath = "//td[2]", .values = &.{ "2", "4" } },
+        .{ .xpath = "//tr[last()]/td[last()]", .values = &.{"4"} },
+        .{ .xpath = "//td[. > 1 and . < 4]", .values = &.{ "2", "3" } },
+        .{ .xpath = "/html/body/div[@id='main']/ul/li[@class='x']", .values = &.{"Beta  item"} },
+        .{ .xpath = "//li[position() > 1 and contains(a, 'a')]", .values = &.{ "Beta  item", "Gamma" } },
+        .{ .xpath = "//ul[count(li) = 3]/li[starts-with(., 'Al')]", .values = &.{"Alpha"} },
+        .{ .xpath = "//li/a/text()", .values = &.{ "Alpha", "Beta  item", "Gamma" } },
+        .{ .xpath = "//div//p", .values = &.{ "one", "two" } },
+        .{ .xpath = "//p/..", .values = &.{ "onetwo", "two" } },
+        .{ .xpath = "//p[. = 'two']/ancestor::div[@id]/@id", .values = &.{"main"} },
+        .{ .xpath = "li", .values = &.{} },
+        .{ .xpath = ".//*[name() = 'p'][1]", .values = &.{ "one", "two" } },
+    };
+    for (cases) |case| {
+        const values = try engine.selectValues(body, case.xpath);
+        defer allocator.free(values);
+        testing.expectEqual(case.values.len, values.len) catch |err| {
+            print("{s}: {d} values\n", .{ case.xpath, values.len });
+            return err;
+        };
+        for (case.values, values) |expected, actual| {
+            try testing.expectEqualStrings(expected, std.mem.trim(u8, actual, "\n "));
+        }
+    }
+
+    // nodes, document order
+    const ancestors = try engine.select(body, "//p[. = 'two']/ancestor::div");
+    defer allocator.free(ancestors);
+    try testing.expectEqual(3, ancestors.len);
+    try testing.expectEqualStrings("main", z.getAttribute_zc(z.nodeToElement(ancestors[0]).?, "id").?);
+
+    // plans are cached and learn the tag id of their names
+    const plan = try engine.compile("//li");
+    try testing.expect(plan.steps[0].tag_id != 0);
+    try testing.expectEqual(cases.len + 1, engine.plan_cache.count());
+
+    try testing.expectError(Err.XPathAttributeResult, engine.select(body, "//a/@href"));
+    for ([_][]const u8{ "//a[", "//a | //b", "foo::a", "//a/@href/b", "//a[@href = ]", "//li[contains(.)]" }) |bad| {
+        try testing.expectError(Err.XPathParseFailed, engine.select(body, bad));
+    }
+
+    const cells = try xpathSelect(allocator, doc, "//td");
+    defer allocator.free(cells);
+    try testing.expectEqual(4, cells.len);
+}
+
+test "XPathEngine string values do not grow with repeated queries" {
+    const allocator = testing.allocator;
+    const doc = try z.createDocFromString(
+        \\<ul><li>Alpha <b>one</b></li><li>Beta <b>two</b></li><li>Gamma</li></ul>
+    );
+    defer z.destroyDocument(doc);
+    const body = z.bodyNode(doc).?;
+
+    var engine: XPathEngine = .init(allocator);
+    defer engine.deinit();
+
+    var capacity: usize = 0;
+    for (0..100) |i| {
+        const values = try engine.selectValues(body, "//li[contains(., 'a ')]");
+        defer allocator.free(values);
+        try testing.expectEqual(2, values.len);
+        try testing.expectEqualStrings("Alpha one", values[0]);
+        try testing.expectEqualStrings("Beta two", values[1]);
+
+        // the joined values reuse the engine scratch, merged into one buffer after the first reset
+        if (i == 1) capacity = engine.scratch.queryCapacity();
+        if (i > 1) try testing.expectEqual(capacity, engine.scratch.queryCapacity());
+    }
+}
@@ -21,6 +21,23 @@ const sanitize = @import("modules/sanitizer.zig");
 const parse = @import("modules/parsing.zig");
 const colours = @import("modules/colours.zig");
 const html_spec = @import("modules/html_spec.zig");
+const dedupe = @import("modules/dedupe.zig");
+const urls = @import("modules/url.zig");
+const links = @import("modules/links.zig");
+const inliner = @import("modules/css_inliner.zig");
+const layout = @import("modules/dom_layout.zig");
+const flat_dom = @import("modules/flat_dom.zig");
+const doc_copy = @import("modules/document_copy.zig");
+const mutation = @import("modules/mutation.zig");
+const serialize_cache = @import("modules/serialize_cache.zig");
+const markdown = @import("modules/markdown.zig");
+const plain_text = @import("modules/plain_text.zig");
+const canonical = @import("modules/canonical.zig");
+const structured_data = @import("modules/structured_data.zig");
+const tables = @import("modules/tables.zig");
+const text_search = @import("modules/text_search.zig");
+const xpath = @import("modules/xpath.zig");
+const forms = @import("modules/forms.zig");
 
 // Re-export commonly used types
 pub const Err = @import("errors.zig").LexborError;
@@ -33,9 +50,32 @@ pub const _STOP: c_int = 1;
 pub const _OK: usize = 0;
 
 // from lexbor source: /tag/const.h
-pub const LXB_TAG_TEMPLATE: u32 = 179; // From lexbor source
-pub const LXB_TAG_STYLE: u32 = 171;
-pub const LXB_TAG_SCRIPT: u32 = 162;
+pub const LXB_TAG_BODY: u32 = 0x001f;
+pub const LXB_TAG_BR: u32 = 0x0020;
+pub const LXB_TAG_BUTTON: u32 = 0x0021;
+pub const LXB_TAG_CODE: u32 = 0x0027;
+pub const LXB_TAG_DATALIST: u32 = 0x002b;
+pub const LXB_TAG_FIELDSET: u32 = 0x0051;
+pub const LXB_TAG_HEAD: u32 = 0x0061;
+pub const LXB_TAG_INPUT: u32 = 0x006a;
+pub const LXB_TAG_LEGEND: u32 = 0x0070;
+pub const LXB_TAG_META: u32 = 0x007c;
+pub const LXB_TAG_OPTGROUP: u32 = 0x008e;
+pub const LXB_TAG_OPTION: u32 = 0x008f;
+pub const LXB_TAG_PRE: u32 = 0x0096;
+pub const LXB_TAG_SCRIPT: u32 = 0x00a1;
+pub const LXB_TAG_SELECT: u32 = 0x00a3;
+pub const LXB_TAG_STYLE: u32 = 0x00ab;
+pub const LXB_TAG_TBODY: u32 = 0x00b1;
+pub const LXB_TAG_TD: u32 = 0x00b2;
+pub const LXB_TAG_TEMPLATE: u32 = 0x00b3;
+pub const LXB_TAG_TEXTAREA: u32 = 0x00b4;
+pub const LXB_TAG_TFOOT: u32 = 0x00b6;
+pub const LXB_TAG_TH: u32 = 0x00b7;
+pub const LXB_TAG_THEAD: u32 = 0x00b8;
+pub const LXB_TAG_TR: u32 = 0x00bb;
+/// ids of the known HTML tags are below it, and the same in every document
+pub const LXB_TAG__LAST_ENTRY: u32 = 0x00c4;
 
 pub const LXB_DOM_NODE_TYPE_ELEMENT: u32 = 1;
 pub const LXB_DOM_NODE_TYPE_TEXT: u32 = 3;
@@ -62,7 +102,8 @@ pub const HtmlParser = opaque {};
 pub const CssParser = opaque {};
 pub const CssSelectors = opaque {};
 pub const CssSelectorList = opaque {};
-pub const CssSelectorSpecificity = opaque {};
+/// lexbor packs specificity in a u32: important | style | a (ids) | b (classes) | c (types)
+pub const CssSelectorSpecificity = u32;
 
 //=========================================================================================================
 // Core
@@ -80,6 +121,7 @@ pub const createTextNode = lxb.createTextNode;
 
 pub const removeNode = lxb.removeNode;
 pub const destroyNode = lxb.destroyNode;
+pub const destroyNode_deep = lxb.destroyNode_deep;
 // pub const destroyElement = lxb.destroyElement;
 
 // DOM access
@@ -121,6 +163,13 @@ pub const isWhitespaceOnlyText = lxb.isWhitespaceOnlyText;
 // NodeTypes
 
 pub const NodeType = Type.NodeType;
+pub const nodeTypeId = layout.nodeTypeId;
+pub const nodeTagId = layout.tagId;
+pub const isHtmlTag = layout.isHtmlTag;
+pub const characterData = layout.characterData;
+pub const isQuirksMode = layout.isQuirksMode;
+pub const DomNodeLayout = layout.DomNodeLayout;
+pub const DomElementLayout = layout.DomElementLayout;
 pub const nodeType = Type.nodeType;
 pub const nodeTypeName = Type.nodeTypeName;
 
@@ -183,6 +232,7 @@ pub const escapeHtml = text.escapeHtml;
 pub const isWhitespaceOnly = norm.isWhitespaceOnly;
 pub const normalizeDOM = norm.normalizeDOM;
 pub const normalizeDOMwithOptions = norm.normalizeDOMwithOptions;
+pub const NormalizeOptions = norm.NormalizeOptions;
 
 pub const normalizeDOMForDisplay = norm.normalizeDOMForDisplay;
 
@@ -220,11 +270,26 @@ pub const appendChildren = lxb.appendChildren;
 
 pub const childNodes = lxb.childNodes;
 pub const children = lxb.children;
+pub const childElementCount = lxb.childElementCount;
+
+// Non-allocating iterators
+pub const ChildIterator = lxb.ChildIterator;
+pub const ElementChildIterator = lxb.ElementChildIterator;
+pub const AncestorIterator = lxb.AncestorIterator;
+pub const SiblingIterator = lxb.SiblingIterator;
+pub const DescendantIterator = lxb.DescendantIterator;
+pub const iterateChildren = lxb.iterateChildren;
+pub const iterateElementChildren = lxb.iterateElementChildren;
+pub const iterateAncestors = lxb.iterateAncestors;
+pub const iterateFollowingSiblings = lxb.iterateFollowingSiblings;
+pub const iteratePrecedingSiblings = lxb.iteratePrecedingSiblings;
+pub const iterateDescendants = lxb.iterateDescendants;
 
 //=========================================================================================================
 // Stream parser for chunk processing
 
 pub const Stream = chunks.Stream;
+pub const StreamPool = chunks.StreamPool;
 
 //=========================================================================================================
 // Parser
@@ -270,10 +335,16 @@ pub const innerTemplateHTML = frag_temp.innerTemplateHTML;
 pub const innerHTML = serialize.innerHTML;
 pub const outerHTML = serialize.outerHTML;
 pub const outerNodeHTML = serialize.outerNodeHTML;
+pub const serializeTo = serialize.serializeTo;
+pub const serializeShallowTo = serialize.serializeShallowTo;
+pub const serializeNodesTo = serialize.serializeNodesTo;
+pub const serializeMatches = serialize.serializeMatches;
 
 // Debug printing utilities
 pub const printDocStruct = serialize.printDocStruct;
 pub const prettyPrint = serialize.prettyPrint;
+pub const prettyPrintTo = serialize.prettyPrintTo;
+pub const PrettyOptions = serialize.PrettyOptions;
 //=========================================================================================================
 // Colouring and syntax highlighting
 pub const ElementStyles = colours.ElementStyles;
@@ -311,11 +382,21 @@ pub const isFrameworkAttributeSafe = specs.isFrameworkAttributeSafe;
 
 pub const CssSelectorEngine = css.CssSelectorEngine;
 pub const createCssEngine = css.createCssEngine;
+pub const ResultCacheOptions = css.ResultCacheOptions;
+pub const ResultCacheStats = css.ResultCacheStats;
+pub const SelectorProfile = css.SelectorProfile;
+pub const ProfileSort = css.ProfileSort;
 
 pub const querySelectorAll = css.querySelectorAll;
 pub const querySelector = css.querySelector;
 pub const filter = css.filter;
 
+// XPath
+pub const XPathEngine = xpath.XPathEngine;
+pub const XPathPlan = xpath.XPathPlan;
+pub const compileXPath = xpath.compileXPath;
+pub const xpathSelect = xpath.xpathSelect;
+
 //=========================================================================================================
 // Class & ClassList
 
@@ -342,6 +423,8 @@ pub const removeAttribute = attrs.removeAttribute;
 
 pub const setAttributes = attrs.setAttributes;
 pub const getAttributes_bf = attrs.getAttributes_bf;
+pub const AttributeIterator = attrs.AttributeIterator;
+pub const iterateAttributes = attrs.iterateAttributes;
 
 pub const getElementId = attrs.getElementId;
 pub const getElementId_zc = attrs.getElementId_zc;
@@ -375,6 +458,121 @@ pub const genProcessAll = walker.genProcessAll;
 pub const genSearchElement = walker.genSearchElement;
 pub const genSearchElements = walker.genSearchElements;
 
+//=========================================================================================================
+// Structural hashing & duplicate subtrees
+
+pub const SubtreeHash = dedupe.SubtreeHash;
+pub const DedupeOptions = dedupe.DedupeOptions;
+pub const Duplicate = dedupe.Duplicate;
+pub const SubtreeIndex = dedupe.SubtreeIndex;
+pub const structuralHash = dedupe.structuralHash;
+
+// Canonical serialization
+pub const CanonicalOptions = canonical.CanonicalOptions;
+pub const canonicalSerializeTo = canonical.canonicalSerializeTo;
+pub const canonicalHash = canonical.canonicalHash;
+pub const HashingWriter = canonical.HashingWriter;
+
+//=========================================================================================================
+// URL parsing (lexbor/url) & link extraction
+
+pub const Url = urls.Url;
+pub const UrlParser = urls.UrlParser;
+pub const UrlSpan = urls.UrlSpan;
+pub const SrcsetIterator = urls.SrcsetIterator;
+pub const iterateSrcset = urls.iterateSrcset;
+pub const CssUrlIterator = urls.CssUrlIterator;
+pub const iterateCssUrls = urls.iterateCssUrls;
+
+pub const Idna = urls.Idna;
+pub const punycodeEncode = urls.punycodeEncode;
+pub const punycodeDecode = urls.punycodeDecode;
+pub const UrlNormalizeOptions = urls.UrlNormalizeOptions;
+pub const UrlNormalizer = urls.UrlNormalizer;
+pub const UrlSet = urls.UrlSet;
+
+pub const Link = links.Link;
+pub const LinkOptions = links.LinkOptions;
+pub const LinkList = links.LinkList;
+pub const LinkExtractor = links.LinkExtractor;
+pub const extractLinks = links.extractLinks;
+pub const UrlRewriteInput = links.UrlRewriteInput;
+pub const rewriteUrls = links.rewriteUrls;
+
+//=========================================================================================================
+// CSS inlining for HTML email
+
+pub const CssInliner = inliner.CssInliner;
+pub const InlineOptions = inliner.InlineOptions;
+pub const InlineStats = inliner.InlineStats;
+pub const inlineStyles = inliner.inlineStyles;
+
+//=========================================================================================================
+// Flat structure-of-arrays DOM view
+
+pub const FlatDom = flat_dom.FlatDom;
+pub const FlatNodeIndex = flat_dom.NodeIndex;
+pub const FlatRange = flat_dom.Range;
+pub const FlatSpan = flat_dom.Span;
+pub const FlatAttribute = flat_dom.FlatAttribute;
+
+//=========================================================================================================
+// Document compaction & copies
+
+pub const CompactOptions = doc_copy.CompactOptions;
+pub const CompactedDocument = doc_copy.CompactedDocument;
+pub const compactDocument = doc_copy.compactDocument;
+pub const forkDocument = doc_copy.forkDocument;
+
+//=========================================================================================================
+// Mutation notifications & serialization cache
+
+pub const MutationKind = mutation.MutationKind;
+pub const Mutation = mutation.Mutation;
+pub const MutationObserver = mutation.MutationObserver;
+pub const addMutationObserver = mutation.addMutationObserver;
+pub const documentOf = mutation.documentOf;
+pub const removeMutationObserver = mutation.removeMutationObserver;
+pub const MutationRecord = mutation.MutationRecord;
+pub const MutationRecorder = mutation.MutationRecorder;
+pub const MutationRecorderOptions = mutation.MutationRecorderOptions;
+
+pub const SerializeCache = serialize_cache.SerializeCache;
+pub const SerializeCacheOptions = serialize_cache.SerializeCacheOptions;
+pub const SerializeCacheStats = serialize_cache.SerializeCacheStats;
+
+//=========================================================================================================
+// Text extraction
+
+pub const toMarkdown = markdown.toMarkdown;
+pub const MarkdownOptions = markdown.MarkdownOptions;
+pub const toPlainText = plain_text.toPlainText;
+pub const PlainTextOptions = plain_text.PlainTextOptions;
+pub const LinkStyle = plain_text.LinkStyle;
+pub const extractStructuredData = structured_data.extractStructuredData;
+pub const StructuredDataCounts = structured_data.StructuredDataCounts;
+pub const extractTable = tables.extractTable;
+pub const extractTableTo = tables.extractTableTo;
+pub const Table = tables.Table;
+pub const TableOptions = tables.TableOptions;
+pub const TableFormat = tables.TableFormat;
+pub const TableSection = tables.TableSection;
+
+// Text search
+pub const findText = text_search.findText;
+pub const findTextAll = text_search.findTextAll;
+pub const FindTextOptions = text_search.FindTextOptions;
+pub const TextMatch = text_search.TextMatch;
+
+// Forms
+pub const collectForm = forms.collectForm;
+pub const iterateForm = forms.iterateForm;
+pub const serializeForm = forms.serializeForm;
+pub const writeFormUrlEncoded = forms.writeFormUrlEncoded;
+pub const FormEntry = forms.FormEntry;
+pub const FormData = forms.FormData;
+pub const FormIterator = forms.FormIterator;
+
 //=========================================================================================================
 // Utilities
 pub const stringContains = search.stringContains;